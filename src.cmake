@@ -33,6 +33,7 @@ set(COMMONLIST
     ${COMMON_DIR}/Endian.h
     ${COMMON_DIR}/FileSystem.cpp
     ${COMMON_DIR}/FileSystem.h
+    ${COMMON_DIR}/IPC/Channel.cpp
     ${COMMON_DIR}/IPC/Channel.h
     ${COMMON_DIR}/IPC/CommandBuffer.cpp
     ${COMMON_DIR}/IPC/CommandBuffer.h
@@ -47,11 +48,14 @@ set(COMMONLIST
     ${COMMON_DIR}/Math.h
     ${COMMON_DIR}/Optional.h
     ${COMMON_DIR}/Platform.h
+    ${COMMON_DIR}/Serialize.cpp
     ${COMMON_DIR}/Serialize.h
     ${COMMON_DIR}/String.cpp
     ${COMMON_DIR}/String.h
     ${COMMON_DIR}/System.cpp
     ${COMMON_DIR}/System.h
+    ${COMMON_DIR}/ThreadPool.cpp
+    ${COMMON_DIR}/ThreadPool.h
     ${COMMON_DIR}/Util.h
     ${COMMON_DIR}/cm/cm_load.cpp
     ${COMMON_DIR}/cm/cm_local.h
@@ -112,6 +116,7 @@ set(RENDERERLIST
     ${ENGINE_DIR}/renderer/tr_model_skel.cpp
     ${ENGINE_DIR}/renderer/tr_model_skel.h
     ${ENGINE_DIR}/renderer/tr_noise.cpp
+    ${ENGINE_DIR}/renderer/tr_occlusion.cpp
     ${ENGINE_DIR}/renderer/tr_public.h
     ${ENGINE_DIR}/renderer/tr_scene.cpp
     ${ENGINE_DIR}/renderer/tr_shade.cpp
@@ -119,6 +124,7 @@ set(RENDERERLIST
     ${ENGINE_DIR}/renderer/tr_shade_calc.cpp
     ${ENGINE_DIR}/renderer/tr_skin.cpp
     ${ENGINE_DIR}/renderer/tr_sky.cpp
+    ${ENGINE_DIR}/renderer/tr_sort.cpp
     ${ENGINE_DIR}/renderer/tr_surface.cpp
     ${ENGINE_DIR}/renderer/tr_types.h
     ${ENGINE_DIR}/renderer/tr_vbo.cpp
@@ -37,6 +37,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #endif
 
 #include "IPC/CommonSyscalls.h"
+#include "ThreadPool.h"
 
 #ifdef _WIN32
 #include <windows.h>
@@ -53,6 +54,9 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <fcntl.h>
 #include <dirent.h>
 #include <unistd.h>
+#ifndef __native_client__
+#include <sys/mman.h>
+#endif
 #endif
 #ifdef __APPLE__
 #include <mach-o/dyld.h>
@@ -282,6 +286,72 @@ inline intptr_t my_pread(int fd, void* buf, size_t count, offset_t offset)
 #endif
 }
 
+
+// Read-only mapping of a whole file, unmapped when the last reference goes away.
+// The mapping remains valid after the file descriptor is closed.
+class MappedRegion {
+public:
+	MappedRegion(const void* base, size_t length)
+		: base(base), length(length) {}
+	~MappedRegion()
+	{
+#ifdef _WIN32
+		UnmapViewOfFile(base);
+#elif !defined(__native_client__)
+		munmap(const_cast<void*>(base), length);
+#endif
+	}
+
+	MappedRegion(const MappedRegion&) = delete;
+	MappedRegion& operator=(const MappedRegion&) = delete;
+
+	const char* Data() const
+	{
+		return static_cast<const char*>(base);
+	}
+	size_t Length() const
+	{
+		return length;
+	}
+
+private:
+	const void* base;
+	size_t length;
+};
+
+// Map an entire file into memory. Returns null if the platform doesn't support
+// it or the mapping failed (e.g. empty file or lack of address space), in which
+// case the caller should fall back to reading the file normally.
+static std::shared_ptr<MappedRegion> my_mmap(int fd)
+{
+	my_stat_t st;
+	if (my_fstat(fd, &st) == -1 || st.st_size <= 0)
+		return nullptr;
+	if (static_cast<uint64_t>(st.st_size) > std::numeric_limits<size_t>::max())
+		return nullptr;
+	size_t length = st.st_size;
+
+#ifdef _WIN32
+	HANDLE mapping = CreateFileMappingW(reinterpret_cast<HANDLE>(_get_osfhandle(fd)), NULL, PAGE_READONLY, 0, 0, NULL);
+	if (!mapping)
+		return nullptr;
+	void* base = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, length);
+	CloseHandle(mapping);
+	if (!base)
+		return nullptr;
+	return std::make_shared<MappedRegion>(base, length);
+#elif defined(__native_client__)
+	// NaCl only supports mapping shared memory objects
+	Q_UNUSED(length);
+	return nullptr;
+#else
+	void* base = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (base == MAP_FAILED)
+		return nullptr;
+	return std::make_shared<MappedRegion>(base, length);
+#endif
+}
+
 // std::error_code support for minizip
 class minizip_category_impl: public std::error_category
 {
@@ -943,6 +1013,30 @@ private:
 
 } // GCC bug workaround
 
+// Helper to construct FileView objects, which have no public constructor
+class FileViewBuilder {
+public:
+	static FileView FromMapping(std::shared_ptr<const MappedRegion> region, size_t offset, size_t length)
+	{
+		FileView out;
+		out.ptr = region->Data() + offset;
+		out.len = length;
+		out.mapped = true;
+		out.owner = std::move(region);
+		return out;
+	}
+	static FileView FromString(std::string data)
+	{
+		std::shared_ptr<std::string> buffer = std::make_shared<std::string>(std::move(data));
+		FileView out;
+		out.ptr = buffer->data();
+		out.len = buffer->size();
+		out.mapped = false;
+		out.owner = std::move(buffer);
+		return out;
+	}
+};
+
 namespace PakPath {
 
 // List of loaded pak files
@@ -963,6 +1057,102 @@ static LoadedPakGuard loadedPaksGuard;
 // the offset_t is the position within the zip archive (unused for PAK_DIR).
 static std::unordered_map<std::string, std::pair<uint32_t, offset_t>> fileMap;
 
+// Memory mappings of the zip paks in loadedPaks, with the same indices. These
+// are created the first time an uncompressed file is read from a pak. Views
+// returned by ReadFileView hold a reference to the mapping, so clearing this
+// list doesn't invalidate them.
+struct PakMapping {
+	PakMapping()
+		: attempted(false) {}
+	bool attempted;
+	std::shared_ptr<const MappedRegion> region;
+};
+static std::vector<PakMapping> pakMappings;
+static std::mutex pakMappingsLock;
+
+static std::shared_ptr<const MappedRegion> GetPakMapping(uint32_t pakIndex, const LoadedPakInfo& pak)
+{
+	std::lock_guard<std::mutex> lock(pakMappingsLock);
+	if (pakMappings.size() <= pakIndex)
+		pakMappings.resize(pakIndex + 1);
+
+	// Only try once, the mapping is unlikely to succeed if it failed before
+	PakMapping& mapping = pakMappings[pakIndex];
+	if (!mapping.attempted) {
+		mapping.attempted = true;
+		mapping.region = my_mmap(pak.fd);
+		if (!mapping.region)
+			fsLogs.Debug("Could not map pak '%s', falling back to regular reads", pak.path);
+	}
+	return mapping.region;
+}
+
+// Get a view of a file which is stored uncompressed in a zip pak, given the
+// offset of its central directory entry. Returns false if the file can't be
+// read directly from the mapping (compressed, encrypted, zip64 or the pak
+// couldn't be mapped), in which case it must be read through minizip instead.
+// The contents are checked against the CRC in the same way minizip does.
+static bool MapStoredFile(uint32_t pakIndex, const LoadedPakInfo& pak, Str::StringRef path, offset_t offset, FileView& out, std::error_code& err)
+{
+	std::shared_ptr<const MappedRegion> region = GetPakMapping(pakIndex, pak);
+	if (!region)
+		return false;
+
+	auto readU16 = [](const unsigned char* p) -> uint32_t {
+		return p[0] | (p[1] << 8);
+	};
+	auto readU32 = [](const unsigned char* p) -> uint32_t {
+		return p[0] | (p[1] << 8) | (p[2] << 16) | (uint32_t(p[3]) << 24);
+	};
+	const unsigned char* base = reinterpret_cast<const unsigned char*>(region->Data());
+	size_t length = region->Length();
+
+	// Central directory entry. The offsets from minizip don't include any data
+	// prepended to the archive, so check that the entry matches the filename
+	// and leave self-extracting archives to minizip.
+	const size_t centralSize = 46;
+	if (offset < 0 || static_cast<uint64_t>(offset) > length || length - offset < centralSize)
+		return false;
+	const unsigned char* central = base + offset;
+	if (readU32(central) != 0x02014b50)
+		return false;
+	uint32_t flags = readU16(central + 8);
+	uint32_t method = readU16(central + 10);
+	uint32_t crc = readU32(central + 16);
+	uint32_t compressedSize = readU32(central + 20);
+	uint32_t uncompressedSize = readU32(central + 24);
+	uint32_t nameLength = readU16(central + 28);
+	uint32_t localOffset = readU32(central + 42);
+	if ((flags & 1) || method != 0 || compressedSize != uncompressedSize)
+		return false;
+	if (uncompressedSize == 0xffffffff || localOffset == 0xffffffff)
+		return false;
+	if (length - offset - centralSize < nameLength || nameLength != path.size())
+		return false;
+	if (memcmp(central + centralSize, path.data(), nameLength) != 0)
+		return false;
+
+	// Local file header, which may have a different extra field length
+	const size_t localSize = 30;
+	if (localOffset > length || length - localOffset < localSize)
+		return false;
+	const unsigned char* local = base + localOffset;
+	if (readU32(local) != 0x04034b50)
+		return false;
+	size_t dataOffset = localOffset + localSize + readU16(local + 26) + readU16(local + 28);
+	if (dataOffset > length || length - dataOffset < uncompressedSize)
+		return false;
+
+	if (crc32(0, base + dataOffset, uncompressedSize) != crc) {
+		SetErrorCodeZlib(err, UNZ_CRCERROR);
+		return true;
+	}
+
+	out = FileViewBuilder::FromMapping(std::move(region), dataOffset, uncompressedSize);
+	ClearErrorCode(err);
+	return true;
+}
+
 #ifndef BUILD_VM
 // Parse the dependencies file of a package
 // Each line of the dependencies file is a name followed by an optional version
@@ -1185,7 +1375,12 @@ void LoadPakExplicit(const PakInfo& pak, uint32_t expectedChecksum, std::error_c
 
 void ClearPaks()
 {
+	DiscardPrefetchedFiles();
 	fileMap.clear();
+	{
+		std::lock_guard<std::mutex> lock(pakMappingsLock);
+		pakMappings.clear();
+	}
 	for (LoadedPakInfo& x: loadedPaks) {
 		if (x.fd != -1)
 			close(x.fd);
@@ -1215,8 +1410,279 @@ const std::vector<LoadedPakInfo>& GetLoadedPaks()
 	return loadedPaks;
 }
 
+// Open a file in a directory pak
+static File OpenPakDirFile(uint32_t pakIndex, const LoadedPakInfo& pak, Str::StringRef path, std::error_code& err)
+{
+#ifdef BUILD_VM
+	Q_UNUSED(pak);
+	Util::optional<IPC::OwnedFileHandle> handle;
+	VM::SendMsg<VM::FSPakPathOpenMsg>(pakIndex, path, handle);
+	return FileFromIPC(std::move(handle), openMode_t::MODE_READ, err);
+#else
+	Q_UNUSED(pakIndex);
+	return RawPath::OpenRead(Path::Build(pak.path, path), err);
+#endif
+}
+
+// Read an entire file from a directory pak
+static std::string ReadPakDirFile(const File& file, std::error_code& err)
+{
+	// Get file length
+	offset_t length = file.Length(err);
+	if (err)
+		return "";
+
+	// Read file contents
+	std::string out;
+	out.resize(length);
+	file.Read(&out[0], length, err);
+	return out;
+}
+
+// Read an entire file from a zip pak through minizip
+static std::string InflateZipFile(const LoadedPakInfo& pak, offset_t offset, std::error_code& err)
+{
+	// Open zip
+	ZipArchive zipFile = ZipArchive::Open(pak.fd, err);
+	if (err)
+		return "";
+
+	// Open file in zip
+	zipFile.OpenFile(offset, err);
+	if (err)
+		return "";
+
+	// Get file length
+	offset_t length = zipFile.FileLength(err);
+	if (err)
+		return "";
+
+	// Read file
+	std::string out;
+	out.resize(length);
+	zipFile.ReadFile(&out[0], length, err);
+	if (err)
+		return "";
+
+	// Close file and check for CRC errors
+	zipFile.CloseFile(err);
+	if (err)
+		return "";
+
+	return out;
+}
+
+// Get a view of a file in a pak. This only accesses the given pak information
+// and the pak mappings, so it may be used from other threads.
+static FileView ReadPakFileView(uint32_t pakIndex, const LoadedPakInfo& pak, Str::StringRef path, offset_t offset, std::error_code& err)
+{
+	std::string data;
+	if (pak.type == pakType_t::PAK_DIR) {
+		// Files in directory paks are copied rather than mapped: they are
+		// typically being edited, and truncating a mapped file would fault
+		// on the next access to the view.
+		File file = OpenPakDirFile(pakIndex, pak, path, err);
+		if (err)
+			return FileView();
+		data = ReadPakDirFile(file, err);
+	} else {
+		FileView view;
+		if (MapStoredFile(pakIndex, pak, path, offset, view, err))
+			return view;
+
+		data = InflateZipFile(pak, offset, err);
+	}
+
+	if (err)
+		return FileView();
+	return FileViewBuilder::FromString(std::move(data));
+}
+
+#ifndef BUILD_VM
+static Cvar::Range<Cvar::Cvar<int>> fs_prefetchThreads("fs_prefetchThreads", "number of threads reading files ahead of their use during loads, 0 to disable", Cvar::NONE, 4, 0, 32);
+
+// A file which was requested through Prefetch. The result is filled in by the
+// prefetch thread, an empty result means the file should be read normally.
+struct PrefetchedFile {
+	PrefetchedFile()
+		: done(false) {}
+	bool done;
+	Util::optional<FileView> result;
+};
+
+struct PrefetchJob {
+	std::string path;
+	uint32_t pakIndex;
+	offset_t offset;
+	unsigned generation;
+	std::shared_ptr<PrefetchedFile> file;
+};
+
+// All of the prefetch state is protected by prefetchLock. The pak information
+// of each job is copied so that LoadPak can run while jobs are in flight, and
+// ClearPaks waits for the prefetch thread to become idle before closing paks.
+static std::mutex prefetchLock;
+static std::condition_variable prefetchCond;
+static std::unordered_map<std::string, std::shared_ptr<PrefetchedFile>> prefetchedFiles;
+static std::vector<PrefetchJob> prefetchQueue;
+static std::vector<LoadedPakInfo> prefetchPaks;
+static std::atomic<unsigned> prefetchGeneration;
+static int prefetchNumThreads = 0;
+static bool prefetchBusy = false;
+static bool prefetchShutdown = false;
+static std::thread prefetchThread;
+
+static void PrefetchThreadMain()
+{
+	Sys::ThreadPool pool;
+	while (true) {
+		std::vector<PrefetchJob> jobs;
+		std::vector<LoadedPakInfo> paks;
+		int numThreads;
+		{
+			std::unique_lock<std::mutex> lock(prefetchLock);
+			prefetchBusy = false;
+			prefetchCond.notify_all();
+			prefetchCond.wait(lock, [] { return prefetchShutdown || !prefetchQueue.empty(); });
+			if (prefetchShutdown)
+				return;
+			std::swap(jobs, prefetchQueue);
+			paks = prefetchPaks;
+			numThreads = prefetchNumThreads;
+			prefetchBusy = true;
+		}
+
+		// The calling thread takes part in ParallelFor
+		pool.SetNumThreads(numThreads - 1);
+
+		auto start = Sys::SteadyClock::now();
+		std::atomic<size_t> totalBytes(0);
+		pool.ParallelFor(jobs.size(), [&](int i) {
+			PrefetchJob& job = jobs[i];
+			if (job.generation == prefetchGeneration) {
+				std::error_code err;
+				FileView view = ReadPakFileView(job.pakIndex, paks[job.pakIndex], job.path, job.offset, err);
+				if (!err) {
+					// Fault in the pages of mapped files, otherwise the
+					// reader would still have to wait for the disk.
+					if (view.IsMapped()) {
+						const volatile char* data = view.data();
+						for (size_t offset = 0; offset < view.size(); offset += 4096)
+							data[offset];
+					}
+					totalBytes += view.size();
+
+					std::lock_guard<std::mutex> lock(prefetchLock);
+					job.file->result.emplace(std::move(view));
+				}
+			}
+
+			std::lock_guard<std::mutex> lock(prefetchLock);
+			job.file->done = true;
+			prefetchCond.notify_all();
+		});
+
+		auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(Sys::SteadyClock::now() - start);
+		fsLogs.Debug("Prefetched %d files (%d KiB) in %d ms", jobs.size(), totalBytes / 1024, duration.count());
+	}
+}
+
+// Stops the prefetch thread on shutdown, before the pak fds are closed
+struct PrefetchGuard {
+	~PrefetchGuard() {
+		{
+			std::lock_guard<std::mutex> lock(prefetchLock);
+			prefetchShutdown = true;
+		}
+		prefetchCond.notify_all();
+		if (prefetchThread.joinable())
+			prefetchThread.join();
+	}
+};
+static PrefetchGuard prefetchGuard;
+
+// Take the result of a prefetch for the given file, waiting for it if the
+// read is still in progress.
+static Util::optional<FileView> TakePrefetchedFile(Str::StringRef path)
+{
+	std::unique_lock<std::mutex> lock(prefetchLock);
+	if (prefetchedFiles.empty())
+		return Util::nullopt;
+	auto it = prefetchedFiles.find(path);
+	if (it == prefetchedFiles.end())
+		return Util::nullopt;
+	std::shared_ptr<PrefetchedFile> file = std::move(it->second);
+	prefetchedFiles.erase(it);
+
+	prefetchCond.wait(lock, [&] { return file->done || prefetchShutdown; });
+	return std::move(file->result);
+}
+
+void Prefetch(const std::vector<std::string>& paths)
+{
+	int numThreads = fs_prefetchThreads.Get();
+	if (numThreads == 0)
+		return;
+
+	std::lock_guard<std::mutex> lock(prefetchLock);
+	unsigned generation = prefetchGeneration;
+	size_t numQueued = prefetchQueue.size();
+	for (const std::string& path: paths) {
+		auto it = fileMap.find(path);
+		if (it == fileMap.end() || prefetchedFiles.count(path))
+			continue;
+
+		auto file = std::make_shared<PrefetchedFile>();
+		prefetchedFiles.emplace(path, file);
+		prefetchQueue.push_back({path, it->second.first, it->second.second, generation, std::move(file)});
+	}
+	if (prefetchQueue.size() == numQueued)
+		return;
+
+	// Jobs only refer to paks by index and new paks are only ever appended,
+	// so the copy can simply be refreshed.
+	prefetchPaks = loadedPaks;
+	prefetchNumThreads = numThreads;
+	if (!prefetchThread.joinable())
+		prefetchThread = std::thread(PrefetchThreadMain);
+	prefetchCond.notify_all();
+}
+
+void AddPrefetchedFile(Str::StringRef path, FileView view)
+{
+	if (fs_prefetchThreads.Get() == 0)
+		return;
+
+	std::lock_guard<std::mutex> lock(prefetchLock);
+	if (!fileMap.count(path) || prefetchedFiles.count(path))
+		return;
+
+	auto file = std::make_shared<PrefetchedFile>();
+	file->done = true;
+	file->result = std::move(view);
+	prefetchedFiles.emplace(path, std::move(file));
+}
+
+void DiscardPrefetchedFiles()
+{
+	std::unique_lock<std::mutex> lock(prefetchLock);
+	prefetchGeneration++;
+	prefetchedFiles.clear();
+
+	// Jobs from the old generation finish immediately
+	prefetchCond.wait(lock, [] { return prefetchQueue.empty() && !prefetchBusy; });
+}
+#endif // BUILD_VM
+
 std::string ReadFile(Str::StringRef path, std::error_code& err)
 {
+#ifndef BUILD_VM
+	if (Util::optional<FileView> prefetched = TakePrefetchedFile(path)) {
+		ClearErrorCode(err);
+		return std::string(prefetched->data(), prefetched->size());
+	}
+#endif
+
 	auto it = fileMap.find(path);
 	if (it == fileMap.end()) {
 		SetErrorCodeFilesystem(err, filesystem_error::no_such_file);
@@ -1225,57 +1691,39 @@ std::string ReadFile(Str::StringRef path, std::error_code& err)
 
 	const LoadedPakInfo& pak = loadedPaks[it->second.first];
 	if (pak.type == pakType_t::PAK_DIR) {
-		// Open file
-#ifdef BUILD_VM
-		Util::optional<IPC::OwnedFileHandle> handle;
-		VM::SendMsg<VM::FSPakPathOpenMsg>(it->second.first, path, handle);
-		File file = FileFromIPC(std::move(handle), openMode_t::MODE_READ, err);
-#else
-		File file = RawPath::OpenRead(Path::Build(pak.path, path), err);
-#endif
-		if (err)
-			return "";
-
-		// Get file length
-		offset_t length = file.Length(err);
+		File file = OpenPakDirFile(it->second.first, pak, path, err);
 		if (err)
 			return "";
-
-		// Read file contents
-		std::string out;
-		out.resize(length);
-		file.Read(&out[0], length, err);
-		return out;
+		return ReadPakDirFile(file, err);
 	} else {
-		// Open zip
-		ZipArchive zipFile = ZipArchive::Open(pak.fd, err);
-		if (err)
-			return "";
-
-		// Open file in zip
-		zipFile.OpenFile(it->second.second, err);
-		if (err)
-			return "";
-
-		// Get file length
-		offset_t length = zipFile.FileLength(err);
-		if (err)
-			return "";
-
-		// Read file
-		std::string out;
-		out.resize(length);
-		zipFile.ReadFile(&out[0], length, err);
-		if (err)
-			return "";
+		// Uncompressed files can be copied straight out of the mapped pak,
+		// which avoids setting up minizip for every read.
+		FileView view;
+		if (MapStoredFile(it->second.first, pak, path, it->second.second, view, err)) {
+			if (err)
+				return "";
+			return std::string(view.data(), view.size());
+		}
+		return InflateZipFile(pak, it->second.second, err);
+	}
+}
 
-		// Close file and check for CRC errors
-		zipFile.CloseFile(err);
-		if (err)
-			return "";
+FileView ReadFileView(Str::StringRef path, std::error_code& err)
+{
+#ifndef BUILD_VM
+	if (Util::optional<FileView> prefetched = TakePrefetchedFile(path)) {
+		ClearErrorCode(err);
+		return std::move(*prefetched);
+	}
+#endif
 
-		return out;
+	auto it = fileMap.find(path);
+	if (it == fileMap.end()) {
+		SetErrorCodeFilesystem(err, filesystem_error::no_such_file);
+		return FileView();
 	}
+
+	return ReadPakFileView(it->second.first, loadedPaks[it->second.first], path, it->second.second, err);
 }
 
 void CopyFile(Str::StringRef path, const File& dest, std::error_code& err)
@@ -1288,13 +1736,7 @@ void CopyFile(Str::StringRef path, const File& dest, std::error_code& err)
 
 	const LoadedPakInfo& pak = loadedPaks[it->second.first];
 	if (pak.type == pakType_t::PAK_DIR) {
-#ifdef BUILD_VM
-		Util::optional<IPC::OwnedFileHandle> handle;
-		VM::SendMsg<VM::FSPakPathOpenMsg>(it->second.first, path, handle);
-		File file = FileFromIPC(std::move(handle), openMode_t::MODE_READ, err);
-#else
-		File file = RawPath::OpenRead(Path::Build(pak.path, path), err);
-#endif
+		File file = OpenPakDirFile(it->second.first, pak, path, err);
 		if (err)
 			return;
 		file.CopyTo(dest, err);
@@ -274,6 +274,45 @@ struct LoadedPakInfo: public PakInfo {
 	std::string pathPrefix;
 };
 
+// Read-only view of the contents of a file. Depending on how the file is
+// stored, the view either points directly into a memory mapping of the file or
+// pak, or owns a decompressed copy of the data. Either way the data remains
+// valid for as long as a view referencing it exists, even if the paks are
+// cleared in the meantime. Note that mapped data has no particular alignment.
+class FileView {
+public:
+	FileView()
+		: ptr(nullptr), len(0), mapped(false) {}
+
+	const char* data() const
+	{
+		return ptr;
+	}
+	size_t size() const
+	{
+		return len;
+	}
+	bool empty() const
+	{
+		return len == 0;
+	}
+
+	// Whether the data is read directly from a memory mapping
+	bool IsMapped() const
+	{
+		return mapped;
+	}
+
+private:
+	friend class FileViewBuilder;
+
+	// Keeps whatever ptr points into (a mapping or a string) alive
+	std::shared_ptr<const void> owner;
+	const char* ptr;
+	size_t len;
+	bool mapped;
+};
+
 // Operations which work on files that are in packages. Packages should be used
 // for read-only assets which can be distributed by auto-download.
 namespace PakPath {
@@ -298,9 +337,29 @@ namespace PakPath {
 	// Read an entire file into a string
 	std::string ReadFile(Str::StringRef path, std::error_code& err = throws());
 
+	// Get a view of an entire file. Files stored uncompressed in a zip pak are
+	// mapped into memory instead of being copied, compressed files and files
+	// in directory paks are read into a buffer owned by the view.
+	FileView ReadFileView(Str::StringRef path, std::error_code& err = throws());
+
 	// Copy an entire file to another file
 	void CopyFile(Str::StringRef path, const File& dest, std::error_code& err = throws());
 
+#ifndef BUILD_VM
+	// Start reading the given files on background threads, so that a later
+	// ReadFile or ReadFileView call for one of them doesn't have to wait for
+	// the disk. Files which don't exist are ignored. Prefetched files are kept
+	// in memory until they are read or DiscardPrefetchedFiles is called.
+	void Prefetch(const std::vector<std::string>& paths);
+
+	// Keep a file that was already read for the next ReadFile or ReadFileView
+	// call for it, in the same way as a prefetched file.
+	void AddPrefetchedFile(Str::StringRef path, FileView view);
+
+	// Cancel pending prefetches and free the prefetched files nobody read
+	void DiscardPrefetchedFiles();
+#endif
+
 	// Check if a file exists
 	bool FileExists(Str::StringRef path);
 
@@ -0,0 +1,179 @@
+/*
+===========================================================================
+Daemon BSD Source Code
+Copyright (c) 2013-2016, Daemon Developers
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the Daemon developers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL DAEMON DEVELOPERS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+===========================================================================
+*/
+
+#include "Channel.h"
+#include "CommandBuffer.h"
+
+namespace IPC {
+
+    // Messages smaller than this are cheaper to send through the socket directly
+    static const size_t BULK_MSG_MIN_SIZE = 8192;
+
+    // Size of the circular buffer for each direction
+    static const size_t BULK_BUFFER_SIZE = 4 << 20;
+
+    struct Channel::BulkBuffers {
+        SharedMemory memory;
+        CommandBuffer send;
+        CommandBuffer recv;
+    };
+
+    Channel::Channel()
+        : canSendSyncMsg(TOPLEVEL_MSG_ALLOWED), canSendAsyncMsg(TOPLEVEL_MSG_ALLOWED) {}
+
+    Channel::Channel(Socket socket)
+        : socket(std::move(socket)), canSendSyncMsg(TOPLEVEL_MSG_ALLOWED), canSendAsyncMsg(TOPLEVEL_MSG_ALLOWED) {}
+
+    Channel::Channel(Channel&& other)
+        : socket(std::move(other.socket)), bulk(std::move(other.bulk)), canSendSyncMsg(TOPLEVEL_MSG_ALLOWED), canSendAsyncMsg(TOPLEVEL_MSG_ALLOWED) {}
+
+    Channel& Channel::operator=(Channel&& other)
+    {
+        std::swap(socket, other.socket);
+        std::swap(bulk, other.bulk);
+        canSendSyncMsg = other.canSendSyncMsg;
+        canSendAsyncMsg = other.canSendAsyncMsg;
+        return *this;
+    }
+
+    Channel::~Channel() {}
+
+    void Channel::SendMsg(const Util::Writer& writer)
+    {
+        size_t length = writer.GetData().size();
+        if (length < BULK_MSG_MIN_SIZE || !bulk) {
+            socket.SendMsg(writer);
+            return;
+        }
+
+        bulk->send.LoadReaderData();
+        if (!bulk->send.CanWrite(length)) {
+            socket.SendMsg(writer);
+            return;
+        }
+
+        bulk->send.Write(writer.GetData().data(), length);
+        bulk->send.AdvanceWritePointer(length);
+
+        // Handles still have to go through the socket
+        Util::Writer header;
+        header.Write<uint32_t>(ID_BULK_MSG);
+        header.Write<uint32_t>(length);
+        for (const FileDesc& desc: writer.GetHandles())
+            header.WriteHandle(desc);
+        socket.SendMsg(header);
+    }
+
+    Util::Reader Channel::RecvMsg()
+    {
+        while (true) {
+            Util::Reader reader = socket.RecvMsg();
+
+            uint32_t id = 0;
+            if (reader.GetData().size() >= sizeof(id))
+                memcpy(&id, reader.GetData().data(), sizeof(id));
+
+            if (id == ID_BULK_MSG)
+                return ReceiveBulkMsg(std::move(reader));
+
+            if (id == ID_BULK_BUFFERS) {
+                ReceiveBulkBuffers(std::move(reader));
+                continue;
+            }
+
+            return reader;
+        }
+    }
+
+    void Channel::CreateBulkBuffers()
+    {
+        std::unique_ptr<BulkBuffers> buffers(new BulkBuffers);
+        buffers->memory = SharedMemory::Create(2 * BULK_BUFFER_SIZE);
+
+        char* base = static_cast<char*>(buffers->memory.GetBase());
+        size_t size = buffers->memory.GetSize() / 2;
+        buffers->send.Init(base, size);
+        buffers->send.Reset();
+        buffers->recv.Init(base + size, size);
+        buffers->recv.Reset();
+
+        Util::Writer writer;
+        writer.Write<uint32_t>(ID_BULK_BUFFERS);
+        writer.Write<SharedMemory>(buffers->memory);
+        socket.SendMsg(writer);
+
+        bulk = std::move(buffers);
+    }
+
+    void Channel::ReceiveBulkBuffers(Util::Reader reader)
+    {
+#ifdef BUILD_ENGINE
+        Q_UNUSED(reader);
+        Sys::Drop("IPC: The VM tried to create the bulk message buffers");
+#else
+        reader.Read<uint32_t>();
+        std::unique_ptr<BulkBuffers> buffers(new BulkBuffers);
+        buffers->memory = reader.Read<SharedMemory>();
+        reader.CheckEndRead();
+
+        // The buffers are seen from the other side here
+        char* base = static_cast<char*>(buffers->memory.GetBase());
+        size_t size = buffers->memory.GetSize() / 2;
+        buffers->recv.Init(base, size);
+        buffers->send.Init(base + size, size);
+
+        bulk = std::move(buffers);
+#endif
+    }
+
+    Util::Reader Channel::ReceiveBulkMsg(Util::Reader reader)
+    {
+        reader.Read<uint32_t>();
+        uint32_t length = reader.Read<uint32_t>();
+
+        if (!bulk)
+            Sys::Drop("IPC: Received a bulk message without bulk message buffers");
+
+        bulk->recv.LoadWriterData();
+        if (!bulk->recv.CanRead(length))
+            Sys::Drop("IPC: Bulk message of size %u is larger than the buffered data", length);
+
+        Util::Reader out;
+        if (length > out.GetData().capacity())
+            Util::CountMessageBufferAllocation();
+        out.GetData().resize(length);
+        bulk->recv.Read(out.GetData().data(), length);
+        bulk->recv.AdvanceReadPointer(length);
+        std::swap(out.GetHandles(), reader.GetHandles());
+
+        return out;
+    }
+
+} // namespace IPC
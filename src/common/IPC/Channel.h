@@ -73,6 +73,12 @@ namespace IPC {
      * the same time pass references to where the output should be written.
      * After the lambda has been called, it will serialize the outputs and
      * send it in the socket.
+     *
+     * Large messages don't go through the socket itself: the engine gives the
+     * VM a shared memory region holding a circular buffer for each direction
+     * and the socket only carries a small header telling the other side to
+     * read the message from there. When the buffer is full the message is
+     * sent through the socket as usual.
      */
 
     #ifdef BUILD_ENGINE
@@ -83,33 +89,25 @@ namespace IPC {
 
     class Channel {
     public:
-        Channel()
-            : canSendSyncMsg(TOPLEVEL_MSG_ALLOWED), canSendAsyncMsg(TOPLEVEL_MSG_ALLOWED) {}
-        Channel(Socket socket)
-            : socket(std::move(socket)), canSendSyncMsg(TOPLEVEL_MSG_ALLOWED), canSendAsyncMsg(TOPLEVEL_MSG_ALLOWED) {}
-        Channel(Channel&& other)
-            : socket(std::move(other.socket)), canSendSyncMsg(TOPLEVEL_MSG_ALLOWED), canSendAsyncMsg(TOPLEVEL_MSG_ALLOWED) {}
-        Channel& operator=(Channel&& other)
-        {
-            std::swap(socket, other.socket);
-            canSendSyncMsg = other.canSendSyncMsg;
-            canSendAsyncMsg = other.canSendAsyncMsg;
-            return *this;
-        }
+        Channel();
+        Channel(Socket socket);
+        Channel(Channel&& other);
+        Channel& operator=(Channel&& other);
+        ~Channel();
+
         explicit operator bool() const
         {
             return bool(socket);
         }
 
-        // Wrappers around socket functions
-        void SendMsg(const Util::Writer& writer) const
-        {
-            socket.SendMsg(writer);
-        }
-        Util::Reader RecvMsg() const
-        {
-            return socket.RecvMsg();
-        }
+        // Wrappers around socket functions, using the shared memory buffers for large messages
+        void SendMsg(const Util::Writer& writer);
+        Util::Reader RecvMsg();
+
+        // The VM can't create shared memory without asking the engine, so the
+        // engine makes the buffers for both directions once the VM is known to
+        // understand them. Large messages go through the socket until then.
+        void CreateBulkBuffers();
         void SetRecvTimeout(std::chrono::nanoseconds timeout)
         {
             socket.SetRecvTimeout(timeout);
@@ -125,8 +123,14 @@ namespace IPC {
         }
 
     private:
+        struct BulkBuffers;
+
+        void ReceiveBulkBuffers(Util::Reader reader);
+        Util::Reader ReceiveBulkMsg(Util::Reader reader);
+
         Socket socket;
         std::unordered_map<uint32_t, Util::Reader> replies;
+        std::unique_ptr<BulkBuffers> bulk;
 
     public:
         bool canSendSyncMsg;
@@ -77,6 +77,11 @@ namespace IPC {
 	const uint32_t ID_RETURN = 0xffffffff;
 	const uint32_t ID_EXIT = 0xfffffffe;
 
+	// Special message IDs used by channels to share their bulk message buffers
+	// and to tell that a message is in them, these never reach the handlers
+	const uint32_t ID_BULK_BUFFERS = 0xfffffffd;
+	const uint32_t ID_BULK_MSG = 0xfffffffc;
+
     // Combine a major and minor ID into a single number.
     // TODO we use a template, because we need the ID to be part of template
     // arguments and some compilers do not support constexpr yet.
@@ -322,12 +322,68 @@ static void FreeHandles(const NaClHandle* h)
 }
 #endif
 
+// Appends received bytes to the message being read
+static void AppendRecvData(Util::Reader& reader, const char* begin, const char* end)
+{
+	std::vector<char>& data = reader.GetData();
+	if (data.size() + (end - begin) > data.capacity())
+		Util::CountMessageBufferAllocation();
+	data.insert(data.end(), begin, end);
+}
+
+// Receive buffers are kept around instead of allocating one for every
+// datagram, there is one per thread receiving at the same time.
+class RecvBuffer {
+public:
+	RecvBuffer()
+	{
+		std::lock_guard<std::mutex> lock(GetPool().mutex);
+		if (!GetPool().buffers.empty()) {
+			buffer = std::move(GetPool().buffers.back());
+			GetPool().buffers.pop_back();
+		}
+		if (!buffer) {
+			Util::CountMessageBufferAllocation();
+			buffer.reset(new char[NACL_ABI_IMC_BYTES_MAX]);
+		}
+	}
+	~RecvBuffer()
+	{
+		std::lock_guard<std::mutex> lock(GetPool().mutex);
+		GetPool().buffers.push_back(std::move(buffer));
+	}
+
+	char& operator[](size_t i)
+	{
+		return buffer[i];
+	}
+	char* get()
+	{
+		return buffer.get();
+	}
+
+private:
+	struct Pool {
+		std::mutex mutex;
+		std::vector<std::unique_ptr<char[]>> buffers;
+	};
+
+	// Never destroyed since sockets can outlive static objects
+	static Pool& GetPool()
+	{
+		static Pool* pool = new Pool;
+		return *pool;
+	}
+
+	std::unique_ptr<char[]> buffer;
+};
+
 bool InternalRecvMsg(Sys::OSHandle handle, Util::Reader& reader)
 {
 	NaClMessageHeader hdr;
 	NaClIOVec iov[2];
 	NaClHandle h[NACL_ABI_IMC_DESC_MAX];
-	std::unique_ptr<char[]> recvBuffer(new char[NACL_ABI_IMC_BYTES_MAX]);
+	RecvBuffer recvBuffer;
 
 	for (size_t i = 0; i < NACL_ABI_IMC_DESC_MAX; i++)
 		h[i] = NACL_INVALID_HANDLE;
@@ -357,7 +413,7 @@ bool InternalRecvMsg(Sys::OSHandle handle, Util::Reader& reader)
 			reader.GetHandles().back().handle = h[i];
 		}
 	}
-	reader.GetData().insert(reader.GetData().end(), &recvBuffer[1], &recvBuffer[result]);
+	AppendRecvData(reader, &recvBuffer[1], &recvBuffer[result]);
 	return recvBuffer[0];
 #else
 	NaClInternalHeader internalHdr;
@@ -446,7 +502,7 @@ bool InternalRecvMsg(Sys::OSHandle handle, Util::Reader& reader)
 			reader.GetHandles().back().flags = flags;
 	}
 
-	reader.GetData().insert(reader.GetData().end(), &desc_end[1], &desc_end[result]);
+	AppendRecvData(reader, &desc_end[1], &desc_end[result]);
 	return desc_end[0];
 #endif
 }
@@ -0,0 +1,105 @@
+/*
+===========================================================================
+Daemon BSD Source Code
+Copyright (c) 2016, Daemon Developers
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the Daemon developers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL DAEMON DEVELOPERS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+===========================================================================
+*/
+
+#include "Common.h"
+
+namespace Util {
+
+	// Only this many buffers are kept, and big ones are freed instead so that
+	// a single large message doesn't keep its memory around.
+	static const size_t MAX_POOLED_BUFFERS = 64;
+	static const size_t MAX_POOLED_BUFFER_SIZE = 256 << 10;
+
+	// Size given to new buffers, which is enough for most messages
+	static const size_t DEFAULT_BUFFER_SIZE = 256;
+
+	struct MessageBufferPool {
+		std::mutex mutex;
+		std::vector<std::vector<char>> buffers;
+	};
+
+	// Never destroyed since readers and writers can outlive static objects
+	static MessageBufferPool& GetMessageBufferPool()
+	{
+		static MessageBufferPool* pool = new MessageBufferPool;
+		return *pool;
+	}
+
+	static std::atomic<int> buffersAcquired;
+	static std::atomic<int> buffersAllocated;
+
+	std::vector<char> AcquireMessageBuffer()
+	{
+		MessageBufferPool& pool = GetMessageBufferPool();
+		buffersAcquired++;
+
+		{
+			std::lock_guard<std::mutex> lock(pool.mutex);
+			if (!pool.buffers.empty()) {
+				std::vector<char> buffer = std::move(pool.buffers.back());
+				pool.buffers.pop_back();
+				return buffer;
+			}
+		}
+
+		CountMessageBufferAllocation();
+		std::vector<char> buffer;
+		buffer.reserve(DEFAULT_BUFFER_SIZE);
+		return buffer;
+	}
+
+	void ReleaseMessageBuffer(std::vector<char>& buffer)
+	{
+		// Moved-from buffers have nothing worth keeping
+		if (buffer.capacity() == 0 || buffer.capacity() > MAX_POOLED_BUFFER_SIZE)
+			return;
+
+		MessageBufferPool& pool = GetMessageBufferPool();
+		buffer.clear();
+
+		std::lock_guard<std::mutex> lock(pool.mutex);
+		if (pool.buffers.size() < MAX_POOLED_BUFFERS)
+			pool.buffers.push_back(std::move(buffer));
+	}
+
+	void CountMessageBufferAllocation()
+	{
+		buffersAllocated++;
+	}
+
+	MessageBufferStats GetMessageBufferStats()
+	{
+		MessageBufferStats stats;
+		stats.acquired = buffersAcquired.exchange(0);
+		stats.allocated = buffersAllocated.exchange(0);
+		return stats;
+	}
+
+} // namespace Util
@@ -57,11 +57,47 @@ namespace Util {
 	// Trait declaration for the serialization trait.
 	template<typename T, typename = void> struct SerializeTraits {};
 
+	/*
+	 * Writers and readers take their data buffer from a pool and give it back
+	 * when destroyed, so that once the pool is warmed up building and reading
+	 * messages doesn't allocate memory anymore.
+	 */
+	std::vector<char> AcquireMessageBuffer();
+	void ReleaseMessageBuffer(std::vector<char>& buffer);
+
+	// Counted when a message buffer had to be allocated or grown
+	void CountMessageBufferAllocation();
+
+	struct MessageBufferStats {
+		int acquired;
+		int allocated;
+	};
+
+	// Returns the number of buffers used and allocated since the last call
+	MessageBufferStats GetMessageBufferStats();
+
 	// Class to generate messages
 	class Writer {
 	public:
+		Writer()
+			: data(AcquireMessageBuffer()) {}
+		Writer(Writer&& other) NOEXCEPT
+			: data(std::move(other.data)), handles(std::move(other.handles)) {}
+		Writer& operator=(Writer&& other) NOEXCEPT
+		{
+			std::swap(data, other.data);
+			std::swap(handles, other.handles);
+			return *this;
+		}
+		~Writer()
+		{
+			ReleaseMessageBuffer(data);
+		}
+
 		void WriteData(const void* p, size_t len)
 		{
+			if (data.size() + len > data.capacity())
+				CountMessageBufferAllocation();
 			data.insert(data.end(), static_cast<const char*>(p), static_cast<const char*>(p) + len);
 		}
 		void WriteSize(size_t size)
@@ -117,7 +153,7 @@ namespace Util {
 	class Reader {
 	public:
 		Reader()
-			: pos(0), handles_pos(0) {}
+			: data(AcquireMessageBuffer()), pos(0), handles_pos(0) {}
 		Reader(Reader&& other) NOEXCEPT
 			: data(std::move(other.data)), handles(std::move(other.handles)), pos(other.pos), handles_pos(other.handles_pos) {}
 		Reader& operator=(Reader&& other) NOEXCEPT
@@ -133,6 +169,8 @@ namespace Util {
 			// Close any handles that weren't read
 			for (size_t i = handles_pos; i < handles.size(); i++)
 				handles[i].Close();
+
+			ReleaseMessageBuffer(data);
 		}
 
 		void ReadData(void* p, size_t len)
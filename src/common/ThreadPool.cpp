@@ -0,0 +1,143 @@
+/*
+===========================================================================
+Daemon BSD Source Code
+Copyright (c) 2016, Daemon Developers
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the Daemon developers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL DAEMON DEVELOPERS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+===========================================================================
+*/
+
+#include "Common.h"
+#include "ThreadPool.h"
+
+namespace Sys {
+
+ThreadPool::ThreadPool()
+	: func(nullptr), count(0), nextTask(0), busyWorkers(0), generation(0), shutdown(false) {}
+
+ThreadPool::~ThreadPool()
+{
+	SetNumThreads(0);
+}
+
+void ThreadPool::SetNumThreads(int numThreads)
+{
+	numThreads = std::max(numThreads, 0);
+	if (numThreads == GetNumThreads())
+		return;
+
+	// Stop every worker, then start the requested number again: resizing is
+	// rare so there is no point in being clever about it.
+	if (!workers.empty()) {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			shutdown = true;
+		}
+		workAvailable.notify_all();
+		for (std::thread& worker : workers)
+			worker.join();
+		workers.clear();
+		shutdown = false;
+	}
+
+	workers.reserve(numThreads);
+	for (int i = 0; i < numThreads; i++)
+		workers.emplace_back(&ThreadPool::WorkerMain, this, generation);
+}
+
+int ThreadPool::GetNumThreads() const
+{
+	return workers.size();
+}
+
+void ThreadPool::ParallelFor(int count, const std::function<void(int)>& func)
+{
+	if (count <= 0)
+		return;
+
+	if (workers.empty() || count == 1) {
+		for (int i = 0; i < count; i++)
+			func(i);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		this->func = &func;
+		this->count = count;
+		nextTask = 0;
+		busyWorkers = workers.size();
+		error = nullptr;
+		generation++;
+	}
+	workAvailable.notify_all();
+
+	RunTasks();
+
+	std::exception_ptr batchError;
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		workDone.wait(lock, [this] { return busyWorkers == 0; });
+		this->func = nullptr;
+		std::swap(batchError, error);
+	}
+
+	if (batchError)
+		std::rethrow_exception(batchError);
+}
+
+void ThreadPool::WorkerMain(unsigned seenGeneration)
+{
+	while (true) {
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			workAvailable.wait(lock, [&] { return shutdown || generation != seenGeneration; });
+			if (shutdown)
+				return;
+			seenGeneration = generation;
+		}
+
+		RunTasks();
+
+		std::lock_guard<std::mutex> lock(mutex);
+		if (--busyWorkers == 0)
+			workDone.notify_one();
+	}
+}
+
+void ThreadPool::RunTasks()
+{
+	int task;
+	while ((task = nextTask.fetch_add(1)) < count) {
+		try {
+			(*func)(task);
+		} catch (...) {
+			std::lock_guard<std::mutex> lock(mutex);
+			if (!error)
+				error = std::current_exception();
+		}
+	}
+}
+
+} // namespace Sys
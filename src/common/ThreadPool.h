@@ -0,0 +1,85 @@
+/*
+===========================================================================
+Daemon BSD Source Code
+Copyright (c) 2016, Daemon Developers
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the Daemon developers nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL DAEMON DEVELOPERS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+===========================================================================
+*/
+
+#ifndef COMMON_THREAD_POOL_H_
+#define COMMON_THREAD_POOL_H_
+
+namespace Sys {
+
+/*
+ * A set of worker threads which help the owning thread run a batch of
+ * independent tasks. A pool without workers runs everything on the calling
+ * thread, so callers don't need a separate serial code path.
+ *
+ * The pool is meant to be owned and driven by a single thread: SetNumThreads
+ * and ParallelFor must not be called concurrently or from inside a task.
+ */
+class ThreadPool {
+public:
+	ThreadPool();
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	// Starts or stops workers so that exactly numThreads of them are running
+	void SetNumThreads(int numThreads);
+	int GetNumThreads() const;
+
+	// Calls func(i) for every i in [0, count), spreading the calls over the
+	// workers and the calling thread, and returns once all of them are done.
+	// If some calls throw, the first exception is rethrown here after the
+	// remaining tasks completed.
+	void ParallelFor(int count, const std::function<void(int)>& func);
+
+private:
+	void WorkerMain(unsigned generation);
+	void RunTasks();
+
+	std::vector<std::thread> workers;
+
+	std::mutex mutex;
+	std::condition_variable workAvailable;
+	std::condition_variable workDone;
+
+	// The batch being processed, protected by mutex. Workers read func and
+	// count after they have been woken up and grab indices from nextTask.
+	const std::function<void(int)>* func;
+	int count;
+	std::atomic<int> nextTask;
+	int busyWorkers;
+	unsigned generation;
+	bool shutdown;
+	std::exception_ptr error;
+};
+
+} // namespace Sys
+
+#endif // COMMON_THREAD_POOL_H_
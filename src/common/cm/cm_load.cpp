@@ -47,8 +47,8 @@ static const int BOX_PLANES       = 12;
 #define LL( x ) x = LittleLong( x )
 
 clipMap_t cm;
-int       c_pointcontents;
-int       c_traces, c_brush_traces, c_patch_traces, c_trisoup_traces;
+std::atomic<int> c_pointcontents;
+std::atomic<int> c_traces, c_brush_traces, c_patch_traces, c_trisoup_traces;
 
 cmodel_t  box_model;
 cplane_t  *box_planes;
@@ -256,6 +256,42 @@ void CM_BoundBrush( cbrush_t *b )
 	b->bounds[ 1 ][ 2 ] = b->sides[ 5 ].plane->dist;
 }
 
+/*
+=================
+CM_SetBrushSidePlanes
+
+Copies the side planes into the brush's own arrays, they must be
+refreshed whenever one of the planes changes.
+=================
+*/
+void CM_SetBrushSidePlanes( cbrush_t *b )
+{
+	int   i;
+	float *normalX, *normalY, *normalZ, *dist;
+
+	if ( !b->sidePlanes )
+	{
+		b->sidePlaneStride = ( b->numsides + 3 ) & ~3;
+		b->sidePlanes = ( float * ) CM_Alloc( 4 * b->sidePlaneStride * sizeof( float ) );
+	}
+
+	normalX = b->sidePlanes;
+	normalY = normalX + b->sidePlaneStride;
+	normalZ = normalY + b->sidePlaneStride;
+	dist = normalZ + b->sidePlaneStride;
+
+	// the padding stays zeroed
+	for ( i = 0; i < b->numsides; i++ )
+	{
+		const cplane_t *plane = b->sides[ i ].plane;
+
+		normalX[ i ] = plane->normal[ 0 ];
+		normalY[ i ] = plane->normal[ 1 ];
+		normalZ[ i ] = plane->normal[ 2 ];
+		dist[ i ] = plane->dist;
+	}
+}
+
 /*
 =================
 CMod_LoadBrushes
@@ -298,6 +334,7 @@ void CMod_LoadBrushes(const byte *const cmod_base, lump_t *l)
 		out->contents = cm.shaders[ shaderNum ].contentFlags;
 
 		CM_BoundBrush( out );
+		CM_SetBrushSidePlanes( out );
 	}
 }
 
@@ -912,9 +949,9 @@ void CM_LoadMap(Str::StringRef name)
 	cmLog.Debug( "CM_LoadMap(%s)", name);
 
 	std::string mapFile = "maps/" + name + ".bsp";
-	std::string mapData;
+	FS::FileView mapData;
 	try {
-		mapData = FS::PakPath::ReadFile(mapFile);
+		mapData = FS::PakPath::ReadFileView(mapFile);
 	} catch (std::system_error&) {
 		Sys::Drop("Could not load %s", mapFile.c_str());
 	}
@@ -933,7 +970,23 @@ void CM_LoadMap(Str::StringRef name)
 		return;
 	}
 
-	header = * ( dheader_t * ) mapData.data();
+	if ( mapData.size() < sizeof( dheader_t ) )
+	{
+		Sys::Drop( "CM_LoadMap: %s is too short", name.c_str() );
+	}
+
+	// the lumps are read in place, so copy files which are mapped at an
+	// unaligned position within their pak
+	std::string alignedMapData;
+	const char *mapBuffer = mapData.data();
+
+	if ( reinterpret_cast<uintptr_t>( mapBuffer ) % alignof( dheader_t ) != 0 )
+	{
+		alignedMapData.assign( mapData.data(), mapData.size() );
+		mapBuffer = alignedMapData.data();
+	}
+
+	memcpy( &header, mapBuffer, sizeof( header ) );
 
 	for (unsigned i = 0; i < sizeof( dheader_t ) / 4; i++ )
 	{
@@ -946,7 +999,7 @@ void CM_LoadMap(Str::StringRef name)
 		           name.c_str(), header.version, BSP_VERSION, BSP_VERSION_Q3 );
 	}
 
-	const byte *const cmod_base = reinterpret_cast<const byte*>(mapData.data());
+	const byte *const cmod_base = reinterpret_cast<const byte*>(mapBuffer);
 
 	// load into heap
 	CMod_LoadShaders(cmod_base, &header.lumps[LUMP_SHADERS]);
@@ -1108,6 +1161,8 @@ void CM_InitBoxHull()
 
 		SetPlaneSignbits( p );
 	}
+
+	CM_SetBrushSidePlanes( box_brush );
 }
 
 /*
@@ -1142,6 +1197,8 @@ clipHandle_t CM_TempBoxModel( const vec3_t mins, const vec3_t maxs, int capsule
 	box_planes[ 10 ].dist = mins[ 2 ];
 	box_planes[ 11 ].dist = -mins[ 2 ];
 
+	CM_SetBrushSidePlanes( box_brush );
+
 	// First side
 	VectorSet( box_brush->edges[ 0 ].p0, mins[ 0 ], mins[ 1 ], mins[ 2 ] );
 	VectorSet( box_brush->edges[ 0 ].p1, mins[ 0 ], maxs[ 1 ], mins[ 2 ] );
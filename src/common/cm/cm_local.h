@@ -89,10 +89,13 @@ struct cbrush_t
 	vec3_t       bounds[ 2 ];
 	int          numsides;
 	cbrushside_t *sides;
-	int          checkcount; // to avoid repeated testings
-	bool     collided; // marker for optimisation
 	cbrushedge_t *edges;
 	int          numEdges;
+
+	// the side planes split into normal x, y, z and dist arrays, each padded
+	// to a multiple of 4 sides, so that traces can test 4 sides at once
+	float        *sidePlanes;
+	int          sidePlaneStride;
 };
 
 struct cPlane_t
@@ -115,6 +118,15 @@ struct cFacet_t
 	bool borderNoAdjust[ MAX_FACET_BEVELS ];
 };
 
+// node of a bounding volume hierarchy over the facets of a surface, the
+// first child of an interior node immediately follows it
+struct cFacetNode_t
+{
+	vec3_t bounds[ 2 ];
+	int    numFacets; // 0 for interior nodes
+	int    index; // first entry in facetNums for leafs, second child otherwise
+};
+
 struct cSurfaceCollide_t
 {
 	vec3_t   bounds[ 2 ];
@@ -123,11 +135,14 @@ struct cSurfaceCollide_t
 
 	int      numFacets;
 	cFacet_t *facets;
+
+	int          numFacetNodes; // 0 if the surface is too small for a tree
+	cFacetNode_t *facetNodes;
+	int          *facetNums;
 };
 
 struct cSurface_t
 {
-	int               checkcount; // to avoid repeated testings
 	int               surfaceFlags;
 	int               contents;
 	cSurfaceCollide_t *sc;
@@ -185,7 +200,6 @@ struct clipMap_t
 	cSurface_t   **surfaces; // non-patches will be nullptr
 
 	int          floodvalid;
-	int          checkcount; // incremented on each trace
 	bool     perPolyCollision;
 };
 
@@ -194,8 +208,8 @@ struct clipMap_t
 #define SURFACE_CLIP_EPSILON ( 0.125 )
 
 extern clipMap_t cm;
-extern int       c_pointcontents;
-extern int       c_traces, c_brush_traces, c_patch_traces, c_trisoup_traces;
+extern std::atomic<int> c_pointcontents;
+extern std::atomic<int> c_traces, c_brush_traces, c_patch_traces, c_trisoup_traces;
 extern Cvar::Cvar<bool> cm_forceTriangles;
 extern Log::Logger cmLog;
 
@@ -215,8 +229,26 @@ struct sphere_t
 	vec3_t offset;
 };
 
+// Marks left by a single trace, so that brushes and surfaces spanning several
+// leafs are only tested once. Every trace running at the same time needs its
+// own context. The marks are stamped with the trace number, which makes them
+// stale as soon as the next trace starts without clearing anything.
+struct traceContext_t
+{
+	unsigned              checkcount; // incremented on each trace
+	std::vector<unsigned> brushChecks;
+	std::vector<unsigned> brushCollisions; // marker for optimisation
+	std::vector<unsigned> surfaceChecks;
+
+	// scratch space for the facets of a surface collide
+	std::vector<int>      facetNums;
+	std::vector<bool>     planeFrontFacing;
+	std::vector<float>    planeIntersections;
+};
+
 struct traceWork_t
 {
+	traceContext_t *context;
 	traceType_t type;
 	vec3_t      start;
 	vec3_t      end;
@@ -233,8 +265,50 @@ struct traceWork_t
 	sphere_t    sphere; // sphere for oriendted capsule collision
 	biSphere_t  biSphere;
 	bool    testLateralCollision; // whether or not to test for lateral collision
+
+	// the facet hit last, for CM_DrawDebugSurface
+	const cSurfaceCollide_t *debugSurfaceCollide;
+	const cFacet_t          *debugFacet;
 };
 
+// returns false if the brush was already tested by this trace
+inline bool CM_MarkBrushChecked( traceWork_t *tw, const cbrush_t *brush )
+{
+	unsigned &mark = tw->context->brushChecks[ brush - cm.brushes ];
+
+	if ( mark == tw->context->checkcount )
+	{
+		return false;
+	}
+
+	mark = tw->context->checkcount;
+	return true;
+}
+
+// returns false if the surface was already tested by this trace
+inline bool CM_MarkSurfaceChecked( traceWork_t *tw, int surfaceNum )
+{
+	unsigned &mark = tw->context->surfaceChecks[ surfaceNum ];
+
+	if ( mark == tw->context->checkcount )
+	{
+		return false;
+	}
+
+	mark = tw->context->checkcount;
+	return true;
+}
+
+inline void CM_MarkBrushCollided( traceWork_t *tw, const cbrush_t *brush )
+{
+	tw->context->brushCollisions[ brush - cm.brushes ] = tw->context->checkcount;
+}
+
+inline bool CM_BrushCollided( const traceWork_t *tw, const cbrush_t *brush )
+{
+	return tw->context->brushCollisions[ brush - cm.brushes ] == tw->context->checkcount;
+}
+
 struct leafList_t
 {
 	int      count;
@@ -269,6 +343,7 @@ cSurfaceCollide_t              *CM_GenerateTriangleSoupCollide( int numVertexes,
 
 
 void* CM_Alloc( int size );
+void  CM_SetBrushSidePlanes( cbrush_t *brush );
 
 // cm_plane.c
 
@@ -284,13 +359,15 @@ int      CM_FindPlane( const float *p1, const float *p2, const float *p3 );
 planeSide_t CM_PointOnPlaneSide( float *p, int planeNum );
 bool CM_ValidateFacet( cFacet_t *facet );
 void     CM_AddFacetBevels( cFacet_t *facet );
+void     CM_BuildFacetTree( cSurfaceCollide_t *sc );
 bool CM_GenerateFacetFor3Points( cFacet_t *facet, const vec3_t p1, const vec3_t p2, const vec3_t p3 );
 bool CM_GenerateFacetFor4Points( cFacet_t *facet, const vec3_t p1, const vec3_t p2, const vec3_t p3, const vec3_t p4 );
 
 
 // cm_test.c
-extern const cSurfaceCollide_t *debugSurfaceCollide;
-extern const cFacet_t          *debugFacet;
+// set from the traces that aren't batched, which may still run on any thread
+extern std::atomic<const cSurfaceCollide_t *> debugSurfaceCollide;
+extern std::atomic<const cFacet_t *>          debugFacet;
 extern bool                debugBlock;
 extern vec3_t                  debugBlockPoints[ 4 ];
 
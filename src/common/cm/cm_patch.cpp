@@ -38,8 +38,8 @@ Maryland 20850 USA.
 
 int                     c_totalPatchBlocks;
 
-const cSurfaceCollide_t *debugSurfaceCollide;
-const cFacet_t          *debugFacet;
+std::atomic<const cSurfaceCollide_t *> debugSurfaceCollide;
+std::atomic<const cFacet_t *>          debugFacet;
 bool                debugBlock;
 vec3_t                  debugBlockPoints[ 4 ];
 
@@ -877,5 +877,7 @@ cSurfaceCollide_t *CM_GeneratePatchCollide( int width, int height, vec3_t *point
 	sc->bounds[ 1 ][ 1 ] += 1;
 	sc->bounds[ 1 ][ 2 ] += 1;
 
+	CM_BuildFacetTree( sc );
+
 	return sc;
 }
@@ -696,3 +696,189 @@ bool CM_GenerateFacetFor3Points( cFacet_t *facet, const vec3_t p1, const vec3_t
 
 	return true;
 }
+
+/*
+==================
+CM_FacetBounds
+
+Bounds of the facet polygon, with a margin for epsilons like the whole
+surface. The bevels keep traces which are clipped by a facet within these
+bounds expanded by the size of the trace.
+==================
+*/
+static void CM_FacetBounds( const cSurfaceCollide_t *sc, const cFacet_t *facet, vec3_t bounds[ 2 ] )
+{
+	float     plane[ 4 ];
+	int       j;
+	winding_t *w;
+
+	Vector4Copy( sc->planes[ facet->surfacePlane ].plane, plane );
+	w = BaseWindingForPlane( plane, plane[ 3 ] );
+
+	for ( j = 0; j < facet->numBorders && w; j++ )
+	{
+		if ( facet->borderPlanes[ j ] == facet->surfacePlane )
+		{
+			continue;
+		}
+
+		Vector4Copy( sc->planes[ facet->borderPlanes[ j ] ].plane, plane );
+
+		if ( !facet->borderInward[ j ] )
+		{
+			VectorSubtract( vec3_origin, plane, plane );
+			plane[ 3 ] = -plane[ 3 ];
+		}
+
+		ChopWindingInPlace( &w, plane, plane[ 3 ], 0.1f );
+	}
+
+	if ( !w )
+	{
+		// can't happen to a validated facet, never skip it anyway
+		for ( j = 0; j < 3; j++ )
+		{
+			bounds[ 0 ][ j ] = -std::numeric_limits<float>::max();
+			bounds[ 1 ][ j ] = std::numeric_limits<float>::max();
+		}
+
+		return;
+	}
+
+	WindingBounds( w, bounds[ 0 ], bounds[ 1 ] );
+	FreeWinding( w );
+
+	for ( j = 0; j < 3; j++ )
+	{
+		bounds[ 0 ][ j ] -= 1;
+		bounds[ 1 ][ j ] += 1;
+	}
+}
+
+static const int FACET_TREE_MIN_FACETS = 8;
+static const int FACET_TREE_LEAF_FACETS = 4;
+
+struct facetTreeBuild_t
+{
+	std::vector<cFacetNode_t> nodes;
+	std::vector<int>          facetNums;
+	std::vector<float>        facetBounds; // mins and maxs, 6 per facet
+	std::vector<float>        centers; // 3 per facet, clamped to the surface bounds
+};
+
+/*
+==================
+CM_BuildFacetNode
+
+Splits facetNums[ first .. first + count ) at the median center along
+the longest axis until few enough facets are left
+==================
+*/
+static void CM_BuildFacetNode( facetTreeBuild_t *build, int first, int count )
+{
+	int    i, j, axis, nodeNum;
+	vec3_t centerBounds[ 2 ];
+
+	nodeNum = build->nodes.size();
+	build->nodes.emplace_back();
+
+	cFacetNode_t node;
+	ClearBounds( node.bounds[ 0 ], node.bounds[ 1 ] );
+	ClearBounds( centerBounds[ 0 ], centerBounds[ 1 ] );
+
+	for ( i = first; i < first + count; i++ )
+	{
+		int facetNum = build->facetNums[ i ];
+
+		for ( j = 0; j < 3; j++ )
+		{
+			node.bounds[ 0 ][ j ] = std::min( node.bounds[ 0 ][ j ], build->facetBounds[ facetNum * 6 + j ] );
+			node.bounds[ 1 ][ j ] = std::max( node.bounds[ 1 ][ j ], build->facetBounds[ facetNum * 6 + 3 + j ] );
+		}
+
+		AddPointToBounds( &build->centers[ facetNum * 3 ], centerBounds[ 0 ], centerBounds[ 1 ] );
+	}
+
+	axis = 0;
+
+	for ( j = 1; j < 3; j++ )
+	{
+		if ( centerBounds[ 1 ][ j ] - centerBounds[ 0 ][ j ] > centerBounds[ 1 ][ axis ] - centerBounds[ 0 ][ axis ] )
+		{
+			axis = j;
+		}
+	}
+
+	if ( count <= FACET_TREE_LEAF_FACETS || centerBounds[ 1 ][ axis ] == centerBounds[ 0 ][ axis ] )
+	{
+		node.numFacets = count;
+		node.index = first;
+		build->nodes[ nodeNum ] = node;
+		return;
+	}
+
+	const std::vector<float> &centers = build->centers;
+	std::nth_element( build->facetNums.begin() + first, build->facetNums.begin() + first + count / 2,
+	                  build->facetNums.begin() + first + count, [ &centers, axis ]( int a, int b ) {
+		return centers[ a * 3 + axis ] < centers[ b * 3 + axis ];
+	} );
+
+	CM_BuildFacetNode( build, first, count / 2 );
+
+	node.numFacets = 0;
+	node.index = build->nodes.size();
+	build->nodes[ nodeNum ] = node;
+
+	CM_BuildFacetNode( build, first + count / 2, count - count / 2 );
+}
+
+/*
+==================
+CM_BuildFacetTree
+
+Builds the hierarchy which lets traces skip the facets that are far
+from them, surfaces with few facets are tested linearly
+==================
+*/
+void CM_BuildFacetTree( cSurfaceCollide_t *sc )
+{
+	facetTreeBuild_t build;
+	int              i, j;
+
+	sc->numFacetNodes = 0;
+	sc->facetNodes = nullptr;
+	sc->facetNums = nullptr;
+
+	if ( sc->numFacets < FACET_TREE_MIN_FACETS )
+	{
+		return;
+	}
+
+	build.facetNums.resize( sc->numFacets );
+	build.facetBounds.resize( sc->numFacets * 6 );
+	build.centers.resize( sc->numFacets * 3 );
+
+	for ( i = 0; i < sc->numFacets; i++ )
+	{
+		build.facetNums[ i ] = i;
+		vec3_t *bounds = reinterpret_cast<vec3_t *>( &build.facetBounds[ i * 6 ] );
+		CM_FacetBounds( sc, &sc->facets[ i ], bounds );
+
+		// keep the centers of degenerate facets meaningful
+		for ( j = 0; j < 3; j++ )
+		{
+			float mins = std::max( bounds[ 0 ][ j ], sc->bounds[ 0 ][ j ] );
+			float maxs = std::min( bounds[ 1 ][ j ], sc->bounds[ 1 ][ j ] );
+			build.centers[ i * 3 + j ] = 0.5f * ( mins + maxs );
+		}
+	}
+
+	build.nodes.reserve( 2 * sc->numFacets / FACET_TREE_LEAF_FACETS + 1 );
+	CM_BuildFacetNode( &build, 0, sc->numFacets );
+
+	sc->numFacetNodes = build.nodes.size();
+	sc->facetNodes = ( cFacetNode_t * ) CM_Alloc( sc->numFacetNodes * sizeof( *sc->facetNodes ) );
+	Com_Memcpy( sc->facetNodes, build.nodes.data(), sc->numFacetNodes * sizeof( *sc->facetNodes ) );
+	sc->facetNums = ( int * ) CM_Alloc( sc->numFacets * sizeof( *sc->facetNums ) );
+	Com_Memcpy( sc->facetNums, build.facetNums.data(), sc->numFacets * sizeof( *sc->facetNums ) );
+}
@@ -32,6 +32,9 @@ Maryland 20850 USA.
 ===========================================================================
 */
 
+#ifndef CM_PUBLIC_H_
+#define CM_PUBLIC_H_
+
 #include "engine/qcommon/q_shared.h"
 #include "engine/qcommon/qfiles.h"
 #include "engine/renderer/tr_types.h"
@@ -65,8 +68,23 @@ void         CM_TransformedBiSphereTrace( trace_t *results, const vec3_t start,
                                           float startRad, float endRad, clipHandle_t model,
                                           int mask, int skipmask, const vec3_t origin );
 
+// traces don't share any state so they can run from several threads at once,
+// except for those against the model returned by CM_TempBoxModel; batched
+// traces don't update the facet shown by CM_DrawDebugSurface
+struct boxTrace_t
+{
+	vec3_t       start, end;
+	vec3_t       mins, maxs;
+	clipHandle_t model;
+	int          brushmask, skipmask;
+	traceType_t  type;
+};
+
+void         CM_BoxTraceBatch( trace_t *results, const boxTrace_t *traces, int numTraces );
+
 float CM_DistanceToModel( const vec3_t loc, clipHandle_t model );
 
+int   CM_NumClusters();
 byte *CM_ClusterPVS( int cluster );
 
 int  CM_PointLeafnum( const vec3_t p );
@@ -89,3 +107,5 @@ int      CM_MarkFragments( int numPoints, const vec3_t *points, const vec3_t pro
 
 // cm_patch.c
 void CM_DrawDebugSurface( void ( *drawPoly )( int color, int numPoints, float *points ) );
+
+#endif // CM_PUBLIC_H_
@@ -168,8 +168,6 @@ int CM_BoxLeafnums( const vec3_t mins, const vec3_t maxs, int *list, int listsiz
 {
 	leafList_t ll;
 
-	cm.checkcount++;
-
 	VectorCopy( mins, ll.bounds[ 0 ] );
 	VectorCopy( maxs, ll.bounds[ 1 ] );
 	ll.count = 0;
@@ -307,6 +305,11 @@ PVS
 ===============================================================================
 */
 
+int CM_NumClusters()
+{
+	return cm.numClusters;
+}
+
 byte           *CM_ClusterPVS( int cluster )
 {
 	if ( cluster < 0 || cluster >= cm.numClusters || !cm.vised )
@@ -35,6 +35,7 @@ Maryland 20850 USA.
 #include "cm_local.h"
 
 #include "cm_patch.h"
+#include "common/ThreadPool.h"
 
 // always use bbox vs. bbox collision and never capsule vs. bbox or vice versa
 //#define ALWAYS_BBOX_VS_BBOX
@@ -44,6 +45,9 @@ Maryland 20850 USA.
 //#define CAPSULE_DEBUG
 
 Cvar::Cvar<bool> cm_noCurves(VM_STRING_PREFIX "cm_noCurves", "something in cm about curves?", Cvar::CHEAT, false);
+static Cvar::Range<Cvar::Cvar<int>> cm_traceThreads(VM_STRING_PREFIX "cm_traceThreads", "Number of worker threads used by batched traces, 0 to trace on the calling thread", Cvar::NONE, 0, 0, 64);
+
+static Sys::ThreadPool tracePool;
 
 /*
 ===============================================================================
@@ -156,93 +160,394 @@ float CM_DistanceFromLineSquared( vec3_t p, vec3_t lp1, vec3_t lp2, vec3_t dir )
 /*
 ===============================================================================
 
-POSITION TESTING
+TRACE CONTEXTS
 
 ===============================================================================
 */
 
+// contexts which are not used by a running trace
+static std::mutex traceContextMutex;
+static std::vector<std::unique_ptr<traceContext_t>> freeTraceContexts;
+
 /*
 ================
-CM_TestBoxInBrush
+CM_AcquireTraceContext
+
+Hands out a context sized for the current map, reusing a previous one
+when possible
 ================
 */
-static void CM_TestBoxInBrush( traceWork_t *tw, cbrush_t *brush )
+static traceContext_t *CM_AcquireTraceContext()
 {
-	int          i;
-	cplane_t     *plane;
-	float        dist;
-	float        d1;
-	cbrushside_t *side;
-	float        t;
-	vec3_t       startp;
+	traceContext_t *context;
 
-	if ( !brush->numsides )
 	{
-		return;
+		std::lock_guard<std::mutex> lock( traceContextMutex );
+
+		if ( freeTraceContexts.empty() )
+		{
+			context = new traceContext_t;
+			context->checkcount = 0;
+		}
+		else
+		{
+			context = freeTraceContexts.back().release();
+			freeTraceContexts.pop_back();
+		}
 	}
 
-	// special test for axial
-	// the first 6 brush planes are always axial
-	if ( tw->bounds[ 0 ][ 0 ] > brush->bounds[ 1 ][ 0 ]
-	     || tw->bounds[ 0 ][ 1 ] > brush->bounds[ 1 ][ 1 ]
-	     || tw->bounds[ 0 ][ 2 ] > brush->bounds[ 1 ][ 2 ]
-	     || tw->bounds[ 1 ][ 0 ] < brush->bounds[ 0 ][ 0 ]
-	     || tw->bounds[ 1 ][ 1 ] < brush->bounds[ 0 ][ 1 ] || tw->bounds[ 1 ][ 2 ] < brush->bounds[ 0 ][ 2 ] )
+	// marks of an earlier map are older than the next trace number so they
+	// can be kept, only the size matters (+1 for the temporary box brush)
+	size_t numBrushes = cm.numBrushes + 1;
+	size_t numSurfaces = cm.numSurfaces;
+
+	if ( context->brushChecks.size() < numBrushes )
 	{
-		return;
+		context->brushChecks.resize( numBrushes, 0 );
+		context->brushCollisions.resize( numBrushes, 0 );
+	}
+
+	if ( context->surfaceChecks.size() < numSurfaces )
+	{
+		context->surfaceChecks.resize( numSurfaces, 0 );
+	}
+
+	// start over when the trace number wraps around
+	if ( ++context->checkcount == 0 )
+	{
+		std::fill( context->brushChecks.begin(), context->brushChecks.end(), 0 );
+		std::fill( context->brushCollisions.begin(), context->brushCollisions.end(), 0 );
+		std::fill( context->surfaceChecks.begin(), context->surfaceChecks.end(), 0 );
+		context->checkcount = 1;
+	}
+
+	return context;
+}
+
+/*
+================
+CM_ReleaseTraceContext
+================
+*/
+static void CM_ReleaseTraceContext( traceContext_t *context )
+{
+	std::lock_guard<std::mutex> lock( traceContextMutex );
+	freeTraceContexts.emplace_back( context );
+}
+
+// gives the context of a trace back even when Com_Error throws out of it
+struct traceContextGuard_t
+{
+	traceContext_t *context;
+
+	traceContextGuard_t() : context( CM_AcquireTraceContext() ) {}
+	~traceContextGuard_t() { CM_ReleaseTraceContext( context ); }
+};
+
+/*
+================
+CM_SetDebugFacet
+
+Publishes the facet hit by a trace for CM_DrawDebugSurface
+================
+*/
+static void CM_SetDebugFacet( const traceWork_t *tw )
+{
+	if ( tw->debugFacet )
+	{
+		debugSurfaceCollide.store( tw->debugSurfaceCollide, std::memory_order_relaxed );
+		debugFacet.store( tw->debugFacet, std::memory_order_relaxed );
+	}
+}
+
+/*
+===============================================================================
+
+BRUSH SIDE DISTANCES
+
+===============================================================================
+*/
+
+#if idx86_sse
+static inline __m128 CM_SelectPS( __m128 mask, __m128 a, __m128 b )
+{
+	return _mm_or_ps( _mm_and_ps( mask, a ), _mm_andnot_ps( mask, b ) );
+}
+
+static inline __m128 CM_DotPS( __m128 x, __m128 y, __m128 z, const float *v )
+{
+	return _mm_add_ps( _mm_add_ps( _mm_mul_ps( x, _mm_set1_ps( v[ 0 ] ) ), _mm_mul_ps( y, _mm_set1_ps( v[ 1 ] ) ) ),
+	                   _mm_mul_ps( z, _mm_set1_ps( v[ 2 ] ) ) );
+}
+#endif
+
+/*
+================
+CM_BrushSideDistances
+
+Computes the signed distances of the trace start and end points to the brush
+sides first .. first + 3, with the planes pushed out by the size of the traced
+shape. d2 may be nullptr if only the start point is needed. Values for sides
+past the end of the brush are meaningless.
+
+The arithmetic is done in the same order as it used to be per plane, so the
+SSE and scalar versions give exactly the same results.
+================
+*/
+static void CM_BrushSideDistances( const traceWork_t *tw, const cbrush_t *brush, int first, traceType_t type,
+                                   float *d1, float *d2 )
+{
+	const float *normalX = brush->sidePlanes + first;
+	const float *normalY = normalX + brush->sidePlaneStride;
+	const float *normalZ = normalY + brush->sidePlaneStride;
+	const float *planeDist = normalZ + brush->sidePlaneStride;
+
+#if idx86_sse
+	__m128 x = _mm_loadu_ps( normalX );
+	__m128 y = _mm_loadu_ps( normalY );
+	__m128 z = _mm_loadu_ps( normalZ );
+	__m128 dist = _mm_loadu_ps( planeDist );
+
+	if ( type == traceType_t::TT_BISPHERE )
+	{
+		// adjust the plane distance appropriately for radius
+		_mm_storeu_ps( d1, _mm_sub_ps( CM_DotPS( x, y, z, tw->start ),
+		                               _mm_add_ps( dist, _mm_set1_ps( tw->biSphere.startRadius ) ) ) );
+
+		if ( d2 )
+		{
+			_mm_storeu_ps( d2, _mm_sub_ps( CM_DotPS( x, y, z, tw->end ),
+			                               _mm_add_ps( dist, _mm_set1_ps( tw->biSphere.endRadius ) ) ) );
+		}
+	}
+	else if ( type == traceType_t::TT_CAPSULE )
+	{
+		// adjust the plane distance appropriately for radius
+		dist = _mm_add_ps( dist, _mm_set1_ps( tw->sphere.radius ) );
+
+		// find the closest point on the capsule to the plane
+		__m128 offsetX = _mm_set1_ps( tw->sphere.offset[ 0 ] );
+		__m128 offsetY = _mm_set1_ps( tw->sphere.offset[ 1 ] );
+		__m128 offsetZ = _mm_set1_ps( tw->sphere.offset[ 2 ] );
+		__m128 below = _mm_cmpgt_ps( CM_DotPS( x, y, z, tw->sphere.offset ), _mm_setzero_ps() );
+
+		for ( int i = 0; i < 2; i++ )
+		{
+			float       *d = i ? d2 : d1;
+			const float *p = i ? tw->end : tw->start;
+
+			if ( !d )
+			{
+				continue;
+			}
+
+			__m128 pX = _mm_set1_ps( p[ 0 ] );
+			__m128 pY = _mm_set1_ps( p[ 1 ] );
+			__m128 pZ = _mm_set1_ps( p[ 2 ] );
+
+			pX = CM_SelectPS( below, _mm_sub_ps( pX, offsetX ), _mm_add_ps( pX, offsetX ) );
+			pY = CM_SelectPS( below, _mm_sub_ps( pY, offsetY ), _mm_add_ps( pY, offsetY ) );
+			pZ = CM_SelectPS( below, _mm_sub_ps( pZ, offsetZ ), _mm_add_ps( pZ, offsetZ ) );
+
+			_mm_storeu_ps( d, _mm_sub_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( pX, x ), _mm_mul_ps( pY, y ) ),
+			                                          _mm_mul_ps( pZ, z ) ), dist ) );
+		}
 	}
+	else
+	{
+		// adjust the plane distance appropriately for mins/maxs, the
+		// corner used is the one of tw->offsets[ plane->signbits ]
+		__m128 zero = _mm_setzero_ps();
+		__m128 offsetX = CM_SelectPS( _mm_cmplt_ps( x, zero ), _mm_set1_ps( tw->size[ 1 ][ 0 ] ), _mm_set1_ps( tw->size[ 0 ][ 0 ] ) );
+		__m128 offsetY = CM_SelectPS( _mm_cmplt_ps( y, zero ), _mm_set1_ps( tw->size[ 1 ][ 1 ] ), _mm_set1_ps( tw->size[ 0 ][ 1 ] ) );
+		__m128 offsetZ = CM_SelectPS( _mm_cmplt_ps( z, zero ), _mm_set1_ps( tw->size[ 1 ][ 2 ] ), _mm_set1_ps( tw->size[ 0 ][ 2 ] ) );
+
+		dist = _mm_sub_ps( dist, _mm_add_ps( _mm_add_ps( _mm_mul_ps( offsetX, x ), _mm_mul_ps( offsetY, y ) ),
+		                                     _mm_mul_ps( offsetZ, z ) ) );
+
+		_mm_storeu_ps( d1, _mm_sub_ps( CM_DotPS( x, y, z, tw->start ), dist ) );
 
-	if ( tw->type == traceType_t::TT_CAPSULE )
+		if ( d2 )
+		{
+			_mm_storeu_ps( d2, _mm_sub_ps( CM_DotPS( x, y, z, tw->end ), dist ) );
+		}
+	}
+#else
+	for ( int i = 0; i < 4; i++ )
 	{
-		// the first six planes are the axial planes, so we only
-		// need to test the remainder
-		for ( i = 6; i < brush->numsides; i++ )
+		vec3_t normal;
+		float  dist;
+		vec3_t startp, endp;
+
+		VectorSet( normal, normalX[ i ], normalY[ i ], normalZ[ i ] );
+
+		if ( type == traceType_t::TT_BISPHERE )
 		{
-			side = brush->sides + i;
-			plane = side->plane;
+			// adjust the plane distance appropriately for radius
+			d1[ i ] = DotProduct( tw->start, normal ) - ( planeDist[ i ] + tw->biSphere.startRadius );
 
+			if ( d2 )
+			{
+				d2[ i ] = DotProduct( tw->end, normal ) - ( planeDist[ i ] + tw->biSphere.endRadius );
+			}
+		}
+		else if ( type == traceType_t::TT_CAPSULE )
+		{
 			// adjust the plane distance appropriately for radius
-			dist = plane->dist + tw->sphere.radius;
-			// find the closest point on the capsule to the plane
-			t = DotProduct( plane->normal, tw->sphere.offset );
+			dist = planeDist[ i ] + tw->sphere.radius;
 
-			if ( t > 0 )
+			// find the closest point on the capsule to the plane
+			if ( DotProduct( normal, tw->sphere.offset ) > 0 )
 			{
 				VectorSubtract( tw->start, tw->sphere.offset, startp );
+				VectorSubtract( tw->end, tw->sphere.offset, endp );
 			}
 			else
 			{
 				VectorAdd( tw->start, tw->sphere.offset, startp );
+				VectorAdd( tw->end, tw->sphere.offset, endp );
 			}
 
-			d1 = DotProduct( startp, plane->normal ) - dist;
+			d1[ i ] = DotProduct( startp, normal ) - dist;
 
-			// if completely in front of face, no intersection
-			if ( d1 > 0 )
+			if ( d2 )
 			{
-				return;
+				d2[ i ] = DotProduct( endp, normal ) - dist;
+			}
+		}
+		else
+		{
+			// adjust the plane distance appropriately for mins/maxs
+			int signbits = ( normal[ 0 ] < 0 ) | ( ( normal[ 1 ] < 0 ) << 1 ) | ( ( normal[ 2 ] < 0 ) << 2 );
+			dist = planeDist[ i ] - DotProduct( tw->offsets[ signbits ], normal );
+
+			d1[ i ] = DotProduct( tw->start, normal ) - dist;
+
+			if ( d2 )
+			{
+				d2[ i ] = DotProduct( tw->end, normal ) - dist;
 			}
 		}
 	}
-	else
+#endif
+}
+
+/*
+===============================================================================
+
+SURFACE FACETS
+
+===============================================================================
+*/
+
+/*
+================
+CM_FacetsInBounds
+
+Lists the facets of the surface whose bounds intersect the trace, sorted so
+that ties between facets are resolved exactly as when testing all of them
+================
+*/
+static const std::vector<int> &CM_FacetsInBounds( traceWork_t *tw, const cSurfaceCollide_t *sc )
+{
+	std::vector<int> &facetNums = tw->context->facetNums;
+	int              stack[ 64 ];
+	int              stackSize = 0;
+	int              nodeNum = 0;
+	int              i;
+
+	facetNums.clear();
+
+	if ( !sc->numFacetNodes )
 	{
-		// the first six planes are the axial planes, so we only
-		// need to test the remainder
-		for ( i = 6; i < brush->numsides; i++ )
+		for ( i = 0; i < sc->numFacets; i++ )
 		{
-			side = brush->sides + i;
-			plane = side->plane;
+			facetNums.push_back( i );
+		}
 
-			// adjust the plane distance appropriately for mins/maxs
-			dist = plane->dist - DotProduct( tw->offsets[ plane->signbits ], plane->normal );
+		return facetNums;
+	}
 
-			d1 = DotProduct( tw->start, plane->normal ) - dist;
+	while ( true )
+	{
+		const cFacetNode_t *node = &sc->facetNodes[ nodeNum ];
 
-			// if completely in front of face, no intersection
-			if ( d1 > 0 )
+		if ( CM_BoundsIntersect( tw->bounds[ 0 ], tw->bounds[ 1 ], node->bounds[ 0 ], node->bounds[ 1 ] ) )
+		{
+			if ( !node->numFacets )
 			{
-				return;
+				// the first child follows its parent
+				stack[ stackSize++ ] = node->index;
+				nodeNum++;
+				continue;
 			}
+
+			facetNums.insert( facetNums.end(), sc->facetNums + node->index, sc->facetNums + node->index + node->numFacets );
+		}
+
+		if ( !stackSize )
+		{
+			break;
+		}
+
+		nodeNum = stack[ --stackSize ];
+	}
+
+	std::sort( facetNums.begin(), facetNums.end() );
+
+	return facetNums;
+}
+
+/*
+===============================================================================
+
+POSITION TESTING
+
+===============================================================================
+*/
+
+/*
+================
+CM_TestBoxInBrush
+================
+*/
+static void CM_TestBoxInBrush( traceWork_t *tw, cbrush_t *brush )
+{
+	int         i;
+	float       d1[ 4 ];
+	traceType_t type;
+
+	if ( !brush->numsides )
+	{
+		return;
+	}
+
+	// special test for axial
+	// the first 6 brush planes are always axial
+	if ( tw->bounds[ 0 ][ 0 ] > brush->bounds[ 1 ][ 0 ]
+	     || tw->bounds[ 0 ][ 1 ] > brush->bounds[ 1 ][ 1 ]
+	     || tw->bounds[ 0 ][ 2 ] > brush->bounds[ 1 ][ 2 ]
+	     || tw->bounds[ 1 ][ 0 ] < brush->bounds[ 0 ][ 0 ]
+	     || tw->bounds[ 1 ][ 1 ] < brush->bounds[ 0 ][ 1 ] || tw->bounds[ 1 ][ 2 ] < brush->bounds[ 0 ][ 2 ] )
+	{
+		return;
+	}
+
+	type = tw->type == traceType_t::TT_CAPSULE ? traceType_t::TT_CAPSULE : traceType_t::TT_AABB;
+
+	// the first six planes are the axial planes, so we only
+	// need to test the remainder
+	for ( i = 6; i < brush->numsides; i++ )
+	{
+		if ( i == 6 || !( i & 3 ) )
+		{
+			CM_BrushSideDistances( tw, brush, i & ~3, type, d1, nullptr );
+		}
+
+		// if completely in front of face, no intersection
+		if ( d1[ i & 3 ] > 0 )
+		{
+			return;
 		}
 	}
 
@@ -259,7 +564,7 @@ CM_PositionTestInSurfaceCollide
 */
 static bool CM_PositionTestInSurfaceCollide( traceWork_t *tw, const cSurfaceCollide_t *sc )
 {
-	int      i, j;
+	int      j;
 	float    offset, t;
 	cPlane_t *planes;
 	cFacet_t *facet;
@@ -271,11 +576,9 @@ static bool CM_PositionTestInSurfaceCollide( traceWork_t *tw, const cSurfaceColl
 		return false;
 	}
 
-	//
-	facet = sc->facets;
-
-	for ( i = 0; i < sc->numFacets; i++, facet++ )
+	for ( int facetNum : CM_FacetsInBounds( tw, sc ) )
 	{
+		facet = &sc->facets[ facetNum ];
 		planes = &sc->planes[ facet->surfacePlane ];
 		VectorCopy( planes->plane, plane );
 		plane[ 3 ] = planes->plane[ 3 ];
@@ -376,6 +679,7 @@ void CM_TestInLeaf( traceWork_t *tw, cLeaf_t *leaf )
 {
 	int        k;
 	int        brushnum;
+	int        surfaceNum;
 	cbrush_t   *b;
 	cSurface_t *surface;
 
@@ -385,13 +689,11 @@ void CM_TestInLeaf( traceWork_t *tw, cLeaf_t *leaf )
 		brushnum = cm.leafbrushes[ leaf->firstLeafBrush + k ];
 		b = &cm.brushes[ brushnum ];
 
-		if ( b->checkcount == cm.checkcount )
+		if ( !CM_MarkBrushChecked( tw, b ) )
 		{
 			continue; // already checked this brush in another leaf
 		}
 
-		b->checkcount = cm.checkcount;
-
 		if ( !( b->contents & tw->contents ) )
 		{
 			continue;
@@ -413,20 +715,19 @@ void CM_TestInLeaf( traceWork_t *tw, cLeaf_t *leaf )
 	// test against all surfaces
 	for ( k = 0; k < leaf->numLeafSurfaces; k++ )
 	{
-		surface = cm.surfaces[ cm.leafsurfaces[ leaf->firstLeafSurface + k ] ];
+		surfaceNum = cm.leafsurfaces[ leaf->firstLeafSurface + k ];
+		surface = cm.surfaces[ surfaceNum ];
 
 		if ( !surface )
 		{
 			continue;
 		}
 
-		if ( surface->checkcount == cm.checkcount )
+		if ( !CM_MarkSurfaceChecked( tw, surfaceNum ) )
 		{
 			continue; // already checked this surface in another leaf
 		}
 
-		surface->checkcount = cm.checkcount;
-
 		if ( !( surface->contents & tw->contents ) )
 		{
 			continue;
@@ -617,12 +918,8 @@ void CM_PositionTest( traceWork_t *tw )
 	ll.lastLeaf = 0;
 	ll.overflowed = false;
 
-	cm.checkcount++;
-
 	CM_BoxLeafnums_r( &ll, 0 );
 
-	cm.checkcount++;
-
 	// test the contents of the leafs
 	for ( i = 0; i < ll.count; i++ )
 	{
@@ -652,8 +949,8 @@ CM_TracePointThroughSurfaceCollide
 */
 void CM_TracePointThroughSurfaceCollide( traceWork_t *tw, const cSurfaceCollide_t *sc )
 {
-	static bool frontFacing[ SHADER_MAX_TRIANGLES ];
-	static float    intersection[ SHADER_MAX_TRIANGLES ];
+	std::vector<bool>  &frontFacing = tw->context->planeFrontFacing;
+	std::vector<float> &intersection = tw->context->planeIntersections;
 	float           intersect;
 	const cPlane_t  *planes;
 	const cFacet_t  *facet;
@@ -666,6 +963,12 @@ void CM_TracePointThroughSurfaceCollide( traceWork_t *tw, const cSurfaceCollide_
 		return;
 	}
 
+	if ( frontFacing.size() < (size_t) sc->numPlanes )
+	{
+		frontFacing.resize( sc->numPlanes );
+		intersection.resize( sc->numPlanes );
+	}
+
 	// determine the trace's relationship to all planes
 	planes = sc->planes;
 
@@ -700,8 +1003,10 @@ void CM_TracePointThroughSurfaceCollide( traceWork_t *tw, const cSurfaceCollide_
 	}
 
 	// see if any of the surface planes are intersected
-	for ( i = 0, facet = sc->facets; i < sc->numFacets; i++, facet++ )
+	for ( int facetNum : CM_FacetsInBounds( tw, sc ) )
 	{
+		facet = &sc->facets[ facetNum ];
+
 		if ( !frontFacing[ facet->surfacePlane ] )
 		{
 			continue;
@@ -741,8 +1046,8 @@ void CM_TracePointThroughSurfaceCollide( traceWork_t *tw, const cSurfaceCollide_
 
 		if ( j == facet->numBorders )
 		{
-			debugSurfaceCollide = sc;
-			debugFacet = facet;
+			tw->debugSurfaceCollide = sc;
+			tw->debugFacet = facet;
 
 			planes = &sc->planes[ facet->surfacePlane ];
 
@@ -833,7 +1138,7 @@ CM_TraceThroughSurfaceCollide
 */
 void CM_TraceThroughSurfaceCollide( traceWork_t *tw, const cSurfaceCollide_t *sc )
 {
-	int           i, j, hit, hitnum;
+	int           j, hit, hitnum;
 	float         offset, enterFrac, leaveFrac, t;
 	cPlane_t      *planes;
 	cFacet_t      *facet;
@@ -852,8 +1157,9 @@ void CM_TraceThroughSurfaceCollide( traceWork_t *tw, const cSurfaceCollide_t *sc
 		return;
 	}
 
-	for ( i = 0, facet = sc->facets; i < sc->numFacets; i++, facet++ )
+	for ( int facetNum : CM_FacetsInBounds( tw, sc ) )
 	{
+		facet = &sc->facets[ facetNum ];
 		enterFrac = -1.0;
 		leaveFrac = 1.0;
 		hitnum = -1;
@@ -974,8 +1280,8 @@ void CM_TraceThroughSurfaceCollide( traceWork_t *tw, const cSurfaceCollide_t *sc
 					enterFrac = 0;
 				}
 
-				debugSurfaceCollide = sc;
-				debugFacet = facet;
+				tw->debugSurfaceCollide = sc;
+				tw->debugFacet = facet;
 
 				tw->trace.fraction = enterFrac;
 				VectorCopy( bestplane, tw->trace.plane.normal );
@@ -1023,16 +1329,14 @@ CM_TraceThroughBrush
 void CM_TraceThroughBrush( traceWork_t *tw, cbrush_t *brush )
 {
 	int          i;
-	cplane_t     *plane, *clipplane;
-	float        dist;
+	cplane_t     *clipplane;
 	float        enterFrac, leaveFrac;
 	float        d1, d2;
+	float        dist1[ 4 ], dist2[ 4 ];
 	bool     getout, startout;
 	float        f;
-	cbrushside_t *side, *leadside;
-	float        t;
-	vec3_t       startp;
-	vec3_t       endp;
+	cbrushside_t *leadside;
+	traceType_t  type;
 
 	enterFrac = -1.0;
 	leaveFrac = 1.0;
@@ -1050,246 +1354,85 @@ void CM_TraceThroughBrush( traceWork_t *tw, cbrush_t *brush )
 
 	leadside = nullptr;
 
-	if ( tw->type == traceType_t::TT_BISPHERE )
+	if ( tw->type == traceType_t::TT_BISPHERE || tw->type == traceType_t::TT_CAPSULE )
 	{
-		//
-		// compare the trace against all planes of the brush
-		// find the latest time the trace crosses a plane towards the interior
-		// and the earliest time the trace crosses a plane towards the exterior
-		//
-		for ( i = 0; i < brush->numsides; i++ )
-		{
-			side = brush->sides + i;
-			plane = side->plane;
-
-			// adjust the plane distance appropriately for radius
-			d1 = DotProduct( tw->start, plane->normal ) - ( plane->dist + tw->biSphere.startRadius );
-			d2 = DotProduct( tw->end, plane->normal ) - ( plane->dist + tw->biSphere.endRadius );
-
-			if ( d2 > 0 )
-			{
-				getout = true; // endpoint is not in solid
-			}
-
-			if ( d1 > 0 )
-			{
-				startout = true;
-			}
-
-			// if completely in front of face, no intersection with the entire brush
-			if ( d1 > 0 && ( d2 >= SURFACE_CLIP_EPSILON || d2 >= d1 ) )
-			{
-				return;
-			}
-
-			// if it doesn't cross the plane, the plane isn't relevent
-			if ( d1 <= 0 && d2 <= 0 )
-			{
-				continue;
-			}
-
-			brush->collided = true;
-
-			// crosses face
-			if ( d1 > d2 )
-			{
-				// enter
-				f = ( d1 - SURFACE_CLIP_EPSILON ) / ( d1 - d2 );
-
-				if ( f < 0 )
-				{
-					f = 0;
-				}
-
-				if ( f > enterFrac )
-				{
-					enterFrac = f;
-					clipplane = plane;
-					leadside = side;
-				}
-			}
-			else
-			{
-				// leave
-				f = ( d1 + SURFACE_CLIP_EPSILON ) / ( d1 - d2 );
-
-				if ( f > 1 )
-				{
-					f = 1;
-				}
-
-				if ( f < leaveFrac )
-				{
-					leaveFrac = f;
-				}
-			}
-		}
+		type = tw->type;
+	}
+	else
+	{
+		type = traceType_t::TT_AABB;
 	}
-	else if ( tw->type == traceType_t::TT_CAPSULE )
+
+	//
+	// compare the trace against all planes of the brush
+	// find the latest time the trace crosses a plane towards the interior
+	// and the earliest time the trace crosses a plane towards the exterior
+	//
+	for ( i = 0; i < brush->numsides; i++ )
 	{
-		//
-		// compare the trace against all planes of the brush
-		// find the latest time the trace crosses a plane towards the interior
-		// and the earliest time the trace crosses a plane towards the exterior
-		//
-		for ( i = 0; i < brush->numsides; i++ )
+		if ( !( i & 3 ) )
 		{
-			side = brush->sides + i;
-			plane = side->plane;
+			CM_BrushSideDistances( tw, brush, i, type, dist1, dist2 );
+		}
 
-			// adjust the plane distance appropriately for radius
-			dist = plane->dist + tw->sphere.radius;
+		d1 = dist1[ i & 3 ];
+		d2 = dist2[ i & 3 ];
 
-			// find the closest point on the capsule to the plane
-			t = DotProduct( plane->normal, tw->sphere.offset );
+		if ( d2 > 0 )
+		{
+			getout = true; // endpoint is not in solid
+		}
 
-			if ( t > 0 )
-			{
-				VectorSubtract( tw->start, tw->sphere.offset, startp );
-				VectorSubtract( tw->end, tw->sphere.offset, endp );
-			}
-			else
-			{
-				VectorAdd( tw->start, tw->sphere.offset, startp );
-				VectorAdd( tw->end, tw->sphere.offset, endp );
-			}
+		if ( d1 > 0 )
+		{
+			startout = true;
+		}
 
-			d1 = DotProduct( startp, plane->normal ) - dist;
-			d2 = DotProduct( endp, plane->normal ) - dist;
+		// if completely in front of face, no intersection with the entire brush
+		if ( d1 > 0 && ( d2 >= SURFACE_CLIP_EPSILON || d2 >= d1 ) )
+		{
+			return;
+		}
 
-			if ( d2 > 0 )
-			{
-				getout = true; // endpoint is not in solid
-			}
+		// if it doesn't cross the plane, the plane isn't relevant
+		if ( d1 <= 0 && d2 <= 0 )
+		{
+			continue;
+		}
 
-			if ( d1 > 0 )
-			{
-				startout = true;
-			}
+		CM_MarkBrushCollided( tw, brush );
 
-			// if completely in front of face, no intersection with the entire brush
-			if ( d1 > 0 && ( d2 >= SURFACE_CLIP_EPSILON || d2 >= d1 ) )
-			{
-				return;
-			}
+		// crosses face
+		if ( d1 > d2 )
+		{
+			// enter
+			f = ( d1 - SURFACE_CLIP_EPSILON ) / ( d1 - d2 );
 
-			// if it doesn't cross the plane, the plane isn't relevant
-			if ( d1 <= 0 && d2 <= 0 )
+			if ( f < 0 )
 			{
-				continue;
+				f = 0;
 			}
 
-			brush->collided = true;
-
-			// crosses face
-			if ( d1 > d2 )
-			{
-				// enter
-				f = ( d1 - SURFACE_CLIP_EPSILON ) / ( d1 - d2 );
-
-				if ( f < 0 )
-				{
-					f = 0;
-				}
-
-				if ( f > enterFrac )
-				{
-					enterFrac = f;
-					clipplane = plane;
-					leadside = side;
-				}
-			}
-			else
+			if ( f > enterFrac )
 			{
-				// leave
-				f = ( d1 + SURFACE_CLIP_EPSILON ) / ( d1 - d2 );
-
-				if ( f > 1 )
-				{
-					f = 1;
-				}
-
-				if ( f < leaveFrac )
-				{
-					leaveFrac = f;
-				}
+				enterFrac = f;
+				leadside = brush->sides + i;
+				clipplane = leadside->plane;
 			}
 		}
-	}
-	else
-	{
-		//
-		// compare the trace against all planes of the brush
-		// find the latest time the trace crosses a plane towards the interior
-		// and the earliest time the trace crosses a plane towards the exterior
-		//
-		for ( i = 0; i < brush->numsides; i++ )
+		else
 		{
-			side = brush->sides + i;
-			plane = side->plane;
-
-			// adjust the plane distance appropriately for mins/maxs
-			dist = plane->dist - DotProduct( tw->offsets[ plane->signbits ], plane->normal );
+			// leave
+			f = ( d1 + SURFACE_CLIP_EPSILON ) / ( d1 - d2 );
 
-			d1 = DotProduct( tw->start, plane->normal ) - dist;
-			d2 = DotProduct( tw->end, plane->normal ) - dist;
-
-			if ( d2 > 0 )
+			if ( f > 1 )
 			{
-				getout = true; // endpoint is not in solid
+				f = 1;
 			}
 
-			if ( d1 > 0 )
+			if ( f < leaveFrac )
 			{
-				startout = true;
-			}
-
-			// if completely in front of face, no intersection with the entire brush
-			if ( d1 > 0 && ( d2 >= SURFACE_CLIP_EPSILON || d2 >= d1 ) )
-			{
-				return;
-			}
-
-			// if it doesn't cross the plane, the plane isn't relevant
-			if ( d1 <= 0 && d2 <= 0 )
-			{
-				continue;
-			}
-
-			brush->collided = true;
-
-			// crosses face
-			if ( d1 > d2 )
-			{
-				// enter
-				f = ( d1 - SURFACE_CLIP_EPSILON ) / ( d1 - d2 );
-
-				if ( f < 0 )
-				{
-					f = 0;
-				}
-
-				if ( f > enterFrac )
-				{
-					enterFrac = f;
-					clipplane = plane;
-					leadside = side;
-				}
-			}
-			else
-			{
-				// leave
-				f = ( d1 + SURFACE_CLIP_EPSILON ) / ( d1 - d2 );
-
-				if ( f > 1 )
-				{
-					f = 1;
-				}
-
-				if ( f < leaveFrac )
-				{
-					leaveFrac = f;
-				}
+				leaveFrac = f;
 			}
 		}
 	}
@@ -1438,6 +1581,7 @@ void CM_TraceThroughLeaf( traceWork_t *tw, cLeaf_t *leaf )
 {
 	int        k;
 	int        brushnum;
+	int        surfaceNum;
 	cbrush_t   *b;
 	cSurface_t *surface;
 
@@ -1448,13 +1592,11 @@ void CM_TraceThroughLeaf( traceWork_t *tw, cLeaf_t *leaf )
 
 		b = &cm.brushes[ brushnum ];
 
-		if ( b->checkcount == cm.checkcount )
+		if ( !CM_MarkBrushChecked( tw, b ) )
 		{
 			continue; // already checked this brush in another leaf
 		}
 
-		b->checkcount = cm.checkcount;
-
 		if ( !( b->contents & tw->contents ) )
 		{
 			continue;
@@ -1465,8 +1607,6 @@ void CM_TraceThroughLeaf( traceWork_t *tw, cLeaf_t *leaf )
 			continue;
 		}
 
-		b->collided = false;
-
 		if ( !CM_BoundsIntersect( tw->bounds[ 0 ], tw->bounds[ 1 ], b->bounds[ 0 ], b->bounds[ 1 ] ) )
 		{
 			continue;
@@ -1484,20 +1624,19 @@ void CM_TraceThroughLeaf( traceWork_t *tw, cLeaf_t *leaf )
 	// trace line against all surfaces in the leaf
 	for ( k = 0; k < leaf->numLeafSurfaces; k++ )
 	{
-		surface = cm.surfaces[ cm.leafsurfaces[ leaf->firstLeafSurface + k ] ];
+		surfaceNum = cm.leafsurfaces[ leaf->firstLeafSurface + k ];
+		surface = cm.surfaces[ surfaceNum ];
 
 		if ( !surface )
 		{
 			continue;
 		}
 
-		if ( surface->checkcount == cm.checkcount )
+		if ( !CM_MarkSurfaceChecked( tw, surfaceNum ) )
 		{
 			continue; // already checked this surface in another leaf
 		}
 
-		surface->checkcount = cm.checkcount;
-
 		if ( !( surface->contents & tw->contents ) )
 		{
 			continue;
@@ -1531,7 +1670,7 @@ void CM_TraceThroughLeaf( traceWork_t *tw, cLeaf_t *leaf )
 			b = &cm.brushes[ brushnum ];
 
 			// This brush never collided, so don't bother
-			if ( !b->collided )
+			if ( !CM_BrushCollided( tw, b ) )
 			{
 				continue;
 			}
@@ -2064,7 +2203,7 @@ CM_Trace
 */
 static void CM_Trace( trace_t *results, const vec3_t start, const vec3_t end, vec3_t mins,
                       vec3_t maxs, clipHandle_t model, const vec3_t origin, int brushmask,
-                      int skipmask, traceType_t type, sphere_t *sphere )
+                      int skipmask, traceType_t type, sphere_t *sphere, bool batched )
 {
 	int         i;
 	traceWork_t tw;
@@ -2073,8 +2212,6 @@ static void CM_Trace( trace_t *results, const vec3_t start, const vec3_t end, ve
 
 	cmod = CM_ClipHandleToModel( model );
 
-	cm.checkcount++; // for multi-check avoidance
-
 	c_traces++; // for statistics, may be zeroed
 
 	// fill in a default trace
@@ -2090,6 +2227,9 @@ static void CM_Trace( trace_t *results, const vec3_t start, const vec3_t end, ve
 		return; // map not loaded, shouldn't happen
 	}
 
+	traceContextGuard_t contextGuard;
+	tw.context = contextGuard.context;
+
 	// allow nullptr to be passed in for 0,0,0
 	if ( !mins )
 	{
@@ -2313,6 +2453,11 @@ static void CM_Trace( trace_t *results, const vec3_t start, const vec3_t end, ve
 		VectorLerp( start, end, tw.trace.fraction, tw.trace.endpos );
 	}
 
+	if ( !batched )
+	{
+		CM_SetDebugFacet( &tw );
+	}
+
 	*results = tw.trace;
 }
 
@@ -2324,7 +2469,7 @@ CM_BoxTrace
 void CM_BoxTrace( trace_t *results, const vec3_t start, const vec3_t end, vec3_t mins, vec3_t maxs,
                   clipHandle_t model, int brushmask, int skipmask, traceType_t type )
 {
-	CM_Trace( results, start, end, mins, maxs, model, vec3_origin, brushmask, skipmask, type, nullptr );
+	CM_Trace( results, start, end, mins, maxs, model, vec3_origin, brushmask, skipmask, type, nullptr, false );
 }
 
 /*
@@ -2418,7 +2563,7 @@ void CM_TransformedBoxTrace( trace_t *results, const vec3_t start, const vec3_t
 
 	// sweep the box through the model
 	CM_Trace( &trace, start_l, end_l, symetricSize[ 0 ], symetricSize[ 1 ], model, origin,
-			  brushmask, skipmask, type, &sphere );
+			  brushmask, skipmask, type, &sphere, false );
 
 	// if the bmodel was rotated and there was a collision
 	if ( rotated && trace.fraction != 1.0 )
@@ -2437,6 +2582,30 @@ void CM_TransformedBoxTrace( trace_t *results, const vec3_t start, const vec3_t
 	*results = trace;
 }
 
+/*
+==================
+CM_BoxTraceBatch
+
+Runs independent box traces on the trace worker pool, results[i] receives the
+outcome of traces[i]. This must not be called from several threads at once.
+==================
+*/
+void CM_BoxTraceBatch( trace_t *results, const boxTrace_t *traces, int numTraces )
+{
+	tracePool.SetNumThreads( cm_traceThreads.Get() );
+
+	tracePool.ParallelFor( numTraces, [ results, traces ]( int i ) {
+		const boxTrace_t &trace = traces[ i ];
+		vec3_t mins, maxs;
+
+		VectorCopy( trace.mins, mins );
+		VectorCopy( trace.maxs, maxs );
+
+		CM_Trace( &results[ i ], trace.start, trace.end, mins, maxs, trace.model, vec3_origin,
+		          trace.brushmask, trace.skipmask, trace.type, nullptr, true );
+	} );
+}
+
 /*
 ==================
 CM_BiSphereTrace
@@ -2452,8 +2621,6 @@ void CM_BiSphereTrace( trace_t *results, const vec3_t start, const vec3_t end, f
 
 	cmod = CM_ClipHandleToModel( model );
 
-	cm.checkcount++; // for multi-check avoidance
-
 	c_traces++; // for statistics, may be zeroed
 
 	// fill in a default trace
@@ -2471,6 +2638,9 @@ void CM_BiSphereTrace( trace_t *results, const vec3_t start, const vec3_t end, f
 		return; // map not loaded, shouldn't happen
 	}
 
+	traceContextGuard_t contextGuard;
+	tw.context = contextGuard.context;
+
 	// set basic parms
 	tw.contents = mask;
 	tw.skipContents = skipmask;
@@ -2528,6 +2698,8 @@ void CM_BiSphereTrace( trace_t *results, const vec3_t start, const vec3_t end, f
 		}
 	}
 
+	CM_SetDebugFacet( &tw );
+
 	*results = tw.trace;
 }
 
@@ -64,6 +64,13 @@ namespace Audio {
         AL::Buffer toDelete = std::move(buffer);
     }
 
+    void Sample::ListFilesToLoad(std::vector<std::string>& files) {
+        std::string file = FindSoundFile(GetName());
+        if (not file.empty()) {
+            files.push_back(std::move(file));
+        }
+    }
+
     AL::Buffer& Sample::GetBuffer() {
         return buffer;
     }
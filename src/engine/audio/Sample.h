@@ -103,6 +103,7 @@ namespace Audio {
 
             virtual bool Load() OVERRIDE FINAL;
             virtual void Cleanup() OVERRIDE FINAL;
+            virtual void ListFilesToLoad(std::vector<std::string>& files) OVERRIDE FINAL;
 
             AL::Buffer& GetBuffer();
 
@@ -50,9 +50,9 @@ static const soundExtToLoaderMap_t soundLoaders[] =
 
 static int numSoundLoaders = ARRAY_LEN(soundLoaders);
 
-AudioData LoadSoundCodec(std::string filename)
+// Finds the file and loader to use for a sound, returns -1 if there is none
+static int FindSoundLoader(const std::string& filename, std::string& path)
 {
-
 	std::string ext = FS::Path::Extension(filename);
 
 	// if filename has extension, try to load it
@@ -62,7 +62,8 @@ AudioData LoadSoundCodec(std::string filename)
 			if (ext == soundLoaders[i].ext) {
 				// if file exists, load it
 				if (FS::PakPath::FileExists(filename)) {
-					return soundLoaders[i].SoundLoader(filename);
+					path = filename;
+					return i;
 				}
 			}
 		}
@@ -93,8 +94,27 @@ AudioData LoadSoundCodec(std::string filename)
 
 	if (bestLoader >= 0)
 	{
-		std::string altName = Str::Format("%s%s", strippedname, soundLoaders[bestLoader].ext );
-		return soundLoaders[bestLoader].SoundLoader(altName);
+		path = Str::Format("%s%s", strippedname, soundLoaders[bestLoader].ext );
+	}
+
+	return bestLoader;
+}
+
+std::string FindSoundFile(std::string filename)
+{
+	std::string path;
+	FindSoundLoader(filename, path);
+	return path;
+}
+
+AudioData LoadSoundCodec(std::string filename)
+{
+	std::string path;
+	int loader = FindSoundLoader(filename, path);
+
+	if (loader >= 0)
+	{
+		return soundLoaders[loader].SoundLoader(path);
 	}
 
 	if (FS::PakPath::FileExists(filename)) {
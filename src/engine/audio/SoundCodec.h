@@ -38,6 +38,9 @@ namespace Audio {
 
     AudioData LoadSoundCodec(std::string filename);
 
+    // Returns the file LoadSoundCodec would read, or an empty string if there is none
+    std::string FindSoundFile(std::string filename);
+
     AudioData LoadWavCodec(std::string filename);
 
     AudioData LoadOggCodec(std::string filename);
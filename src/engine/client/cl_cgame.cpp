@@ -705,6 +705,9 @@ void CL_InitCGame()
 
 	cls.state = connstate_t::CA_LOADING;
 
+	// start reading the map's assets while the cgame registers them
+	FS_PrefetchMapAssets( mapname );
+
 	// init for this gamestate
 	cgvm.CGameInit(clc.serverMessageSequence, clc.clientNum);
 
@@ -720,6 +723,9 @@ void CL_InitCGame()
 	// on the card even if the driver does deferred loading
 	re.EndRegistration();
 
+	// anything that wasn't used by now won't be
+	FS::PakPath::DiscardPrefetchedFiles();
+
 	// Cause any input while loading to be dropped and forget what's pressed
 	IN_DropInputsForFrame();
 	CL_ClearKeys();
@@ -1109,6 +1115,7 @@ void CGameVM::Start()
 	if ( version != CGAME_API_VERSION ) {
 		Com_Error( errorParm_t::ERR_DROP, "CGame ABI mismatch, expected %d, got %d", CGAME_API_VERSION, version );
 	}
+	this->CreateBulkBuffers();
 	this->CGameStaticInit();
 }
 
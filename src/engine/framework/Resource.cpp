@@ -43,6 +43,9 @@ namespace Resource {
         return true;
     }
 
+    void Resource::ListFilesToLoad(std::vector<std::string>&) {
+    }
+
     bool Resource::IsStillValid() {
         return true;
     }
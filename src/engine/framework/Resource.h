@@ -32,6 +32,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define FRAMEWORK_RESOURCE_H_
 
 #include "common/Common.h"
+#include "common/FileSystem.h"
 
 /*
  * Resource registration logic.
@@ -114,6 +115,11 @@ namespace Resource {
             // Unloads the resource and frees memory. Will always be called after Load.
             virtual void Cleanup() = 0;
 
+            // Adds the files that Load will read to the list, so that they can be
+            // read ahead of time when many resources are loaded at once.
+            // Defaults to []{}
+            virtual void ListFilesToLoad(std::vector<std::string>& files);
+
             // Checks if the resource is still valid and up to date,
             // for example after the FS loads a mod, some resources can have
             // been modified by the mod and what's in memory isn't valid anymore.
@@ -235,6 +241,16 @@ namespace Resource {
         // Delete unused resources
         Prune();
 
+        // Read the files of the new resources on other threads while they are
+        // being loaded one after the other.
+        std::vector<std::string> files;
+        for (auto& entry : resources) {
+            if (not entry.second->loaded) {
+                entry.second->ListFilesToLoad(files);
+            }
+        }
+        FS::PakPath::Prefetch(files);
+
         // And then load the new ones, so as to reduce peak memory usage.
         for (auto it = resources.begin(); it != resources.end(); it ++) {
             if (not it->second->loaded) {
@@ -141,6 +141,13 @@ public:
 		LogMessage(false, false, Msg::id);
 	}
 
+	// Start passing large messages through shared memory, only once the VM
+	// has passed its version check
+	void CreateBulkBuffers()
+	{
+		rootChannel.CreateBulkBuffers();
+	}
+
 	struct InProcessInfo {
 		std::thread thread;
 		std::mutex mutex;
@@ -823,6 +823,7 @@ sysEvent_t Com_GetEvent()
 	char       *s;
 	msg_t      netmsg;
 	netadr_t   adr;
+	int        packetTime;
 
 	// return if we have data
 	if ( eventHead > eventTail )
@@ -849,7 +850,7 @@ sysEvent_t Com_GetEvent()
 	MSG_Init( &netmsg, sys_packetReceived, sizeof( sys_packetReceived ) );
 	adr.type = netadrtype_t::NA_UNSPEC;
 
-	if ( Sys_GetPacket( &adr, &netmsg ) )
+	if ( Sys_GetPacket( &adr, &netmsg, &packetTime ) )
 	{
 		netadr_t *buf;
 		int      len;
@@ -859,7 +860,7 @@ sysEvent_t Com_GetEvent()
 		buf = ( netadr_t * ) Z_Malloc( len );
 		*buf = adr;
 		memcpy( buf + 1, &netmsg.data[ netmsg.readcount ], netmsg.cursize - netmsg.readcount );
-		Com_QueueEvent( 0, sysEventType_t::SE_PACKET, 0, 0, len, buf );
+		Com_QueueEvent( packetTime, sysEventType_t::SE_PACKET, 0, 0, len, buf );
 	}
 
 	// return if we have data
@@ -881,7 +882,7 @@ sysEvent_t Com_GetEvent()
 Com_RunAndTimeServerPacket
 =================
 */
-void Com_RunAndTimeServerPacket( netadr_t *evFrom, msg_t *buf )
+void Com_RunAndTimeServerPacket( netadr_t *evFrom, msg_t *buf, int time )
 {
 	int t1, t2, msec;
 
@@ -892,7 +893,7 @@ void Com_RunAndTimeServerPacket( netadr_t *evFrom, msg_t *buf )
 		t1 = Sys_Milliseconds();
 	}
 
-	SV_PacketEvent( *evFrom, buf );
+	SV_PacketEvent( *evFrom, buf, time );
 
 	if ( com_speeds->integer )
 	{
@@ -952,7 +953,7 @@ int Com_EventLoop()
 				// if the server just shut down, flush the events
 				if ( com_sv_running->integer )
 				{
-					Com_RunAndTimeServerPacket( &evFrom, &buf );
+					Com_RunAndTimeServerPacket( &evFrom, &buf, Sys_Milliseconds() );
 				}
 			}
 
@@ -1065,7 +1066,7 @@ int Com_EventLoop()
 
 				if ( com_sv_running->integer )
 				{
-					Com_RunAndTimeServerPacket( &evFrom, &buf );
+					Com_RunAndTimeServerPacket( &evFrom, &buf, ev.evTime );
 				}
 				else
 				{
@@ -1482,6 +1483,7 @@ static Cvar::Cvar<int> watchdogThreshold("common.watchdogTime", "seconds of serv
 static Cvar::Cvar<std::string> watchdogCmd("common.watchdogCmd", "the command triggered by the watchdog, empty for /quit", Cvar::NONE, "");
 
 static Cvar::Cvar<bool> showTraceStats("common.showTraceStats", "are physics traces stats printed each frame", Cvar::CHEAT, false);
+static Cvar::Cvar<bool> showMessageBufferStats("common.showMessageBufferStats", "are IPC message buffer allocations printed each frame", Cvar::NONE, false);
 
 void Com_Frame()
 {
@@ -1680,11 +1682,11 @@ void Com_Frame()
 	//
 	if ( showTraceStats.Get() )
 	{
-		extern int c_traces, c_brush_traces, c_patch_traces, c_trisoup_traces;
-		extern int c_pointcontents;
+		extern std::atomic<int> c_traces, c_brush_traces, c_patch_traces, c_trisoup_traces;
+		extern std::atomic<int> c_pointcontents;
 
-		Log::Notice( "%4i traces  (%ib %ip %it) %4i points\n", c_traces, c_brush_traces, c_patch_traces, c_trisoup_traces,
-		            c_pointcontents );
+		Log::Notice( "%4i traces  (%ib %ip %it) %4i points\n", c_traces.load(), c_brush_traces.load(), c_patch_traces.load(),
+		            c_trisoup_traces.load(), c_pointcontents.load() );
 		c_traces = 0;
 		c_brush_traces = 0;
 		c_patch_traces = 0;
@@ -1692,6 +1694,16 @@ void Com_Frame()
 		c_pointcontents = 0;
 	}
 
+	//
+	// IPC message buffer tracking
+	//
+	if ( showMessageBufferStats.Get() )
+	{
+		Util::MessageBufferStats stats = Util::GetMessageBufferStats();
+
+		Log::Notice( "%4i message buffers  %i allocations\n", stats.acquired, stats.allocated );
+	}
+
 	// old net chan encryption key
 	//key = lastTime * 0x87243987;
 
@@ -1705,6 +1717,9 @@ Com_Shutdown
 */
 void Com_Shutdown()
 {
+	// also stops the network threads, on fatal errors as well
+	NET_Shutdown();
+
 	if ( logfile )
 	{
 		FS_FCloseFile( logfile );
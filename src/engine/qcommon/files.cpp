@@ -620,6 +620,93 @@ void FS_LoadAllMapMetadata()
 	}
 }
 
+// Adds the file the renderer would load for an image name without extension,
+// using the same preference order as R_LoadImage.
+static void FS_AddImageToPrefetch(Str::StringRef name, std::vector<std::string>& files)
+{
+	static const char* const imageExtensions[] = {"webp", "png", "tga", "jpg", "jpeg", "dds", "crn", "ktx"};
+
+	std::string bestName;
+	const FS::LoadedPakInfo* bestPak = nullptr;
+	for (const char* ext: imageExtensions) {
+		std::string altName = Str::Format("%s.%s", name, ext);
+		const FS::LoadedPakInfo* pak = FS::PakPath::LocateFile(altName);
+		if (pak && (!bestPak || pak < bestPak)) {
+			bestPak = pak;
+			bestName = std::move(altName);
+		}
+	}
+	if (bestPak)
+		files.push_back(std::move(bestName));
+}
+
+void FS_PrefetchMapAssets(Str::StringRef mapName)
+{
+	std::string bspName = "maps/" + mapName + ".bsp";
+	FS::FileView bsp;
+	try {
+		bsp = FS::PakPath::ReadFileView(bspName);
+	} catch (std::system_error&) {
+		return;
+	}
+
+	std::vector<std::string> files;
+
+	dheader_t header;
+	if (bsp.size() < sizeof(header))
+		return;
+	memcpy(&header, bsp.data(), sizeof(header));
+	for (unsigned i = 0; i < sizeof(header) / 4; i++)
+		((int*) &header)[i] = LittleLong(((int*) &header)[i]);
+	auto lumpValid = [&bsp](const lump_t& lump) {
+		return lump.fileofs >= 0 && lump.filelen >= 0 && size_t(lump.fileofs) <= bsp.size() && size_t(lump.filelen) <= bsp.size() - lump.fileofs;
+	};
+
+	// Textures named after the shaders used by the map surfaces. Scripted
+	// shaders may use other images, those are only known once parsed.
+	const lump_t& shaderLump = header.lumps[LUMP_SHADERS];
+	if (lumpValid(shaderLump)) {
+		int numShaders = shaderLump.filelen / sizeof(dshader_t);
+		for (int i = 0; i < numShaders; i++) {
+			dshader_t shader;
+			memcpy(&shader, bsp.data() + shaderLump.fileofs + i * sizeof(dshader_t), sizeof(shader));
+			shader.shader[sizeof(shader.shader) - 1] = '\0';
+			FS_AddImageToPrefetch(shader.shader, files);
+		}
+	}
+
+	// Models and sounds referenced by the entities
+	const lump_t& entityLump = header.lumps[LUMP_ENTITIES];
+	if (lumpValid(entityLump)) {
+		std::string entities(bsp.data() + entityLump.fileofs, entityLump.filelen);
+		const char* data = entities.c_str();
+		std::string key;
+		while (true) {
+			const char* token = COM_Parse(&data);
+			if (!data || !token[0])
+				break;
+			if (token[0] == '{' || token[0] == '}')
+				continue;
+
+			key = token;
+			token = COM_Parse(&data);
+			if (!data)
+				break;
+			if (key == "model" || key == "model2") {
+				if (token[0] != '*')
+					files.push_back(token);
+			} else if (key == "noise" || key == "sound" || key == "music") {
+				files.push_back(token);
+			}
+		}
+	}
+
+	FS::PakPath::Prefetch(files);
+
+	// The map itself is read again by the renderer, hand it the copy read here
+	FS::PakPath::AddPrefetchedFile(bspName, std::move(bsp));
+}
+
 bool FS_LoadServerPaks(const char* paks, bool isDemo)
 {
 	Cmd::Args args(paks);
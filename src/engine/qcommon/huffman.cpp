@@ -39,17 +39,14 @@ Maryland 20850 USA.
 #include "qcommon/q_shared.h"
 #include "qcommon.h"
 
-static int bloc = 0;
-
 //bani - optimized version
 //clears data along the way so we don't have to memset() it ahead of time
 void Huff_putBit( int bit, byte *fout, int *offset )
 {
 	int x, y;
 
-	bloc = *offset;
-	x = bloc >> 3;
-	y = bloc & 7;
+	x = *offset >> 3;
+	y = *offset & 7;
 
 	if ( !y )
 	{
@@ -57,8 +54,7 @@ void Huff_putBit( int bit, byte *fout, int *offset )
 	}
 
 	fout[ x ] |= bit << y;
-	bloc++;
-	*offset = bloc;
+	( *offset )++;
 }
 
 //bani - optimized version
@@ -67,39 +63,64 @@ int Huff_getBit( byte *fin, int *offset )
 {
 	int t;
 
-	bloc = *offset;
-	t = fin[ bloc >> 3 ] >> ( bloc & 7 ) & 0x1;
-	bloc++;
-	*offset = bloc;
+	t = fin[ *offset >> 3 ] >> ( *offset & 7 ) & 0x1;
+	( *offset )++;
 	return t;
 }
 
-//bani - optimized version
-//clears data along the way so we don't have to memset() it ahead of time
-static void add_bit( char bit, byte *fout )
+/*
+Writes numBits (at most 57) bits at once, with the same layout as calling
+Huff_putBit for each of them starting with the lowest one.
+*/
+void Huff_putBits( uint64_t bits, int numBits, byte *fout, int *offset )
 {
-	int x, y;
+	int x, y, last;
 
-	y = bloc >> 3;
-	x = bloc++ & 7;
+	if ( numBits <= 0 )
+	{
+		return;
+	}
+
+	x = *offset >> 3;
+	y = *offset & 7;
+	last = ( *offset + numBits - 1 ) >> 3;
+
+	bits = ( bits & ( ~0ULL >> ( 64 - numBits ) ) ) << y;
+
+	// the start of the first byte may already be used
+	if ( y )
+	{
+		fout[ x ] |= ( byte ) bits;
+	}
+	else
+	{
+		fout[ x ] = ( byte ) bits;
+	}
 
-	if ( !x )
+	while ( x < last )
 	{
-		fout[ y ] = 0;
+		bits >>= 8;
+		fout[ ++x ] = ( byte ) bits;
 	}
 
-	fout[ y ] |= bit << x;
+	*offset += numBits;
 }
 
-//bani - optimized version
-//optimization works on gcc 3.x, but not 2.95 ? most curious.
-static int get_bit( byte *fin )
+/*
+Returns at least the next 57 bits starting at offset, the first one in the
+lowest bit. The bytes after the end of the buffer are read as 0.
+*/
+uint64_t Huff_peekBits( const byte *fin, int size, int offset )
 {
-	int t;
+	int      x = offset >> 3;
+	uint64_t bits = 0;
 
-	t = fin[ bloc >> 3 ] >> ( bloc & 7 ) & 0x1;
-	bloc++;
-	return t;
+	for ( int i = 0; i < 8 && x + i < size; i++ )
+	{
+		bits |= ( uint64_t ) fin[ x + i ] << ( 8 * i );
+	}
+
+	return bits >> ( offset & 7 );
 }
 
 static node_t **get_ppnode( huff_t *huff )
@@ -373,11 +394,11 @@ void Huff_addRef( huff_t *huff, byte ch )
 }
 
 /* Get a symbol */
-int Huff_Receive( node_t *node, int *ch, byte *fin )
+int Huff_Receive( node_t *node, int *ch, byte *fin, int *offset )
 {
 	while ( node && node->symbol == INTERNAL_NODE )
 	{
-		if ( get_bit( fin ) )
+		if ( Huff_getBit( fin, offset ) )
 		{
 			node = node->right;
 		}
@@ -399,11 +420,11 @@ int Huff_Receive( node_t *node, int *ch, byte *fin )
 /* Get a symbol */
 void Huff_offsetReceive( node_t *node, int *ch, byte *fin, int *offset )
 {
-	bloc = *offset;
+	int bloc = *offset;
 
 	while ( node && node->symbol == INTERNAL_NODE )
 	{
-		if ( get_bit( fin ) )
+		if ( Huff_getBit( fin, &bloc ) )
 		{
 			node = node->right;
 		}
@@ -425,57 +446,111 @@ void Huff_offsetReceive( node_t *node, int *ch, byte *fin, int *offset )
 }
 
 /* Send the prefix code for this node */
-static void send( node_t *node, node_t *child, byte *fout )
+static void send( node_t *node, node_t *child, byte *fout, int *offset )
 {
 	if ( node->parent )
 	{
-		send( node->parent, node, fout );
+		send( node->parent, node, fout, offset );
 	}
 
 	if ( child )
 	{
 		if ( node->right == child )
 		{
-			add_bit( 1, fout );
+			Huff_putBit( 1, fout, offset );
 		}
 		else
 		{
-			add_bit( 0, fout );
+			Huff_putBit( 0, fout, offset );
 		}
 	}
 }
 
 /* Send a symbol */
-void Huff_transmit( huff_t *huff, int ch, byte *fout )
+void Huff_transmit( huff_t *huff, int ch, byte *fout, int *offset )
 {
 	int i;
 
 	if ( huff->loc[ ch ] == nullptr )
 	{
 		/* node_t hasn't been transmitted, send a NYT, then the symbol */
-		Huff_transmit( huff, NYT, fout );
+		Huff_transmit( huff, NYT, fout, offset );
 
 		for ( i = 7; i >= 0; i-- )
 		{
-			add_bit( ( char )( ( ch >> i ) & 0x1 ), fout );
+			Huff_putBit( ( ch >> i ) & 0x1, fout, offset );
 		}
 	}
 	else
 	{
-		send( huff->loc[ ch ], nullptr, fout );
+		send( huff->loc[ ch ], nullptr, fout, offset );
 	}
 }
 
 void Huff_offsetTransmit( huff_t *huff, int ch, byte *fout, int *offset )
 {
-	bloc = *offset;
-	send( huff->loc[ ch ], nullptr, fout );
-	*offset = bloc;
+	send( huff->loc[ ch ], nullptr, fout, offset );
+}
+
+/* Flatten the current codes of the tree */
+void Huff_BuildTable( const huff_t *huff, huffTable_t *table )
+{
+	int          ch, length, i;
+	const node_t *node;
+
+	Com_Memset( table, 0, sizeof( *table ) );
+
+	for ( ch = 0; ch <= HMAX; ch++ )
+	{
+		if ( !huff->loc[ ch ] )
+		{
+			continue;
+		}
+
+		length = 0;
+
+		for ( node = huff->loc[ ch ]; node->parent; node = node->parent )
+		{
+			length++;
+		}
+
+		if ( length == 0 || length > 32 )
+		{
+			continue;
+		}
+
+		table->length[ ch ] = length;
+
+		// the bits are sent from the root, so the leaf's one comes last
+		i = length;
+
+		for ( node = huff->loc[ ch ]; node->parent; node = node->parent )
+		{
+			i--;
+
+			if ( node->parent->right == node )
+			{
+				table->code[ ch ] |= 1u << i;
+			}
+		}
+
+		if ( length > HUFF_LOOKUP_BITS )
+		{
+			continue;
+		}
+
+		// every bit pattern starting with the code decodes to this symbol
+		for ( i = 0; i < 1 << ( HUFF_LOOKUP_BITS - length ); i++ )
+		{
+			table->lookupSymbol[ table->code[ ch ] | ( i << length ) ] = ch;
+			table->lookupLength[ table->code[ ch ] | ( i << length ) ] = length;
+		}
+	}
 }
 
 void Huff_Decompress( msg_t *mbuf, int offset )
 {
-	int    ch, cch, i, j, size;
+	int    ch, cch, i, j, size, bloc;
 	byte   seq[ 65536 ];
 	byte   *buffer;
 	huff_t huff;
@@ -511,14 +586,14 @@ void Huff_Decompress( msg_t *mbuf, int offset )
 		ch = 0;
 
 		// don't overflow reading from the messages
-		// FIXME: would it be better to have an overflow check in get_bit ?
+		// FIXME: would it be better to have an overflow check in Huff_getBit ?
 		if ( ( bloc >> 3 ) > size )
 		{
 			seq[ j ] = 0;
 			break;
 		}
 
-		Huff_Receive( huff.tree, &ch, buffer );  /* Get a character */
+		Huff_Receive( huff.tree, &ch, buffer, &bloc );  /* Get a character */
 
 		if ( ch == NYT )
 		{
@@ -527,7 +602,7 @@ void Huff_Decompress( msg_t *mbuf, int offset )
 
 			for ( i = 0; i < 8; i++ )
 			{
-				ch = ( ch << 1 ) + get_bit( buffer );
+				ch = ( ch << 1 ) + Huff_getBit( buffer, &bloc );
 			}
 		}
 
@@ -542,7 +617,7 @@ void Huff_Decompress( msg_t *mbuf, int offset )
 
 void Huff_Compress( msg_t *mbuf, int offset )
 {
-	int    i, ch, size;
+	int    i, ch, size, bloc;
 	byte   seq[ 65536 ];
 	byte   *buffer;
 	huff_t huff;
@@ -572,7 +647,7 @@ void Huff_Compress( msg_t *mbuf, int offset )
 	for ( i = 0; i < size; i++ )
 	{
 		ch = buffer[ i ];
-		Huff_transmit( &huff, ch, seq );  /* Transmit symbol */
+		Huff_transmit( &huff, ch, seq, &bloc );  /* Transmit symbol */
 		Huff_addRef( &huff, ( byte ) ch );  /* Do update */
 	}
 
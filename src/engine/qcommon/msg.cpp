@@ -36,6 +36,7 @@ Maryland 20850 USA.
 #include "qcommon.h"
 
 static huffman_t msgHuff;
+static huffTable_t msgHuffTable; // msgHuff never changes once trained
 static bool  msgInit = false;
 
 /*
@@ -189,34 +190,98 @@ void MSG_WriteBits( msg_t *msg, int value, int bits )
 	}
 	else
 	{
+		uint64_t pending;
+		int      numPending;
+
 		value &= ( 0xffffffff >> ( 32 - bits ) );
 
-		if ( bits & 7 )
-		{
-			int nbits;
+		// the odd bits are sent raw, then every byte is huffman coded,
+		// gather them all and write them at once
+		numPending = bits & 7;
+		pending = value & ( ( 1 << numPending ) - 1 );
+		value = ( unsigned int ) value >> numPending;
+		bits -= numPending;
 
-			nbits = bits & 7;
+		for ( i = 0; i < bits; i += 8 )
+		{
+			int symbol = value & 0xff;
+			int length = msgHuffTable.length[ symbol ];
 
-			for ( i = 0; i < nbits; i++ )
+			if ( !length || numPending + length > 57 )
 			{
-				Huff_putBit( ( value & 1 ), msg->data, &msg->bit );
-				value = ( value >> 1 );
+				Huff_putBits( pending, numPending, msg->data, &msg->bit );
+				pending = 0;
+				numPending = 0;
+
+				if ( !length )
+				{
+					Huff_offsetTransmit( &msgHuff.compressor, symbol, msg->data, &msg->bit );
+					value = ( unsigned int ) value >> 8;
+					continue;
+				}
 			}
 
-			bits = bits - nbits;
+			pending |= ( uint64_t ) msgHuffTable.code[ symbol ] << numPending;
+			numPending += length;
+			value = ( unsigned int ) value >> 8;
 		}
 
-		if ( bits )
+		Huff_putBits( pending, numPending, msg->data, &msg->bit );
+
+		msg->cursize = ( msg->bit >> 3 ) + 1;
+	}
+}
+
+/*
+Appends bits that MSG_WriteBits wrote to another message starting at its
+first bit. The huffman codes don't depend on what was written before them,
+so an encoded part of a message can be reused as is.
+
+MSG_WriteBits checks for overflow before each of the writes, which aren't
+known anymore. Returns false without writing anything when the message
+ends too close to tell whether they would have overflowed, the caller must
+then do the writes itself.
+*/
+bool MSG_WriteEncodedBits( msg_t *msg, const byte *data, int numBits, int uncompsize )
+{
+	if ( msg->oob )
+	{
+		Com_Error( errorParm_t::ERR_DROP, "MSG_WriteEncodedBits: out of band message" );
+	}
+
+	// the first write would have overflowed already
+	if ( msg->maxsize - msg->cursize < 32 )
+	{
+		msg->uncompsize += uncompsize; // NERVE - SMF - net debugging
+		msg->overflowed = true;
+		return true;
+	}
+
+	// the last write starts before the last bit, so none of them overflows
+	// if there still is room at that point
+	if ( msg->maxsize - std::max( msg->cursize, ( ( msg->bit + numBits - 1 ) >> 3 ) + 1 ) < 32 )
+	{
+		return false;
+	}
+
+	msg->uncompsize += uncompsize; // NERVE - SMF - net debugging
+
+	// whole bytes are read so the chunks stay aligned in data
+	for ( int i = 0; i < numBits; i += 56 )
+	{
+		int      chunkBits = std::min( 56, numBits - i );
+		uint64_t bits = 0;
+
+		for ( int j = 0; j < ( chunkBits + 7 ) >> 3; j++ )
 		{
-			for ( i = 0; i < bits; i += 8 )
-			{
-				Huff_offsetTransmit( &msgHuff.compressor, ( value & 0xff ), msg->data, &msg->bit );
-				value = ( value >> 8 );
-			}
+			bits |= ( uint64_t ) data[ ( i >> 3 ) + j ] << ( 8 * j );
 		}
 
-		msg->cursize = ( msg->bit >> 3 ) + 1;
+		Huff_putBits( bits, chunkBits, msg->data, &msg->bit );
 	}
+
+	msg->cursize = ( msg->bit >> 3 ) + 1;
+	return true;
 }
 
 int MSG_ReadBits( msg_t *msg, int bits )
@@ -269,29 +334,47 @@ int MSG_ReadBits( msg_t *msg, int bits )
 	}
 	else
 	{
-		nbits = 0;
+		uint64_t stream;
+		int      numUsed;
 
-		if ( bits & 7 )
+		// look at the next bits all at once instead of reading them one by one
+		stream = Huff_peekBits( msg->data, msg->maxsize, msg->bit );
+
+		nbits = bits & 7;
+		value = stream & ( ( 1 << nbits ) - 1 );
+		numUsed = nbits;
+		bits -= nbits;
+
+		for ( i = 0; i < bits; i += 8 )
 		{
-			nbits = bits & 7;
+			int lookup;
 
-			for ( i = 0; i < nbits; i++ )
+			if ( numUsed + HUFF_LOOKUP_BITS > 57 )
 			{
-				value |= ( Huff_getBit( msg->data, &msg->bit ) << i );
+				msg->bit += numUsed;
+				stream = Huff_peekBits( msg->data, msg->maxsize, msg->bit );
+				numUsed = 0;
 			}
 
-			bits = bits - nbits;
-		}
+			lookup = ( stream >> numUsed ) & ( ( 1 << HUFF_LOOKUP_BITS ) - 1 );
 
-		if ( bits )
-		{
-			for ( i = 0; i < bits; i += 8 )
+			if ( msgHuffTable.lookupLength[ lookup ] )
 			{
+				get = msgHuffTable.lookupSymbol[ lookup ];
+				numUsed += msgHuffTable.lookupLength[ lookup ];
+			}
+			else
+			{
+				msg->bit += numUsed;
 				Huff_offsetReceive( msgHuff.decompressor.tree, &get, msg->data, &msg->bit );
-				value |= ( get << ( i + nbits ) );
+				stream = Huff_peekBits( msg->data, msg->maxsize, msg->bit );
+				numUsed = 0;
 			}
+
+			value |= ( get << ( i + nbits ) );
 		}
 
+		msg->bit += numUsed;
 		msg->readcount = ( msg->bit >> 3 ) + 1;
 	}
 
@@ -898,76 +981,78 @@ struct netField_t
 	const char *name;
 	int  offset;
 	int  bits;
-	int  used;
 };
 
 #define NETF( x ) # x,int((size_t)&( (entityState_t*)0 )->x)
 
 static netField_t entityStateFields[] =
 {
-	{ NETF( eType ),             8              , 0 },
-	{ NETF( eFlags ),            24             , 0 },
-	{ NETF( pos.trType ),        8              , 0 },
-	{ NETF( pos.trTime ),        32             , 0 },
-	{ NETF( pos.trDuration ),    32             , 0 },
-	{ NETF( pos.trBase[ 0 ] ),   0              , 0 },
-	{ NETF( pos.trBase[ 1 ] ),   0              , 0 },
-	{ NETF( pos.trBase[ 2 ] ),   0              , 0 },
-	{ NETF( pos.trDelta[ 0 ] ),  0              , 0 },
-	{ NETF( pos.trDelta[ 1 ] ),  0              , 0 },
-	{ NETF( pos.trDelta[ 2 ] ),  0              , 0 },
-	{ NETF( apos.trType ),       8              , 0 },
-	{ NETF( apos.trTime ),       32             , 0 },
-	{ NETF( apos.trDuration ),   32             , 0 },
-	{ NETF( apos.trBase[ 0 ] ),  0              , 0 },
-	{ NETF( apos.trBase[ 1 ] ),  0              , 0 },
-	{ NETF( apos.trBase[ 2 ] ),  0              , 0 },
-	{ NETF( apos.trDelta[ 0 ] ), 0              , 0 },
-	{ NETF( apos.trDelta[ 1 ] ), 0              , 0 },
-	{ NETF( apos.trDelta[ 2 ] ), 0              , 0 },
-	{ NETF( time ),              32             , 0 },
-	{ NETF( time2 ),             32             , 0 },
-	{ NETF( origin[ 0 ] ),       0              , 0 },
-	{ NETF( origin[ 1 ] ),       0              , 0 },
-	{ NETF( origin[ 2 ] ),       0              , 0 },
-	{ NETF( origin2[ 0 ] ),      0              , 0 },
-	{ NETF( origin2[ 1 ] ),      0              , 0 },
-	{ NETF( origin2[ 2 ] ),      0              , 0 },
-	{ NETF( angles[ 0 ] ),       0              , 0 },
-	{ NETF( angles[ 1 ] ),       0              , 0 },
-	{ NETF( angles[ 2 ] ),       0              , 0 },
-	{ NETF( angles2[ 0 ] ),      0              , 0 },
-	{ NETF( angles2[ 1 ] ),      0              , 0 },
-	{ NETF( angles2[ 2 ] ),      0              , 0 },
-	{ NETF( otherEntityNum ),    GENTITYNUM_BITS, 0 },
-	{ NETF( otherEntityNum2 ),   GENTITYNUM_BITS, 0 },
-	{ NETF( groundEntityNum ),   GENTITYNUM_BITS, 0 },
-	{ NETF( loopSound ),         8              , 0 },
-	{ NETF( constantLight ),     32             , 0 },
-	{ NETF( modelindex ),        MODELINDEX_BITS, 0 },
-	{ NETF( modelindex2 ),       MODELINDEX_BITS, 0 },
-	{ NETF( frame ),             16             , 0 },
-	{ NETF( clientNum ),         8              , 0 },
-	{ NETF( solid ),             24             , 0 },
-	{ NETF( event ),             10             , 0 },
-	{ NETF( eventParm ),         8              , 0 },
-	{ NETF( eventSequence ),     8              , 0 },  // warning: need to modify cg_event.c at "// check the sequencial list" if you change this
-	{ NETF( events[ 0 ] ),       8              , 0 },
-	{ NETF( events[ 1 ] ),       8              , 0 },
-	{ NETF( events[ 2 ] ),       8              , 0 },
-	{ NETF( events[ 3 ] ),       8              , 0 },
-	{ NETF( eventParms[ 0 ] ),   8              , 0 },
-	{ NETF( eventParms[ 1 ] ),   8              , 0 },
-	{ NETF( eventParms[ 2 ] ),   8              , 0 },
-	{ NETF( eventParms[ 3 ] ),   8              , 0 },
-	{ NETF( weapon ),            8              , 0 },
-	{ NETF( legsAnim ),          ANIM_BITS      , 0 },
-	{ NETF( torsoAnim ),         ANIM_BITS      , 0 },
-	{ NETF( generic1 ),          10             , 0 },
-	{ NETF( misc ),              MAX_MISC       , 0 },
-	{ NETF( weaponAnim ),        ANIM_BITS      , 0 },
+	{ NETF( eType ),             8 },
+	{ NETF( eFlags ),            24 },
+	{ NETF( pos.trType ),        8 },
+	{ NETF( pos.trTime ),        32 },
+	{ NETF( pos.trDuration ),    32 },
+	{ NETF( pos.trBase[ 0 ] ),   0 },
+	{ NETF( pos.trBase[ 1 ] ),   0 },
+	{ NETF( pos.trBase[ 2 ] ),   0 },
+	{ NETF( pos.trDelta[ 0 ] ),  0 },
+	{ NETF( pos.trDelta[ 1 ] ),  0 },
+	{ NETF( pos.trDelta[ 2 ] ),  0 },
+	{ NETF( apos.trType ),       8 },
+	{ NETF( apos.trTime ),       32 },
+	{ NETF( apos.trDuration ),   32 },
+	{ NETF( apos.trBase[ 0 ] ),  0 },
+	{ NETF( apos.trBase[ 1 ] ),  0 },
+	{ NETF( apos.trBase[ 2 ] ),  0 },
+	{ NETF( apos.trDelta[ 0 ] ), 0 },
+	{ NETF( apos.trDelta[ 1 ] ), 0 },
+	{ NETF( apos.trDelta[ 2 ] ), 0 },
+	{ NETF( time ),              32 },
+	{ NETF( time2 ),             32 },
+	{ NETF( origin[ 0 ] ),       0 },
+	{ NETF( origin[ 1 ] ),       0 },
+	{ NETF( origin[ 2 ] ),       0 },
+	{ NETF( origin2[ 0 ] ),      0 },
+	{ NETF( origin2[ 1 ] ),      0 },
+	{ NETF( origin2[ 2 ] ),      0 },
+	{ NETF( angles[ 0 ] ),       0 },
+	{ NETF( angles[ 1 ] ),       0 },
+	{ NETF( angles[ 2 ] ),       0 },
+	{ NETF( angles2[ 0 ] ),      0 },
+	{ NETF( angles2[ 1 ] ),      0 },
+	{ NETF( angles2[ 2 ] ),      0 },
+	{ NETF( otherEntityNum ),    GENTITYNUM_BITS },
+	{ NETF( otherEntityNum2 ),   GENTITYNUM_BITS },
+	{ NETF( groundEntityNum ),   GENTITYNUM_BITS },
+	{ NETF( loopSound ),         8 },
+	{ NETF( constantLight ),     32 },
+	{ NETF( modelindex ),        MODELINDEX_BITS },
+	{ NETF( modelindex2 ),       MODELINDEX_BITS },
+	{ NETF( frame ),             16 },
+	{ NETF( clientNum ),         8 },
+	{ NETF( solid ),             24 },
+	{ NETF( event ),             10 },
+	{ NETF( eventParm ),         8 },
+	{ NETF( eventSequence ),     8 },  // warning: need to modify cg_event.c at "// check the sequencial list" if you change this
+	{ NETF( events[ 0 ] ),       8 },
+	{ NETF( events[ 1 ] ),       8 },
+	{ NETF( events[ 2 ] ),       8 },
+	{ NETF( events[ 3 ] ),       8 },
+	{ NETF( eventParms[ 0 ] ),   8 },
+	{ NETF( eventParms[ 1 ] ),   8 },
+	{ NETF( eventParms[ 2 ] ),   8 },
+	{ NETF( eventParms[ 3 ] ),   8 },
+	{ NETF( weapon ),            8 },
+	{ NETF( legsAnim ),          ANIM_BITS },
+	{ NETF( torsoAnim ),         ANIM_BITS },
+	{ NETF( generic1 ),          10 },
+	{ NETF( misc ),              MAX_MISC },
+	{ NETF( weaponAnim ),        ANIM_BITS },
 };
 
+// how often each field changed, snapshots can be encoded from several threads
+static std::atomic<int> entityStateFieldsUsed[ ARRAY_LEN( entityStateFields ) ];
+
 static int QDECL qsort_entitystatefields( const void *a, const void *b )
 {
 	int aa, bb;
@@ -975,12 +1060,12 @@ static int QDECL qsort_entitystatefields( const void *a, const void *b )
 	aa = * ( ( int * ) a );
 	bb = * ( ( int * ) b );
 
-	if ( entityStateFields[ aa ].used > entityStateFields[ bb ].used )
+	if ( entityStateFieldsUsed[ aa ] > entityStateFieldsUsed[ bb ] )
 	{
 		return -1;
 	}
 
-	if ( entityStateFields[ bb ].used > entityStateFields[ aa ].used )
+	if ( entityStateFieldsUsed[ bb ] > entityStateFieldsUsed[ aa ] )
 	{
 		return 1;
 	}
@@ -1079,7 +1164,7 @@ void MSG_WriteDeltaEntity( msg_t *msg, entityState_t *from, entityState_t *to, b
 		{
 			lc = i + 1;
 
-			field->used++;
+			entityStateFieldsUsed[ i ].fetch_add( 1, std::memory_order_relaxed );
 		}
 	}
 
@@ -1371,115 +1456,117 @@ player_state_t communication
 
 static netField_t playerStateFields[] =
 {
-	{ PSF( commandTime ),          32             , 0 }
+	{ PSF( commandTime ),          32 }
 	,
-	{ PSF( pm_type ),              8              , 0 }
+	{ PSF( pm_type ),              8 }
 	,
-	{ PSF( bobCycle ),             8              , 0 }
+	{ PSF( bobCycle ),             8 }
 	,
-	{ PSF( pm_flags ),             16             , 0 }
+	{ PSF( pm_flags ),             16 }
 	,
-	{ PSF( pm_time ),              -16            , 0 }
+	{ PSF( pm_time ),              -16 }
 	,
-	{ PSF( origin[ 0 ] ),          0              , 0 }
+	{ PSF( origin[ 0 ] ),          0 }
 	,
-	{ PSF( origin[ 1 ] ),          0              , 0 }
+	{ PSF( origin[ 1 ] ),          0 }
 	,
-	{ PSF( origin[ 2 ] ),          0              , 0 }
+	{ PSF( origin[ 2 ] ),          0 }
 	,
-	{ PSF( velocity[ 0 ] ),        0              , 0 }
+	{ PSF( velocity[ 0 ] ),        0 }
 	,
-	{ PSF( velocity[ 1 ] ),        0              , 0 }
+	{ PSF( velocity[ 1 ] ),        0 }
 	,
-	{ PSF( velocity[ 2 ] ),        0              , 0 }
+	{ PSF( velocity[ 2 ] ),        0 }
 	,
-	{ PSF( weaponTime ),           -16            , 0 }
+	{ PSF( weaponTime ),           -16 }
 	,
-	{ PSF( gravity ),              16             , 0 }
+	{ PSF( gravity ),              16 }
 	,
-	{ PSF( speed ),                16             , 0 }
+	{ PSF( speed ),                16 }
 	,
-	{ PSF( delta_angles[ 0 ] ),    16             , 0 }
+	{ PSF( delta_angles[ 0 ] ),    16 }
 	,
-	{ PSF( delta_angles[ 1 ] ),    16             , 0 }
+	{ PSF( delta_angles[ 1 ] ),    16 }
 	,
-	{ PSF( delta_angles[ 2 ] ),    16             , 0 }
+	{ PSF( delta_angles[ 2 ] ),    16 }
 	,
-	{ PSF( groundEntityNum ),      GENTITYNUM_BITS, 0 }
+	{ PSF( groundEntityNum ),      GENTITYNUM_BITS }
 	,
-	{ PSF( legsTimer ),            16             , 0 }
+	{ PSF( legsTimer ),            16 }
 	,
-	{ PSF( torsoTimer ),           16             , 0 }
+	{ PSF( torsoTimer ),           16 }
 	,
-	{ PSF( legsAnim ),             ANIM_BITS      , 0 }
+	{ PSF( legsAnim ),             ANIM_BITS }
 	,
-	{ PSF( torsoAnim ),            ANIM_BITS      , 0 }
+	{ PSF( torsoAnim ),            ANIM_BITS }
 	,
-	{ PSF( movementDir ),          8              , 0 }
+	{ PSF( movementDir ),          8 }
 	,
-	{ PSF( eFlags ),               24             , 0 }
+	{ PSF( eFlags ),               24 }
 	,
-	{ PSF( eventSequence ),        8              , 0 }
+	{ PSF( eventSequence ),        8 }
 	,
-	{ PSF( events[ 0 ] ),          8              , 0 }
+	{ PSF( events[ 0 ] ),          8 }
 	,
-	{ PSF( events[ 1 ] ),          8              , 0 }
+	{ PSF( events[ 1 ] ),          8 }
 	,
-	{ PSF( events[ 2 ] ),          8              , 0 }
+	{ PSF( events[ 2 ] ),          8 }
 	,
-	{ PSF( events[ 3 ] ),          8              , 0 }
+	{ PSF( events[ 3 ] ),          8 }
 	,
-	{ PSF( eventParms[ 0 ] ),      8              , 0 }
+	{ PSF( eventParms[ 0 ] ),      8 }
 	,
-	{ PSF( eventParms[ 1 ] ),      8              , 0 }
+	{ PSF( eventParms[ 1 ] ),      8 }
 	,
-	{ PSF( eventParms[ 2 ] ),      8              , 0 }
+	{ PSF( eventParms[ 2 ] ),      8 }
 	,
-	{ PSF( eventParms[ 3 ] ),      8              , 0 }
+	{ PSF( eventParms[ 3 ] ),      8 }
 	,
-	{ PSF( clientNum ),            8              , 0 }
+	{ PSF( clientNum ),            8 }
 	,
-	{ PSF( weapon ),               7              , 0 }
+	{ PSF( weapon ),               7 }
 	,
-	{ PSF( weaponstate ),          4              , 0 }
+	{ PSF( weaponstate ),          4 }
 	,
-	{ PSF( viewangles[ 0 ] ),      0              , 0 }
+	{ PSF( viewangles[ 0 ] ),      0 }
 	,
-	{ PSF( viewangles[ 1 ] ),      0              , 0 }
+	{ PSF( viewangles[ 1 ] ),      0 }
 	,
-	{ PSF( viewangles[ 2 ] ),      0              , 0 }
+	{ PSF( viewangles[ 2 ] ),      0 }
 	,
-	{ PSF( viewheight ),           -8             , 0 }
+	{ PSF( viewheight ),           -8 }
 	,
-	{ PSF( damageEvent ),          8              , 0 }
+	{ PSF( damageEvent ),          8 }
 	,
-	{ PSF( damageYaw ),            8              , 0 }
+	{ PSF( damageYaw ),            8 }
 	,
-	{ PSF( damagePitch ),          8              , 0 }
+	{ PSF( damagePitch ),          8 }
 	,
-	{ PSF( damageCount ),          8              , 0 }
+	{ PSF( damageCount ),          8 }
 	,
-	{ PSF( generic1 ),             10             , 0 }
+	{ PSF( generic1 ),             10 }
 	,
-	{ PSF( loopSound ),            16             , 0 }
+	{ PSF( loopSound ),            16 }
 	,
-	{ PSF( grapplePoint[ 0 ] ),    0              , 0 }
+	{ PSF( grapplePoint[ 0 ] ),    0 }
 	,
-	{ PSF( grapplePoint[ 1 ] ),    0              , 0 }
+	{ PSF( grapplePoint[ 1 ] ),    0 }
 	,
-	{ PSF( grapplePoint[ 2 ] ),    0              , 0 }
+	{ PSF( grapplePoint[ 2 ] ),    0 }
 	,
-	{ PSF( ammo ),                 12             , 0 }
+	{ PSF( ammo ),                 12 }
 	,
-	{ PSF( clips ),                4              , 0 }
+	{ PSF( clips ),                4 }
 	,
-	{ PSF( tauntTimer ),           12             , 0 }
+	{ PSF( tauntTimer ),           12 }
 	,
-	{ PSF( otherEntityNum ),       10             , 0 }
+	{ PSF( otherEntityNum ),       10 }
 	,
-	{ PSF( weaponAnim ),           ANIM_BITS      , 0 }
+	{ PSF( weaponAnim ),           ANIM_BITS }
 };
 
+static std::atomic<int> playerStateFieldsUsed[ ARRAY_LEN( playerStateFields ) ];
+
 static int QDECL qsort_playerstatefields( const void *a, const void *b )
 {
 	int aa, bb;
@@ -1487,12 +1574,12 @@ static int QDECL qsort_playerstatefields( const void *a, const void *b )
 	aa = * ( ( int * ) a );
 	bb = * ( ( int * ) b );
 
-	if ( playerStateFields[ aa ].used > playerStateFields[ bb ].used )
+	if ( playerStateFieldsUsed[ aa ] > playerStateFieldsUsed[ bb ] )
 	{
 		return -1;
 	}
 
-	if ( playerStateFields[ bb ].used > playerStateFields[ aa ].used )
+	if ( playerStateFieldsUsed[ bb ] > playerStateFieldsUsed[ aa ] )
 	{
 		return 1;
 	}
@@ -1585,7 +1672,7 @@ void MSG_WriteDeltaPlayerstate( msg_t *msg, playerState_t *from, playerState_t *
 		{
 			lc = i + 1;
 
-			field->used++;
+			playerStateFieldsUsed[ i ].fetch_add( 1, std::memory_order_relaxed );
 		}
 	}
 
@@ -2208,6 +2295,9 @@ void MSG_initHuffman()
 			Huff_addRef( &msgHuff.decompressor, ( byte ) i );  /* Do update */
 		}
 	}
+
+	// both trees saw the same data so they have the same codes
+	Huff_BuildTable( &msgHuff.compressor, &msgHuffTable );
 }
 
 //===========================================================================
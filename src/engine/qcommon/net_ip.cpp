@@ -36,6 +36,11 @@ Maryland 20850 USA.
 #include "qcommon/qcommon.h"
 #include <common/FileSystem.h>
 
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
 #ifdef BUILD_SERVER
 #include "server/server.h"
 #endif
@@ -98,6 +103,10 @@ static bool winsockInitialized = false;
 #               include <sys/filio.h>
 #       endif
 
+#       ifdef __linux__
+#               include <sys/epoll.h>
+#       endif
+
 using SOCKET = int;
 #       define INVALID_SOCKET -1
 #       define SOCKET_ERROR   -1
@@ -135,6 +144,10 @@ static cvar_t              *net_port;
 static cvar_t              *net_port6;
 static cvar_t              *net_mcast6addr;
 static cvar_t              *net_mcast6iface;
+#ifdef __linux__
+static cvar_t              *net_batchIO;
+#endif
+static cvar_t              *net_recvThread;
 
 static struct sockaddr     socksRelayAddr;
 
@@ -172,6 +185,87 @@ struct nip_localaddr_t
 static nip_localaddr_t localIP[ MAX_IPS ];
 static int             numIP;
 
+#ifdef __linux__
+/*
+With net_batchIO, the sockets are drained with recvmmsg into a ring of
+packets that Sys_GetPacket hands out one at a time, and the packets sent
+between NET_BeginPacketBatch and NET_EndPacketBatch go out with sendmmsg.
+NET_Sleep waits on an epoll instance holding the sockets.
+*/
+
+static const int NET_BATCH_PACKETS = 32;
+
+// room for the data of the queued outgoing packets
+static const int NET_SEND_BATCH_BYTES = 64 * 1024;
+
+struct batchRecvPacket_t
+{
+	SOCKET                  socket;
+	struct sockaddr_storage from;
+	socklen_t               fromlen;
+	int                     length;
+	byte                    data[ MAX_MSGLEN ];
+};
+
+struct batchSendPacket_t
+{
+	SOCKET                  socket;
+	struct sockaddr_storage to;
+	socklen_t               tolen;
+	netadrtype_t            type;
+	int                     offset;
+	int                     length;
+};
+
+static batchRecvPacket_t recvBatch[ NET_BATCH_PACKETS ];
+static int               recvBatchHead;
+static int               recvBatchCount;
+
+static batchSendPacket_t sendBatch[ NET_BATCH_PACKETS ];
+static int               sendBatchCount;
+static byte              sendBatchData[ NET_SEND_BATCH_BYTES ];
+static int               sendBatchBytes;
+static int               sendBatchDepth;
+
+// set when the kernel lacks recvmmsg or sendmmsg
+static bool              batchIOUnsupported = false;
+
+static int               epollFd = -1;
+#endif
+
+/*
+With net_recvThread, a thread blocks on the sockets and timestamps the
+packets as they arrive. They reach the main thread through a bounded
+single-producer/single-consumer ring of bytes, where each packet takes a
+header followed by its data.
+*/
+
+static const size_t NET_RECV_QUEUE_BYTES = 1024 * 1024;
+static const size_t NET_RECV_QUEUE_ALIGN = 64;
+
+struct queuedPacket_t
+{
+	netadr_t from;
+	int      time;
+	int      readcount;
+	int      cursize; // -1 when the rest of the buffer is skipped
+};
+
+static_assert( sizeof( queuedPacket_t ) <= NET_RECV_QUEUE_ALIGN, "the header must fit at the end of the buffer" );
+static_assert( NET_RECV_QUEUE_BYTES % NET_RECV_QUEUE_ALIGN == 0, "the buffer must hold whole slots" );
+
+static std::thread             recvThread;
+static std::atomic<bool>       recvThreadRunning;
+static std::vector<byte>       recvQueue;
+static std::atomic<size_t>     recvQueueHead; // written by the receive thread
+static std::atomic<size_t>     recvQueueTail; // written by the main thread
+static std::atomic<int>        recvQueueDropped;
+
+// lets NET_Sleep wake up when a packet is queued
+static std::mutex              recvSleepMutex;
+static std::condition_variable recvSleepCondition;
+static std::atomic<bool>       recvSleeping;
+
 //=============================================================================
 
 /*
@@ -704,73 +798,186 @@ bool        NET_IsLocalAddress( netadr_t adr )
 
 /*
 ==================
-Sys_GetPacket
+NET_ReadPacket
 
-Never called by the game logic, just the system event queuing
+Fills the address and the message of a packet received on a socket,
+returns false if the packet must be dropped
 ==================
 */
-bool Sys_GetPacket( netadr_t *net_from, msg_t *net_message )
+static bool NET_ReadPacket( SOCKET sock, struct sockaddr_storage *from, socklen_t fromlen, int length, netadr_t *net_from, msg_t *net_message )
 {
-	int                     ret;
-	struct sockaddr_storage from;
+	if ( sock == ip_socket )
+	{
+		memset( ( ( struct sockaddr_in * ) from )->sin_zero, 0, 8 );
+	}
 
-	socklen_t               fromlen;
-	int                     err;
+	if ( sock == ip_socket && usingSocks && memcmp( from, &socksRelayAddr, fromlen ) == 0 )
+	{
+		if ( length < 10 || net_message->data[ 0 ] != 0 || net_message->data[ 1 ] != 0 || net_message->data[ 2 ] != 0 || net_message->data[ 3 ] != 1 )
+		{
+			return false;
+		}
 
-	if ( ip_socket != INVALID_SOCKET )
+		net_from->type = netadrtype_t::NA_IP;
+		net_from->ip[ 0 ] = net_message->data[ 4 ];
+		net_from->ip[ 1 ] = net_message->data[ 5 ];
+		net_from->ip[ 2 ] = net_message->data[ 6 ];
+		net_from->ip[ 3 ] = net_message->data[ 7 ];
+		net_from->port = * ( short * ) &net_message->data[ 8 ];
+		net_message->readcount = 10;
+	}
+	else
 	{
-		fromlen = sizeof( from );
-		ret = recvfrom( ip_socket, ( char * ) net_message->data, net_message->maxsize, 0, ( struct sockaddr * ) &from, &fromlen );
+		SockadrToNetadr( ( struct sockaddr * ) from, net_from );
+		net_message->readcount = 0;
+	}
+
+	if ( length == net_message->maxsize )
+	{
+		Log::Notice( "Oversize packet from %s\n", NET_AdrToString( *net_from ) );
+		return false;
+	}
+
+	net_message->cursize = length;
+	return true;
+}
+
+#ifdef __linux__
+/*
+==================
+NET_FillRecvBatch
+
+Drains the sockets into the ring, returns false if nothing was waiting
+==================
+*/
+static bool NET_FillRecvBatch()
+{
+	struct mmsghdr msgs[ NET_BATCH_PACKETS ];
+	struct iovec   iovecs[ NET_BATCH_PACKETS ];
+
+	SOCKET sockets[] = {
+		ip_socket,
+		ip6_socket,
+		multicast6_socket != ip6_socket ? multicast6_socket : INVALID_SOCKET,
+	};
+
+	recvBatchHead = 0;
+	recvBatchCount = 0;
+
+	for ( SOCKET sock : sockets )
+	{
+		if ( sock == INVALID_SOCKET || recvBatchCount == NET_BATCH_PACKETS )
+		{
+			continue;
+		}
+
+		int first = recvBatchCount;
+		int count = NET_BATCH_PACKETS - first;
+
+		for ( int i = first; i < NET_BATCH_PACKETS; i++ )
+		{
+			iovecs[ i ].iov_base = recvBatch[ i ].data;
+			iovecs[ i ].iov_len = sizeof( recvBatch[ i ].data );
+
+			memset( &msgs[ i ], 0, sizeof( msgs[ i ] ) );
+			msgs[ i ].msg_hdr.msg_name = &recvBatch[ i ].from;
+			msgs[ i ].msg_hdr.msg_namelen = sizeof( recvBatch[ i ].from );
+			msgs[ i ].msg_hdr.msg_iov = &iovecs[ i ];
+			msgs[ i ].msg_hdr.msg_iovlen = 1;
+		}
+
+		int ret = recvmmsg( sock, &msgs[ first ], count, MSG_DONTWAIT, nullptr );
 
 		if ( ret == SOCKET_ERROR )
 		{
-			err = socketError;
+			int err = socketError;
+
+			if ( err == ENOSYS )
+			{
+				Log::Notice( "recvmmsg is not supported, falling back to recvfrom" );
+				batchIOUnsupported = true;
+				return false;
+			}
 
 			if ( err != EAGAIN && err != ECONNRESET )
 			{
 				Log::Notice( "NET_GetPacket: %s\n", NET_ErrorString() );
 			}
+
+			continue;
 		}
-		else
+
+		for ( int i = first; i < first + ret; i++ )
 		{
-			memset( ( ( struct sockaddr_in * ) &from )->sin_zero, 0, 8 );
+			recvBatch[ i ].socket = sock;
+			recvBatch[ i ].fromlen = msgs[ i ].msg_hdr.msg_namelen;
+			recvBatch[ i ].length = msgs[ i ].msg_len;
+		}
 
-			if ( usingSocks && memcmp( &from, &socksRelayAddr, fromlen ) == 0 )
-			{
-				if ( ret < 10 || net_message->data[ 0 ] != 0 || net_message->data[ 1 ] != 0 || net_message->data[ 2 ] != 0 || net_message->data[ 3 ] != 1 )
-				{
-					return false;
-				}
+		recvBatchCount += ret;
+	}
 
-				net_from->type = netadrtype_t::NA_IP;
-				net_from->ip[ 0 ] = net_message->data[ 4 ];
-				net_from->ip[ 1 ] = net_message->data[ 5 ];
-				net_from->ip[ 2 ] = net_message->data[ 6 ];
-				net_from->ip[ 3 ] = net_message->data[ 7 ];
-				net_from->port = * ( short * ) &net_message->data[ 8 ];
-				net_message->readcount = 10;
-			}
-			else
-			{
-				SockadrToNetadr( ( struct sockaddr * ) &from, net_from );
-				net_message->readcount = 0;
-			}
+	return recvBatchCount > 0;
+}
+#endif
 
-			if ( ret == net_message->maxsize )
-			{
-				Log::Notice( "Oversize packet from %s\n", NET_AdrToString( *net_from ) );
-				return false;
-			}
+enum class recvResult_t
+{
+	NONE, // nothing is waiting on the sockets
+	DROPPED,
+	PACKET
+};
 
-			net_message->cursize = ret;
-			return true;
+/*
+==================
+NET_ReceivePacket
+==================
+*/
+static recvResult_t NET_ReceivePacket( netadr_t *net_from, msg_t *net_message )
+{
+	int                     ret;
+	struct sockaddr_storage from;
+
+	socklen_t               fromlen;
+	int                     err;
+
+#ifdef __linux__
+	if ( net_batchIO->integer && !batchIOUnsupported )
+	{
+		if ( recvBatchHead < recvBatchCount || NET_FillRecvBatch() )
+		{
+			const batchRecvPacket_t &packet = recvBatch[ recvBatchHead++ ];
+
+			ret = std::min( packet.length, net_message->maxsize );
+			memcpy( net_message->data, packet.data, ret );
+			from = packet.from;
+
+			return NET_ReadPacket( packet.socket, &from, packet.fromlen, ret, net_from, net_message ) ? recvResult_t::PACKET : recvResult_t::DROPPED;
+		}
+
+		// unless recvmmsg turned out to be missing, there is nothing to read
+		if ( !batchIOUnsupported )
+		{
+			return recvResult_t::NONE;
 		}
 	}
+#endif
 
-	if ( ip6_socket != INVALID_SOCKET )
+	SOCKET sockets[] = {
+		ip_socket,
+		ip6_socket,
+		multicast6_socket != ip6_socket ? multicast6_socket : INVALID_SOCKET,
+	};
+
+	for ( SOCKET sock : sockets )
 	{
+		if ( sock == INVALID_SOCKET )
+		{
+			continue;
+		}
+
 		fromlen = sizeof( from );
-		ret = recvfrom( ip6_socket, ( char * ) net_message->data, net_message->maxsize, 0, ( struct sockaddr * ) &from, &fromlen );
+		ret = recvfrom( sock, ( char * ) net_message->data, net_message->maxsize, 0, ( struct sockaddr * ) &from, &fromlen );
 
 		if ( ret == SOCKET_ERROR )
 		{
@@ -780,59 +987,487 @@ bool Sys_GetPacket( netadr_t *net_from, msg_t *net_message )
 			{
 				Log::Notice( "NET_GetPacket: %s\n", NET_ErrorString() );
 			}
+
+			continue;
 		}
-		else
+
+		return NET_ReadPacket( sock, &from, fromlen, ret, net_from, net_message ) ? recvResult_t::PACKET : recvResult_t::DROPPED;
+	}
+
+	return recvResult_t::NONE;
+}
+
+/*
+==================
+NET_WaitForPackets
+
+Waits up to msec for a packet to arrive on one of the sockets
+==================
+*/
+static void NET_WaitForPackets( int msec )
+{
+	struct timeval timeout;
+
+	fd_set         fdset;
+	SOCKET         highestfd = INVALID_SOCKET;
+
+	FD_ZERO( &fdset );
+
+	for ( SOCKET sock : { ip_socket, ip6_socket, multicast6_socket } )
+	{
+		if ( sock == INVALID_SOCKET )
 		{
-			SockadrToNetadr( ( struct sockaddr * ) &from, net_from );
-			net_message->readcount = 0;
+			continue;
+		}
 
-			if ( ret == net_message->maxsize )
-			{
-				Log::Notice( "Oversize packet from %s\n", NET_AdrToString( *net_from ) );
-				return false;
-			}
+		FD_SET( sock, &fdset );
+
+		if ( highestfd == INVALID_SOCKET || sock > highestfd )
+		{
+			highestfd = sock;
+		}
+	}
+
+	if ( highestfd == INVALID_SOCKET )
+	{
+		return;
+	}
+
+	timeout.tv_sec = msec / 1000;
+	timeout.tv_usec = ( msec % 1000 ) * 1000;
+	select( highestfd + 1, &fdset, nullptr, nullptr, &timeout );
+}
+
+/*
+==================
+NET_PushRecvQueue
+
+Called by the receive thread only, returns false if the queue is full
+==================
+*/
+static bool NET_PushRecvQueue( const netadr_t *from, int time, const msg_t *msg )
+{
+	size_t head = recvQueueHead.load( std::memory_order_relaxed );
+	size_t tail = recvQueueTail.load( std::memory_order_acquire );
+	size_t offset = head % NET_RECV_QUEUE_BYTES;
+	size_t size = PAD( sizeof( queuedPacket_t ) + msg->cursize, NET_RECV_QUEUE_ALIGN );
+
+	// a packet never wraps around, the end of the buffer is skipped instead
+	size_t skip = NET_RECV_QUEUE_BYTES - offset < size ? NET_RECV_QUEUE_BYTES - offset : 0;
+
+	if ( head + skip + size - tail > NET_RECV_QUEUE_BYTES )
+	{
+		return false;
+	}
+
+	if ( skip )
+	{
+		( ( queuedPacket_t * ) &recvQueue[ offset ] )->cursize = -1;
+		offset = 0;
+	}
+
+	queuedPacket_t *packet = ( queuedPacket_t * ) &recvQueue[ offset ];
+
+	packet->from = *from;
+	packet->time = time;
+	packet->readcount = msg->readcount;
+	packet->cursize = msg->cursize;
+	memcpy( packet + 1, msg->data, msg->cursize );
+
+	recvQueueHead.store( head + skip + size, std::memory_order_release );
+	return true;
+}
+
+/*
+==================
+NET_PopRecvQueue
+==================
+*/
+static bool NET_PopRecvQueue( netadr_t *net_from, msg_t *net_message, int *time )
+{
+	size_t head = recvQueueHead.load( std::memory_order_acquire );
+	size_t tail = recvQueueTail.load( std::memory_order_relaxed );
+
+	while ( tail != head )
+	{
+		size_t               offset = tail % NET_RECV_QUEUE_BYTES;
+		const queuedPacket_t *packet = ( const queuedPacket_t * ) &recvQueue[ offset ];
+
+		if ( packet->cursize < 0 )
+		{
+			tail += NET_RECV_QUEUE_BYTES - offset;
+			continue;
+		}
+
+		bool fits = packet->cursize <= net_message->maxsize;
+
+		if ( fits )
+		{
+			*net_from = packet->from;
+			*time = packet->time;
+			net_message->readcount = packet->readcount;
+			net_message->cursize = packet->cursize;
+			memcpy( net_message->data, packet + 1, packet->cursize );
+		}
+
+		tail += PAD( sizeof( queuedPacket_t ) + packet->cursize, NET_RECV_QUEUE_ALIGN );
+		recvQueueTail.store( tail, std::memory_order_release );
 
-			net_message->cursize = ret;
+		if ( fits )
+		{
 			return true;
 		}
 	}
 
-	if ( multicast6_socket != INVALID_SOCKET && multicast6_socket != ip6_socket )
+	recvQueueTail.store( tail, std::memory_order_release );
+	return false;
+}
+
+/*
+==================
+NET_RecvThread
+
+Blocks on the sockets and queues the packets for the main thread with the
+time they arrived
+==================
+*/
+static void NET_RecvThread()
+{
+	static byte data[ MAX_MSGLEN ];
+
+	while ( recvThreadRunning )
 	{
-		fromlen = sizeof( from );
-		ret = recvfrom( multicast6_socket, ( char * ) net_message->data, net_message->maxsize, 0, ( struct sockaddr * ) &from, &fromlen );
+		// wake up regularly to notice when the thread has to stop
+		NET_WaitForPackets( 100 );
 
-		if ( ret == SOCKET_ERROR )
+		while ( recvThreadRunning )
 		{
-			err = socketError;
+			netadr_t     from;
+			msg_t        msg;
+			recvResult_t result;
 
-			if ( err != EAGAIN && err != ECONNRESET )
+			MSG_Init( &msg, data, sizeof( data ) );
+			from.type = netadrtype_t::NA_UNSPEC;
+
+			result = NET_ReceivePacket( &from, &msg );
+
+			if ( result == recvResult_t::NONE )
 			{
-				Log::Notice( "NET_GetPacket: %s\n", NET_ErrorString() );
+				break;
+			}
+
+			if ( result == recvResult_t::DROPPED )
+			{
+				continue;
+			}
+
+			if ( !NET_PushRecvQueue( &from, Sys_Milliseconds(), &msg ) )
+			{
+				recvQueueDropped++;
+				continue;
+			}
+
+			// NET_Sleep sets recvSleeping before checking the queue, so the
+			// store of the head must not be reordered after this load
+			std::atomic_thread_fence( std::memory_order_seq_cst );
+
+			if ( recvSleeping )
+			{
+				std::lock_guard<std::mutex> lock( recvSleepMutex );
+				recvSleepCondition.notify_one();
 			}
 		}
+	}
+}
+
+/*
+==================
+NET_StartRecvThread
+==================
+*/
+static void NET_StartRecvThread()
+{
+	if ( !net_recvThread->integer || ( ip_socket == INVALID_SOCKET && ip6_socket == INVALID_SOCKET ) )
+	{
+		return;
+	}
+
+	recvQueue.resize( NET_RECV_QUEUE_BYTES );
+	recvQueueHead = 0;
+	recvQueueTail = 0;
+	recvQueueDropped = 0;
+
+	recvThreadRunning = true;
+	recvThread = std::thread( NET_RecvThread );
+}
+
+/*
+==================
+NET_StopRecvThread
+
+The packets still in the queue are dropped
+==================
+*/
+static void NET_StopRecvThread()
+{
+	if ( !recvThread.joinable() )
+	{
+		return;
+	}
+
+	recvThreadRunning = false;
+
+	// a fatal error raised by the thread itself shuts down from it
+	if ( recvThread.get_id() == std::this_thread::get_id() )
+	{
+		recvThread.detach();
+	}
+	else
+	{
+		recvThread.join();
+	}
+
+	recvQueueHead = 0;
+	recvQueueTail = 0;
+}
+
+// Stops the receive thread when the process exits without NET_Shutdown,
+// destroying a running std::thread would terminate it. Declared after the
+// state the thread uses so that it is destroyed first.
+struct RecvThreadGuard
+{
+	~RecvThreadGuard()
+	{
+		NET_StopRecvThread();
+	}
+};
+static RecvThreadGuard recvThreadGuard;
+
+// Keeps the receive thread stopped while the main thread changes the sockets
+// it reads, the packets already queued are kept
+struct recvThreadPause_t
+{
+	bool paused;
+
+	recvThreadPause_t()
+		: paused( recvThread.joinable() )
+	{
+		if ( paused )
+		{
+			recvThreadRunning = false;
+			recvThread.join();
+		}
+	}
+
+	~recvThreadPause_t()
+	{
+		if ( paused )
+		{
+			recvThreadRunning = true;
+			recvThread = std::thread( NET_RecvThread );
+		}
+	}
+};
+
+/*
+==================
+Sys_GetPacket
+
+Never called by the game logic, just the system event queuing. The time is
+when the packet arrived.
+==================
+*/
+bool Sys_GetPacket( netadr_t *net_from, msg_t *net_message, int *time )
+{
+	if ( recvThread.joinable() )
+	{
+		int dropped = recvQueueDropped.exchange( 0 );
+
+		if ( dropped )
+		{
+			Log::Warn( "%i packets were dropped, the receive queue is full", dropped );
+		}
+
+		return NET_PopRecvQueue( net_from, net_message, time );
+	}
+
+	*time = Sys_Milliseconds();
+
+	return NET_ReceivePacket( net_from, net_message ) == recvResult_t::PACKET;
+}
+
+//=============================================================================
+
+static char socksBuf[ 4096 ];
+
+/*
+==================
+NET_SendPacketError
+==================
+*/
+static void NET_SendPacketError( int err, netadrtype_t type, sa_family_t family )
+{
+	// wouldblock is silent
+	if ( err == EAGAIN )
+	{
+		return;
+	}
+
+	// some PPP links do not allow broadcasts and return an error
+	if ( ( err == EADDRNOTAVAIL ) && ( ( type == netadrtype_t::NA_BROADCAST ) ) )
+	{
+		return;
+	}
+
+	if ( family == AF_INET )
+	{
+		Log::Notice( "Sys_SendPacket (ipv4): %s\n", NET_ErrorString() );
+	}
+	else if ( family == AF_INET6 )
+	{
+		Log::Notice( "Sys_SendPacket (ipv6): %s\n", NET_ErrorString() );
+	}
+	else
+	{
+		Log::Notice( "Sys_SendPacket (%i): %s\n", family , NET_ErrorString() );
+	}
+}
+
+#ifdef __linux__
+/*
+==================
+NET_FlushSendBatch
+
+Sends the queued packets, with one sendmmsg for each run of packets going
+out of the same socket
+==================
+*/
+static void NET_FlushSendBatch()
+{
+	struct mmsghdr msgs[ NET_BATCH_PACKETS ];
+	struct iovec   iovecs[ NET_BATCH_PACKETS ];
+
+	for ( int i = 0; i < sendBatchCount; i++ )
+	{
+		iovecs[ i ].iov_base = sendBatchData + sendBatch[ i ].offset;
+		iovecs[ i ].iov_len = sendBatch[ i ].length;
+
+		memset( &msgs[ i ], 0, sizeof( msgs[ i ] ) );
+		msgs[ i ].msg_hdr.msg_name = &sendBatch[ i ].to;
+		msgs[ i ].msg_hdr.msg_namelen = sendBatch[ i ].tolen;
+		msgs[ i ].msg_hdr.msg_iov = &iovecs[ i ];
+		msgs[ i ].msg_hdr.msg_iovlen = 1;
+	}
+
+	int i = 0;
+
+	while ( i < sendBatchCount )
+	{
+		const batchSendPacket_t &packet = sendBatch[ i ];
+		int                     ret;
+
+		if ( batchIOUnsupported )
+		{
+			ret = sendto( packet.socket, sendBatchData + packet.offset, packet.length, 0, ( struct sockaddr * ) &packet.to, packet.tolen );
+			ret = ret == SOCKET_ERROR ? ret : 1;
+		}
 		else
 		{
-			SockadrToNetadr( ( struct sockaddr * ) &from, net_from );
-			net_message->readcount = 0;
+			int count = 1;
 
-			if ( ret == net_message->maxsize )
+			while ( i + count < sendBatchCount && sendBatch[ i + count ].socket == packet.socket )
 			{
-				Log::Notice( "Oversize packet from %s\n", NET_AdrToString( *net_from ) );
-				return false;
+				count++;
 			}
 
-			net_message->cursize = ret;
-			return true;
+			ret = sendmmsg( packet.socket, &msgs[ i ], count, 0 );
+
+			if ( ret == SOCKET_ERROR && socketError == ENOSYS )
+			{
+				Log::Notice( "sendmmsg is not supported, falling back to sendto" );
+				batchIOUnsupported = true;
+				continue;
+			}
+		}
+
+		// the packets before the one that failed went out, skip it and go on
+		if ( ret == SOCKET_ERROR )
+		{
+			NET_SendPacketError( socketError, packet.type, packet.to.ss_family );
 		}
+
+		i += std::max( ret, 1 );
 	}
 
-	return false;
+	sendBatchCount = 0;
+	sendBatchBytes = 0;
 }
 
-//=============================================================================
+/*
+==================
+NET_QueueSendBatch
 
-static char socksBuf[ 4096 ];
+Returns false if the packet doesn't fit in the batch and has to be sent
+right away
+==================
+*/
+static bool NET_QueueSendBatch( SOCKET sock, const struct sockaddr_storage *to, socklen_t tolen, netadrtype_t type, const void *data, int length )
+{
+	if ( length > NET_SEND_BATCH_BYTES )
+	{
+		return false;
+	}
+
+	if ( sendBatchCount == NET_BATCH_PACKETS || sendBatchBytes + length > NET_SEND_BATCH_BYTES )
+	{
+		NET_FlushSendBatch();
+	}
+
+	batchSendPacket_t &packet = sendBatch[ sendBatchCount++ ];
+
+	packet.socket = sock;
+	packet.to = *to;
+	packet.tolen = tolen;
+	packet.type = type;
+	packet.offset = sendBatchBytes;
+	packet.length = length;
+
+	memcpy( sendBatchData + sendBatchBytes, data, length );
+	sendBatchBytes += length;
+
+	return true;
+}
+#endif
+
+/*
+==================
+NET_BeginPacketBatch
+
+Until the matching NET_EndPacketBatch, the packets may be held back to be
+sent together
+==================
+*/
+void NET_BeginPacketBatch()
+{
+#ifdef __linux__
+	sendBatchDepth++;
+#endif
+}
+
+/*
+==================
+NET_EndPacketBatch
+==================
+*/
+void NET_EndPacketBatch()
+{
+#ifdef __linux__
+	if ( --sendBatchDepth == 0 && sendBatchCount )
+	{
+		NET_FlushSendBatch();
+	}
+#endif
+}
 
 /*
 ==================
@@ -878,44 +1513,36 @@ void Sys_SendPacket( int length, const void *data, netadr_t to )
 	}
 	else
 	{
+		SOCKET    sock = INVALID_SOCKET;
+		socklen_t addrlen = 0;
+
 		if ( addr.ss_family == AF_INET )
 		{
-			ret = sendto( ip_socket, ( const char* )data, length, 0, ( struct sockaddr * ) &addr, sizeof( struct sockaddr_in ) );
+			sock = ip_socket;
+			addrlen = sizeof( struct sockaddr_in );
 		}
 		else if ( addr.ss_family == AF_INET6 )
 		{
-			ret = sendto( ip6_socket, ( const char* )data, length, 0, ( struct sockaddr * ) &addr, sizeof( struct sockaddr_in6 ) );
+			sock = ip6_socket;
+			addrlen = sizeof( struct sockaddr_in6 );
 		}
-	}
-
-	if ( ret == SOCKET_ERROR )
-	{
-		int err = socketError;
 
-		// wouldblock is silent
-		if ( err == EAGAIN )
+		if ( sock != INVALID_SOCKET )
 		{
-			return;
-		}
+#ifdef __linux__
+			if ( sendBatchDepth && net_batchIO->integer && NET_QueueSendBatch( sock, &addr, addrlen, to.type, data, length ) )
+			{
+				return;
+			}
+#endif
 
-		// some PPP links do not allow broadcasts and return an error
-		if ( ( err == EADDRNOTAVAIL ) && ( ( to.type == netadrtype_t::NA_BROADCAST ) ) )
-		{
-			return;
+			ret = sendto( sock, ( const char* )data, length, 0, ( struct sockaddr * ) &addr, addrlen );
 		}
+	}
 
-		if ( addr.ss_family == AF_INET )
-		{
-			Log::Notice( "Sys_SendPacket (ipv4): %s\n", NET_ErrorString() );
-		}
-		else if ( addr.ss_family == AF_INET6 )
-		{
-			Log::Notice( "Sys_SendPacket (ipv6): %s\n", NET_ErrorString() );
-		}
-		else
-		{
-			Log::Notice( "Sys_SendPacket (%i): %s\n", addr.ss_family , NET_ErrorString() );
-		}
+	if ( ret == SOCKET_ERROR )
+	{
+		NET_SendPacketError( socketError, to.type, addr.ss_family );
 	}
 }
 
@@ -1264,6 +1891,45 @@ void NET_SetMulticast6()
 	}
 }
 
+#ifdef __linux__
+/*
+====================
+NET_EpollAddSocket
+====================
+*/
+static bool NET_EpollAddSocket( SOCKET sock )
+{
+	struct epoll_event event;
+
+	memset( &event, 0, sizeof( event ) );
+	event.events = EPOLLIN;
+	event.data.fd = sock;
+
+	if ( epoll_ctl( epollFd, EPOLL_CTL_ADD, sock, &event ) == -1 )
+	{
+		Log::Warn( "NET_EpollAddSocket: epoll_ctl: %s", NET_ErrorString() );
+		return false;
+	}
+
+	return true;
+}
+
+/*
+====================
+NET_EpollRemoveSocket
+
+Must be called before the socket is closed
+====================
+*/
+static void NET_EpollRemoveSocket( SOCKET sock )
+{
+	if ( epollFd != -1 && epoll_ctl( epollFd, EPOLL_CTL_DEL, sock, nullptr ) == -1 )
+	{
+		Log::Warn( "NET_EpollRemoveSocket: epoll_ctl: %s", NET_ErrorString() );
+	}
+}
+#endif
+
 /*
 ====================
 NET_JoinMulticast
@@ -1279,6 +1945,9 @@ void NET_JoinMulticast6()
 		return;
 	}
 
+	// the receive thread reads multicast6_socket
+	recvThreadPause_t pause;
+
 	if ( IN6_IS_ADDR_MULTICAST( &boundto.sin6_addr ) || IN6_IS_ADDR_UNSPECIFIED( &boundto.sin6_addr ) )
 	{
 		// The way the socket was bound does not prohibit receiving multi-cast packets. So we don't need to open a new one.
@@ -1320,14 +1989,28 @@ void NET_JoinMulticast6()
 			return;
 		}
 	}
+
+#ifdef __linux__
+	// the epoll set may have been built before the group was joined
+	if ( epollFd != -1 && multicast6_socket != ip6_socket )
+	{
+		NET_EpollAddSocket( multicast6_socket );
+	}
+#endif
 }
 
 void NET_LeaveMulticast6()
 {
 	if ( multicast6_socket != INVALID_SOCKET )
 	{
+		// the receive thread may be waiting on the socket that is closed
+		recvThreadPause_t pause;
+
 		if ( multicast6_socket != ip6_socket )
 		{
+#ifdef __linux__
+			NET_EpollRemoveSocket( multicast6_socket );
+#endif
 			closesocket( multicast6_socket );
 		}
 		else
@@ -1799,6 +2482,65 @@ static void NET_OpenIP()
 	Cvar_Set( "net_currentPort6", va( "%i", port6 ) );
 }
 
+#ifdef __linux__
+/*
+====================
+NET_OpenEpoll
+====================
+*/
+static void NET_OpenEpoll()
+{
+	epollFd = epoll_create1( EPOLL_CLOEXEC );
+
+	if ( epollFd == -1 )
+	{
+		Log::Warn( "NET_OpenEpoll: epoll_create1: %s", NET_ErrorString() );
+		return;
+	}
+
+	// NET_JoinMulticast6 adds the multicast socket if it is opened later
+	for ( SOCKET sock : { ip_socket, ip6_socket, multicast6_socket != ip6_socket ? multicast6_socket : INVALID_SOCKET } )
+	{
+		if ( sock == INVALID_SOCKET )
+		{
+			continue;
+		}
+
+		if ( !NET_EpollAddSocket( sock ) )
+		{
+			close( epollFd );
+			epollFd = -1;
+			return;
+		}
+	}
+}
+
+/*
+====================
+NET_CloseEpoll
+
+Also sends the pending packets and drops the ones received but not read,
+before the sockets are closed
+====================
+*/
+static void NET_CloseEpoll()
+{
+	if ( sendBatchCount )
+	{
+		NET_FlushSendBatch();
+	}
+
+	recvBatchHead = 0;
+	recvBatchCount = 0;
+
+	if ( epollFd != -1 )
+	{
+		close( epollFd );
+		epollFd = -1;
+	}
+}
+#endif
+
 //===================================================================
 
 /*
@@ -1871,6 +2613,18 @@ static bool NET_GetCvars()
 	modified += net_socksPassword->modified;
 	net_socksPassword->modified = false;
 
+#ifdef __linux__
+	// batch the socket system calls with recvmmsg/sendmmsg and sleep with epoll
+	net_batchIO = Cvar_Get( "net_batchIO", "1", CVAR_LATCH  );
+	modified += net_batchIO->modified;
+	net_batchIO->modified = false;
+#endif
+
+	// receive the packets on a thread of their own, which timestamps them on arrival
+	net_recvThread = Cvar_Get( "net_recvThread", "0", CVAR_LATCH  );
+	modified += net_recvThread->modified;
+	net_recvThread->modified = false;
+
 	return modified ? true : false;
 }
 
@@ -1923,6 +2677,12 @@ void NET_Config( bool enableNetworking )
 
 	if ( stop )
 	{
+		NET_StopRecvThread();
+
+#ifdef __linux__
+		NET_CloseEpoll();
+#endif
+
 		if ( ip_socket != INVALID_SOCKET )
 		{
 			closesocket( ip_socket );
@@ -1958,6 +2718,13 @@ void NET_Config( bool enableNetworking )
 		{
 			NET_OpenIP();
 			NET_SetMulticast6();
+#ifdef __linux__
+			if ( net_batchIO->integer )
+			{
+				NET_OpenEpoll();
+			}
+#endif
+			NET_StartRecvThread();
 #ifdef BUILD_SERVER
 			SV_NET_Config();
 #endif
@@ -2070,11 +2837,6 @@ Sleeps msec or until something happens on the network
 */
 void NET_Sleep( int msec )
 {
-	struct timeval timeout;
-
-	fd_set         fdset;
-	SOCKET         highestfd = INVALID_SOCKET;
-
 	if ( ip_socket == INVALID_SOCKET && ip6_socket == INVALID_SOCKET )
 	{
 		return;
@@ -2085,28 +2847,35 @@ void NET_Sleep( int msec )
 		return;
 	}
 
-	FD_ZERO( &fdset );
-
-	if ( ip_socket != INVALID_SOCKET )
+	if ( recvThread.joinable() )
 	{
-		FD_SET( ip_socket, &fdset );
+		std::unique_lock<std::mutex> lock( recvSleepMutex );
 
-		highestfd = ip_socket;
+		recvSleeping = true;
+		recvSleepCondition.wait_for( lock, std::chrono::milliseconds( msec ), [] {
+			return recvQueueHead.load() != recvQueueTail.load();
+		} );
+		recvSleeping = false;
+		return;
 	}
 
-	if ( ip6_socket != INVALID_SOCKET )
+#ifdef __linux__
+	if ( epollFd != -1 )
 	{
-		FD_SET( ip6_socket, &fdset );
+		struct epoll_event events[ 2 ];
 
-		if ( highestfd == INVALID_SOCKET || ip6_socket > highestfd )
+		// the packets already drained from the sockets wouldn't wake it up
+		if ( recvBatchHead < recvBatchCount )
 		{
-			highestfd = ip6_socket;
+			return;
 		}
+
+		epoll_wait( epollFd, events, ARRAY_LEN( events ), msec );
+		return;
 	}
+#endif
 
-	timeout.tv_sec = msec / 1000;
-	timeout.tv_usec = ( msec % 1000 ) * 1000;
-	select( highestfd + 1, &fdset, nullptr, nullptr, &timeout );
+	NET_WaitForPackets( msec );
 }
 
 /*
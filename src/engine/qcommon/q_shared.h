@@ -108,6 +108,7 @@ void ignore_result(T) {}
 #include <string>
 #include <vector>
 #include <array>
+#include <bitset>
 #include <list>
 #include <forward_list>
 #include <set>
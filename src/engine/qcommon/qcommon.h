@@ -79,6 +79,7 @@ struct entityState_t;
 struct playerState_t;
 
 void  MSG_WriteBits( msg_t *msg, int value, int bits );
+bool  MSG_WriteEncodedBits( msg_t *msg, const byte *data, int numBits, int uncompsize );
 
 void  MSG_WriteChar( msg_t *sb, int c );
 void  MSG_WriteByte( msg_t *sb, int c );
@@ -215,6 +216,8 @@ void       NET_JoinMulticast6();
 void       NET_LeaveMulticast6();
 
 void       NET_Sleep( int msec );
+void       NET_BeginPacketBatch();
+void       NET_EndPacketBatch();
 
 #ifdef HAVE_GEOIP
 const char *NET_GeoIP_Country( const netadr_t *a );
@@ -514,6 +517,10 @@ const char* FS_LoadedPaks();
 bool     FS_LoadPak( const char *name );
 void     FS_LoadBasePak();
 void     FS_LoadAllMapMetadata();
+
+// Starts reading the textures, models and sounds a map refers to on
+// background threads, see FS::PakPath::Prefetch
+void     FS_PrefetchMapAssets( Str::StringRef mapName );
 bool     FS_LoadServerPaks( const char* paks, bool isDemo );
 
 // shutdown and restart the filesystem so changes to fs_gamedir can take effect
@@ -817,7 +824,7 @@ void S_ClearSoundBuffer();
 void     SV_Init();
 void     SV_Shutdown( const char *finalmsg );
 void     SV_Frame( int msec );
-void     SV_PacketEvent( netadr_t from, msg_t *msg );
+void     SV_PacketEvent( netadr_t from, msg_t *msg, int time );
 int      SV_FrameMsec();
 
 /*
@@ -866,7 +873,7 @@ void       Com_QueueEvent( int time, sysEventType_t type, int value, int value2,
 int        Com_EventLoop();
 
 void Sys_SendPacket(int length, const void *data, netadr_t to);
-bool Sys_GetPacket(netadr_t *net_from, msg_t *net_message);
+bool Sys_GetPacket(netadr_t *net_from, msg_t *net_message, int *time);
 
 bool Sys_StringToAdr(const char *s, netadr_t *a, netadrtype_t family);
 
@@ -928,16 +935,34 @@ struct huffman_t
     huff_t decompressor;
 };
 
+/* Flattened prefix codes of a tree that doesn't change anymore, so that
+ * symbols can be written and read without walking the tree bit by bit.
+ * Codes are stored in stream order: the first bit sent is the lowest one. */
+#define HUFF_LOOKUP_BITS 11
+
+struct huffTable_t
+{
+    uint32_t code[ HMAX + 1 ];
+    byte     length[ HMAX + 1 ]; /* 0 if the symbol has no code or it is too long */
+
+    /* symbol whose code starts the next HUFF_LOOKUP_BITS bits of the stream */
+    uint16_t lookupSymbol[ 1 << HUFF_LOOKUP_BITS ];
+    byte     lookupLength[ 1 << HUFF_LOOKUP_BITS ]; /* 0 if the code is longer, walk the tree then */
+};
+
 void             Huff_Compress( msg_t *buf, int offset );
 void             Huff_Decompress( msg_t *buf, int offset );
 void             Huff_Init( huffman_t *huff );
 void             Huff_addRef( huff_t *huff, byte ch );
-int              Huff_Receive( node_t *node, int *ch, byte *fin );
-void             Huff_transmit( huff_t *huff, int ch, byte *fout );
+int              Huff_Receive( node_t *node, int *ch, byte *fin, int *offset );
+void             Huff_transmit( huff_t *huff, int ch, byte *fout, int *offset );
 void             Huff_offsetReceive( node_t *node, int *ch, byte *fin, int *offset );
 void             Huff_offsetTransmit( huff_t *huff, int ch, byte *fout, int *offset );
 void             Huff_putBit( int bit, byte *fout, int *offset );
 int              Huff_getBit( byte *fout, int *offset );
+void             Huff_putBits( uint64_t bits, int numBits, byte *fout, int *offset );
+uint64_t         Huff_peekBits( const byte *fin, int size, int offset );
+void             Huff_BuildTable( const huff_t *huff, huffTable_t *table );
 
 extern huffman_t clientHuffTables;
 
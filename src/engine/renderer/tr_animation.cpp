@@ -51,6 +51,8 @@ static skelAnimation_t *R_AllocAnimation()
 	return anim;
 }
 
+static void R_ClearSkeletonCache();
+
 /*
 ===============
 R_InitAnimations
@@ -63,6 +65,9 @@ void R_InitAnimations()
 	// leave a space for nullptr animation
 	tr.numAnimations = 0;
 
+	// the handles of the cached poses are about to be reused
+	R_ClearSkeletonCache();
+
 	anim = R_AllocAnimation();
 	anim->type = animType_t::AT_BAD;
 	strcpy( anim->name, "<default animation>" );
@@ -594,14 +599,14 @@ void R_AnimationList_f()
 R_CullMD5
 =============
 */
-static void R_CullMD5( trRefEntity_t *ent )
+static void R_CullMD5( frontEndJob_t *job, trRefEntity_t *ent, model_t *pModel )
 {
 	int        i;
 
 	if ( ent->e.skeleton.type == refSkeletonType_t::SK_INVALID )
 	{
 		// no properly set skeleton so use the bounding box by the model instead by the animations
-		md5Model_t *model = tr.currentModel->md5;
+		md5Model_t *model = pModel->md5;
 
 		VectorCopy( model->bounds[ 0 ], ent->localBounds[ 0 ] );
 		VectorCopy( model->bounds[ 1 ], ent->localBounds[ 1 ] );
@@ -616,23 +621,23 @@ static void R_CullMD5( trRefEntity_t *ent )
 		}
 	}
 
-	R_SetupEntityWorldBounds(ent);
+	R_SetupEntityWorldBounds( ent, &job->orientation );
 
-	switch ( R_CullBox( ent->worldBounds ) )
+	switch ( R_CullBox( ent->worldBounds, &job->pc ) )
 	{
 		case cullResult_t::CULL_IN:
-			tr.pc.c_box_cull_md5_in++;
+			job->pc.c_box_cull_md5_in++;
 			ent->cull = cullResult_t::CULL_IN;
 			return;
 
 		case cullResult_t::CULL_CLIP:
-			tr.pc.c_box_cull_md5_clip++;
+			job->pc.c_box_cull_md5_clip++;
 			ent->cull = cullResult_t::CULL_CLIP;
 			return;
 
 		case cullResult_t::CULL_OUT:
 		default:
-			tr.pc.c_box_cull_md5_out++;
+			job->pc.c_box_cull_md5_out++;
 			ent->cull = cullResult_t::CULL_OUT;
 			return;
 	}
@@ -643,7 +648,7 @@ static void R_CullMD5( trRefEntity_t *ent )
 R_AddMD5Surfaces
 ==============
 */
-void R_AddMD5Surfaces( trRefEntity_t *ent )
+void R_AddMD5Surfaces( frontEndJob_t *job, trRefEntity_t *ent, model_t *pModel )
 {
 	md5Model_t   *model;
 	md5Surface_t *surface;
@@ -652,7 +657,7 @@ void R_AddMD5Surfaces( trRefEntity_t *ent )
 	bool     personalModel;
 	int          fogNum;
 
-	model = tr.currentModel->md5;
+	model = pModel->md5;
 
 	// don't add third_person objects if not in a portal
 	personalModel = ( ent->e.renderfx & RF_THIRD_PERSON ) &&
@@ -660,7 +665,7 @@ void R_AddMD5Surfaces( trRefEntity_t *ent )
 
 	// cull the entire model if merged bounding box of both frames
 	// is outside the view frustum
-	R_CullMD5( ent );
+	R_CullMD5( job, ent, pModel );
 
 	if ( ent->cull == cullResult_t::CULL_OUT )
 	{
@@ -726,7 +731,7 @@ void R_AddMD5Surfaces( trRefEntity_t *ent )
 			// don't add third_person objects if not viewing through a portal
 			if ( !personalModel )
 			{
-				R_AddDrawSurf( (surfaceType_t*) surface, shader, -1, fogNum );
+				R_AddDrawSurf( job, (surfaceType_t*) surface, shader, -1, fogNum );
 			}
 		}
 	}
@@ -776,7 +781,7 @@ void R_AddMD5Surfaces( trRefEntity_t *ent )
 			// don't add third_person objects if not viewing through a portal
 			if ( !personalModel )
 			{
-				R_AddDrawSurf( (surfaceType_t*) vboSurface, shader, -1, fogNum );
+				R_AddDrawSurf( job, (surfaceType_t*) vboSurface, shader, -1, fogNum );
 			}
 		}
 	}
@@ -787,7 +792,7 @@ void R_AddMD5Surfaces( trRefEntity_t *ent )
 R_AddIQMInteractions
 =================
 */
-void R_AddIQMInteractions( trRefEntity_t *ent, trRefLight_t *light, interactionType_t iaType )
+void R_AddIQMInteractions( frontEndJob_t *job, trRefEntity_t *ent, model_t *pModel, trRefLight_t *light, interactionType_t iaType )
 {
 	int               i;
 	IQModel_t         *model;
@@ -831,27 +836,15 @@ void R_AddIQMInteractions( trRefEntity_t *ent, trRefLight_t *light, interactionT
 	personalModel = ( ent->e.renderfx & RF_THIRD_PERSON ) &&
 	  tr.viewParms.portalLevel == 0;
 
-	model = tr.currentModel->iqm;
+	model = pModel->iqm;
 
-	// do a quick AABB cull
-	if ( !BoundsIntersect( light->worldBounds[ 0 ], light->worldBounds[ 1 ], ent->worldBounds[ 0 ], ent->worldBounds[ 1 ] ) )
+	// cull against the light volume and its shadow cube sides
+	if ( R_CullLightEntity( light, ent, &cubeSideBits, &job->pc ) )
 	{
-		tr.pc.c_dlightSurfacesCulled += model->num_surfaces;
+		job->pc.c_dlightSurfacesCulled += model->num_surfaces;
 		return;
 	}
 
-	// do a more expensive and precise light frustum cull
-	if ( !r_noLightFrustums->integer )
-	{
-		if ( R_CullLightWorldBounds( light, ent->worldBounds ) == cullResult_t::CULL_OUT )
-		{
-			tr.pc.c_dlightSurfacesCulled += model->num_surfaces;
-			return;
-		}
-	}
-
-	cubeSideBits = R_CalcLightCubeSideBits( light, ent->worldBounds );
-
 		// generate interactions with all surfaces
 		for ( i = 0, surface = model->surfaces; i < model->num_surfaces; i++, surface++ )
 		{
@@ -899,8 +892,8 @@ void R_AddIQMInteractions( trRefEntity_t *ent, trRefLight_t *light, interactionT
 			// don't add third_person objects if not viewing through a portal
 			if ( !personalModel )
 			{
-				R_AddLightInteraction( light, ( surfaceType_t * ) surface, shader, cubeSideBits, iaType );
-				tr.pc.c_dlightSurfaces++;
+				R_AddLightInteraction( job, light, ( surfaceType_t * ) surface, shader, cubeSideBits, iaType );
+				job->pc.c_dlightSurfaces++;
 			}
 		}
 }
@@ -910,7 +903,7 @@ void R_AddIQMInteractions( trRefEntity_t *ent, trRefLight_t *light, interactionT
 R_AddMD5Interactions
 =================
 */
-void R_AddMD5Interactions( trRefEntity_t *ent, trRefLight_t *light, interactionType_t iaType )
+void R_AddMD5Interactions( frontEndJob_t *job, trRefEntity_t *ent, model_t *pModel, trRefLight_t *light, interactionType_t iaType )
 {
 	int               i;
 	md5Model_t        *model;
@@ -955,27 +948,15 @@ void R_AddMD5Interactions( trRefEntity_t *ent, trRefLight_t *light, interactionT
 	personalModel = ( ent->e.renderfx & RF_THIRD_PERSON ) &&
 	  tr.viewParms.portalLevel == 0;
 
-	model = tr.currentModel->md5;
+	model = pModel->md5;
 
-	// do a quick AABB cull
-	if ( !BoundsIntersect( light->worldBounds[ 0 ], light->worldBounds[ 1 ], ent->worldBounds[ 0 ], ent->worldBounds[ 1 ] ) )
+	// cull against the light volume and its shadow cube sides
+	if ( R_CullLightEntity( light, ent, &cubeSideBits, &job->pc ) )
 	{
-		tr.pc.c_dlightSurfacesCulled += model->numSurfaces;
+		job->pc.c_dlightSurfacesCulled += model->numSurfaces;
 		return;
 	}
 
-	// do a more expensive and precise light frustum cull
-	if ( !r_noLightFrustums->integer )
-	{
-		if ( R_CullLightWorldBounds( light, ent->worldBounds ) == cullResult_t::CULL_OUT )
-		{
-			tr.pc.c_dlightSurfacesCulled += model->numSurfaces;
-			return;
-		}
-	}
-
-	cubeSideBits = R_CalcLightCubeSideBits( light, ent->worldBounds );
-
 	if ( !r_vboModels->integer || !model->numVBOSurfaces ||
 	     ( !glConfig2.vboVertexSkinningAvailable && ent->e.skeleton.type == refSkeletonType_t::SK_ABSOLUTE ) )
 	{
@@ -1026,8 +1007,8 @@ void R_AddMD5Interactions( trRefEntity_t *ent, trRefLight_t *light, interactionT
 			// don't add third_person objects if not viewing through a portal
 			if ( !personalModel )
 			{
-				R_AddLightInteraction( light, (surfaceType_t*) surface, shader, cubeSideBits, iaType );
-				tr.pc.c_dlightSurfaces++;
+				R_AddLightInteraction( job, light, (surfaceType_t*) surface, shader, cubeSideBits, iaType );
+				job->pc.c_dlightSurfaces++;
 			}
 		}
 	}
@@ -1083,8 +1064,8 @@ void R_AddMD5Interactions( trRefEntity_t *ent, trRefLight_t *light, interactionT
 			// don't add third_person objects if not viewing through a portal
 			if ( !personalModel )
 			{
-				R_AddLightInteraction( light, (surfaceType_t*) vboSurface, shader, cubeSideBits, iaType );
-				tr.pc.c_dlightSurfaces++;
+				R_AddLightInteraction( job, light, (surfaceType_t*) vboSurface, shader, cubeSideBits, iaType );
+				job->pc.c_dlightSurfaces++;
 			}
 		}
 	}
@@ -1298,135 +1279,239 @@ static int IQMBuildSkeleton( refSkeleton_t *skel, skelAnimation_t *skelAnim,
 
 /*
 ==============
-RE_BuildSkeleton
+MD5DecodeChannel
+
+Applies the animated components of a frame to the base pose of a channel
 ==============
 */
-int RE_BuildSkeleton( refSkeleton_t *skel, qhandle_t hAnim, int startFrame, int endFrame, float frac, bool clearOrigin )
+static void MD5DecodeChannel( const md5Channel_t *channel, const md5Frame_t *frame, vec3_t origin, quat_t quat )
 {
-	skelAnimation_t *skelAnim;
+	const float *components = &frame->components[ channel->componentsOffset ];
+	int         componentsApplied = 0;
 
-	skelAnim = R_GetAnimationByHandle( hAnim );
+	VectorCopy( channel->baseOrigin, origin );
+	QuatCopy( channel->baseQuat, quat );
 
-	if ( skelAnim->type == animType_t::AT_IQM && skelAnim->iqm ) {
-		return IQMBuildSkeleton( skel, skelAnim, startFrame, endFrame, frac );
+	// the translation bits come first, then the quaternion rotation bits
+	for ( int j = 0; j < 3; j++ )
+	{
+		if ( channel->componentsBits & ( COMPONENT_BIT_TX << j ) )
+		{
+			origin[ j ] = components[ componentsApplied++ ];
+		}
 	}
-	else if ( skelAnim->type == animType_t::AT_MD5 && skelAnim->md5 )
+
+	for ( int j = 0; j < 3; j++ )
 	{
-		int            i;
-		md5Animation_t *anim;
-		md5Channel_t   *channel;
-		md5Frame_t     *newFrame, *oldFrame;
-		vec3_t         newOrigin, oldOrigin, lerpedOrigin;
-		quat_t         newQuat, oldQuat, lerpedQuat;
-		int            componentsApplied;
-
-		anim = skelAnim->md5;
-
-		// Validate the frames so there is no chance of a crash.
-		// This will write directly into the entity structure, so
-		// when the surfaces are rendered, they don't need to be
-		// range checked again.
-
-		/*
-		   if((startFrame >= anim->numFrames) || (startFrame < 0) || (endFrame >= anim->numFrames) || (endFrame < 0))
-		   {
-		   Log::Debug("RE_BuildSkeleton: no such frame %d to %d for '%s'\n", startFrame, endFrame, anim->name);
-		   //startFrame = 0;
-		   //endFrame = 0;
-		   }
-		 */
-
-		startFrame = Math::Clamp( startFrame, 0, anim->numFrames - 1 );
-		endFrame = Math::Clamp( endFrame, 0, anim->numFrames - 1 );
-
-		// compute frame pointers
-		oldFrame = &anim->frames[ startFrame ];
-		newFrame = &anim->frames[ endFrame ];
-
-		// calculate a bounding box in the current coordinate system
-		for ( i = 0; i < 3; i++ )
+		if ( channel->componentsBits & ( COMPONENT_BIT_QX << j ) )
 		{
-			skel->bounds[ 0 ][ i ] =
-			  oldFrame->bounds[ 0 ][ i ] < newFrame->bounds[ 0 ][ i ] ? oldFrame->bounds[ 0 ][ i ] : newFrame->bounds[ 0 ][ i ];
-			skel->bounds[ 1 ][ i ] =
-			  oldFrame->bounds[ 1 ][ i ] > newFrame->bounds[ 1 ][ i ] ? oldFrame->bounds[ 1 ][ i ] : newFrame->bounds[ 1 ][ i ];
+			quat[ j ] = components[ componentsApplied++ ];
 		}
+	}
+
+	QuatCalcW( quat );
+	QuatNormalize( quat );
+}
+
+#if idx86_sse
+static inline __m128 sseSelect( __m128 mask, __m128 a, __m128 b )
+{
+	return _mm_or_ps( _mm_and_ps( mask, a ), _mm_andnot_ps( mask, b ) );
+}
+
+/*
+==============
+sseSinZeroHalfPI
+
+sin for angles in [0, PI/2], same polynomial as the one of the
+van Waveren paper QuatSlerp is based on
+==============
+*/
+static inline __m128 sseSinZeroHalfPI( __m128 a )
+{
+	__m128 s = _mm_mul_ps( a, a );
+	__m128 t = _mm_set1_ps( -2.39e-08f );
+
+	t = _mm_add_ps( _mm_mul_ps( t, s ), _mm_set1_ps( 2.7526e-06f ) );
+	t = _mm_add_ps( _mm_mul_ps( t, s ), _mm_set1_ps( -1.98409e-04f ) );
+	t = _mm_add_ps( _mm_mul_ps( t, s ), _mm_set1_ps( 8.3333315e-03f ) );
+	t = _mm_add_ps( _mm_mul_ps( t, s ), _mm_set1_ps( -1.666666664e-01f ) );
+	t = _mm_add_ps( _mm_mul_ps( t, s ), _mm_set1_ps( 1.0f ) );
+
+	return _mm_mul_ps( t, a );
+}
+
+/*
+==============
+sseATan2Positive
+
+atan2 for y >= 0 and x >= 0, not both zero
+==============
+*/
+static inline __m128 sseATan2Positive( __m128 y, __m128 x )
+{
+	// keep the ratio in [0, 1] and use atan( y / x ) = PI/2 - atan( x / y ) otherwise
+	__m128 swap = _mm_cmpgt_ps( y, x );
+	__m128 a = _mm_div_ps( sseSelect( swap, x, y ), sseSelect( swap, y, x ) );
+	__m128 s = _mm_mul_ps( a, a );
+	__m128 t = _mm_set1_ps( 0.0028662257f );
+
+	t = _mm_add_ps( _mm_mul_ps( t, s ), _mm_set1_ps( -0.0161657367f ) );
+	t = _mm_add_ps( _mm_mul_ps( t, s ), _mm_set1_ps( 0.0429096138f ) );
+	t = _mm_add_ps( _mm_mul_ps( t, s ), _mm_set1_ps( -0.0752896400f ) );
+	t = _mm_add_ps( _mm_mul_ps( t, s ), _mm_set1_ps( 0.1065626393f ) );
+	t = _mm_add_ps( _mm_mul_ps( t, s ), _mm_set1_ps( -0.1420889944f ) );
+	t = _mm_add_ps( _mm_mul_ps( t, s ), _mm_set1_ps( 0.1999355085f ) );
+	t = _mm_add_ps( _mm_mul_ps( t, s ), _mm_set1_ps( -0.3333314528f ) );
+	t = _mm_add_ps( _mm_mul_ps( t, s ), _mm_set1_ps( 1.0f ) );
+	t = _mm_mul_ps( t, a );
+
+	return sseSelect( swap, _mm_sub_ps( _mm_set1_ps( M_PI / 2 ), t ), t );
+}
+#endif
+
+/*
+==============
+QuatSlerp4
 
-		for ( i = 0, channel = anim->channels; i < anim->numChannels; i++, channel++ )
+QuatSlerp on four pairs of quaternions at once
+==============
+*/
+static void QuatSlerp4( const quat_t from[ 4 ], const quat_t to[ 4 ], float frac, quat_t out[ 4 ] )
+{
+	if ( frac <= 0.0f || frac >= 1.0f )
+	{
+		for ( int j = 0; j < 4; j++ )
 		{
-			// set baseframe values
-			VectorCopy( channel->baseOrigin, newOrigin );
-			VectorCopy( channel->baseOrigin, oldOrigin );
+			QuatCopy( frac <= 0.0f ? from[ j ] : to[ j ], out[ j ] );
+		}
 
-			QuatCopy( channel->baseQuat, newQuat );
-			QuatCopy( channel->baseQuat, oldQuat );
+		return;
+	}
 
-			componentsApplied = 0;
+#if idx86_sse
+	// one component of the four quaternions per register
+	__m128 fx = _mm_loadu_ps( from[ 0 ] ), fy = _mm_loadu_ps( from[ 1 ] );
+	__m128 fz = _mm_loadu_ps( from[ 2 ] ), fw = _mm_loadu_ps( from[ 3 ] );
+	__m128 tx = _mm_loadu_ps( to[ 0 ] ), ty = _mm_loadu_ps( to[ 1 ] );
+	__m128 tz = _mm_loadu_ps( to[ 2 ] ), tw = _mm_loadu_ps( to[ 3 ] );
 
-			// update tranlation bits
-			if ( channel->componentsBits & COMPONENT_BIT_TX )
-			{
-				oldOrigin[ 0 ] = oldFrame->components[ channel->componentsOffset + componentsApplied ];
-				newOrigin[ 0 ] = newFrame->components[ channel->componentsOffset + componentsApplied ];
-				componentsApplied++;
-			}
+	_MM_TRANSPOSE4_PS( fx, fy, fz, fw );
+	_MM_TRANSPOSE4_PS( tx, ty, tz, tw );
 
-			if ( channel->componentsBits & COMPONENT_BIT_TY )
-			{
-				oldOrigin[ 1 ] = oldFrame->components[ channel->componentsOffset + componentsApplied ];
-				newOrigin[ 1 ] = newFrame->components[ channel->componentsOffset + componentsApplied ];
-				componentsApplied++;
-			}
+	__m128 one = _mm_set1_ps( 1.0f );
+	__m128 signBit = _mm_set1_ps( -0.0f );
+	__m128 frac4 = _mm_set1_ps( frac );
+	__m128 oneMinusFrac4 = _mm_set1_ps( 1.0f - frac );
 
-			if ( channel->componentsBits & COMPONENT_BIT_TZ )
-			{
-				oldOrigin[ 2 ] = oldFrame->components[ channel->componentsOffset + componentsApplied ];
-				newOrigin[ 2 ] = newFrame->components[ channel->componentsOffset + componentsApplied ];
-				componentsApplied++;
-			}
+	__m128 cosom = _mm_add_ps( _mm_add_ps( _mm_mul_ps( fx, tx ), _mm_mul_ps( fy, ty ) ),
+	                           _mm_add_ps( _mm_mul_ps( fz, tz ), _mm_mul_ps( fw, tw ) ) );
+	__m128 absCosom = _mm_andnot_ps( signBit, cosom );
+	__m128 useSlerp = _mm_cmpgt_ps( _mm_sub_ps( one, absCosom ), _mm_set1_ps( 1e-6f ) );
 
-			// update quaternion rotation bits
-			if ( channel->componentsBits & COMPONENT_BIT_QX )
-			{
-				( ( vec_t * ) oldQuat ) [ 0 ] = oldFrame->components[ channel->componentsOffset + componentsApplied ];
-				( ( vec_t * ) newQuat ) [ 0 ] = newFrame->components[ channel->componentsOffset + componentsApplied ];
-				componentsApplied++;
-			}
+	// the lanes close enough to lerp would divide by zero, their result is dropped
+	__m128 sinSqr = _mm_max_ps( _mm_sub_ps( one, _mm_mul_ps( absCosom, absCosom ) ), _mm_set1_ps( 1e-12f ) );
+	__m128 sinom = _mm_div_ps( one, _mm_sqrt_ps( sinSqr ) );
+	__m128 omega = sseATan2Positive( _mm_mul_ps( sinSqr, sinom ), absCosom );
 
-			if ( channel->componentsBits & COMPONENT_BIT_QY )
-			{
-				( ( vec_t * ) oldQuat ) [ 1 ] = oldFrame->components[ channel->componentsOffset + componentsApplied ];
-				( ( vec_t * ) newQuat ) [ 1 ] = newFrame->components[ channel->componentsOffset + componentsApplied ];
-				componentsApplied++;
-			}
+	__m128 scale0 = _mm_mul_ps( sseSinZeroHalfPI( _mm_mul_ps( oneMinusFrac4, omega ) ), sinom );
+	__m128 scale1 = _mm_mul_ps( sseSinZeroHalfPI( _mm_mul_ps( frac4, omega ) ), sinom );
 
-			if ( channel->componentsBits & COMPONENT_BIT_QZ )
-			{
-				( ( vec_t * ) oldQuat ) [ 2 ] = oldFrame->components[ channel->componentsOffset + componentsApplied ];
-				( ( vec_t * ) newQuat ) [ 2 ] = newFrame->components[ channel->componentsOffset + componentsApplied ];
-			}
+	scale0 = sseSelect( useSlerp, scale0, oneMinusFrac4 );
+	scale1 = sseSelect( useSlerp, scale1, frac4 );
+	scale1 = _mm_xor_ps( scale1, _mm_and_ps( _mm_cmplt_ps( cosom, _mm_setzero_ps() ), signBit ) );
 
-			QuatCalcW( oldQuat );
-			QuatNormalize( oldQuat );
+	__m128 ox = _mm_add_ps( _mm_mul_ps( scale0, fx ), _mm_mul_ps( scale1, tx ) );
+	__m128 oy = _mm_add_ps( _mm_mul_ps( scale0, fy ), _mm_mul_ps( scale1, ty ) );
+	__m128 oz = _mm_add_ps( _mm_mul_ps( scale0, fz ), _mm_mul_ps( scale1, tz ) );
+	__m128 ow = _mm_add_ps( _mm_mul_ps( scale0, fw ), _mm_mul_ps( scale1, tw ) );
 
-			QuatCalcW( newQuat );
-			QuatNormalize( newQuat );
+	_MM_TRANSPOSE4_PS( ox, oy, oz, ow );
 
-#if 1
-			VectorLerp( oldOrigin, newOrigin, frac, lerpedOrigin );
-			QuatSlerp( oldQuat, newQuat, frac, lerpedQuat );
+	_mm_storeu_ps( out[ 0 ], ox );
+	_mm_storeu_ps( out[ 1 ], oy );
+	_mm_storeu_ps( out[ 2 ], oz );
+	_mm_storeu_ps( out[ 3 ], ow );
 #else
-			VectorCopy( newOrigin, lerpedOrigin );
-			QuatCopy( newQuat, lerpedQuat );
+	for ( int j = 0; j < 4; j++ )
+	{
+		QuatSlerp( from[ j ], to[ j ], frac, out[ j ] );
+	}
 #endif
+}
+
+/*
+==============
+MD5BuildSkeleton
+
+The channels are decoded four at a time so their rotations can be
+slerped together.
+==============
+*/
+static int MD5BuildSkeleton( refSkeleton_t *skel, skelAnimation_t *skelAnim,
+			     int startFrame, int endFrame, float frac, bool clearOrigin )
+{
+	int            i, j;
+	md5Animation_t *anim;
+	md5Channel_t   *channel;
+	md5Frame_t     *newFrame, *oldFrame;
+	vec3_t         newOrigins[ 4 ], oldOrigins[ 4 ], lerpedOrigin;
+	quat_t         newQuats[ 4 ], oldQuats[ 4 ], lerpedQuats[ 4 ];
+	int            numChannels;
+
+	anim = skelAnim->md5;
+
+	// Validate the frames so there is no chance of a crash.
+	// This will write directly into the entity structure, so
+	// when the surfaces are rendered, they don't need to be
+	// range checked again.
+	startFrame = Math::Clamp( startFrame, 0, anim->numFrames - 1 );
+	endFrame = Math::Clamp( endFrame, 0, anim->numFrames - 1 );
+
+	// compute frame pointers
+	oldFrame = &anim->frames[ startFrame ];
+	newFrame = &anim->frames[ endFrame ];
+
+	// calculate a bounding box in the current coordinate system
+	for ( i = 0; i < 3; i++ )
+	{
+		skel->bounds[ 0 ][ i ] =
+		  oldFrame->bounds[ 0 ][ i ] < newFrame->bounds[ 0 ][ i ] ? oldFrame->bounds[ 0 ][ i ] : newFrame->bounds[ 0 ][ i ];
+		skel->bounds[ 1 ][ i ] =
+		  oldFrame->bounds[ 1 ][ i ] > newFrame->bounds[ 1 ][ i ] ? oldFrame->bounds[ 1 ][ i ] : newFrame->bounds[ 1 ][ i ];
+	}
+
+	for ( i = 0; i < anim->numChannels; i += 4 )
+	{
+		numChannels = std::min( anim->numChannels - i, 4 );
+
+		for ( j = 0, channel = &anim->channels[ i ]; j < numChannels; j++, channel++ )
+		{
+			MD5DecodeChannel( channel, oldFrame, oldOrigins[ j ], oldQuats[ j ] );
+			MD5DecodeChannel( channel, newFrame, newOrigins[ j ], newQuats[ j ] );
+		}
+
+		// pad the last group with identity rotations
+		for ( ; j < 4; j++ )
+		{
+			QuatClear( oldQuats[ j ] );
+			QuatClear( newQuats[ j ] );
+		}
+
+		QuatSlerp4( oldQuats, newQuats, frac, lerpedQuats );
+
+		for ( j = 0, channel = &anim->channels[ i ]; j < numChannels; j++, channel++ )
+		{
+			refBone_t *bone = &skel->bones[ i + j ];
+
+			VectorLerp( oldOrigins[ j ], newOrigins[ j ], frac, lerpedOrigin );
 
 			// copy lerped information to the bone + extra data
-			skel->bones[ i ].parentIndex = channel->parentIndex;
+			bone->parentIndex = channel->parentIndex;
 
 			if ( channel->parentIndex < 0 && clearOrigin )
 			{
-				VectorClear( skel->bones[ i ].t.trans );
-				QuatClear( skel->bones[ i ].t.rot );
+				VectorClear( bone->t.trans );
 
 				// move bounding box back
 				VectorSubtract( skel->bounds[ 0 ], lerpedOrigin, skel->bounds[ 0 ] );
@@ -1434,26 +1519,218 @@ int RE_BuildSkeleton( refSkeleton_t *skel, qhandle_t hAnim, int startFrame, int
 			}
 			else
 			{
-				VectorCopy( lerpedOrigin, skel->bones[ i ].t.trans );
+				VectorCopy( lerpedOrigin, bone->t.trans );
 			}
 
-			QuatCopy( lerpedQuat, skel->bones[ i ].t.rot );
-			skel->bones[ i ].t.scale = 1.0f;
+			QuatCopy( lerpedQuats[ j ], bone->t.rot );
+			bone->t.scale = 1.0f;
 
 #if defined( REFBONE_NAMES )
-			Q_strncpyz( skel->bones[ i ].name, channel->name, sizeof( skel->bones[ i ].name ) );
+			Q_strncpyz( bone->name, channel->name, sizeof( bone->name ) );
 #endif
 		}
+	}
 
-		skel->numBones = anim->numChannels;
-		skel->type = refSkeletonType_t::SK_RELATIVE;
-		return true;
+	skel->numBones = anim->numChannels;
+	skel->type = refSkeletonType_t::SK_RELATIVE;
+	return true;
+}
+
+/*
+===========================================================================
+SKELETON POSE CACHE
+
+Crowds of the same model tend to play the same animation at the same time,
+so the built skeletons are kept by animation, frames, lerp fraction and
+clearOrigin, and copied out again when the same pose is asked for. The
+fraction is rounded to SKELETON_FRAC_STEPS steps so that close poses
+are shared; the pose is then built at the rounded fraction so the result
+doesn't depend on whether it came from the cache. The least recently used
+poses are dropped once they take more than r_skeletonCacheSize kilobytes.
+===========================================================================
+*/
+
+static const int SKELETON_FRAC_STEPS = 256;
+
+struct skeletonPoseKey_t
+{
+	qhandle_t hAnim;
+	int       startFrame;
+	int       endFrame;
+	int       fracStep;
+	bool      clearOrigin;
+
+	bool operator==( const skeletonPoseKey_t &other ) const
+	{
+		return hAnim == other.hAnim && startFrame == other.startFrame && endFrame == other.endFrame &&
+		       fracStep == other.fracStep && clearOrigin == other.clearOrigin;
+	}
+};
+
+struct skeletonPoseKeyHash_t
+{
+	size_t operator()( const skeletonPoseKey_t &key ) const
+	{
+		size_t hash = key.hAnim;
+
+		hash = hash * 31 + key.startFrame;
+		hash = hash * 31 + key.endFrame;
+		hash = hash * 31 + key.fracStep;
+		return hash * 2 + key.clearOrigin;
+	}
+};
+
+struct skeletonPose_t
+{
+	skeletonPoseKey_t      key;
+	refSkeletonType_t      type;
+	vec3_t                 bounds[ 2 ];
+	std::vector<refBone_t> bones;
+};
+
+// most recently used first
+static std::list<skeletonPose_t> skeletonPoses;
+static std::unordered_map<skeletonPoseKey_t, std::list<skeletonPose_t>::iterator, skeletonPoseKeyHash_t> skeletonPoseMap;
+static size_t skeletonPoseBytes;
+
+static size_t R_SkeletonPoseSize( int numBones )
+{
+	return sizeof( skeletonPose_t ) + numBones * sizeof( refBone_t );
+}
+
+static void R_ClearSkeletonCache()
+{
+	skeletonPoses.clear();
+	skeletonPoseMap.clear();
+	skeletonPoseBytes = 0;
+}
+
+/*
+==============
+R_SkeletonCacheInfo
+==============
+*/
+void R_SkeletonCacheInfo( size_t *numPoses, size_t *poseBytes )
+{
+	*numPoses = skeletonPoses.size();
+	*poseBytes = skeletonPoseBytes;
+}
+
+/*
+==============
+R_CacheSkeletonPose
+==============
+*/
+static void R_CacheSkeletonPose( const skeletonPoseKey_t &key, const refSkeleton_t *skel, size_t maxBytes )
+{
+	size_t size = R_SkeletonPoseSize( skel->numBones );
+
+	if ( size > maxBytes )
+	{
+		return;
+	}
+
+	while ( skeletonPoseBytes + size > maxBytes )
+	{
+		const skeletonPose_t &oldest = skeletonPoses.back();
+
+		skeletonPoseBytes -= R_SkeletonPoseSize( oldest.bones.size() );
+		skeletonPoseMap.erase( oldest.key );
+		skeletonPoses.pop_back();
+		tr.pc.c_skeletonCacheEvictions++;
+	}
+
+	skeletonPoses.emplace_front();
+
+	skeletonPose_t &pose = skeletonPoses.front();
+	pose.key = key;
+	pose.type = skel->type;
+	VectorCopy( skel->bounds[ 0 ], pose.bounds[ 0 ] );
+	VectorCopy( skel->bounds[ 1 ], pose.bounds[ 1 ] );
+	pose.bones.assign( skel->bones, skel->bones + skel->numBones );
+
+	skeletonPoseMap[ key ] = skeletonPoses.begin();
+	skeletonPoseBytes += size;
+}
+
+/*
+==============
+R_BuildSkeleton
+==============
+*/
+static int R_BuildSkeleton( refSkeleton_t *skel, qhandle_t hAnim, int startFrame, int endFrame, float frac, bool clearOrigin )
+{
+	skelAnimation_t *skelAnim;
+
+	skelAnim = R_GetAnimationByHandle( hAnim );
+
+	if ( skelAnim->type == animType_t::AT_IQM && skelAnim->iqm ) {
+		return IQMBuildSkeleton( skel, skelAnim, startFrame, endFrame, frac );
+	}
+	else if ( skelAnim->type == animType_t::AT_MD5 && skelAnim->md5 )
+	{
+		return MD5BuildSkeleton( skel, skelAnim, startFrame, endFrame, frac, clearOrigin );
 	}
 
 	// FIXME: clear existing bones and bounds?
 	return false;
 }
 
+/*
+==============
+RE_BuildSkeleton
+==============
+*/
+int RE_BuildSkeleton( refSkeleton_t *skel, qhandle_t hAnim, int startFrame, int endFrame, float frac, bool clearOrigin )
+{
+	size_t maxBytes = size_t( r_skeletonCacheSize->integer ) * 1024;
+
+	if ( !maxBytes )
+	{
+		R_ClearSkeletonCache();
+	}
+
+	// fractions out of [0, 1] extrapolate the poses, leave them alone
+	if ( !maxBytes || frac < 0.0f || frac > 1.0f )
+	{
+		return R_BuildSkeleton( skel, hAnim, startFrame, endFrame, frac, clearOrigin );
+	}
+
+	skeletonPoseKey_t key;
+	key.hAnim = hAnim;
+	key.startFrame = startFrame;
+	key.endFrame = endFrame;
+	key.fracStep = int( frac * SKELETON_FRAC_STEPS + 0.5f );
+	key.clearOrigin = clearOrigin;
+
+	auto it = skeletonPoseMap.find( key );
+
+	if ( it != skeletonPoseMap.end() )
+	{
+		const skeletonPose_t &pose = *it->second;
+
+		skel->type = pose.type;
+		skel->numBones = pose.bones.size();
+		VectorCopy( pose.bounds[ 0 ], skel->bounds[ 0 ] );
+		VectorCopy( pose.bounds[ 1 ], skel->bounds[ 1 ] );
+		std::copy( pose.bones.begin(), pose.bones.end(), skel->bones );
+
+		skeletonPoses.splice( skeletonPoses.begin(), skeletonPoses, it->second );
+		tr.pc.c_skeletonCacheHits++;
+		return true;
+	}
+
+	tr.pc.c_skeletonCacheMisses++;
+
+	if ( !R_BuildSkeleton( skel, hAnim, startFrame, endFrame, float( key.fracStep ) / SKELETON_FRAC_STEPS, clearOrigin ) )
+	{
+		return false;
+	}
+
+	R_CacheSkeletonPose( key, skel, maxBytes );
+	return true;
+}
+
 /*
 ==============
 RE_BlendSkeleton
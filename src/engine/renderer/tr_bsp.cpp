@@ -23,6 +23,8 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 */
 // tr_bsp.c
 #include "tr_local.h"
+#include "common/FileSystem.h"
+#include "common/ThreadPool.h"
 #include "framework/CommandSystem.h"
 
 /*
@@ -38,12 +40,42 @@ static world_t    s_worldData;
 static int        s_lightCount;
 static growList_t s_interactions;
 static byte       *fileBase;
+static int        fileLength;
 
 static int        c_redundantInteractions;
 static int        c_vboWorldSurfaces;
 static int        c_vboLightSurfaces;
 static int        c_vboShadowSurfaces;
 
+/*
+The lumps are loaded in a fixed order so the hunk gets the same layout and
+the world the same data whatever the number of threads. Everything touching
+the hunk, the shaders or GL stays on the main thread, only the work filling
+memory that was already allocated is spread over the world load threads:
+
+- the geometry of faces and triangle soups is filled in the background
+  from R_LoadSurfaces until R_FinishSurfaceGeometry. The stages in between
+  (marksurfaces, nodes and leafs, submodels, fogs, visibility) don't read it.
+- the light grid points are decoded in parallel.
+*/
+
+// surfaces given to a world load thread at once
+static const int SURFACE_GEOMETRY_BATCH = 64;
+
+// light grid points given to a world load thread at once
+static const int LIGHT_GRID_BATCH = 4096;
+
+struct surfaceGeometryJob_t
+{
+	dsurface_t   *ds;
+	drawVert_t   *verts;
+	bspSurface_t *surf;
+};
+
+static Sys::ThreadPool                   worldLoadPool;
+static std::vector<surfaceGeometryJob_t> surfaceGeometryJobs;
+static std::thread                       surfaceGeometryThread;
+
 //===============================================================================
 
 /*
@@ -812,6 +844,137 @@ static void FinishGenericSurface( dsurface_t *ds, srfGeneric_t *gen, vec3_t pt )
 	}
 }
 
+/*
+===============
+R_CenterSurfaceTexCoords
+
+Moves the texture coordinates of every group of connected triangles
+next to the origin
+===============
+*/
+static void R_CenterSurfaceTexCoords( srfVert_t *verts, int numVerts, const srfTriangle_t *triangles, int numTriangles )
+{
+	int                  i, j;
+	const srfTriangle_t  *tri;
+	struct vertexComponent_t {
+		vec2_t stBounds[ 2 ];
+		int    minVertex;
+	};
+	bool         updated;
+
+	std::vector<vertexComponent_t> components( numVerts );
+
+	for ( i = 0; i < numVerts; i++ )
+	{
+		components[ i ].minVertex = i;
+
+		for ( j = 0; j < 2; j++ )
+		{
+			components[ i ].stBounds[ 0 ][ j ] = verts[ i ].st[ j ];
+			components[ i ].stBounds[ 1 ][ j ] = verts[ i ].st[ j ];
+		}
+	}
+
+	// compute strongly connected components and TC bounds per component
+	do {
+		updated = false;
+
+		for( i = 0, tri = triangles; i < numTriangles; i++, tri++ ) {
+			int minVertex = std::min( std::min( components[ tri->indexes[ 0 ] ].minVertex,
+						  components[ tri->indexes[ 1 ] ].minVertex ),
+					     components[ tri->indexes[ 2 ] ].minVertex );
+			for( j = 0; j < 3; j++ ) {
+				int vertex = tri->indexes[ j ];
+				if( components[ vertex ].minVertex != minVertex ) {
+					updated = true;
+					components[ vertex ].minVertex = minVertex;
+					components[ minVertex ].stBounds[ 0 ][ 0 ] = std::min( components[ minVertex ].stBounds[ 0 ][ 0 ],
+											  components[ vertex ].stBounds[ 0 ][ 0 ] );
+					components[ minVertex ].stBounds[ 0 ][ 1 ] = std::min( components[ minVertex ].stBounds[ 0 ][ 1 ],
+											  components[ vertex ].stBounds[ 0 ][ 1 ] );
+					components[ minVertex ].stBounds[ 1 ][ 0 ] = std::max( components[ minVertex ].stBounds[ 1 ][ 0 ],
+											  components[ vertex ].stBounds[ 1 ][ 0 ] );
+					components[ minVertex ].stBounds[ 1 ][ 1 ] = std::max( components[ minVertex ].stBounds[ 1 ][ 1 ],
+											  components[ vertex ].stBounds[ 1 ][ 1 ] );
+				}
+			}
+		}
+	} while( updated );
+
+	// center texture coords
+	for( i = 0; i < numVerts; i++ ) {
+		if( components[ i ].minVertex == i ) {
+			for( j = 0; j < 2; j++ ) {
+				components[ i ].stBounds[ 0 ][ j ] = rintf( 0.5f * (components[ i ].stBounds[ 1 ][ j ] + components[ i ].stBounds[ 0 ][ j ]) );
+			}
+		}
+
+		for ( j = 0; j < 2; j++ )
+		{
+			verts[ i ].st[ j ] -= components[ components[ i ].minVertex ].stBounds[ 0 ][ j ];
+		}
+	}
+}
+
+/*
+===============
+R_CalcSurfaceTangents
+===============
+*/
+static void R_CalcSurfaceTangents( srfVert_t *verts, const srfTriangle_t *triangles, int numTriangles )
+{
+	int                 i;
+	const srfTriangle_t *tri;
+	srfVert_t           *dv0, *dv1, *dv2;
+	vec3_t              tangent, binormal;
+
+	for ( i = 0, tri = triangles; i < numTriangles; i++, tri++ )
+	{
+		dv0 = &verts[ tri->indexes[ 0 ] ];
+		dv1 = &verts[ tri->indexes[ 1 ] ];
+		dv2 = &verts[ tri->indexes[ 2 ] ];
+
+		R_CalcTangents( tangent, binormal,
+				dv0->xyz, dv1->xyz, dv2->xyz,
+				dv0->st, dv1->st, dv2->st );
+		R_TBNtoQtangents( tangent, binormal, dv0->normal,
+				  dv0->qtangent );
+		R_TBNtoQtangents( tangent, binormal, dv1->normal,
+				  dv1->qtangent );
+		R_TBNtoQtangents( tangent, binormal, dv2->normal,
+				  dv2->qtangent );
+	}
+}
+
+/*
+===============
+R_ParseSurfaceIndexes
+
+Copies the triangles of a face or a triangle soup, this is done on the
+main thread so bad indexes can be reported
+===============
+*/
+static void R_ParseSurfaceIndexes( dsurface_t *ds, srfTriangle_t *triangles, int numTriangles, int numVerts, int *indexes )
+{
+	int           i, j;
+	srfTriangle_t *tri;
+
+	indexes += LittleLong( ds->firstIndex );
+
+	for ( i = 0, tri = triangles; i < numTriangles; i++, tri++ )
+	{
+		for ( j = 0; j < 3; j++ )
+		{
+			tri->indexes[ j ] = LittleLong( indexes[ i * 3 + j ] );
+
+			if ( tri->indexes[ j ] < 0 || tri->indexes[ j ] >= numVerts )
+			{
+				ri.Error( errorParm_t::ERR_DROP, "Bad index in face surface" );
+			}
+		}
+	}
+}
+
 /*
 ===============
 ParseFace
@@ -819,16 +982,9 @@ ParseFace
 */
 static void ParseFace( dsurface_t *ds, drawVert_t *verts, bspSurface_t *surf, int *indexes )
 {
-	int              i, j;
 	srfSurfaceFace_t *cv;
-	srfTriangle_t    *tri;
 	int              numVerts, numTriangles;
 	int              realLightmapNum;
-	struct vertexComponent_t {
-		vec2_t stBounds[ 2 ];
-		int    minVertex;
-	} *components;
-	bool         updated;
 
 	// get lightmap
 	realLightmapNum = LittleLong( ds->lightmapNum );
@@ -873,13 +1029,31 @@ static void ParseFace( dsurface_t *ds, drawVert_t *verts, bspSurface_t *surf, in
 
 	surf->data = ( surfaceType_t * ) cv;
 
+	// copy triangles
+	R_ParseSurfaceIndexes( ds, cv->triangles, numTriangles, numVerts, indexes );
+
+	// the vertexes are filled by FinishFace
+	surfaceGeometryJobs.push_back( { ds, verts, surf } );
+}
+
+/*
+===============
+FinishFace
+
+Fills the vertexes of a face allocated by ParseFace, can run on a world
+load thread
+===============
+*/
+static void FinishFace( dsurface_t *ds, drawVert_t *verts, srfSurfaceFace_t *cv )
+{
+	int i, j;
+	int realLightmapNum = LittleLong( ds->lightmapNum );
+
 	// copy vertexes
 	ClearBounds( cv->bounds[ 0 ], cv->bounds[ 1 ] );
 	verts += LittleLong( ds->firstVert );
 
-	components = (struct vertexComponent_t *)ri.Hunk_AllocateTempMemory( numVerts * sizeof( struct vertexComponent_t ) );
-
-	for ( i = 0; i < numVerts; i++ )
+	for ( i = 0; i < cv->numVerts; i++ )
 	{
 		for ( j = 0; j < 3; j++ )
 		{
@@ -889,15 +1063,10 @@ static void ParseFace( dsurface_t *ds, drawVert_t *verts, bspSurface_t *surf, in
 
 		AddPointToBounds( cv->verts[ i ].xyz, cv->bounds[ 0 ], cv->bounds[ 1 ] );
 
-		components[ i ].minVertex = i;
-
 		for ( j = 0; j < 2; j++ )
 		{
 			cv->verts[ i ].st[ j ] = LittleFloat( verts[ i ].st[ j ] );
 			cv->verts[ i ].lightmap[ j ] = LittleFloat( verts[ i ].lightmap[ j ] );
-
-			components[ i ].stBounds[ 0 ][ j ] = cv->verts[ i ].st[ j ];
-			components[ i ].stBounds[ 1 ][ j ] = cv->verts[ i ].st[ j ];
 		}
 
 		cv->verts[ i ].lightmap[ 0 ] = FatPackU( LittleFloat( verts[ i ].lightmap[ 0 ] ), realLightmapNum );
@@ -909,63 +1078,7 @@ static void ParseFace( dsurface_t *ds, drawVert_t *verts, bspSurface_t *surf, in
 		R_ColorShiftLightingBytes( cv->verts[ i ].lightColor.ToArray(), cv->verts[ i ].lightColor.ToArray() );
 	}
 
-	// copy triangles
-	indexes += LittleLong( ds->firstIndex );
-
-	for ( i = 0, tri = cv->triangles; i < numTriangles; i++, tri++ )
-	{
-		for ( j = 0; j < 3; j++ )
-		{
-			tri->indexes[ j ] = LittleLong( indexes[ i * 3 + j ] );
-
-			if ( tri->indexes[ j ] < 0 || tri->indexes[ j ] >= numVerts )
-			{
-				ri.Error( errorParm_t::ERR_DROP, "Bad index in face surface" );
-			}
-		}
-	}
-
-	// compute strongly connected components and TC bounds per component
-	do {
-		updated = false;
-
-		for( i = 0, tri = cv->triangles; i < numTriangles; i++, tri++ ) {
-			int minVertex = std::min( std::min( components[ tri->indexes[ 0 ] ].minVertex,
-						  components[ tri->indexes[ 1 ] ].minVertex ),
-					     components[ tri->indexes[ 2 ] ].minVertex );
-			for( j = 0; j < 3; j++ ) {
-				int vertex = tri->indexes[ j ];
-				if( components[ vertex ].minVertex != minVertex ) {
-					updated = true;
-					components[ vertex ].minVertex = minVertex;
-					components[ minVertex ].stBounds[ 0 ][ 0 ] = std::min( components[ minVertex ].stBounds[ 0 ][ 0 ],
-											  components[ vertex ].stBounds[ 0 ][ 0 ] );
-					components[ minVertex ].stBounds[ 0 ][ 1 ] = std::min( components[ minVertex ].stBounds[ 0 ][ 1 ],
-											  components[ vertex ].stBounds[ 0 ][ 1 ] );
-					components[ minVertex ].stBounds[ 1 ][ 0 ] = std::max( components[ minVertex ].stBounds[ 1 ][ 0 ],
-											  components[ vertex ].stBounds[ 1 ][ 0 ] );
-					components[ minVertex ].stBounds[ 1 ][ 1 ] = std::max( components[ minVertex ].stBounds[ 1 ][ 1 ],
-											  components[ vertex ].stBounds[ 1 ][ 1 ] );
-				}
-			}
-		}
-	} while( updated );
-
-	// center texture coords
-	for( i = 0; i < numVerts; i++ ) {
-		if( components[ i ].minVertex == i ) {
-			for( j = 0; j < 2; j++ ) {
-				components[ i ].stBounds[ 0 ][ j ] = rintf( 0.5f * (components[ i ].stBounds[ 1 ][ j ] + components[ i ].stBounds[ 0 ][ j ]) );
-			}
-		}
-
-		for ( j = 0; j < 2; j++ )
-		{
-			cv->verts[ i ].st[ j ] -= components[ components[ i ].minVertex ].stBounds[ 0 ][ j ];
-		}
-	}
-
-	ri.Hunk_FreeTempMemory( components );
+	R_CenterSurfaceTexCoords( cv->verts, cv->numVerts, cv->triangles, cv->numTriangles );
 
 	// take the plane information from the lightmap vector
 	for ( i = 0; i < 3; i++ )
@@ -977,29 +1090,7 @@ static void ParseFace( dsurface_t *ds, drawVert_t *verts, bspSurface_t *surf, in
 	SetPlaneSignbits( &cv->plane );
 	cv->plane.type = PlaneTypeForNormal( cv->plane.normal );
 
-	surf->data = ( surfaceType_t * ) cv;
-
-	{
-		srfVert_t *dv0, *dv1, *dv2;
-		vec3_t    tangent, binormal;
-
-		for ( i = 0, tri = cv->triangles; i < numTriangles; i++, tri++ )
-		{
-			dv0 = &cv->verts[ tri->indexes[ 0 ] ];
-			dv1 = &cv->verts[ tri->indexes[ 1 ] ];
-			dv2 = &cv->verts[ tri->indexes[ 2 ] ];
-
-			R_CalcTangents( tangent, binormal,
-					dv0->xyz, dv1->xyz, dv2->xyz,
-					dv0->st, dv1->st, dv2->st );
-			R_TBNtoQtangents( tangent, binormal, dv0->normal,
-					  dv0->qtangent );
-			R_TBNtoQtangents( tangent, binormal, dv1->normal,
-					  dv1->qtangent );
-			R_TBNtoQtangents( tangent, binormal, dv2->normal,
-					  dv2->qtangent );
-		}
-	}
+	R_CalcSurfaceTangents( cv->verts, cv->triangles, cv->numTriangles );
 
 	// finish surface
 	FinishGenericSurface( ds, ( srfGeneric_t * ) cv, cv->verts[ 0 ].xyz );
@@ -1144,15 +1235,8 @@ ParseTriSurf
 static void ParseTriSurf( dsurface_t *ds, drawVert_t *verts, bspSurface_t *surf, int *indexes )
 {
 	srfTriangles_t       *cv;
-	srfTriangle_t        *tri;
-	int                  i, j;
 	int                  numVerts, numTriangles;
 	static surfaceType_t skipData = surfaceType_t::SF_SKIP;
-	struct vertexComponent_t {
-		vec2_t stBounds[ 2 ];
-		int    minVertex;
-	} *components;
-	bool         updated;
 
 	// get lightmap
 	surf->lightmapNum = -1; // FIXME LittleLong(ds->lightmapNum);
@@ -1195,15 +1279,31 @@ static void ParseTriSurf( dsurface_t *ds, drawVert_t *verts, bspSurface_t *surf,
 
 	surf->data = ( surfaceType_t * ) cv;
 
+	// copy triangles
+	R_ParseSurfaceIndexes( ds, cv->triangles, numTriangles, numVerts, indexes );
+
+	// the vertexes are filled by FinishTriSurf
+	surfaceGeometryJobs.push_back( { ds, verts, surf } );
+}
+
+/*
+===============
+FinishTriSurf
+
+Fills the vertexes of a triangle soup allocated by ParseTriSurf, can run
+on a world load thread
+===============
+*/
+static void FinishTriSurf( dsurface_t *ds, drawVert_t *verts, srfTriangles_t *cv )
+{
+	int           i, j;
+	srfTriangle_t *tri;
+
 	// copy vertexes
 	verts += LittleLong( ds->firstVert );
 
-	components = (struct vertexComponent_t *)ri.Hunk_AllocateTempMemory( numVerts * sizeof( struct vertexComponent_t ) );
-
-	for ( i = 0; i < numVerts; i++ )
+	for ( i = 0; i < cv->numVerts; i++ )
 	{
-		components[ i ].minVertex = i;
-
 		for ( j = 0; j < 3; j++ )
 		{
 			cv->verts[ i ].xyz[ j ] = LittleFloat( verts[ i ].xyz[ j ] );
@@ -1214,9 +1314,6 @@ static void ParseTriSurf( dsurface_t *ds, drawVert_t *verts, bspSurface_t *surf,
 		{
 			cv->verts[ i ].st[ j ] = LittleFloat( verts[ i ].st[ j ] );
 			cv->verts[ i ].lightmap[ j ] = LittleFloat( verts[ i ].lightmap[ j ] );
-
-			components[ i ].stBounds[ 0 ][ j ] = cv->verts[ i ].st[ j ];
-			components[ i ].stBounds[ 1 ][ j ] = cv->verts[ i ].st[ j ];
 		}
 
 			cv->verts[ i ].lightColor = Color::Adapt( verts[ i ].color );
@@ -1224,69 +1321,13 @@ static void ParseTriSurf( dsurface_t *ds, drawVert_t *verts, bspSurface_t *surf,
 		R_ColorShiftLightingBytes( cv->verts[ i ].lightColor.ToArray(), cv->verts[ i ].lightColor.ToArray() );
 	}
 
-	// copy triangles
-	indexes += LittleLong( ds->firstIndex );
-
-	for ( i = 0, tri = cv->triangles; i < numTriangles; i++, tri++ )
-	{
-		for ( j = 0; j < 3; j++ )
-		{
-			tri->indexes[ j ] = LittleLong( indexes[ i * 3 + j ] );
-
-			if ( tri->indexes[ j ] < 0 || tri->indexes[ j ] >= numVerts )
-			{
-				ri.Error( errorParm_t::ERR_DROP, "Bad index in face surface" );
-			}
-		}
-	}
-
-	// compute strongly connected components and TC bounds per component
-	do {
-		updated = false;
-
-		for( i = 0, tri = cv->triangles; i < numTriangles; i++, tri++ ) {
-			int minVertex = std::min( std::min( components[ tri->indexes[ 0 ] ].minVertex,
-						  components[ tri->indexes[ 1 ] ].minVertex ),
-					     components[ tri->indexes[ 2 ] ].minVertex );
-			for( j = 0; j < 3; j++ ) {
-				int vertex = tri->indexes[ j ];
-				if( components[ vertex ].minVertex != minVertex ) {
-					updated = true;
-					components[ vertex ].minVertex = minVertex;
-					components[ minVertex ].stBounds[ 0 ][ 0 ] = std::min( components[ minVertex ].stBounds[ 0 ][ 0 ],
-											  components[ vertex ].stBounds[ 0 ][ 0 ] );
-					components[ minVertex ].stBounds[ 0 ][ 1 ] = std::min( components[ minVertex ].stBounds[ 0 ][ 1 ],
-											  components[ vertex ].stBounds[ 0 ][ 1 ] );
-					components[ minVertex ].stBounds[ 1 ][ 0 ] = std::max( components[ minVertex ].stBounds[ 1 ][ 0 ],
-											  components[ vertex ].stBounds[ 1 ][ 0 ] );
-					components[ minVertex ].stBounds[ 1 ][ 1 ] = std::max( components[ minVertex ].stBounds[ 1 ][ 1 ],
-											  components[ vertex ].stBounds[ 1 ][ 1 ] );
-				}
-			}
-		}
-	} while( updated );
-
-	// center texture coords
-	for( i = 0; i < numVerts; i++ ) {
-		if( components[ i ].minVertex == i ) {
-			for( j = 0; j < 2; j++ ) {
-				components[ i ].stBounds[ 0 ][ j ] = rintf( 0.5f * (components[ i ].stBounds[ 1 ][ j ] + components[ i ].stBounds[ 0 ][ j ]) );
-			}
-		}
-
-		for ( j = 0; j < 2; j++ )
-		{
-			cv->verts[ i ].st[ j ] -= components[ components[ i ].minVertex ].stBounds[ 0 ][ j ];
-		}
-	}
-
-	ri.Hunk_FreeTempMemory( components );
+	R_CenterSurfaceTexCoords( cv->verts, cv->numVerts, cv->triangles, cv->numTriangles );
 
 	// calc bounding box
 	// HACK: don't loop only through the vertices because they can contain bad data with .lwo models ...
 	ClearBounds( cv->bounds[ 0 ], cv->bounds[ 1 ] );
 
-	for ( i = 0, tri = cv->triangles; i < numTriangles; i++, tri++ )
+	for ( i = 0, tri = cv->triangles; i < cv->numTriangles; i++, tri++ )
 	{
 		AddPointToBounds( cv->verts[ tri->indexes[ 0 ] ].xyz, cv->bounds[ 0 ], cv->bounds[ 1 ] );
 		AddPointToBounds( cv->verts[ tri->indexes[ 1 ] ].xyz, cv->bounds[ 0 ], cv->bounds[ 1 ] );
@@ -1294,30 +1335,86 @@ static void ParseTriSurf( dsurface_t *ds, drawVert_t *verts, bspSurface_t *surf,
 	}
 
 	// Tr3B - calc tangent spaces
+	R_CalcSurfaceTangents( cv->verts, cv->triangles, cv->numTriangles );
+
+	// finish surface
+	FinishGenericSurface( ds, ( srfGeneric_t * ) cv, cv->verts[ 0 ].xyz );
+}
+
+/*
+===============
+R_FinishSurfaceGeometryJob
+===============
+*/
+static void R_FinishSurfaceGeometryJob( const surfaceGeometryJob_t &job )
+{
+	if ( *job.surf->data == surfaceType_t::SF_FACE )
 	{
-		srfVert_t *dv0, *dv1, *dv2;
-		vec3_t    tangent, binormal;
+		FinishFace( job.ds, job.verts, ( srfSurfaceFace_t * ) job.surf->data );
+	}
+	else
+	{
+		FinishTriSurf( job.ds, job.verts, ( srfTriangles_t * ) job.surf->data );
+	}
+}
 
-		for ( i = 0, tri = cv->triangles; i < numTriangles; i++, tri++ )
-		{
-			dv0 = &cv->verts[ tri->indexes[ 0 ] ];
-			dv1 = &cv->verts[ tri->indexes[ 1 ] ];
-			dv2 = &cv->verts[ tri->indexes[ 2 ] ];
+/*
+===============
+R_StartSurfaceGeometry
+
+Fills the vertexes of the surfaces queued by ParseFace and ParseTriSurf,
+on the world load threads if there are any
+===============
+*/
+static void R_StartSurfaceGeometry()
+{
+	int numThreads = Math::Clamp( r_mapLoadThreads->integer, 0, MAX_MAP_LOAD_THREADS );
 
-			R_CalcTangents( tangent, binormal,
-					dv0->xyz, dv1->xyz, dv2->xyz,
-					dv0->st, dv1->st, dv2->st );
-			R_TBNtoQtangents( tangent, binormal, dv0->normal,
-					  dv0->qtangent );
-			R_TBNtoQtangents( tangent, binormal, dv1->normal,
-					  dv1->qtangent );
-			R_TBNtoQtangents( tangent, binormal, dv2->normal,
-					  dv2->qtangent );
+	if ( !numThreads )
+	{
+		for ( const surfaceGeometryJob_t &job : surfaceGeometryJobs )
+		{
+			R_FinishSurfaceGeometryJob( job );
 		}
+
+		surfaceGeometryJobs.clear();
+		return;
 	}
 
-	// finish surface
-	FinishGenericSurface( ds, ( srfGeneric_t * ) cv, cv->verts[ 0 ].xyz );
+	// the background thread takes part in ParallelFor
+	worldLoadPool.SetNumThreads( numThreads - 1 );
+
+	surfaceGeometryThread = std::thread( [] {
+		int numJobs = surfaceGeometryJobs.size();
+		int numBatches = ( numJobs + SURFACE_GEOMETRY_BATCH - 1 ) / SURFACE_GEOMETRY_BATCH;
+
+		worldLoadPool.ParallelFor( numBatches, [ numJobs ]( int batch ) {
+			int last = std::min( ( batch + 1 ) * SURFACE_GEOMETRY_BATCH, numJobs );
+
+			for ( int i = batch * SURFACE_GEOMETRY_BATCH; i < last; i++ )
+			{
+				R_FinishSurfaceGeometryJob( surfaceGeometryJobs[ i ] );
+			}
+		} );
+	} );
+}
+
+/*
+===============
+R_FinishSurfaceGeometry
+
+Waits for the vertexes filled since R_StartSurfaceGeometry, this must be
+called before anything reads them and before the hunk is freed
+===============
+*/
+static void R_FinishSurfaceGeometry()
+{
+	if ( surfaceGeometryThread.joinable() )
+	{
+		surfaceGeometryThread.join();
+	}
+
+	surfaceGeometryJobs.clear();
 }
 
 /*
@@ -3381,6 +3478,8 @@ static void R_LoadSurfaces( lump_t *surfs, lump_t *verts, lump_t *indexLump )
 	Log::Debug("...loaded %d faces, %i meshes, %i trisurfs, %i flares %i foliages", numFaces, numMeshes, numTriSurfs,
 	           numFlares, numFoliages );
 
+	R_StartSurfaceGeometry();
+
 	if ( r_stitchCurves->integer )
 	{
 		R_StitchAllPatches();
@@ -3844,6 +3943,106 @@ static void R_LoadFogs( lump_t *l, lump_t *brushesLump, lump_t *sidesLump )
 	Log::Debug("%i fog volumes loaded", s_worldData.numFogs );
 }
 
+/*
+===============
+R_DecodeLightGridPoint
+===============
+*/
+static void R_DecodeLightGridPoint( const dgridPoint_t *in, bspGridPoint1_t *gridPoint1, bspGridPoint2_t *gridPoint2 )
+{
+	int    j;
+	byte   tmpAmbient[ 4 ];
+	byte   tmpDirected[ 4 ];
+	vec3_t ambientColor, directedColor, direction;
+	float  lat, lng;
+	float  scale;
+
+	tmpAmbient[ 0 ] = in->ambient[ 0 ];
+	tmpAmbient[ 1 ] = in->ambient[ 1 ];
+	tmpAmbient[ 2 ] = in->ambient[ 2 ];
+	tmpAmbient[ 3 ] = 255;
+
+	tmpDirected[ 0 ] = in->directed[ 0 ];
+	tmpDirected[ 1 ] = in->directed[ 1 ];
+	tmpDirected[ 2 ] = in->directed[ 2 ];
+	tmpDirected[ 3 ] = 255;
+
+	R_ColorShiftLightingBytes( tmpAmbient, tmpAmbient );
+	R_ColorShiftLightingBytes( tmpDirected, tmpDirected );
+
+	for ( j = 0; j < 3; j++ )
+	{
+		ambientColor[ j ] = tmpAmbient[ j ] * ( 1.0f / 255.0f );
+		directedColor[ j ] = tmpDirected[ j ] * ( 1.0f / 255.0f );
+	}
+
+	// standard spherical coordinates to cartesian coordinates conversion
+
+	// decode X as cos( lat ) * sin( long )
+	// decode Y as sin( lat ) * sin( long )
+	// decode Z as cos( long )
+
+	// RB: having a look in NormalToLatLong used by q3map2 shows the order of latLong
+
+	// Lat = 0 at (1,0,0) to 360 (-1,0,0), encoded in 8-bit sine table format
+	// Lng = 0 at (0,0,1) to 180 (0,0,-1), encoded in 8-bit sine table format
+
+	lat = DEG2RAD( in->latLong[ 1 ] * ( 360.0f / 255.0f ) );
+	lng = DEG2RAD( in->latLong[ 0 ] * ( 360.0f / 255.0f ) );
+
+	direction[ 0 ] = cos( lat ) * sin( lng );
+	direction[ 1 ] = sin( lat ) * sin( lng );
+	direction[ 2 ] = cos( lng );
+
+	// Pack data into an bspGridPoint
+	gridPoint1->ambient[ 0 ] = floatToUnorm8( ambientColor[ 0 ] );
+	gridPoint1->ambient[ 1 ] = floatToUnorm8( ambientColor[ 1 ] );
+	gridPoint1->ambient[ 2 ] = floatToUnorm8( ambientColor[ 2 ] );
+	gridPoint2->directed[ 0 ] = floatToUnorm8( directedColor[ 0 ] );
+	gridPoint2->directed[ 1 ] = floatToUnorm8( directedColor[ 1 ] );
+	gridPoint2->directed[ 2 ] = floatToUnorm8( directedColor[ 2 ] );
+
+	// Light direction vectors have to be stored in two bytes:
+	// First the vector is projected onto a unit octahedron, that means |x| + |y| + |z| = 1,
+	// then it is projected onto the x/y plane. The magnitude of z can be reconstructed by
+	// the above identity, but not the sign.
+	// Fortunately the identity implies |x| + |y| <= 1, so all vectors fall within a diamond
+	// shape within the unit square that covers exactly half of the area:
+	//
+	//           +-----+-----+
+	//           |    /|\    |
+	//           |   /#|#\   |
+	//           |  /##|##\  |
+	//           | /###|###\ |
+	//           |/####|####\|
+	//           +-----+-----+
+	//           |\####|####/|
+	//           | \###|###/ |
+	//           |  \##|##/  |
+	//           |   \#|#/   |
+	//           |    \|/    |
+	//           +-----+-----+
+	//
+	// If z >= 0, we keep just the x,y coordinates in the diamond, otherwise the point
+	// is flipped across the nearest diamond edge into one of the outer triangles.
+
+	// The interpolation in this format behaves quite good except when interpolating
+	// two points that are in different outer triangles.
+
+	scale = fabsf( direction[ 0 ] ) + fabsf( direction[ 1 ] ) + fabsf( direction[ 2 ] );
+	if( scale > 0.0f ) {
+		VectorScale( direction, 1.0f / scale, direction );
+		if( direction[ 2 ] < 0.0f ) {
+			float X = direction[ 0 ];
+			float Y = direction[ 1 ];
+			direction[ 0 ] = copysignf( 1.0f - fabs( Y ), X );
+			direction[ 1 ] = copysignf( 1.0f - fabs( X ), Y );
+		}
+	}
+	gridPoint1->lightVecX = 128 + floatToSnorm8( direction[ 0 ] );
+	gridPoint2->lightVecY = 128 + floatToSnorm8( direction[ 1 ] );
+}
+
 /*
 ================
 R_LoadLightGrid
@@ -3858,7 +4057,6 @@ void R_LoadLightGrid( lump_t *l )
 	dgridPoint_t   *in;
 	bspGridPoint1_t *gridPoint1;
 	bspGridPoint2_t *gridPoint2;
-	float          lat, lng;
 	int            from[ 3 ], to[ 3 ];
 	float          weights[ 3 ] = { 0.25f, 0.5f, 0.25f };
 	float          *factors[ 3 ] = { weights, weights, weights };
@@ -3963,97 +4161,17 @@ void R_LoadLightGrid( lump_t *l )
 	w->lightGridData1 = gridPoint1;
 	w->lightGridData2 = gridPoint2;
 
-	for ( i = 0; i < w->numLightGridPoints;
-	      i++, in++, gridPoint1++, gridPoint2++ )
-	{
-		byte tmpAmbient[ 4 ];
-		byte tmpDirected[ 4 ];
-
-		tmpAmbient[ 0 ] = in->ambient[ 0 ];
-		tmpAmbient[ 1 ] = in->ambient[ 1 ];
-		tmpAmbient[ 2 ] = in->ambient[ 2 ];
-		tmpAmbient[ 3 ] = 255;
-
-		tmpDirected[ 0 ] = in->directed[ 0 ];
-		tmpDirected[ 1 ] = in->directed[ 1 ];
-		tmpDirected[ 2 ] = in->directed[ 2 ];
-		tmpDirected[ 3 ] = 255;
+	int numBatches = ( w->numLightGridPoints + LIGHT_GRID_BATCH - 1 ) / LIGHT_GRID_BATCH;
 
-		R_ColorShiftLightingBytes( tmpAmbient, tmpAmbient );
-		R_ColorShiftLightingBytes( tmpDirected, tmpDirected );
+	worldLoadPool.SetNumThreads( Math::Clamp( r_mapLoadThreads->integer, 1, MAX_MAP_LOAD_THREADS ) - 1 );
+	worldLoadPool.ParallelFor( numBatches, [ w, in ]( int batch ) {
+		int last = std::min( ( batch + 1 ) * LIGHT_GRID_BATCH, w->numLightGridPoints );
 
-		for ( j = 0; j < 3; j++ )
+		for ( int i = batch * LIGHT_GRID_BATCH; i < last; i++ )
 		{
-			ambientColor[ j ] = tmpAmbient[ j ] * ( 1.0f / 255.0f );
-			directedColor[ j ] = tmpDirected[ j ] * ( 1.0f / 255.0f );
-		}
-
-		// standard spherical coordinates to cartesian coordinates conversion
-
-		// decode X as cos( lat ) * sin( long )
-		// decode Y as sin( lat ) * sin( long )
-		// decode Z as cos( long )
-
-		// RB: having a look in NormalToLatLong used by q3map2 shows the order of latLong
-
-		// Lat = 0 at (1,0,0) to 360 (-1,0,0), encoded in 8-bit sine table format
-		// Lng = 0 at (0,0,1) to 180 (0,0,-1), encoded in 8-bit sine table format
-
-		lat = DEG2RAD( in->latLong[ 1 ] * ( 360.0f / 255.0f ) );
-		lng = DEG2RAD( in->latLong[ 0 ] * ( 360.0f / 255.0f ) );
-
-		direction[ 0 ] = cos( lat ) * sin( lng );
-		direction[ 1 ] = sin( lat ) * sin( lng );
-		direction[ 2 ] = cos( lng );
-
-		// Pack data into an bspGridPoint
-		gridPoint1->ambient[ 0 ] = floatToUnorm8( ambientColor[ 0 ] );
-		gridPoint1->ambient[ 1 ] = floatToUnorm8( ambientColor[ 1 ] );
-		gridPoint1->ambient[ 2 ] = floatToUnorm8( ambientColor[ 2 ] );
-		gridPoint2->directed[ 0 ] = floatToUnorm8( directedColor[ 0 ] );
-		gridPoint2->directed[ 1 ] = floatToUnorm8( directedColor[ 1 ] );
-		gridPoint2->directed[ 2 ] = floatToUnorm8( directedColor[ 2 ] );
-
-		// Light direction vectors have to be stored in two bytes:
-		// First the vector is projected onto a unit octahedron, that means |x| + |y| + |z| = 1,
-		// then it is projected onto the x/y plane. The magnitude of z can be reconstructed by
-		// the above identity, but not the sign.
-		// Fortunately the identity implies |x| + |y| <= 1, so all vectors fall within a diamond
-		// shape within the unit square that covers exactly half of the area:
-		//
-		//           +-----+-----+
-		//           |    /|\    |
-		//           |   /#|#\   |
-		//           |  /##|##\  |
-		//           | /###|###\ |
-		//           |/####|####\|
-		//           +-----+-----+
-		//           |\####|####/|
-		//           | \###|###/ |
-		//           |  \##|##/  |
-		//           |   \#|#/   |
-		//           |    \|/    |
-		//           +-----+-----+
-		//
-		// If z >= 0, we keep just the x,y coordinates in the diamond, otherwise the point
-		// is flipped across the nearest diamond edge into one of the outer triangles.
-
-		// The interpolation in this format behaves quite good except when interpolating
-		// two points that are in different outer triangles.
-
-		scale = fabsf( direction[ 0 ] ) + fabsf( direction[ 1 ] ) + fabsf( direction[ 2 ] );
-		if( scale > 0.0f ) {
-			VectorScale( direction, 1.0f / scale, direction );
-			if( direction[ 2 ] < 0.0f ) {
-				float X = direction[ 0 ];
-				float Y = direction[ 1 ];
-				direction[ 0 ] = copysignf( 1.0f - fabs( Y ), X );
-				direction[ 1 ] = copysignf( 1.0f - fabs( X ), Y );
-			}
+			R_DecodeLightGridPoint( &in[ i ], &w->lightGridData1[ i ], &w->lightGridData2[ i ] );
 		}
-		gridPoint1->lightVecX = 128 + floatToSnorm8( direction[ 0 ] );
-		gridPoint2->lightVecY = 128 + floatToSnorm8( direction[ 1 ] );
-	}
+	} );
 
 	// fill in gridpoints with zero light (samples in walls) to avoid
 	// darkening of objects near walls
@@ -4799,30 +4917,113 @@ static void R_RecursivePrecacheInteractionNode( bspNode_t *node, trRefLight_t *l
 
 /*
 =================
-R_CreateInteractionVBO
+R_CreateInteractionVBO
+=================
+*/
+static interactionVBO_t *R_CreateInteractionVBO( trRefLight_t *light )
+{
+	interactionVBO_t *iaVBO;
+
+	iaVBO = (interactionVBO_t*) ri.Hunk_Alloc( sizeof( *iaVBO ), ha_pref::h_low );
+
+	// connect to interaction grid
+	if ( !light->firstInteractionVBO )
+	{
+		light->firstInteractionVBO = iaVBO;
+	}
+
+	if ( light->lastInteractionVBO )
+	{
+		light->lastInteractionVBO->next = iaVBO;
+	}
+
+	light->lastInteractionVBO = iaVBO;
+	iaVBO->next = nullptr;
+
+	return iaVBO;
+}
+
+/*
+The interactions precached for the static lights of a map are saved to
+interactions/<map>.cache in the home path and read back on the next load
+of the same map instead of walking the BSP and building the meshes again.
+
+The file is keyed by the checksum of the BSP file and a checksum of
+everything else the precaching depends on: the cvars, the shader flags and
+tessellation of the surfaces, and the bounds of the lights. The surfaces,
+leafs and shaders are stored as indexes into the world and the meshes with
+the indexes they upload, so loading the cache gives the same lists and
+IBOs as precaching.
+*/
+
+static const uint32_t INTERACTION_CACHE_VERSION = 2;
+
+enum class interactionMeshType_t
+{
+	LIGHT,
+	SHADOW,
+	SHADOW_CUBE,
+};
+
+struct interactionCacheHeader_t
+{
+	uint32_t version;
+	uint32_t bspChecksum;
+	uint32_t settingsChecksum;
+	int32_t  numLights;
+};
+
+struct interactionCacheLight_t
+{
+	int32_t lightNum;
+	int32_t numInteractions;
+	int32_t numLeafs;
+	int32_t numMeshes;
+};
+
+struct interactionCacheEntry_t
+{
+	int32_t surfaceNum;
+	int32_t mergedIntoVBO;
+};
+
+struct interactionCacheMesh_t
+{
+	int32_t type;
+	int32_t cubeSideBits;
+	int32_t surfaceNum; // a surface using the shader of the mesh
+	int32_t numIndexes;
+	int32_t numVerts;
+	float   bounds[ 2 ][ 3 ];
+	int32_t numIBOIndexes;
+};
+
+// the records are read in place, they must keep the indexes that follow them aligned
+static_assert( std::is_pod<interactionCacheMesh_t>::value, "interaction cache records are written as binary" );
+static_assert( sizeof( interactionCacheHeader_t ) % sizeof( glIndex_t ) == 0, "misaligned interaction cache record" );
+static_assert( sizeof( interactionCacheLight_t ) % sizeof( glIndex_t ) == 0, "misaligned interaction cache record" );
+static_assert( sizeof( interactionCacheEntry_t ) % sizeof( glIndex_t ) == 0, "misaligned interaction cache record" );
+static_assert( sizeof( interactionCacheMesh_t ) % sizeof( glIndex_t ) == 0, "misaligned interaction cache record" );
+
+static bool                   s_recordInteractionMeshes;
+static std::vector<glIndex_t> s_interactionMeshIndexes;
+
+/*
+=================
+R_CreateInteractionIBO
+
+Creates the IBO of a light or shadow mesh and keeps its indexes when the
+interaction cache is being written
 =================
 */
-static interactionVBO_t *R_CreateInteractionVBO( trRefLight_t *light )
+static IBO_t *R_CreateInteractionIBO( const char *name, glIndex_t *indexes, int numIndexes )
 {
-	interactionVBO_t *iaVBO;
-
-	iaVBO = (interactionVBO_t*) ri.Hunk_Alloc( sizeof( *iaVBO ), ha_pref::h_low );
-
-	// connect to interaction grid
-	if ( !light->firstInteractionVBO )
-	{
-		light->firstInteractionVBO = iaVBO;
-	}
-
-	if ( light->lastInteractionVBO )
+	if ( s_recordInteractionMeshes )
 	{
-		light->lastInteractionVBO->next = iaVBO;
+		s_interactionMeshIndexes.insert( s_interactionMeshIndexes.end(), indexes, indexes + numIndexes );
 	}
 
-	light->lastInteractionVBO = iaVBO;
-	iaVBO->next = nullptr;
-
-	return iaVBO;
+	return R_CreateStaticIBO( name, indexes, numIndexes );
 }
 
 /*
@@ -5200,7 +5401,7 @@ static void R_CreateVBOLightMeshes( trRefLight_t *light )
 			}
 
 			vboSurf->vbo = s_worldData.vbo;
-			vboSurf->ibo = R_CreateStaticIBO( va( "staticLightMesh_IBO %i", c_vboLightSurfaces ), indexes, 3 * numTriangles );
+			vboSurf->ibo = R_CreateInteractionIBO( va( "staticLightMesh_IBO %i", c_vboLightSurfaces ), indexes, 3 * numTriangles );
 
 			ri.Hunk_FreeTempMemory( indexes );
 
@@ -5572,7 +5773,7 @@ static void R_CreateVBOShadowMeshes( trRefLight_t *light )
 			}
 
 			vboSurf->vbo = s_worldData.vbo;
-			vboSurf->ibo = R_CreateStaticIBO( va( "staticShadowMesh_IBO %i", c_vboLightSurfaces ), indexes, 3 * numTriangles );
+			vboSurf->ibo = R_CreateInteractionIBO( va( "staticShadowMesh_IBO %i", c_vboLightSurfaces ), indexes, 3 * numTriangles );
 
 			ri.Hunk_FreeTempMemory( indexes );
 
@@ -5926,7 +6127,7 @@ static void R_CreateVBOShadowCubeMeshes( trRefLight_t *light )
 				}
 
 				vboSurf->vbo = s_worldData.vbo;
-				vboSurf->ibo = R_CreateStaticIBO( va( "staticShadowPyramidMesh_IBO %i", c_vboShadowSurfaces ), indexes, numTriangles );
+				vboSurf->ibo = R_CreateInteractionIBO( va( "staticShadowPyramidMesh_IBO %i", c_vboShadowSurfaces ), indexes, numTriangles );
 
 				ri.Hunk_FreeTempMemory( indexes );
 
@@ -5993,9 +6194,434 @@ static void R_CalcInteractionCubeSideBits( trRefLight_t *light )
 			}
 
 			light->shadowLOD = 0; // important for R_CalcLightCubeSideBits
-			iaCache->cubeSideBits = R_CalcLightCubeSideBits( light, localBounds );
+			iaCache->cubeSideBits = R_CalcLightCubeSideBits( light, localBounds, &tr.pc );
+		}
+	}
+}
+
+template<typename T>
+static void R_AppendInteractionCache( std::string &data, const T *values, size_t count )
+{
+	data.append( reinterpret_cast<const char *>( values ), count * sizeof( T ) );
+}
+
+/*
+=================
+R_InteractionCacheSettings
+
+Checksums what the interactions depend on besides the BSP file itself
+=================
+*/
+static uint32_t R_InteractionCacheSettings( const std::vector<trRefLight_t *> &lights )
+{
+	std::string  key;
+	int          i;
+	bspSurface_t *surface;
+
+	int32_t cvars[] = {
+		r_vboLighting->integer,
+		r_vboShadows->integer,
+		r_shadows->integer,
+		r_precomputedLighting->integer,
+		r_vertexLighting->integer,
+		s_worldData.numVerts,
+		s_worldData.numTriangles,
+	};
+
+	R_AppendInteractionCache( key, cvars, ARRAY_LEN( cvars ) );
+	R_AppendInteractionCache( key, tr.sunDirection, 3 );
+
+	for ( i = 0, surface = s_worldData.surfaces; i < s_worldData.numSurfaces; i++, surface++ )
+	{
+		shader_t *shader = surface->shader;
+
+		int32_t flags[] = {
+			Util::ordinal( *surface->data ),
+			shader->isSky,
+			shader->interactLight,
+			shader->noShadows,
+			shader->isPortal,
+			shader->alphaTest,
+			int( shader->cullType ),
+		};
+
+		R_AppendInteractionCache( key, flags, ARRAY_LEN( flags ) );
+		R_AppendInteractionCache( key, &shader->sort, 1 );
+
+		// the cached indexes point into the world VBO, whose surface order
+		// depends on the shader addresses, so the layout has to match too
+		int32_t layout[ 2 ] = { -1, -1 };
+
+		switch ( *surface->data )
+		{
+			case surfaceType_t::SF_FACE:
+				layout[ 0 ] = ( ( srfSurfaceFace_t * ) surface->data )->firstVert;
+				layout[ 1 ] = ( ( srfSurfaceFace_t * ) surface->data )->firstTriangle;
+				break;
+
+			case surfaceType_t::SF_GRID:
+				layout[ 0 ] = ( ( srfGridMesh_t * ) surface->data )->firstVert;
+				layout[ 1 ] = ( ( srfGridMesh_t * ) surface->data )->firstTriangle;
+				break;
+
+			case surfaceType_t::SF_TRIANGLES:
+				layout[ 0 ] = ( ( srfTriangles_t * ) surface->data )->firstVert;
+				layout[ 1 ] = ( ( srfTriangles_t * ) surface->data )->firstTriangle;
+				break;
+
+			default:
+				break;
+		}
+
+		if ( layout[ 0 ] >= 0 )
+		{
+			srfGeneric_t *gen = ( srfGeneric_t * ) surface->data;
+
+			R_AppendInteractionCache( key, &gen->bounds[ 0 ][ 0 ], 6 );
+			R_AppendInteractionCache( key, layout, ARRAY_LEN( layout ) );
+		}
+	}
+
+	for ( trRefLight_t *light : lights )
+	{
+		int32_t type[] = {
+			Util::ordinal( light->l.rlType ),
+			light->l.noShadows,
+		};
+
+		R_AppendInteractionCache( key, type, ARRAY_LEN( type ) );
+		R_AppendInteractionCache( key, light->origin, 3 );
+		R_AppendInteractionCache( key, &light->worldBounds[ 0 ][ 0 ], 6 );
+	}
+
+	return Com_BlockChecksum( key.data(), key.size() );
+}
+
+/*
+=================
+R_InteractionCachePath
+=================
+*/
+static std::string R_InteractionCachePath()
+{
+	return Str::Format( "interactions/%s.cache", s_worldData.baseName );
+}
+
+/*
+=================
+R_SaveInteractionCache
+=================
+*/
+static void R_SaveInteractionCache( const std::vector<trRefLight_t *> &lights, uint32_t bspChecksum, uint32_t settingsChecksum )
+{
+	std::string              data;
+	interactionCacheHeader_t header;
+	size_t                   meshIndex = 0;
+
+	header.version = INTERACTION_CACHE_VERSION;
+	header.bspChecksum = bspChecksum;
+	header.settingsChecksum = settingsChecksum;
+	header.numLights = lights.size();
+
+	R_AppendInteractionCache( data, &header, 1 );
+
+	for ( trRefLight_t *light : lights )
+	{
+		interactionCacheLight_t cacheLight{};
+
+		cacheLight.lightNum = light - s_worldData.lights;
+		cacheLight.numLeafs = light->leafs.numElements;
+
+		for ( interactionCache_t *iaCache = light->firstInteractionCache; iaCache; iaCache = iaCache->next )
+		{
+			cacheLight.numInteractions++;
+		}
+
+		for ( interactionVBO_t *iaVBO = light->firstInteractionVBO; iaVBO; iaVBO = iaVBO->next )
+		{
+			cacheLight.numMeshes++;
+		}
+
+		R_AppendInteractionCache( data, &cacheLight, 1 );
+
+		for ( interactionCache_t *iaCache = light->firstInteractionCache; iaCache; iaCache = iaCache->next )
+		{
+			interactionCacheEntry_t entry;
+
+			entry.surfaceNum = iaCache->surface - s_worldData.surfaces;
+			entry.mergedIntoVBO = iaCache->mergedIntoVBO;
+
+			R_AppendInteractionCache( data, &entry, 1 );
+		}
+
+		// new leafs are inserted at the front, store them from the oldest
+		for ( link_t *l = light->leafs.prev; l != &light->leafs; l = l->prev )
+		{
+			int32_t nodeNum = ( bspNode_t * ) l->data - s_worldData.nodes;
+
+			R_AppendInteractionCache( data, &nodeNum, 1 );
+		}
+
+		for ( interactionVBO_t *iaVBO = light->firstInteractionVBO; iaVBO; iaVBO = iaVBO->next )
+		{
+			interactionCacheMesh_t mesh;
+			srfVBOMesh_t           *vboSurf;
+
+			if ( iaVBO->vboLightMesh )
+			{
+				mesh.type = Util::ordinal( interactionMeshType_t::LIGHT );
+				vboSurf = iaVBO->vboLightMesh;
+			}
+			else
+			{
+				mesh.type = Util::ordinal( iaVBO->cubeSideBits ? interactionMeshType_t::SHADOW_CUBE : interactionMeshType_t::SHADOW );
+				vboSurf = iaVBO->vboShadowMesh;
+			}
+
+			mesh.cubeSideBits = iaVBO->cubeSideBits;
+			mesh.surfaceNum = -1;
+			mesh.numIndexes = vboSurf->numIndexes;
+			mesh.numVerts = vboSurf->numVerts;
+			mesh.numIBOIndexes = vboSurf->ibo ? vboSurf->ibo->indexesNum : 0;
+			VectorCopy( vboSurf->bounds[ 0 ], mesh.bounds[ 0 ] );
+			VectorCopy( vboSurf->bounds[ 1 ], mesh.bounds[ 1 ] );
+
+			for ( interactionCache_t *iaCache = light->firstInteractionCache; iaCache; iaCache = iaCache->next )
+			{
+				if ( iaCache->surface->shader == iaVBO->shader )
+				{
+					mesh.surfaceNum = iaCache->surface - s_worldData.surfaces;
+					break;
+				}
+			}
+
+			if ( mesh.surfaceNum < 0 || meshIndex + mesh.numIBOIndexes > s_interactionMeshIndexes.size() )
+			{
+				Log::Warn( "interaction cache of %s not saved: mesh without a surface", s_worldData.name );
+				return;
+			}
+
+			R_AppendInteractionCache( data, &mesh, 1 );
+			R_AppendInteractionCache( data, s_interactionMeshIndexes.data() + meshIndex, mesh.numIBOIndexes );
+
+			meshIndex += mesh.numIBOIndexes;
+		}
+	}
+
+	std::string path = R_InteractionCachePath();
+	ri.FS_WriteFile( path.c_str(), data.data(), data.size() );
+
+	Log::Debug( "wrote %s (%i bytes)", path, data.size() );
+}
+
+/*
+=================
+R_ParseInteractionCache
+
+Walks the records of an interaction cache file, checking them when apply
+is false and rebuilding the interactions of the lights when it is true.
+The lights must have been set up as for R_PrecacheInteractions.
+=================
+*/
+static bool R_ParseInteractionCache( std::string &data, const std::vector<trRefLight_t *> &lights, bool apply )
+{
+	size_t offset = sizeof( interactionCacheHeader_t );
+
+	auto read = [ & ]( size_t size ) -> byte * {
+		if ( size > data.size() - offset )
+		{
+			return nullptr;
+		}
+
+		byte *record = reinterpret_cast<byte *>( &data[ offset ] );
+		offset += size;
+		return record;
+	};
+
+	for ( trRefLight_t *light : lights )
+	{
+		auto *cacheLight = ( interactionCacheLight_t * ) read( sizeof( interactionCacheLight_t ) );
+
+		if ( !cacheLight || cacheLight->lightNum != light - s_worldData.lights
+		     || cacheLight->numInteractions < 0 || cacheLight->numLeafs < 0 || cacheLight->numMeshes < 0 )
+		{
+			return false;
+		}
+
+		auto *entries = ( interactionCacheEntry_t * ) read( cacheLight->numInteractions * sizeof( interactionCacheEntry_t ) );
+		auto *nodeNums = ( int32_t * ) read( cacheLight->numLeafs * sizeof( int32_t ) );
+
+		if ( !entries || !nodeNums )
+		{
+			return false;
+		}
+
+		for ( int i = 0; i < cacheLight->numInteractions; i++ )
+		{
+			if ( entries[ i ].surfaceNum < 0 || entries[ i ].surfaceNum >= s_worldData.numSurfaces )
+			{
+				return false;
+			}
+
+			if ( apply )
+			{
+				R_PrecacheInteraction( light, &s_worldData.surfaces[ entries[ i ].surfaceNum ] );
+				light->lastInteractionCache->mergedIntoVBO = entries[ i ].mergedIntoVBO;
+			}
+		}
+
+		for ( int i = 0; i < cacheLight->numLeafs; i++ )
+		{
+			if ( nodeNums[ i ] < 0 || nodeNums[ i ] >= s_worldData.numnodes )
+			{
+				return false;
+			}
+
+			if ( apply )
+			{
+				link_t *l = ( link_t * ) ri.Hunk_Alloc( sizeof( *l ), ha_pref::h_low );
+				InitLink( l, &s_worldData.nodes[ nodeNums[ i ] ] );
+
+				InsertLink( l, &light->leafs );
+
+				light->leafs.numElements++;
+			}
+		}
+
+		for ( int i = 0; i < cacheLight->numMeshes; i++ )
+		{
+			auto *mesh = ( interactionCacheMesh_t * ) read( sizeof( interactionCacheMesh_t ) );
+
+			if ( !mesh || mesh->numIBOIndexes < 0 || mesh->surfaceNum < 0 || mesh->surfaceNum >= s_worldData.numSurfaces
+			     || mesh->type < 0 || mesh->type > Util::ordinal( interactionMeshType_t::SHADOW_CUBE ) )
+			{
+				return false;
+			}
+
+			auto *indexes = ( glIndex_t * ) read( mesh->numIBOIndexes * sizeof( glIndex_t ) );
+
+			if ( !indexes )
+			{
+				return false;
+			}
+
+			for ( int j = 0; j < mesh->numIBOIndexes; j++ )
+			{
+				if ( indexes[ j ] >= ( glIndex_t ) s_worldData.numVerts )
+				{
+					return false;
+				}
+			}
+
+			if ( !apply )
+			{
+				continue;
+			}
+
+			srfVBOMesh_t *vboSurf = ( srfVBOMesh_t * ) ri.Hunk_Alloc( sizeof( *vboSurf ), ha_pref::h_low );
+			vboSurf->surfaceType = surfaceType_t::SF_VBO_MESH;
+			vboSurf->numIndexes = mesh->numIndexes;
+			vboSurf->numVerts = mesh->numVerts;
+			vboSurf->lightmapNum = -1;
+
+			VectorCopy( mesh->bounds[ 0 ], vboSurf->bounds[ 0 ] );
+			VectorCopy( mesh->bounds[ 1 ], vboSurf->bounds[ 1 ] );
+
+			vboSurf->vbo = s_worldData.vbo;
+
+			interactionVBO_t *iaVBO;
+
+			switch ( interactionMeshType_t( mesh->type ) )
+			{
+				case interactionMeshType_t::LIGHT:
+					vboSurf->ibo = R_CreateStaticIBO( va( "staticLightMesh_IBO %i", c_vboLightSurfaces ), indexes, mesh->numIBOIndexes );
+
+					iaVBO = R_CreateInteractionVBO( light );
+					iaVBO->vboLightMesh = vboSurf;
+
+					c_vboLightSurfaces++;
+					break;
+
+				case interactionMeshType_t::SHADOW:
+					vboSurf->ibo = R_CreateStaticIBO( va( "staticShadowMesh_IBO %i", c_vboLightSurfaces ), indexes, mesh->numIBOIndexes );
+
+					iaVBO = R_CreateInteractionVBO( light );
+					iaVBO->vboShadowMesh = vboSurf;
+
+					c_vboShadowSurfaces++;
+					break;
+
+				default:
+					vboSurf->ibo = R_CreateStaticIBO( va( "staticShadowPyramidMesh_IBO %i", c_vboShadowSurfaces ), indexes, mesh->numIBOIndexes );
+
+					iaVBO = R_CreateInteractionVBO( light );
+					iaVBO->vboShadowMesh = vboSurf;
+
+					c_vboShadowSurfaces++;
+					break;
+			}
+
+			iaVBO->cubeSideBits = mesh->cubeSideBits;
+			iaVBO->shader = s_worldData.surfaces[ mesh->surfaceNum ].shader;
+		}
+
+		if ( apply )
+		{
+			// cheap enough to redo, it also resets the shadow LOD like precaching does
+			R_CalcInteractionCubeSideBits( light );
 		}
 	}
+
+	return offset == data.size();
+}
+
+/*
+=================
+R_LoadInteractionCache
+=================
+*/
+static bool R_LoadInteractionCache( const std::vector<trRefLight_t *> &lights, uint32_t bspChecksum, uint32_t settingsChecksum )
+{
+	interactionCacheHeader_t header;
+	std::error_code          err;
+
+	// FS::FileView only maps files of the paks, this one is in the home path
+	// so it is read in one piece and its records are used in place
+	std::string path = R_InteractionCachePath();
+	FS::File file = FS::HomePath::OpenRead( path, err );
+
+	if ( err )
+	{
+		return false;
+	}
+
+	std::string data = file.ReadAll( err );
+
+	if ( err || data.size() < sizeof( header ) )
+	{
+		return false;
+	}
+
+	memcpy( &header, data.data(), sizeof( header ) );
+
+	if ( header.version != INTERACTION_CACHE_VERSION || header.bspChecksum != bspChecksum
+	     || header.settingsChecksum != settingsChecksum || header.numLights != int( lights.size() ) )
+	{
+		Log::Debug( "%s is out of date", path );
+		return false;
+	}
+
+	// check everything first so a bad file doesn't leave half built lights
+	if ( !R_ParseInteractionCache( data, lights, false ) )
+	{
+		Log::Warn( "%s is corrupt, precaching the interactions", path );
+		return false;
+	}
+
+	R_ParseInteractionCache( data, lights, true );
+
+	Log::Debug( "loaded the interactions of %i lights from %s", header.numLights, path );
+	return true;
 }
 
 /*
@@ -6009,6 +6635,10 @@ void R_PrecacheInteractions()
 	trRefLight_t *light;
 	bspSurface_t *surface;
 	int          startTime, endTime;
+	uint32_t     bspChecksum = 0, settingsChecksum = 0;
+	bool         useCache;
+
+	std::vector<trRefLight_t *> lights;
 
 	startTime = ri.Milliseconds();
 
@@ -6066,22 +6696,51 @@ void R_PrecacheInteractions()
 		light->firstInteractionVBO = nullptr;
 		light->lastInteractionVBO = nullptr;
 
-		// perform culling and add all the potentially visible surfaces
-		s_lightCount++;
 		QueueInit( &light->leafs );
-		R_RecursivePrecacheInteractionNode( s_worldData.nodes, light );
 
-		// create a static VBO surface for each light geometry batch
-		R_CreateVBOLightMeshes( light );
+		lights.push_back( light );
+	}
+
+	useCache = r_interactionCache->integer && !lights.empty();
+
+	if ( useCache )
+	{
+		bspChecksum = Com_BlockChecksum( fileBase, fileLength );
+		settingsChecksum = R_InteractionCacheSettings( lights );
+	}
+
+	if ( !useCache || !R_LoadInteractionCache( lights, bspChecksum, settingsChecksum ) )
+	{
+		s_recordInteractionMeshes = useCache;
+		s_interactionMeshIndexes.clear();
+
+		for ( trRefLight_t *light : lights )
+		{
+			// perform culling and add all the potentially visible surfaces
+			s_lightCount++;
+			R_RecursivePrecacheInteractionNode( s_worldData.nodes, light );
+
+			// create a static VBO surface for each light geometry batch
+			R_CreateVBOLightMeshes( light );
+
+			// create a static VBO surface for each shadow geometry batch
+			R_CreateVBOShadowMeshes( light );
 
-		// create a static VBO surface for each shadow geometry batch
-		R_CreateVBOShadowMeshes( light );
+			// calculate pyramid bits for each interaction in omni-directional lights
+			R_CalcInteractionCubeSideBits( light );
+
+			// create a static VBO surface for each light geometry batch inside a cubemap pyramid
+			R_CreateVBOShadowCubeMeshes( light );
+		}
 
-		// calculate pyramid bits for each interaction in omni-directional lights
-		R_CalcInteractionCubeSideBits( light );
+		if ( useCache )
+		{
+			R_SaveInteractionCache( lights, bspChecksum, settingsChecksum );
+		}
 
-		// create a static VBO surface for each light geometry batch inside a cubemap pyramid
-		R_CreateVBOShadowCubeMeshes( light );
+		s_recordInteractionMeshes = false;
+		s_interactionMeshIndexes.clear();
+		s_interactionMeshIndexes.shrink_to_fit();
 	}
 
 	// move interactions grow list to hunk
@@ -6720,7 +7379,7 @@ void RE_LoadWorldMap( const char *name )
 	tr.worldMapLoaded = true;
 
 	// load it
-	ri.FS_ReadFile( name, ( void ** ) &buffer );
+	fileLength = ri.FS_ReadFile( name, ( void ** ) &buffer );
 
 	if ( !buffer )
 	{
@@ -6761,6 +7420,17 @@ void RE_LoadWorldMap( const char *name )
 		( ( int * ) header ) [ i ] = LittleLong( ( ( int * ) header ) [ i ] );
 	}
 
+	// the surface geometry may still be filled in the background when a
+	// later stage drops the load, wait for it before the hunk goes away
+	struct worldLoadThreadsGuard_t
+	{
+		~worldLoadThreadsGuard_t()
+		{
+			R_FinishSurfaceGeometry();
+			worldLoadPool.SetNumThreads( 0 );
+		}
+	} worldLoadThreadsGuard;
+
 	// load into heap
 	R_LoadEntities( &header->lumps[ LUMP_ENTITIES ] );
 
@@ -6783,8 +7453,14 @@ void RE_LoadWorldMap( const char *name )
 
 	R_LoadVisibility( &header->lumps[ LUMP_VISIBILITY ] );
 
+	// the stages from here on read the surface geometry
+	R_FinishSurfaceGeometry();
+
 	R_LoadLightGrid( &header->lumps[ LUMP_LIGHTGRID ] );
 
+	// pick the faces the main view is culled with
+	R_BuildOccluders( &s_worldData );
+
 	// create a static vbo for the world
 	R_CreateWorldVBO();
 	R_CreateClusters();
@@ -74,6 +74,9 @@ void R_PerformanceCounters()
 
 		Log::Notice("(md5) %i bin %i bclip %i bout",
 		           tr.pc.c_box_cull_md5_in, tr.pc.c_box_cull_md5_clip, tr.pc.c_box_cull_md5_out );
+
+		Log::Notice("(occ) %i occluders %i tests %i out",
+		           tr.pc.c_occluders, tr.pc.c_occlusionTests, tr.pc.c_occlusion_cull_out );
 	}
 	else if ( r_speeds->integer == Util::ordinal(renderSpeeds_t::RSPEEDS_VIEWCLUSTER ))
 	{
@@ -116,6 +119,16 @@ void R_PerformanceCounters()
 		           tr.pc.c_decalProjectors, tr.pc.c_decalTestSurfaces, tr.pc.c_decalClipSurfaces, tr.pc.c_decalSurfaces,
 		           tr.pc.c_decalSurfacesCreated );
 	}
+	else if ( r_speeds->integer == Util::ordinal(renderSpeeds_t::RSPEEDS_SKELETONS ))
+	{
+		size_t numPoses, poseBytes;
+
+		R_SkeletonCacheInfo( &numPoses, &poseBytes );
+
+		Log::Notice("skeleton cache hits:%i misses:%i evictions:%i poses:%i size:%iKB",
+		           tr.pc.c_skeletonCacheHits, tr.pc.c_skeletonCacheMisses, tr.pc.c_skeletonCacheEvictions,
+		           int( numPoses ), int( poseBytes / 1024 ) );
+	}
 
 	Com_Memset( &tr.pc, 0, sizeof( tr.pc ) );
 	Com_Memset( &backEnd.pc, 0, sizeof( backEnd.pc ) );
@@ -443,6 +456,9 @@ void RE_SetColorGrading( int slot, qhandle_t hShader )
 		return;
 	}
 
+	// the size of the image is needed
+	R_FinishImageLoad( image );
+
 	if ( image->width != REF_COLORGRADEMAP_SIZE && image->height != REF_COLORGRADEMAP_SIZE )
 	{
 		return;
@@ -786,6 +802,9 @@ void RE_BeginFrame()
 
 	GLimp_LogComment( "--- RE_BeginFrame ---\n" );
 
+	R_UpdateTextureStreaming();
+	R_UploadDecodedImages();
+
 	tr.frameCount++;
 	tr.frameSceneNum = 0;
 	tr.viewCount = 0;
@@ -837,7 +837,7 @@ AddDecalSurface()
 adds a decal surface to the scene
 */
 
-void R_AddDecalSurface( decal_t *decal )
+void R_AddDecalSurface( frontEndJob_t *job, decal_t *decal )
 {
 	int        i;
 	float      fade;
@@ -873,8 +873,8 @@ void R_AddDecalSurface( decal_t *decal )
 	}
 
 	/* add surface to scene */
-	R_AddDrawSurf( ( surfaceType_t * ) srf, decal->shader, -1, decal->fogIndex );
-	tr.pc.c_decalSurfaces++;
+	R_AddDrawSurf( job, ( surfaceType_t * ) srf, decal->shader, -1, decal->fogIndex );
+	job->pc.c_decalSurfaces++;
 
 	/* free temporary decal */
 	if ( decal->fadeEndTime <= tr.refdef.time )
@@ -888,7 +888,7 @@ R_AddDecalSurfaces()
 adds decal surfaces to the scene
 */
 
-void R_AddDecalSurfaces( bspModel_t *bmodel )
+void R_AddDecalSurfaces( frontEndJob_t *job, bspModel_t *bmodel )
 {
 	int     i, count;
 	decal_t *decal;
@@ -901,7 +901,7 @@ void R_AddDecalSurfaces( bspModel_t *bmodel )
 
 	for ( i = 0; i < count; i++, decal++ )
 	{
-		R_AddDecalSurface( decal );
+		R_AddDecalSurface( job, decal );
 	}
 }
 
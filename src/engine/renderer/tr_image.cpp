@@ -22,6 +22,7 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 */
 // tr_image.c
 #include <common/FileSystem.h>
+#include "common/ThreadPool.h"
 #include "tr_local.h"
 
 int                  gl_filter_min = GL_LINEAR_MIPMAP_NEAREST;
@@ -768,6 +769,111 @@ R_ConvertBC5Image(const byte **in, byte **out, int numMips, int numLayers,
 	}
 }
 
+/*
+===============
+R_GetImageUploadSize
+
+Computes the size an image of the given size is uploaded with,
+after picmip and the clamp to the OpenGL limits
+===============
+*/
+static void R_GetImageUploadSize( GLenum type, int bits, int width, int height, int *scaledWidth, int *scaledHeight )
+{
+	// perform optional picmip operation
+	if ( !( bits & IF_NOPICMIP ) )
+	{
+		int picmip = std::max( r_picmip->integer, 0 );
+
+		width >>= picmip;
+		height >>= picmip;
+	}
+
+	// clamp to minimum size
+	width = std::max( width, 1 );
+	height = std::max( height, 1 );
+
+	// clamp to the current upper OpenGL limit
+	// scale both axis down equally so we don't have to
+	// deal with a half mip resampling
+	int maxSize = type == GL_TEXTURE_CUBE_MAP ? glConfig2.maxCubeMapTextureSize : glConfig.maxTextureSize;
+
+	while ( width > maxSize || height > maxSize )
+	{
+		width >>= 1;
+		height >>= 1;
+	}
+
+	*scaledWidth = width;
+	*scaledHeight = height;
+}
+
+/*
+===============
+R_GetImageSamples
+
+Returns 4 if the alpha channel of an RGBA image is needed, 3 otherwise
+===============
+*/
+static int R_GetImageSamples( int bits, const byte *pic, int numPixels )
+{
+	// Tr3B: normalmaps have the displacement maps in the alpha channel
+	// samples 3 would cause an opaque alpha channel and odd displacements!
+	if ( bits & IF_NORMALMAP )
+	{
+		return ( bits & ( IF_DISPLACEMAP | IF_ALPHATEST ) ) ? 4 : 3;
+	}
+
+	if ( bits & IF_LIGHTMAP )
+	{
+		return 3;
+	}
+
+	// verify if the alpha channel is being used or not
+	for ( int i = 0; i < numPixels; i++ )
+	{
+		if ( pic[ i * 4 + 3 ] != 255 )
+		{
+			return 4;
+		}
+	}
+
+	return 3;
+}
+
+/*
+===============
+R_NormalizeImagePixels
+===============
+*/
+static void R_NormalizeImagePixels( byte *pic, int numPixels )
+{
+	for ( int i = 0; i < numPixels; i++ )
+	{
+		vec3_t n;
+
+		n[ 0 ] = Tex_ByteToFloat( pic[ i * 4 + 0 ] );
+		n[ 1 ] = Tex_ByteToFloat( pic[ i * 4 + 1 ] );
+		n[ 2 ] = Tex_ByteToFloat( pic[ i * 4 + 2 ] );
+
+		VectorNormalize( n );
+
+		pic[ i * 4 + 0 ] = Tex_FloatToByte( n[ 0 ] );
+		pic[ i * 4 + 1 ] = Tex_FloatToByte( n[ 1 ] );
+		pic[ i * 4 + 2 ] = Tex_FloatToByte( n[ 2 ] );
+	}
+}
+
+// an RGBA image already resampled to its upload size, see R_DecodeImageJob
+struct preparedImage_t
+{
+	const byte *data;
+	int        width, height;
+	int        samples;
+};
+
+// the pixel unpack buffer prepared images are uploaded from
+static GLuint imageUploadPBO;
+
 /*
 ===============
 R_UploadImage
@@ -780,15 +886,15 @@ level 1 has only numLayers/2 layers. There are still numLayers pointers in
 the dataArray for every mip level, the unneeded elements at the end aren't used.
 ===============
 */
-void R_UploadImage( const byte **dataArray, int numLayers, int numMips,
-		    image_t *image )
+static void R_UploadImageInternal( const byte **dataArray, int numLayers, int numMips,
+				   image_t *image, const preparedImage_t *prepared )
 {
 	const byte *data;
 	byte       *scaledBuffer = nullptr;
+	const byte *uploadData;
 	int        scaledWidth, scaledHeight;
 	int        mipWidth, mipHeight, mipLayers, mipSize, blockSize;
-	int        i, j, c;
-	const byte *scan;
+	int        i, j;
 	GLenum     target;
 	GLenum     format = GL_RGBA;
 	GLenum     internalFormat = GL_RGB;
@@ -802,53 +908,24 @@ void R_UploadImage( const byte **dataArray, int numLayers, int numMips,
 
 	GL_Bind( image );
 
-	scaledWidth = image->width;
-	scaledHeight = image->height;
-
-	// perform optional picmip operation
-	if ( !( image->bits & IF_NOPICMIP ) )
-	{
-		int picmip = r_picmip->integer;
-		if( picmip < 0 )
-			picmip = 0;
-
-		scaledWidth >>= picmip;
-		scaledHeight >>= picmip;
-
-		if( dataArray && numMips > picmip ) {
-			dataArray += numLayers * picmip;
-			numMips -= picmip;
-		}
-	}
-
-	// clamp to minimum size
-	if ( scaledWidth < 1 )
-	{
-		scaledWidth = 1;
-	}
-
-	if ( scaledHeight < 1 )
-	{
-		scaledHeight = 1;
-	}
-
-	// clamp to the current upper OpenGL limit
-	// scale both axis down equally so we don't have to
-	// deal with a half mip resampling
-	if ( image->type == GL_TEXTURE_CUBE_MAP )
+	if ( prepared )
 	{
-		while ( scaledWidth > glConfig2.maxCubeMapTextureSize || scaledHeight > glConfig2.maxCubeMapTextureSize )
-		{
-			scaledWidth >>= 1;
-			scaledHeight >>= 1;
-		}
+		scaledWidth = prepared->width;
+		scaledHeight = prepared->height;
 	}
 	else
 	{
-		while ( scaledWidth > glConfig.maxTextureSize || scaledHeight > glConfig.maxTextureSize )
+		R_GetImageUploadSize( image->type, image->bits, image->width, image->height, &scaledWidth, &scaledHeight );
+
+		// skip the precomputed mipmaps picmip drops
+		if ( !( image->bits & IF_NOPICMIP ) )
 		{
-			scaledWidth >>= 1;
-			scaledHeight >>= 1;
+			int picmip = std::max( r_picmip->integer, 0 );
+
+			if( dataArray && numMips > picmip ) {
+				dataArray += numLayers * picmip;
+				numMips -= picmip;
+			}
 		}
 	}
 
@@ -992,47 +1069,20 @@ void R_UploadImage( const byte **dataArray, int numLayers, int numMips,
 	{
 		internalFormat = GL_RGBA8;
 	}
-	else if ( !dataArray ) {
+	else if ( !dataArray && !prepared ) {
 		internalFormat = GL_RGBA8;
 	}
 	else
 	{
 		int samples;
 
-		// scan the texture for each channel's max values
-		// and verify if the alpha channel is being used or not
-		c = image->width * image->height;
-		scan = dataArray[0];
-
-		samples = 3;
-
-		// Tr3B: normalmaps have the displacement maps in the alpha channel
-		// samples 3 would cause an opaque alpha channel and odd displacements!
-		if ( image->bits & IF_NORMALMAP )
-		{
-			if ( image->bits & ( IF_DISPLACEMAP | IF_ALPHATEST ) )
-			{
-				samples = 4;
-			}
-			else
-			{
-				samples = 3;
-			}
-		}
-		else if ( image->bits & IF_LIGHTMAP )
+		if ( prepared )
 		{
-			samples = 3;
+			samples = prepared->samples;
 		}
 		else
 		{
-			for ( i = 0; i < c; i++ )
-			{
-				if ( scan[ i * 4 + 3 ] != 255 )
-				{
-					samples = 4;
-					break;
-				}
-			}
+			samples = R_GetImageSamples( image->bits, dataArray[ 0 ], image->width * image->height );
 		}
 
 		// select proper internal format
@@ -1097,9 +1147,25 @@ void R_UploadImage( const byte **dataArray, int numLayers, int numMips,
 	}
 
 	if( format != GL_NONE ) {
-		if( dataArray )
+		if( dataArray && !prepared )
 			scaledBuffer = (byte*) ri.Hunk_AllocateTempMemory( sizeof( byte ) * scaledWidth * scaledHeight * 4 );
 
+		uploadData = scaledBuffer;
+
+		if ( prepared )
+		{
+			// going through a buffer object lets the driver copy the
+			// pixels to the texture without stalling this thread
+			if ( !imageUploadPBO )
+			{
+				glGenBuffers( 1, &imageUploadPBO );
+			}
+
+			glBindBuffer( GL_PIXEL_UNPACK_BUFFER, imageUploadPBO );
+			glBufferData( GL_PIXEL_UNPACK_BUFFER, scaledWidth * scaledHeight * 4, prepared->data, GL_STREAM_DRAW );
+			uploadData = nullptr;
+		}
+
 		for ( i = 0; i < numLayers; i++ )
 		{
 			if( dataArray )
@@ -1121,21 +1187,7 @@ void R_UploadImage( const byte **dataArray, int numLayers, int numMips,
 				}
 
 				if( image->bits & IF_NORMALMAP ) {
-					c = scaledWidth * scaledHeight;
-					for ( i = 0; i < c; i++ )
-					{
-						vec3_t n;
-
-						n[ 0 ] = Tex_ByteToFloat( scaledBuffer[ i * 4 + 0 ] );
-						n[ 1 ] = Tex_ByteToFloat( scaledBuffer[ i * 4 + 1 ] );
-						n[ 2 ] = Tex_ByteToFloat( scaledBuffer[ i * 4 + 2 ] );
-
-						VectorNormalize( n );
-
-						scaledBuffer[ i * 4 + 0 ] = Tex_FloatToByte( n[ 0 ] );
-						scaledBuffer[ i * 4 + 1 ] = Tex_FloatToByte( n[ 1 ] );
-						scaledBuffer[ i * 4 + 2 ] = Tex_FloatToByte( n[ 2 ] );
-					}
+					R_NormalizeImagePixels( scaledBuffer, scaledWidth * scaledHeight );
 				}
 			}
 
@@ -1155,7 +1207,7 @@ void R_UploadImage( const byte **dataArray, int numLayers, int numMips,
 				break;
 			case GL_TEXTURE_CUBE_MAP:
 				glTexImage2D( target + i, 0, internalFormat, scaledWidth, scaledHeight, 0, format, GL_UNSIGNED_BYTE,
-				              scaledBuffer );
+				              uploadData );
 				break;
 
 			default:
@@ -1165,7 +1217,7 @@ void R_UploadImage( const byte **dataArray, int numLayers, int numMips,
 				}
 				else
 				{
-					glTexImage2D( target, 0, internalFormat, scaledWidth, scaledHeight, 0, format, GL_UNSIGNED_BYTE, scaledBuffer );
+					glTexImage2D( target, 0, internalFormat, scaledWidth, scaledHeight, 0, format, GL_UNSIGNED_BYTE, uploadData );
 				}
 
 				break;
@@ -1179,6 +1231,11 @@ void R_UploadImage( const byte **dataArray, int numLayers, int numMips,
 				}
 			}
 		}
+
+		if ( prepared )
+		{
+			glBindBuffer( GL_PIXEL_UNPACK_BUFFER, 0 );
+		}
 	} else {
 		// already compressed texture data, precomputed mipmaps must be
 		// in the data array
@@ -1384,6 +1441,12 @@ void R_UploadImage( const byte **dataArray, int numLayers, int numMips,
 	GL_Unbind( image );
 }
 
+void R_UploadImage( const byte **dataArray, int numLayers, int numMips,
+		    image_t *image )
+{
+	R_UploadImageInternal( dataArray, numLayers, numMips, image, nullptr );
+}
+
 /*
 ================
 R_AllocImage
@@ -1555,210 +1618,1102 @@ image_t        *R_CreateCubeImage( const char *name,
 		R_ExportTexture( image );
 	}
 
-	return image;
+	return image;
+}
+
+/*
+================
+R_Create3DImage
+================
+*/
+image_t        *R_Create3DImage( const char *name,
+				 const byte *pic,
+				 int width, int height, int depth,
+				 int bits, filterType_t filterType,
+				 wrapType_t wrapType )
+{
+	image_t *image;
+	const byte **pics;
+	int i;
+
+	image = R_AllocImage( name, true );
+
+	if ( !image )
+	{
+		return nullptr;
+	}
+
+	image->type = GL_TEXTURE_3D;
+
+	image->width = width;
+	image->height = height;
+
+	if( pic ) {
+		pics = (const byte**) ri.Hunk_AllocateTempMemory( depth * sizeof(const byte *) );
+		for( i = 0; i < depth; i++ ) {
+			pics[i] = pic + i * width * height * sizeof(u8vec4_t);
+		}
+	} else {
+		pics = nullptr;
+	}
+
+	image->bits = bits;
+	image->filterType = filterType;
+	image->wrapType = wrapType;
+
+	R_UploadImage( pics, depth, 1, image );
+
+	if( pics ) {
+		ri.Hunk_FreeTempMemory( pics );
+	}
+
+	if( r_exportTextures->integer ) {
+		R_ExportTexture( image );
+	}
+
+	return image;
+}
+
+struct imageExtToLoaderMap_t
+{
+	const char *ext;
+	void ( *ImageLoader )( const char *, unsigned char **, int *, int *, int *, int *, int *, byte );
+
+	// decodes a file already in memory, only set for the formats which are
+	// decoded to RGBA and can be loaded in the background
+	void ( *ImageDecoder )( const char *, const byte *, int, unsigned char **, int *, int *, byte );
+};
+
+// Note that the ordering indicates the order of preference used
+// when there are multiple images of different formats available
+static const imageExtToLoaderMap_t imageLoaders[] =
+{
+	{ "webp", LoadWEBP, DecodeWEBP },
+	{ "png",  LoadPNG,  DecodePNG  },
+	{ "tga",  LoadTGA,  DecodeTGA  },
+	{ "jpg",  LoadJPG,  DecodeJPG  },
+	{ "jpeg", LoadJPG,  DecodeJPG  },
+	{ "dds",  LoadDDS,  nullptr    },
+	{ "crn",  LoadCRN,  nullptr    },
+	{ "ktx",  LoadKTX,  nullptr    },
+};
+
+static int                   numImageLoaders = ARRAY_LEN( imageLoaders );
+
+// time spent in the loaders of each format, the loads are done on the main
+// thread and include reading the file, the decodes are done in the background
+struct imageLoadTimes_t
+{
+	std::atomic<int>     loads;
+	std::atomic<int64_t> loadMicros;
+	std::atomic<int>     decodes;
+	std::atomic<int64_t> decodeMicros;
+};
+
+static imageLoadTimes_t imageLoadTimes[ ARRAY_LEN( imageLoaders ) ];
+
+static int64_t R_MicrosecondsSince( Sys::SteadyClock::time_point start )
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>( Sys::SteadyClock::now() - start ).count();
+}
+
+/*
+===============
+R_ImageLoadTimes_f
+
+Prints the time spent loading images of each format, "reset" clears it
+===============
+*/
+void R_ImageLoadTimes_f()
+{
+	if ( ri.Cmd_Argc() > 1 && !Q_stricmp( ri.Cmd_Argv( 1 ), "reset" ) )
+	{
+		for ( imageLoadTimes_t &times : imageLoadTimes )
+		{
+			times.loads = 0;
+			times.loadMicros = 0;
+			times.decodes = 0;
+			times.decodeMicros = 0;
+		}
+
+		return;
+	}
+
+	Log::Notice( "-format- -loads- -load ms- -decodes- -decode ms-" );
+
+	for ( int i = 0; i < numImageLoaders; i++ )
+	{
+		const imageLoadTimes_t &times = imageLoadTimes[ i ];
+
+		if ( !times.loads && !times.decodes )
+		{
+			continue;
+		}
+
+		Log::Notice( "%-8s %7d %9.1f %9d %11.1f", imageLoaders[ i ].ext,
+		             times.loads.load(), times.loadMicros.load() / 1000.0,
+		             times.decodes.load(), times.decodeMicros.load() / 1000.0 );
+	}
+}
+
+/*
+=================
+R_RunImageLoader
+=================
+*/
+static void R_RunImageLoader( int loader, const char *filename, byte **pic, int *width, int *height,
+			      int *numLayers, int *numMips, int *bits, byte alphaByte )
+{
+	Sys::SteadyClock::time_point start = Sys::SteadyClock::now();
+
+	imageLoaders[ loader ].ImageLoader( filename, pic, width, height, numLayers, numMips, bits, alphaByte );
+
+	if ( *pic )
+	{
+		imageLoadTimes[ loader ].loads++;
+		imageLoadTimes[ loader ].loadMicros += R_MicrosecondsSince( start );
+	}
+}
+
+/*
+=================
+R_FindBestImageLoader
+
+Returns the loader of the format filename is available in,
+filename must not have an extension
+=================
+*/
+static int R_FindBestImageLoader( const char *filename )
+{
+	int bestLoader = -1;
+	const FS::PakInfo* bestPak = nullptr;
+
+	// try and find a suitable match using all the image formats supported
+	// prioritize with the pak priority
+	for ( int i = 0; i < numImageLoaders; i++ )
+	{
+		std::string altName = Str::Format("%s.%s", filename, imageLoaders[i].ext);
+		const FS::PakInfo* pak = FS::PakPath::LocateFile(altName);
+
+		// We found a file and its pak is better than the best pak we have
+		// this relies on how the filesystem works internally and should be moved
+		// to a more explicit interface once there is one. (FIXME)
+		if ( pak != nullptr && (bestPak == nullptr || pak < bestPak ) )
+		{
+			bestPak = pak;
+			bestLoader = i;
+		}
+	}
+
+	return bestLoader;
+}
+
+/*
+=================
+R_LoadImage
+
+Loads any of the supported image types into a canonical
+32 bit format.
+=================
+*/
+static void R_LoadImage( const char **buffer, byte **pic, int *width, int *height,
+			 int *numLayers, int *numMips,
+			 int *bits )
+{
+	char *token;
+
+	*pic = nullptr;
+	*width = 0;
+	*height = 0;
+
+	token = COM_ParseExt2( buffer, false );
+
+	if ( !token[ 0 ] )
+	{
+		Log::Warn("NULL parameter for R_LoadImage" );
+		return;
+	}
+
+	int        i;
+	const char *ext;
+	char       filename[ MAX_QPATH ];
+	byte       alphaByte;
+
+	// Tr3B: clear alpha of normalmaps for displacement mapping
+	if ( *bits & IF_NORMALMAP )
+	{
+		alphaByte = 0x00;
+	}
+	else
+	{
+		alphaByte = 0xFF;
+	}
+
+	Q_strncpyz( filename, token, sizeof( filename ) );
+
+	ext = COM_GetExtension( filename );
+
+	if ( *ext )
+	{
+		// look for the correct loader and use it
+		for ( i = 0; i < numImageLoaders; i++ )
+		{
+			if ( !Q_stricmp( ext, imageLoaders[ i ].ext ) )
+			{
+				// load
+				R_RunImageLoader( i, filename, pic, width, height, numLayers, numMips, bits, alphaByte );
+				break;
+			}
+		}
+
+		// a loader was found
+		if ( i < numImageLoaders )
+		{
+			if ( *pic == nullptr )
+			{
+				// loader failed, most likely because the file isn't there;
+				// try again without the extension
+				COM_StripExtension3( token, filename, MAX_QPATH );
+			}
+			else
+			{
+				// something loaded
+				return;
+			}
+		}
+	}
+
+	int bestLoader = R_FindBestImageLoader( filename );
+
+	if ( bestLoader >= 0 )
+	{
+		char *altName = va( "%s.%s", filename, imageLoaders[ bestLoader ].ext );
+		R_RunImageLoader( bestLoader, altName, pic, width, height, numLayers, numMips, bits, alphaByte );
+	}
+}
+
+/*
+=================================================================
+
+ASYNCHRONOUS IMAGE LOADING
+
+The images of shader stages are read on the main thread, then decoded and
+resampled to their upload size by r_imageLoadThreads threads. They are drawn
+with a 1x1 placeholder until R_UploadDecodedImages uploads them at the start
+of a frame, at most r_imageUploadBudget kilobytes per frame. Anything that
+needs the actual image before that goes through R_FinishImageLoad.
+
+Images that can be streamed are decoded again at another size whenever
+R_UpdateTextureStreaming picks another mip level for them, see
+TEXTURE STREAMING below.
+
+=================================================================
+*/
+
+struct imageLoadJob_t
+{
+	image_t     *image = nullptr;
+	std::string name;
+	int         loader = 0;
+	int         bits = 0;
+
+	byte        *fileData = nullptr;
+	int         fileLength = 0;
+
+	// streamed images are halved level times after the usual picmip and
+	// resample, but not below TEXTURE_STREAM_MIN_SIZE
+	int         streamIndex = -1;
+	int         level = 0;
+
+	// filled in by the decoding threads, scaledPic is empty if the image
+	// couldn't be decoded
+	bool              decoded = false;
+	byte              *pic = nullptr;
+	int               width = 0, height = 0;
+	int               fullWidth = 0, fullHeight = 0;
+	int               maxLevel = 0;
+	int               uploadWidth = 0, uploadHeight = 0;
+	int               samples = 4;
+	std::vector<byte> scaledPic;
+
+	~imageLoadJob_t()
+	{
+		if ( fileData )
+		{
+			ri.FS_FreeFile( fileData );
+		}
+
+		if ( pic )
+		{
+			ri.Free( pic );
+		}
+	}
+};
+
+// imageLoadQueue and the decoded flags are protected by imageLoadLock,
+// imageLoadJobs is only used by the main thread
+static std::mutex                                 imageLoadLock;
+static std::condition_variable                    imageLoadCond;
+static std::vector<imageLoadJob_t *>              imageLoadQueue;
+static std::list<std::unique_ptr<imageLoadJob_t>> imageLoadJobs;
+static std::thread                                imageLoadThread;
+static std::atomic<bool>                          imageLoadShutdown( false );
+static int                                        imageLoadNumThreads = 0;
+
+// streamed images aren't dropped below this size
+static const int TEXTURE_STREAM_MIN_SIZE = 64;
+
+struct streamedImage_t
+{
+	image_t     *image;
+	std::string filename; // including the extension
+	int         loader;
+
+	// known once the image was decoded once
+	int         fullWidth, fullHeight;
+	int         maxLevel;
+
+	int         level; // of the resident texture
+	int         requestedLevel; // -1 if no other level was requested
+	int         requestFrame;
+	bool        queued; // the file of the requested level was read
+	bool        failed;
+
+	int         lastUsedFrame;
+	float       screenSize;
+	float       pixelsPerUnit;
+};
+
+// only used by the main thread, the decoding threads only get indexes
+static std::vector<streamedImage_t> streamedImages;
+
+/*
+===============
+R_DecodeImageJob
+
+Runs on the decoding threads, does everything R_FindImageFile and
+R_UploadImage would do to the pixels on the main thread
+===============
+*/
+static void R_DecodeImageJob( imageLoadJob_t *job )
+{
+	if ( imageLoadShutdown )
+	{
+		return;
+	}
+
+	// Tr3B: clear alpha of normalmaps for displacement mapping
+	byte alphaByte = ( job->bits & IF_NORMALMAP ) ? 0x00 : 0xFF;
+
+	Sys::SteadyClock::time_point start = Sys::SteadyClock::now();
+
+	imageLoaders[ job->loader ].ImageDecoder( job->name.c_str(), job->fileData, job->fileLength,
+	                                          &job->pic, &job->width, &job->height, alphaByte );
+
+	ri.FS_FreeFile( job->fileData );
+	job->fileData = nullptr;
+
+	if ( !job->pic )
+	{
+		return;
+	}
+
+	imageLoadTimes[ job->loader ].decodes++;
+	imageLoadTimes[ job->loader ].decodeMicros += R_MicrosecondsSince( start );
+
+	if ( job->bits & IF_LIGHTMAP )
+	{
+		R_ProcessLightmap( job->pic, 4, job->width, job->height, job->bits, job->pic );
+	}
+
+	job->samples = R_GetImageSamples( job->bits, job->pic, job->width * job->height );
+
+	R_GetImageUploadSize( GL_TEXTURE_2D, job->bits, job->width, job->height, &job->fullWidth, &job->fullHeight );
+
+	if ( job->streamIndex >= 0 )
+	{
+		while ( std::max( job->fullWidth, job->fullHeight ) >> ( job->maxLevel + 1 ) >= TEXTURE_STREAM_MIN_SIZE )
+		{
+			job->maxLevel++;
+		}
+
+		job->level = std::min( job->level, job->maxLevel );
+	}
+	else
+	{
+		job->level = 0;
+	}
+
+	job->uploadWidth = job->fullWidth;
+	job->uploadHeight = job->fullHeight;
+
+	if ( job->uploadWidth == job->width && job->uploadHeight == job->height )
+	{
+		job->scaledPic.assign( job->pic, job->pic + job->uploadWidth * job->uploadHeight * 4 );
+	}
+	else
+	{
+		job->scaledPic.resize( job->uploadWidth * job->uploadHeight * 4 );
+		ResampleTexture( ( unsigned * ) job->pic, job->width, job->height,
+		                 ( unsigned * ) job->scaledPic.data(), job->uploadWidth, job->uploadHeight,
+		                 ( job->bits & IF_NORMALMAP ) );
+	}
+
+	// ResampleTexture only filters properly down to half the size
+	for ( int i = 0; i < job->level; i++ )
+	{
+		int               halfWidth = std::max( job->uploadWidth >> 1, 1 );
+		int               halfHeight = std::max( job->uploadHeight >> 1, 1 );
+		std::vector<byte> half( halfWidth * halfHeight * 4 );
+
+		ResampleTexture( ( unsigned * ) job->scaledPic.data(), job->uploadWidth, job->uploadHeight,
+		                 ( unsigned * ) half.data(), halfWidth, halfHeight, ( job->bits & IF_NORMALMAP ) );
+
+		job->scaledPic.swap( half );
+		job->uploadWidth = halfWidth;
+		job->uploadHeight = halfHeight;
+	}
+
+	if ( job->bits & IF_NORMALMAP )
+	{
+		R_NormalizeImagePixels( job->scaledPic.data(), job->uploadWidth * job->uploadHeight );
+	}
+
+	ri.Free( job->pic );
+	job->pic = nullptr;
+}
+
+static void R_ImageLoadThreadMain()
+{
+	Sys::ThreadPool pool;
+
+	while ( true )
+	{
+		std::vector<imageLoadJob_t *> jobs;
+		int                           numThreads;
+
+		{
+			std::unique_lock<std::mutex> lock( imageLoadLock );
+			imageLoadCond.wait( lock, [] { return imageLoadShutdown || !imageLoadQueue.empty(); } );
+
+			if ( imageLoadShutdown )
+			{
+				return;
+			}
+
+			std::swap( jobs, imageLoadQueue );
+			numThreads = imageLoadNumThreads;
+		}
+
+		// the calling thread takes part in ParallelFor
+		pool.SetNumThreads( numThreads - 1 );
+		pool.ParallelFor( jobs.size(), [ & ]( int i ) {
+			R_DecodeImageJob( jobs[ i ] );
+
+			std::lock_guard<std::mutex> lock( imageLoadLock );
+			jobs[ i ]->decoded = true;
+			imageLoadCond.notify_all();
+		} );
+	}
+}
+
+/*
+===============
+R_StopImageLoads
+
+Stops the decoding threads and drops the images not uploaded yet
+===============
+*/
+static void R_StopImageLoads()
+{
+	if ( imageLoadThread.joinable() )
+	{
+		{
+			std::lock_guard<std::mutex> lock( imageLoadLock );
+			imageLoadShutdown = true;
+		}
+
+		imageLoadCond.notify_all();
+		imageLoadThread.join();
+		imageLoadShutdown = false;
+	}
+
+	imageLoadQueue.clear();
+	imageLoadJobs.clear();
+	streamedImages.clear();
+
+	if ( imageUploadPBO )
+	{
+		glDeleteBuffers( 1, &imageUploadPBO );
+		imageUploadPBO = 0;
+	}
+}
+
+/*
+===============
+R_StartImageJob
+===============
+*/
+static void R_StartImageJob( std::unique_ptr<imageLoadJob_t> job )
+{
+	{
+		std::lock_guard<std::mutex> lock( imageLoadLock );
+		imageLoadQueue.push_back( job.get() );
+		imageLoadNumThreads = r_imageLoadThreads->integer;
+	}
+
+	imageLoadCond.notify_all();
+	imageLoadJobs.push_back( std::move( job ) );
+
+	if ( !imageLoadThread.joinable() )
+	{
+		imageLoadThread = std::thread( R_ImageLoadThreadMain );
+	}
+}
+
+/*
+===============
+R_QueueImageLoad
+
+Reads the file of an image and queues it to be decoded. Returns false if the
+image has to be loaded synchronously, because background loading is disabled
+or the format can't be decoded in the background. Otherwise *image is set to
+the placeholder, or to nullptr if the image doesn't exist.
+===============
+*/
+static bool R_QueueImageLoad( const char *name, int bits, filterType_t filterType, wrapType_t wrapType, image_t **image )
+{
+	char filename[ MAX_QPATH ];
+	int  loader = -1;
+	void *fileData = nullptr;
+	int  fileLength = 0;
+
+	if ( r_imageLoadThreads->integer <= 0 )
+	{
+		return false;
+	}
+
+	*image = nullptr;
+
+	// look for the file the same way as R_LoadImage
+	Q_strncpyz( filename, name, sizeof( filename ) );
+
+	const char *ext = COM_GetExtension( filename );
+
+	if ( *ext )
+	{
+		for ( int i = 0; i < numImageLoaders; i++ )
+		{
+			if ( !Q_stricmp( ext, imageLoaders[ i ].ext ) )
+			{
+				loader = i;
+				break;
+			}
+		}
+
+		if ( loader >= 0 )
+		{
+			if ( !imageLoaders[ loader ].ImageDecoder )
+			{
+				return false;
+			}
+
+			fileLength = ri.FS_ReadFile( filename, &fileData );
+
+			if ( !fileData )
+			{
+				// try again without the extension
+				COM_StripExtension3( name, filename, sizeof( filename ) );
+				loader = -1;
+			}
+		}
+	}
+
+	if ( loader < 0 )
+	{
+		loader = R_FindBestImageLoader( filename );
+
+		if ( loader < 0 )
+		{
+			return true;
+		}
+
+		if ( !imageLoaders[ loader ].ImageDecoder )
+		{
+			return false;
+		}
+
+		Q_strcat( filename, sizeof( filename ), va( ".%s", imageLoaders[ loader ].ext ) );
+		fileLength = ri.FS_ReadFile( filename, &fileData );
+
+		if ( !fileData )
+		{
+			return true;
+		}
+	}
+
+	if ( bits & IF_LIGHTMAP )
+	{
+		bits |= IF_NOCOMPRESSION;
+	}
+
+	// a flat normal for normal maps, with no displacement
+	static const byte placeholderPic[ 4 ] = { 128, 128, 128, 255 };
+	static const byte placeholderNormalPic[ 4 ] = { 128, 128, 255, 0 };
+	const byte        *pic = ( bits & IF_NORMALMAP ) ? placeholderNormalPic : placeholderPic;
+
+	*image = R_AllocImage( name, true );
+
+	( *image )->type = GL_TEXTURE_2D;
+	( *image )->width = 1;
+	( *image )->height = 1;
+	( *image )->bits = bits;
+	( *image )->filterType = filterType;
+	( *image )->wrapType = wrapType;
+
+	R_UploadImage( &pic, 1, 1, *image );
+
+	( *image )->loading = true;
+
+	std::unique_ptr<imageLoadJob_t> job( new imageLoadJob_t );
+	job->image = *image;
+	job->name = filename;
+	job->loader = loader;
+	job->bits = bits;
+	job->fileData = ( byte * ) fileData;
+	job->fileLength = fileLength;
+
+	// user interface images are loaded with IF_NOPICMIP
+	if ( r_textureStreamBudget->integer && !( bits & ( IF_NOPICMIP | IF_LIGHTMAP ) ) )
+	{
+		streamedImage_t stream {};
+		stream.image = *image;
+		stream.filename = filename;
+		stream.loader = loader;
+		stream.requestedLevel = -1;
+		stream.lastUsedFrame = tr.frameCount;
+
+		// start with the smallest level, the front end asks for more
+		job->streamIndex = streamedImages.size();
+		job->level = INT_MAX;
+
+		streamedImages.push_back( stream );
+	}
+
+	R_StartImageJob( std::move( job ) );
+
+	return true;
+}
+
+/*
+===============
+R_UploadImageJob
+
+Replaces the placeholder of a decoded image, the render thread must be synced
+===============
+*/
+static void R_UploadImageJob( imageLoadJob_t *job )
+{
+	image_t *image = job->image;
+
+	image->loading = false;
+
+	if ( job->streamIndex >= 0 )
+	{
+		streamedImage_t &stream = streamedImages[ job->streamIndex ];
+
+		stream.requestedLevel = -1;
+		stream.queued = false;
+
+		if ( job->scaledPic.empty() )
+		{
+			stream.failed = true;
+		}
+		else
+		{
+			stream.fullWidth = job->fullWidth;
+			stream.fullHeight = job->fullHeight;
+			stream.maxLevel = job->maxLevel;
+			stream.level = job->level;
+		}
+	}
+
+	if ( job->scaledPic.empty() )
+	{
+		Log::Warn( "could not load image '%s', keeping its placeholder", job->name );
+		return;
+	}
+
+	preparedImage_t prepared;
+	prepared.data = job->scaledPic.data();
+	prepared.width = job->uploadWidth;
+	prepared.height = job->uploadHeight;
+	prepared.samples = job->samples;
+
+	image->width = job->width;
+	image->height = job->height;
+
+	R_UploadImageInternal( nullptr, 1, 1, image, &prepared );
+
+	if( r_exportTextures->integer ) {
+		R_ExportTexture( image );
+	}
+}
+
+/*
+===============
+R_FinishImageLoad
+
+Waits for an image to be decoded and uploads it right away
+===============
+*/
+void R_FinishImageLoad( image_t *image )
+{
+	if ( !image || !image->loading )
+	{
+		return;
+	}
+
+	auto it = std::find_if( imageLoadJobs.begin(), imageLoadJobs.end(),
+	                        [ image ]( const std::unique_ptr<imageLoadJob_t> &job ) {
+	                            return job->image == image;
+	                        } );
+
+	ASSERT( it != imageLoadJobs.end() );
+
+	{
+		std::unique_lock<std::mutex> lock( imageLoadLock );
+		imageLoadCond.wait( lock, [ & ] { return ( *it )->decoded; } );
+	}
+
+	R_SyncRenderThread();
+	R_UploadImageJob( it->get() );
+	imageLoadJobs.erase( it );
+}
+
+/*
+===============
+R_UploadDecodedImages
+
+Uploads the images decoded since the last frame, up to r_imageUploadBudget
+kilobytes. Called at the start of every frame.
+===============
+*/
+void R_UploadDecodedImages()
+{
+	size_t budget = size_t( r_imageUploadBudget->integer ) * 1024;
+	size_t uploaded = 0;
+	bool   synced = false;
+
+	for ( auto it = imageLoadJobs.begin(); it != imageLoadJobs.end() && uploaded < budget; )
+	{
+		imageLoadJob_t *job = it->get();
+
+		{
+			std::lock_guard<std::mutex> lock( imageLoadLock );
+
+			if ( !job->decoded )
+			{
+				++it;
+				continue;
+			}
+		}
+
+		if ( !synced )
+		{
+			R_SyncRenderThread();
+			synced = true;
+		}
+
+		uploaded += job->scaledPic.size();
+		R_UploadImageJob( job );
+		it = imageLoadJobs.erase( it );
+	}
 }
 
 /*
-================
-R_Create3DImage
-================
+=================================================================
+
+TEXTURE STREAMING
+
+Streamed images start at their smallest level. The front end reports how
+large they are on screen through R_AddTextureUsage, and every frame
+R_UpdateTextureStreaming picks the level each image needs. When those don't
+fit in r_textureStreamBudget, the levels of all the images are lowered
+together until they do. Files are prefetched from the paks when a level is
+requested and read TEXTURE_STREAM_READ_DELAY frames later, then decoded at
+that level by the image loading threads. r_picmip still caps the size of
+streamed images.
+
+=================================================================
 */
-image_t        *R_Create3DImage( const char *name,
-				 const byte *pic,
-				 int width, int height, int depth,
-				 int bits, filterType_t filterType,
-				 wrapType_t wrapType )
-{
-	image_t *image;
-	const byte **pics;
-	int i;
 
-	image = R_AllocImage( name, true );
+// frames an image has to stay unused before it is dropped to its smallest level
+static const int TEXTURE_STREAM_UNUSED_FRAMES = 300;
 
-	if ( !image )
-	{
-		return nullptr;
-	}
+// frames between prefetching the file of an image and reading it
+static const int TEXTURE_STREAM_READ_DELAY = 2;
 
-	image->type = GL_TEXTURE_3D;
+// images requested per frame, and at most in flight
+static const int MAX_TEXTURE_STREAM_REQUESTS = 4;
+static const int MAX_TEXTURE_STREAM_PENDING = 16;
 
-	image->width = width;
-	image->height = height;
+/*
+===============
+R_StreamedImageBytes
 
-	if( pic ) {
-		pics = (const byte**) ri.Hunk_AllocateTempMemory( depth * sizeof(const byte *) );
-		for( i = 0; i < depth; i++ ) {
-			pics[i] = pic + i * width * height * sizeof(u8vec4_t);
-		}
-	} else {
-		pics = nullptr;
-	}
+Estimates the memory used by a streamed image at the given level
+===============
+*/
+static size_t R_StreamedImageBytes( const streamedImage_t &stream, int level )
+{
+	size_t texels = size_t( std::max( stream.fullWidth >> level, 1 ) ) * std::max( stream.fullHeight >> level, 1 );
+	size_t bytes;
 
-	image->bits = bits;
-	image->filterType = filterType;
-	image->wrapType = wrapType;
+	switch ( stream.image->internalFormat )
+	{
+		case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+		case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+			bytes = texels / 2;
+			break;
 
-	R_UploadImage( pics, depth, 1, image );
+		case GL_COMPRESSED_RGBA_S3TC_DXT3_EXT:
+		case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+		case GL_ALPHA8:
+			bytes = texels;
+			break;
 
-	if( pics ) {
-		ri.Hunk_FreeTempMemory( pics );
+		default:
+			bytes = texels * 4;
+			break;
 	}
 
-	if( r_exportTextures->integer ) {
-		R_ExportTexture( image );
+	// the mipmaps
+	if ( stream.image->filterType == filterType_t::FT_DEFAULT )
+	{
+		bytes += bytes / 3;
 	}
 
-	return image;
+	return bytes;
 }
 
-struct imageExtToLoaderMap_t
-{
-	const char *ext;
-	void ( *ImageLoader )( const char *, unsigned char **, int *, int *, int *, int *, int *, byte );
-};
+/*
+===============
+R_WantedStreamLevel
 
-// Note that the ordering indicates the order of preference used
-// when there are multiple images of different formats available
-static const imageExtToLoaderMap_t imageLoaders[] =
+Returns the largest level that still has a texel for every pixel
+the image covers
+===============
+*/
+static int R_WantedStreamLevel( const streamedImage_t &stream )
 {
-	{ "webp", LoadWEBP },
-	{ "png",  LoadPNG  },
-	{ "tga",  LoadTGA  },
-	{ "jpg",  LoadJPG  },
-	{ "jpeg", LoadJPG  },
-	{ "dds",  LoadDDS  },
-	{ "crn",  LoadCRN  },
-	{ "ktx",  LoadKTX  },
-};
+	int   size = std::max( stream.fullWidth, stream.fullHeight );
+	float wanted = std::max( stream.screenSize, size * stream.pixelsPerUnit );
+	int   level = stream.maxLevel;
 
-static int                   numImageLoaders = ARRAY_LEN( imageLoaders );
+	while ( level > 0 && ( size >> level ) < wanted )
+	{
+		level--;
+	}
+
+	return level;
+}
 
 /*
-=================
-R_LoadImage
+===============
+R_QueueStreamedImage
 
-Loads any of the supported image types into a canonical
-32 bit format.
-=================
+Reads the file of the level requested for a streamed image
+and queues it to be decoded
+===============
 */
-static void R_LoadImage( const char **buffer, byte **pic, int *width, int *height,
-			 int *numLayers, int *numMips,
-			 int *bits )
+static void R_QueueStreamedImage( int index )
 {
-	char *token;
-
-	*pic = nullptr;
-	*width = 0;
-	*height = 0;
-
-	token = COM_ParseExt2( buffer, false );
+	streamedImage_t &stream = streamedImages[ index ];
+	void            *fileData;
+	int             fileLength = ri.FS_ReadFile( stream.filename.c_str(), &fileData );
 
-	if ( !token[ 0 ] )
+	if ( !fileData )
 	{
-		Log::Warn("NULL parameter for R_LoadImage" );
+		stream.requestedLevel = -1;
+		stream.failed = true;
 		return;
 	}
 
-	int        i;
-	const char *ext;
-	char       filename[ MAX_QPATH ];
-	byte       alphaByte;
+	std::unique_ptr<imageLoadJob_t> job( new imageLoadJob_t );
+	job->image = stream.image;
+	job->name = stream.filename;
+	job->loader = stream.loader;
+	job->bits = stream.image->bits;
+	job->fileData = ( byte * ) fileData;
+	job->fileLength = fileLength;
+	job->streamIndex = index;
+	job->level = stream.requestedLevel;
 
-	// Tr3B: clear alpha of normalmaps for displacement mapping
-	if ( *bits & IF_NORMALMAP )
+	stream.queued = true;
+
+	R_StartImageJob( std::move( job ) );
+}
+
+/*
+===============
+R_UpdateTextureStreaming
+
+Picks the level of every streamed image from its usage in the last frames
+and requests the ones to change. Called at the start of every frame.
+===============
+*/
+void R_UpdateTextureStreaming()
+{
+	if ( streamedImages.empty() || !r_textureStreamBudget->integer || !r_imageLoadThreads->integer )
 	{
-		alphaByte = 0x00;
+		return;
 	}
-	else
+
+	size_t           budget = size_t( r_textureStreamBudget->integer ) << 20;
+	size_t           residentBytes = 0;
+	int              numPending = 0;
+	std::vector<int> wantedLevels( streamedImages.size() );
+
+	for ( size_t i = 0; i < streamedImages.size(); i++ )
 	{
-		alphaByte = 0xFF;
-	}
+		streamedImage_t &stream = streamedImages[ i ];
+		image_t         *image = stream.image;
 
-	Q_strncpyz( filename, token, sizeof( filename ) );
+		// take the usage reported by the front end since the last call
+		if ( image->streamScreenSize > 0.0f || image->streamPixelsPerUnit > 0.0f )
+		{
+			stream.screenSize = image->streamScreenSize;
+			stream.pixelsPerUnit = image->streamPixelsPerUnit;
+			stream.lastUsedFrame = tr.frameCount;
 
-	ext = COM_GetExtension( filename );
+			image->streamScreenSize = 0.0f;
+			image->streamPixelsPerUnit = 0.0f;
+		}
+		else if ( tr.frameCount - stream.lastUsedFrame > TEXTURE_STREAM_UNUSED_FRAMES )
+		{
+			stream.screenSize = 0.0f;
+			stream.pixelsPerUnit = 0.0f;
+		}
 
-	if ( *ext )
-	{
-		// look for the correct loader and use it
-		for ( i = 0; i < numImageLoaders; i++ )
+		if ( stream.requestedLevel >= 0 )
 		{
-			if ( !Q_stricmp( ext, imageLoaders[ i ].ext ) )
+			numPending++;
+
+			if ( !stream.queued && tr.frameCount - stream.requestFrame >= TEXTURE_STREAM_READ_DELAY )
 			{
-				// load
-				imageLoaders[ i ].ImageLoader( filename, pic, width, height, numLayers, numMips, bits, alphaByte );
-				break;
+				R_QueueStreamedImage( i );
 			}
 		}
 
-		// a loader was found
-		if ( i < numImageLoaders )
+		// not decoded yet
+		if ( !stream.fullWidth )
 		{
-			if ( *pic == nullptr )
-			{
-				// loader failed, most likely because the file isn't there;
-				// try again without the extension
-				COM_StripExtension3( token, filename, MAX_QPATH );
-			}
-			else
+			wantedLevels[ i ] = -1;
+			continue;
+		}
+
+		wantedLevels[ i ] = R_WantedStreamLevel( stream );
+		residentBytes += R_StreamedImageBytes( stream, stream.level );
+	}
+
+	// lower the levels of all the images together until they fit
+	int bias;
+
+	for ( bias = 0; bias < 16; bias++ )
+	{
+		size_t wantedBytes = 0;
+
+		for ( size_t i = 0; i < streamedImages.size(); i++ )
+		{
+			if ( wantedLevels[ i ] >= 0 )
 			{
-				// something loaded
-				return;
+				wantedBytes += R_StreamedImageBytes( streamedImages[ i ], std::min( wantedLevels[ i ] + bias, streamedImages[ i ].maxLevel ) );
 			}
 		}
+
+		if ( wantedBytes <= budget )
+		{
+			break;
+		}
 	}
 
-	int bestLoader = -1;
-	const FS::PakInfo* bestPak = nullptr;
+	bool overBudget = residentBytes > budget;
 
-	// try and find a suitable match using all the image formats supported
-	// prioritize with the pak priority
-	for ( i = 0; i < numImageLoaders; i++ )
+	// raise the most visible images first, then lower the others
+	struct streamRequest_t
 	{
-		std::string altName = Str::Format("%s.%s", filename, imageLoaders[i].ext);
-		const FS::PakInfo* pak = FS::PakPath::LocateFile(altName);
+		int   index;
+		int   level;
+		bool  raise;
+		float size;
+	};
 
-		// We found a file and its pak is better than the best pak we have
-		// this relies on how the filesystem works internally and should be moved
-		// to a more explicit interface once there is one. (FIXME)
-		if ( pak != nullptr && (bestPak == nullptr || pak < bestPak ) )
+	std::vector<streamRequest_t> requests;
+
+	for ( size_t i = 0; i < streamedImages.size(); i++ )
+	{
+		const streamedImage_t &stream = streamedImages[ i ];
+
+		if ( wantedLevels[ i ] < 0 || stream.requestedLevel >= 0 || stream.failed )
 		{
-			bestPak = pak;
-			bestLoader = i;
+			continue;
+		}
+
+		int level = std::min( wantedLevels[ i ] + bias, stream.maxLevel );
+
+		// don't drop images for a single level unless the memory is needed,
+		// they would go back and forth when their size is near a threshold
+		if ( level < stream.level || ( level > stream.level && ( overBudget || level > stream.level + 1 ) ) )
+		{
+			int size = std::max( stream.fullWidth, stream.fullHeight );
+
+			requests.push_back( { int( i ), level, level < stream.level,
+			                      std::max( stream.screenSize, size * stream.pixelsPerUnit ) } );
 		}
 	}
 
-	if ( bestLoader >= 0 )
+	std::sort( requests.begin(), requests.end(), []( const streamRequest_t &a, const streamRequest_t &b ) {
+		return a.raise != b.raise ? a.raise : a.size > b.size;
+	} );
+
+	std::vector<std::string> prefetch;
+
+	for ( const streamRequest_t &request : requests )
 	{
-		char *altName = va( "%s.%s", filename, imageLoaders[ bestLoader ].ext );
-		imageLoaders[ bestLoader ].ImageLoader( altName, pic, width, height, numLayers, numMips, bits, alphaByte );
+		if ( prefetch.size() >= size_t( MAX_TEXTURE_STREAM_REQUESTS ) || numPending >= MAX_TEXTURE_STREAM_PENDING )
+		{
+			break;
+		}
+
+		streamedImage_t &stream = streamedImages[ request.index ];
+
+		stream.requestedLevel = request.level;
+		stream.requestFrame = tr.frameCount;
+		stream.queued = false;
+
+		prefetch.push_back( stream.filename );
+		numPending++;
+	}
+
+	if ( !prefetch.empty() )
+	{
+		FS::PakPath::Prefetch( prefetch );
 	}
 }
 
 /*
 ===============
-R_FindImageFile
-
-Finds or loads the given image.
-Returns nullptr if it fails, not a default image.
-==============
+R_FindLoadedImage
+===============
 */
-image_t        *R_FindImageFile( const char *imageName, int bits, filterType_t filterType, wrapType_t wrapType )
+static image_t *R_FindLoadedImage( const char *imageName, int bits, wrapType_t wrapType )
 {
-	image_t       *image = nullptr;
-	int           width = 0, height = 0, numLayers = 0, numMips = 0;
-	byte          *pic[ MAX_TEXTURE_MIPS * MAX_TEXTURE_LAYERS ];
-	byte          *mallocPtr = nullptr;
+	image_t       *image;
 	long          hash;
 	char          buffer[ 1024 ];
-	const char          *buffer_p;
 	unsigned long diff;
 
-	if ( !imageName )
-	{
-		return nullptr;
-	}
-
 	Q_strncpyz( buffer, imageName, sizeof( buffer ) );
 	hash = GenerateImageHashValue( buffer );
 
@@ -1787,6 +2742,42 @@ image_t        *R_FindImageFile( const char *imageName, int bits, filterType_t f
 		}
 	}
 
+	return nullptr;
+}
+
+/*
+===============
+R_FindImageFile
+
+Finds or loads the given image.
+Returns nullptr if it fails, not a default image.
+==============
+*/
+image_t        *R_FindImageFile( const char *imageName, int bits, filterType_t filterType, wrapType_t wrapType )
+{
+	image_t       *image = nullptr;
+	int           width = 0, height = 0, numLayers = 0, numMips = 0;
+	byte          *pic[ MAX_TEXTURE_MIPS * MAX_TEXTURE_LAYERS ];
+	byte          *mallocPtr = nullptr;
+	char          buffer[ 1024 ];
+	const char          *buffer_p;
+
+	if ( !imageName )
+	{
+		return nullptr;
+	}
+
+	image = R_FindLoadedImage( imageName, bits, wrapType );
+
+	if ( image )
+	{
+		// the caller may need the actual image
+		R_FinishImageLoad( image );
+		return image;
+	}
+
+	Q_strncpyz( buffer, imageName, sizeof( buffer ) );
+
 	// load the pic from disk
 	pic[ 0 ] = nullptr;
 	buffer_p = &buffer[ 0 ];
@@ -1816,6 +2807,39 @@ image_t        *R_FindImageFile( const char *imageName, int bits, filterType_t f
 	return image;
 }
 
+/*
+===============
+R_FindImageFileAsync
+
+Like R_FindImageFile, but the image may be decoded in the background.
+Returns nullptr if the file doesn't exist, a placeholder if it can't
+be decoded.
+==============
+*/
+image_t *R_FindImageFileAsync( const char *imageName, int bits, filterType_t filterType, wrapType_t wrapType )
+{
+	image_t *image;
+
+	if ( !imageName )
+	{
+		return nullptr;
+	}
+
+	image = R_FindLoadedImage( imageName, bits, wrapType );
+
+	if ( image )
+	{
+		return image;
+	}
+
+	if ( R_QueueImageLoad( imageName, bits, filterType, wrapType, &image ) )
+	{
+		return image;
+	}
+
+	return R_FindImageFile( imageName, bits, filterType, wrapType );
+}
+
 static void R_Flip( byte *in, int width, int height )
 {
 	int32_t *data = (int32_t *) in;
@@ -2835,6 +3859,8 @@ void R_ShutdownImages()
 
 	Log::Debug("------- R_ShutdownImages -------" );
 
+	R_StopImageLoads();
+
 	for ( i = 0; i < tr.images.currentElements; i++ )
 	{
 		image = (image_t*) Com_GrowListElement( &tr.images, i );
@@ -2874,6 +3900,8 @@ void RE_GetTextureSize( int textureID, int *width, int *height )
 		return;
 	}
 
+	R_FinishImageLoad( baseImage );
+
 	if ( width )
 	{
 		*width = baseImage->width;
@@ -54,6 +54,29 @@ static void NORETURN R_JPGErrorExit( j_common_ptr cinfo )
 	ri.Error( errorParm_t::ERR_FATAL, "%s", buffer );
 }
 
+/* libjpeg error handler extended with a jump target, so that a corrupt
+ * image unwinds back into DecodeJPG instead of raising a fatal error,
+ * which would throw out of the image decode worker threads.
+ */
+struct jpgDecodeErrorManager_t
+{
+	struct jpeg_error_mgr pub;
+	jmp_buf setjmpBuffer;
+};
+
+static void NORETURN R_JPGDecodeErrorExit( j_common_ptr cinfo )
+{
+	char buffer[ JMSG_LENGTH_MAX ];
+	jpgDecodeErrorManager_t *err = reinterpret_cast<jpgDecodeErrorManager_t *>( cinfo->err );
+
+	( *cinfo->err->format_message )( cinfo, buffer );
+
+	Log::Warn( "LoadJPG: %s", buffer );
+
+	/* DecodeJPG releases the decompression object once it gets control back */
+	longjmp( err->setjmpBuffer, 1 );
+}
+
 static void R_JPGOutputMessage( j_common_ptr cinfo )
 {
 	char buffer[ JMSG_LENGTH_MAX ];
@@ -64,8 +87,15 @@ static void R_JPGOutputMessage( j_common_ptr cinfo )
 	Log::Notice(buffer);
 }
 
-void LoadJPG( const char *filename, unsigned char **pic, int *width, int *height,
-	      int*, int*, int*, byte )
+/*
+=============
+DecodeJPG
+
+Decodes a JPEG file already in memory, this may be called from any thread.
+Invalid images are only warned about, *pic is left untouched.
+=============
+*/
+void DecodeJPG( const char *filename, const byte *data, int len, unsigned char **pic, int *width, int *height, byte )
 {
 	/* This struct contains the JPEG decompression parameters and pointers to
 	 * working space (which is allocated as needed by the JPEG library).
@@ -85,39 +115,23 @@ void LoadJPG( const char *filename, unsigned char **pic, int *width, int *height
 	 * Note that this struct must live as long as the main JPEG parameter
 	 * struct, to avoid dangling-pointer problems.
 	 */
-	struct jpeg_error_mgr jerr;
+	jpgDecodeErrorManager_t jerr;
 
 	/* More stuff */
 	JSAMPARRAY            buffer; /* Output row buffer */
 	unsigned int          row_stride; /* physical row width in output buffer */
 	unsigned int          pixelcount, memcount;
 	unsigned int          sindex, dindex;
-	byte                  *out;
-	int                   len;
-	union
-	{
-		byte *b;
-		void *v;
-	} fbuffer;
+	byte                  *buf;
 
-	byte *buf;
+	/* Both are modified after setjmp(), so they must be volatile to be
+	 * reliable in the error path.
+	 */
+	byte                  *volatile out = nullptr;
 #if JPEG_LIB_VERSION < 80
-	FILE *jpegfd;
+	FILE *volatile jpegfd = nullptr;
 #endif
 
-	/* In this example we want to open the input file before doing anything else,
-	 * so that the setjmp() error recovery below can assume the file is open.
-	 * VERY IMPORTANT: use "b" option to fopen() if you are on a machine that
-	 * requires it in order to read binary files.
-	 */
-
-	len = ri.FS_ReadFile( ( char * ) filename, &fbuffer.v );
-
-	if ( !fbuffer.b || len < 0 )
-	{
-		return;
-	}
-
 	/* Step 1: allocate and initialize JPEG decompression object */
 
 	/* We have to set up the error handler first, in case the initialization
@@ -125,20 +139,43 @@ void LoadJPG( const char *filename, unsigned char **pic, int *width, int *height
 	 * This routine fills in the contents of struct jerr, and returns jerr's
 	 * address which we place into the link field in cinfo.
 	 */
-	cinfo.err = jpeg_std_error( &jerr );
-	cinfo.err->error_exit = R_JPGErrorExit;
+	cinfo.err = jpeg_std_error( &jerr.pub );
+	cinfo.err->error_exit = R_JPGDecodeErrorExit;
 	cinfo.err->output_message = R_JPGOutputMessage;
 
+	/* Establish the setjmp return context for R_JPGDecodeErrorExit to use. */
+	if ( setjmp( jerr.setjmpBuffer ) )
+	{
+		/* If we get here, the JPEG code has signaled an error, which was
+		 * already warned about. Clean up and leave *pic untouched.
+		 */
+		jpeg_destroy_decompress( &cinfo );
+#if JPEG_LIB_VERSION < 80
+		if ( jpegfd )
+		{
+			fclose( jpegfd );
+		}
+#endif
+
+		if ( out )
+		{
+			ri.Free( out );
+		}
+
+		Log::Warn( "LoadJPG: could not decode %s", filename );
+		return;
+	}
+
 	/* Now we can initialize the JPEG decompression object. */
 	jpeg_create_decompress( &cinfo );
 
 	/* Step 2: specify data source (eg, a file) */
 
 #if JPEG_LIB_VERSION < 80
-	jpegfd = fmemopen( fbuffer.b, len, "r" );
+	jpegfd = fmemopen( const_cast<byte *>( data ), len, "r" );
 	jpeg_stdio_src( &cinfo, jpegfd );
 #else
-	jpeg_mem_src( &cinfo, fbuffer.b, len );
+	jpeg_mem_src( &cinfo, const_cast<byte *>( data ), len );
 #endif
 
 	/* Step 3: read file parameters with jpeg_read_header() */
@@ -182,14 +219,14 @@ void LoadJPG( const char *filename, unsigned char **pic, int *width, int *height
 	     || pixelcount > 0x1FFFFFFF || cinfo.output_components != 3 )
 	{
 		// Free the memory to make sure we don't leak memory
-		ri.FS_FreeFile( fbuffer.v );
 		jpeg_destroy_decompress( &cinfo );
 #if JPEG_LIB_VERSION < 80
 		fclose( jpegfd );
 #endif
 
-		ri.Error(errorParm_t::ERR_DROP, "LoadJPG: %s has an invalid image format: %dx%d*4=%d, components: %d", filename,
+		Log::Warn("LoadJPG: %s has an invalid image format: %dx%d*4=%d, components: %d", filename,
 		          cinfo.output_width, cinfo.output_height, pixelcount * 4, cinfo.output_components );
+		return;
 	}
 
 	memcount = pixelcount * 4;
@@ -232,8 +269,6 @@ void LoadJPG( const char *filename, unsigned char **pic, int *width, int *height
 	}
 	while ( sindex );
 
-	*pic = out;
-
 	/* Step 7: Finish decompression */
 
 	jpeg_finish_decompress( &cinfo );
@@ -255,7 +290,9 @@ void LoadJPG( const char *filename, unsigned char **pic, int *width, int *height
 #if JPEG_LIB_VERSION < 80
 	fclose( jpegfd );
 #endif
-	ri.FS_FreeFile( fbuffer.v );
+
+	/* Only hand the image out once no more JPEG errors are possible. */
+	*pic = out;
 
 	/* At this point you may want to check to see whether any corrupt-data
 	 * warnings occurred (test whether jerr.pub.num_warnings is nonzero).
@@ -264,6 +301,35 @@ void LoadJPG( const char *filename, unsigned char **pic, int *width, int *height
 	/* And we're done! */
 }
 
+void LoadJPG( const char *filename, unsigned char **pic, int *width, int *height,
+	      int*, int*, int*, byte alphaByte )
+{
+	int  len;
+	union
+	{
+		byte *b;
+		void *v;
+	} fbuffer;
+
+	len = ri.FS_ReadFile( ( char * ) filename, &fbuffer.v );
+
+	if ( !fbuffer.b || len < 0 )
+	{
+		return;
+	}
+
+	*pic = nullptr;
+
+	DecodeJPG( filename, fbuffer.b, len, pic, width, height, alphaByte );
+
+	ri.FS_FreeFile( fbuffer.v );
+
+	if ( !*pic )
+	{
+		ri.Error( errorParm_t::ERR_DROP, "LoadJPG: could not load %s", filename );
+	}
+}
+
 /*
 =========================================================
 
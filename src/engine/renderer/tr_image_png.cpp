@@ -52,8 +52,14 @@ static void NORETURN png_user_error_fn( png_structp png_ptr, png_const_charp err
 	longjmp( png_jmpbuf( png_ptr ), 0 );
 }
 
-void LoadPNG( const char *name, byte **pic, int *width, int *height,
-	      int*, int*, int*, byte alphaByte )
+/*
+=============
+DecodePNG
+
+Decodes a PNG file already in memory, this may be called from any thread
+=============
+*/
+void DecodePNG( const char *name, const byte *data, int, byte **pic, int *width, int *height, byte alphaByte )
 {
 	int          bit_depth;
 	int          color_type;
@@ -63,23 +69,13 @@ void LoadPNG( const char *name, byte **pic, int *width, int *height,
 	png_infop    info;
 	png_structp  png;
 	png_bytep    *row_pointers;
-	byte         *data;
 	byte         *out;
 
-	// load png
-	ri.FS_ReadFile( name, ( void ** ) &data );
-
-	if ( !data )
-	{
-		return;
-	}
-
 	png = png_create_read_struct( PNG_LIBPNG_VER_STRING, ( png_voidp ) nullptr, png_user_error_fn, png_user_warning_fn );
 
 	if ( !png )
 	{
 		Log::Warn("LoadPNG: png_create_write_struct() failed for (%s)", name );
-		ri.FS_FreeFile( data );
 		return;
 	}
 
@@ -89,7 +85,6 @@ void LoadPNG( const char *name, byte **pic, int *width, int *height,
 	if ( !info )
 	{
 		Log::Warn("LoadPNG: png_create_info_struct() failed for (%s)", name );
-		ri.FS_FreeFile( data );
 		png_destroy_read_struct( &png, ( png_infopp ) nullptr, ( png_infopp ) nullptr );
 		return;
 	}
@@ -103,12 +98,11 @@ void LoadPNG( const char *name, byte **pic, int *width, int *height,
 	{
 		// if we get here, we had a problem reading the file
 		Log::Warn("LoadPNG: first exception handler called for (%s)", name );
-		ri.FS_FreeFile( data );
 		png_destroy_read_struct( &png, ( png_infopp ) & info, ( png_infopp ) nullptr );
 		return;
 	}
 
-	png_set_read_fn( png, data, png_read_data );
+	png_set_read_fn( png, const_cast<byte *>( data ), png_read_data );
 
 	png_set_sig_bytes( png, 0 );
 
@@ -165,14 +159,14 @@ void LoadPNG( const char *name, byte **pic, int *width, int *height,
 	*height = h;
 	*pic = out = ( byte * ) ri.Z_Malloc( w * h * 4 );
 
-	row_pointers = ( png_bytep * ) ri.Hunk_AllocateTempMemory( sizeof( png_bytep ) * h );
+	// the hunk can't be used outside of the main thread
+	row_pointers = ( png_bytep * ) ri.Z_Malloc( sizeof( png_bytep ) * h );
 
 	// set a new exception handler
 	if ( setjmp( png_jmpbuf( png ) ) )
 	{
 		Log::Warn("LoadPNG: second exception handler called for (%s)", name );
-		ri.Hunk_FreeTempMemory( row_pointers );
-		ri.FS_FreeFile( data );
+		ri.Free( row_pointers );
 		png_destroy_read_struct( &png, ( png_infopp ) & info, ( png_infopp ) nullptr );
 		return;
 	}
@@ -191,7 +185,25 @@ void LoadPNG( const char *name, byte **pic, int *width, int *height,
 	// clean up after the read, and free any memory allocated
 	png_destroy_read_struct( &png, &info, ( png_infopp ) nullptr );
 
-	ri.Hunk_FreeTempMemory( row_pointers );
+	ri.Free( row_pointers );
+}
+
+void LoadPNG( const char *name, byte **pic, int *width, int *height,
+	      int*, int*, int*, byte alphaByte )
+{
+	byte *data;
+	int  len;
+
+	// load png
+	len = ri.FS_ReadFile( name, ( void ** ) &data );
+
+	if ( !data )
+	{
+		return;
+	}
+
+	DecodePNG( name, data, len, pic, width, height, alphaByte );
+
 	ri.FS_FreeFile( data );
 }
 
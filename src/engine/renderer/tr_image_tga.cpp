@@ -25,32 +25,23 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 
 /*
 =============
-LoadTGA
+DecodeTGA
+
+Decodes a TGA file already in memory, this may be called from any thread.
+Errors are only warned about, *pic is left to nullptr.
 =============
 */
-void LoadTGA( const char *name, byte **pic, int *width, int *height,
-	      int*, int*, int*, byte alphaByte )
+void DecodeTGA( const char *name, const byte *buffer, int, byte **pic, int *width, int *height, byte alphaByte )
 {
 	unsigned int columns, rows, numPixels;
 	byte        *pixbuf;
 	int         row;
-	byte        *buf_p;
-	byte        *buffer;
+	const byte  *buf_p;
 	TargaHeader targa_header;
 	byte        *targa_rgba;
 
 	*pic = nullptr;
 
-	//
-	// load the file
-	//
-	ri.FS_ReadFile( ( char * ) name, ( void ** ) &buffer );
-
-	if ( !buffer )
-	{
-		return;
-	}
-
 	buf_p = buffer;
 
 	targa_header.id_length = *buf_p++;
@@ -75,20 +66,20 @@ void LoadTGA( const char *name, byte **pic, int *width, int *height,
 
 	if ( targa_header.image_type != 2 && targa_header.image_type != 10 && targa_header.image_type != 3 )
 	{
-		ri.FS_FreeFile( buffer );
-		ri.Error(errorParm_t::ERR_DROP, "LoadTGA: Only type 2 (RGB), 3 (gray), and 10 (RGB) TGA images supported (%s)", name );
+		Log::Warn("LoadTGA: Only type 2 (RGB), 3 (gray), and 10 (RGB) TGA images supported (%s)", name );
+		return;
 	}
 
 	if ( targa_header.colormap_type != 0 )
 	{
-		ri.FS_FreeFile( buffer );
-		ri.Error(errorParm_t::ERR_DROP, "LoadTGA: colormaps not supported (%s)", name );
+		Log::Warn("LoadTGA: colormaps not supported (%s)", name );
+		return;
 	}
 
 	if ( ( targa_header.pixel_size != 32 && targa_header.pixel_size != 24 ) && targa_header.image_type != 3 )
 	{
-		ri.FS_FreeFile( buffer );
-		ri.Error(errorParm_t::ERR_DROP, "LoadTGA: Only 32 or 24 bit images supported (no colormaps) (%s)", name );
+		Log::Warn("LoadTGA: Only 32 or 24 bit images supported (no colormaps) (%s)", name );
+		return;
 	}
 
 	columns = targa_header.width;
@@ -107,8 +98,8 @@ void LoadTGA( const char *name, byte **pic, int *width, int *height,
 
 	if ( !columns || !rows || numPixels > 0x7FFFFFFF || numPixels / columns / 4 != rows )
 	{
-		ri.FS_FreeFile( buffer );
-		ri.Error(errorParm_t::ERR_DROP, "LoadTGA: %s has an invalid image size", name );
+		Log::Warn("LoadTGA: %s has an invalid image size", name );
+		return;
 	}
 
 	targa_rgba = (byte*) ri.Z_Malloc( numPixels );
@@ -166,8 +157,9 @@ void LoadTGA( const char *name, byte **pic, int *width, int *height,
 
 					default:
 						ri.Free( targa_rgba );
-						ri.FS_FreeFile( buffer );
-						ri.Error(errorParm_t::ERR_DROP, "LoadTGA: illegal pixel_size '%d' in file '%s'", targa_header.pixel_size, name );
+						*pic = nullptr;
+						Log::Warn("LoadTGA: illegal pixel_size '%d' in file '%s'", targa_header.pixel_size, name );
+						return;
 				}
 			}
 		}
@@ -212,8 +204,9 @@ void LoadTGA( const char *name, byte **pic, int *width, int *height,
 
 						default:
 							ri.Free( targa_rgba );
-							ri.FS_FreeFile( buffer );
-							ri.Error(errorParm_t::ERR_DROP, "LoadTGA: illegal pixel_size '%d' in file '%s'", targa_header.pixel_size, name );
+							*pic = nullptr;
+							Log::Warn("LoadTGA: illegal pixel_size '%d' in file '%s'", targa_header.pixel_size, name );
+							return;
 					}
 
 					for ( j = 0; j < packetSize; j++ )
@@ -272,9 +265,9 @@ void LoadTGA( const char *name, byte **pic, int *width, int *height,
 
 							default:
 								ri.Free( targa_rgba );
-								ri.FS_FreeFile( buffer );
-								ri.Error(errorParm_t::ERR_DROP,
-								          "LoadTGA: illegal pixel_size '%d' in file '%s'", targa_header.pixel_size, name );
+								*pic = nullptr;
+								Log::Warn("LoadTGA: illegal pixel_size '%d' in file '%s'", targa_header.pixel_size, name );
+								return;
 						}
 
 						column++;
@@ -314,7 +307,8 @@ breakOut:
 
 		//Log::Warn("'%s' TGA file header declares top-down image, flipping", name);
 
-		flip = ( unsigned char * ) ri.Hunk_AllocateTempMemory( columns * 4 );
+		// the hunk can't be used outside of the main thread
+		flip = ( unsigned char * ) ri.Z_Malloc( columns * 4 );
 
 		for ( row = 0; row < (int) rows / 2; row++ )
 		{
@@ -326,8 +320,39 @@ breakOut:
 			memcpy( dst, flip, columns * 4 );
 		}
 
-		ri.Hunk_FreeTempMemory( flip );
+		ri.Free( flip );
+	}
+}
+
+/*
+=============
+LoadTGA
+=============
+*/
+void LoadTGA( const char *name, byte **pic, int *width, int *height,
+	      int*, int*, int*, byte alphaByte )
+{
+	byte *buffer;
+	int  len;
+
+	*pic = nullptr;
+
+	//
+	// load the file
+	//
+	len = ri.FS_ReadFile( ( char * ) name, ( void ** ) &buffer );
+
+	if ( !buffer )
+	{
+		return;
 	}
 
+	DecodeTGA( name, buffer, len, pic, width, height, alphaByte );
+
 	ri.FS_FreeFile( buffer );
+
+	if ( !*pic )
+	{
+		ri.Error( errorParm_t::ERR_DROP, "LoadTGA: could not load %s", name );
+	}
 }
@@ -31,31 +31,22 @@ LoadWEBP
 =========================================================
 */
 
-void LoadWEBP( const char *filename, unsigned char **pic, int *width, int *height,
-	       int*, int*, int*, byte )
+/*
+=============
+DecodeWEBP
+
+Decodes a WebP file already in memory, this may be called from any thread
+=============
+*/
+void DecodeWEBP( const char *, const byte *data, int len, byte **pic, int *width, int *height, byte )
 {
 	byte *out;
-	int  len;
 	int  stride;
 	int  size;
-	union
-	{
-		byte *b;
-		void *v;
-	} fbuffer;
-
-	/* read compressed data */
-	len = ri.FS_ReadFile( ( char * ) filename, &fbuffer.v );
-
-	if ( !fbuffer.b || len < 0 )
-	{
-		return;
-	}
 
 	/* validate data and query image size */
-	if ( !WebPGetInfo( fbuffer.b, len, width, height ) )
+	if ( !WebPGetInfo( data, len, width, height ) )
 	{
-		ri.FS_FreeFile( fbuffer.v );
 		return;
 	}
 
@@ -64,12 +55,34 @@ void LoadWEBP( const char *filename, unsigned char **pic, int *width, int *heigh
 
 	out = (byte*) ri.Z_Malloc( size );
 
-	if ( !WebPDecodeRGBAInto( fbuffer.b, len, out, size, stride ) )
+	if ( !WebPDecodeRGBAInto( data, len, out, size, stride ) )
 	{
 		ri.Free( out );
 		return;
 	}
 
-	ri.FS_FreeFile( fbuffer.v );
 	*pic = out;
 }
+
+void LoadWEBP( const char *filename, unsigned char **pic, int *width, int *height,
+	       int*, int*, int*, byte alphaByte )
+{
+	int  len;
+	union
+	{
+		byte *b;
+		void *v;
+	} fbuffer;
+
+	/* read compressed data */
+	len = ri.FS_ReadFile( ( char * ) filename, &fbuffer.v );
+
+	if ( !fbuffer.b || len < 0 )
+	{
+		return;
+	}
+
+	DecodeWEBP( filename, fbuffer.b, len, pic, width, height, alphaByte );
+
+	ri.FS_FreeFile( fbuffer.v );
+}
@@ -50,6 +50,10 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 	cvar_t      *r_zfar;
 
 	cvar_t      *r_smp;
+	cvar_t      *r_frontEndThreads;
+	cvar_t      *r_skinningThreads;
+	cvar_t      *r_mapLoadThreads;
+	cvar_t      *r_skeletonCacheSize;
 	cvar_t      *r_showSmp;
 	cvar_t      *r_skipBackEnd;
 	cvar_t      *r_skipLightBuffer;
@@ -71,6 +75,7 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 	cvar_t      *r_speeds;
 	cvar_t      *r_novis;
 	cvar_t      *r_nocull;
+	cvar_t      *r_occlusionCulling;
 	cvar_t      *r_facePlaneCull;
 	cvar_t      *r_showcluster;
 	cvar_t      *r_nocurves;
@@ -86,10 +91,14 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 	cvar_t      *r_compressSpecularMaps;
 	cvar_t      *r_compressNormalMaps;
 	cvar_t      *r_exportTextures;
+	cvar_t      *r_imageLoadThreads;
+	cvar_t      *r_imageUploadBudget;
+	cvar_t      *r_textureStreamBudget;
 	cvar_t      *r_heatHaze;
 	cvar_t      *r_noMarksOnTrisurfs;
 	cvar_t      *r_recompileShaders;
 	cvar_t      *r_lazyShaders;
+	cvar_t      *r_shaderIndex;
 
 	cvar_t      *r_ext_occlusion_query;
 	cvar_t      *r_ext_draw_buffers;
@@ -236,6 +245,7 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 	cvar_t      *r_vboCurves;
 	cvar_t      *r_vboTriangles;
 	cvar_t      *r_vboShadows;
+	cvar_t      *r_interactionCache;
 	cvar_t      *r_vboLighting;
 	cvar_t      *r_vboModels;
 	cvar_t      *r_vboVertexSkinning;
@@ -1113,10 +1123,17 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 		r_compressSpecularMaps = ri.Cvar_Get( "r_compressSpecularMaps", "1", CVAR_LATCH );
 		r_compressNormalMaps = ri.Cvar_Get( "r_compressNormalMaps", "0", CVAR_LATCH );
 		r_exportTextures = ri.Cvar_Get( "r_exportTextures", "0", 0 );
+		r_imageLoadThreads = ri.Cvar_Get( "r_imageLoadThreads", "2", CVAR_ARCHIVE );
+		AssertCvarRange( r_imageLoadThreads, 0, MAX_IMAGE_LOAD_THREADS, true );
+		r_imageUploadBudget = ri.Cvar_Get( "r_imageUploadBudget", "8192", CVAR_ARCHIVE );
+		AssertCvarRange( r_imageUploadBudget, 1, 1 << 20, true );
+		r_textureStreamBudget = ri.Cvar_Get( "r_textureStreamBudget", "0", CVAR_ARCHIVE );
+		AssertCvarRange( r_textureStreamBudget, 0, 1 << 16, true );
 		r_heatHaze = ri.Cvar_Get( "r_heatHaze", "1", 0 );
 		r_noMarksOnTrisurfs = ri.Cvar_Get( "r_noMarksOnTrisurfs", "1", CVAR_CHEAT );
 		r_recompileShaders = ri.Cvar_Get( "r_recompileShaders", "0", 0 );
 		r_lazyShaders = ri.Cvar_Get( "r_lazyShaders", "0", 0 );
+		r_shaderIndex = ri.Cvar_Get( "r_shaderIndex", "1", CVAR_ARCHIVE );
 
 		r_forceFog = ri.Cvar_Get( "r_forceFog", "0", CVAR_CHEAT /* | CVAR_LATCH */ );
 		AssertCvarRange( r_forceFog, 0.0f, 1.0f, false );
@@ -1130,6 +1147,14 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 		AssertCvarRange( r_forceAmbient, 0.0f, 0.3f, false );
 
 		r_smp = ri.Cvar_Get( "r_smp", "0",  CVAR_LATCH );
+		r_frontEndThreads = ri.Cvar_Get( "r_frontEndThreads", "2", CVAR_ARCHIVE );
+		AssertCvarRange( r_frontEndThreads, 0, MAX_FRONTEND_THREADS, true );
+		r_skinningThreads = ri.Cvar_Get( "r_skinningThreads", "2", CVAR_ARCHIVE );
+		AssertCvarRange( r_skinningThreads, 0, MAX_SKINNING_THREADS, true );
+		r_mapLoadThreads = ri.Cvar_Get( "r_mapLoadThreads", "2", CVAR_ARCHIVE );
+		AssertCvarRange( r_mapLoadThreads, 0, MAX_MAP_LOAD_THREADS, true );
+		r_skeletonCacheSize = ri.Cvar_Get( "r_skeletonCacheSize", "512", CVAR_ARCHIVE );
+		AssertCvarRange( r_skeletonCacheSize, 0, 65536, true );
 
 		// temporary latched variables that can only change over a restart
 		r_singleShader = ri.Cvar_Get( "r_singleShader", "0", CVAR_CHEAT | CVAR_LATCH );
@@ -1166,6 +1191,7 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 		r_vboCurves = ri.Cvar_Get( "r_vboCurves", "1", CVAR_CHEAT );
 		r_vboTriangles = ri.Cvar_Get( "r_vboTriangles", "1", CVAR_CHEAT );
 		r_vboShadows = ri.Cvar_Get( "r_vboShadows", "1", CVAR_CHEAT );
+		r_interactionCache = ri.Cvar_Get( "r_interactionCache", "1", CVAR_ARCHIVE );
 		r_vboLighting = ri.Cvar_Get( "r_vboLighting", "1", CVAR_CHEAT );
 		r_vboModels = ri.Cvar_Get( "r_vboModels", "1", 0 );
 		r_vboVertexSkinning = ri.Cvar_Get( "r_vboVertexSkinning", "1",  CVAR_LATCH );
@@ -1217,6 +1243,7 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 		r_drawpolies = ri.Cvar_Get( "r_drawpolies", "1", CVAR_CHEAT );
 		r_ignore = ri.Cvar_Get( "r_ignore", "1", CVAR_CHEAT );
 		r_nocull = ri.Cvar_Get( "r_nocull", "0", CVAR_CHEAT );
+		r_occlusionCulling = ri.Cvar_Get( "r_occlusionCulling", "1", CVAR_ARCHIVE );
 		r_novis = ri.Cvar_Get( "r_novis", "0", CVAR_CHEAT );
 		r_showcluster = ri.Cvar_Get( "r_showcluster", "0", CVAR_CHEAT );
 		r_speeds = ri.Cvar_Get( "r_speeds", "0", 0 );
@@ -1344,6 +1371,7 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 
 		// make sure all the commands added here are also removed in R_Shutdown
 		ri.Cmd_AddCommand( "imagelist", R_ImageList_f );
+		ri.Cmd_AddCommand( "imageloadtimes", R_ImageLoadTimes_f );
 		ri.Cmd_AddCommand( "shaderlist", R_ShaderList_f );
 		ri.Cmd_AddCommand( "shaderexp", R_ShaderExp_f );
 		ri.Cmd_AddCommand( "skinlist", R_SkinList_f );
@@ -1491,6 +1519,7 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 		ri.Cmd_RemoveCommand( "screenshotJPEG" );
 		ri.Cmd_RemoveCommand( "screenshot" );
 		ri.Cmd_RemoveCommand( "imagelist" );
+		ri.Cmd_RemoveCommand( "imageloadtimes" );
 		ri.Cmd_RemoveCommand( "shaderlist" );
 		ri.Cmd_RemoveCommand( "shaderexp" );
 		ri.Cmd_RemoveCommand( "skinlist" );
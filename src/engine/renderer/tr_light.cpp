@@ -30,11 +30,10 @@ R_AddBrushModelInteractions
 Determine which dynamic lights may effect this bmodel
 =============
 */
-void R_AddBrushModelInteractions( trRefEntity_t *ent, trRefLight_t *light, interactionType_t iaType )
+void R_AddBrushModelInteractions( frontEndJob_t *job, trRefEntity_t *ent, model_t *model, trRefLight_t *light, interactionType_t iaType )
 {
 	bspSurface_t      *surf;
 	bspModel_t        *bspModel = nullptr;
-	model_t           *pModel = nullptr;
 	byte              cubeSideBits;
 
 	// cull the entire model if it is outside the view frustum
@@ -69,28 +68,15 @@ void R_AddBrushModelInteractions( trRefEntity_t *ent, trRefLight_t *light, inter
 
 #endif
 
-	pModel = R_GetModelByHandle( ent->e.hModel );
-	bspModel = pModel->bsp;
+	bspModel = model->bsp;
 
-	// do a quick AABB cull
-	if ( !BoundsIntersect( light->worldBounds[ 0 ], light->worldBounds[ 1 ], ent->worldBounds[ 0 ], ent->worldBounds[ 1 ] ) )
+	// cull against the light volume and its shadow cube sides
+	if ( R_CullLightEntity( light, ent, &cubeSideBits, &job->pc ) )
 	{
-		tr.pc.c_dlightSurfacesCulled += bspModel->numSurfaces;
+		job->pc.c_dlightSurfacesCulled += bspModel->numSurfaces;
 		return;
 	}
 
-	// do a more expensive and precise light frustum cull
-	if ( !r_noLightFrustums->integer )
-	{
-		if ( R_CullLightWorldBounds( light, ent->worldBounds ) == cullResult_t::CULL_OUT )
-		{
-			tr.pc.c_dlightSurfacesCulled += bspModel->numSurfaces;
-			return;
-		}
-	}
-
-	cubeSideBits = R_CalcLightCubeSideBits( light, ent->worldBounds );
-
 	// set the light bits in all the surfaces
 	for (unsigned i = 0; i < bspModel->numSurfaces; i++ )
 	{
@@ -102,8 +88,8 @@ void R_AddBrushModelInteractions( trRefEntity_t *ent, trRefLight_t *light, inter
 			continue;
 		}
 
-		R_AddLightInteraction( light, surf->data, surf->shader, cubeSideBits, iaType );
-		tr.pc.c_dlightSurfaces++;
+		R_AddLightInteraction( job, light, surf->data, surf->shader, cubeSideBits, iaType );
+		job->pc.c_dlightSurfaces++;
 	}
 }
 
@@ -859,13 +845,15 @@ void R_SetupLightProjection( trRefLight_t *light )
 /*
 =================
 R_AddLightInteraction
+
+Queues an interaction of job->entity with the light in the job, it is
+allocated when the job is merged
 =================
 */
-bool R_AddLightInteraction( trRefLight_t *light, surfaceType_t *surface, shader_t *surfaceShader, byte cubeSideBits,
+bool R_AddLightInteraction( frontEndJob_t *job, trRefLight_t *light, surfaceType_t *surface, shader_t *surfaceShader, byte cubeSideBits,
                                 interactionType_t iaType )
 {
-	int           iaIndex;
-	interaction_t *ia;
+	frontEndInteraction_t pending;
 
 	// skip all surfaces that don't matter for lighting only pass
 	if ( surfaceShader )
@@ -880,6 +868,42 @@ bool R_AddLightInteraction( trRefLight_t *light, surfaceType_t *surface, shader_
 		return false;
 	}
 
+	pending.light = light;
+	pending.entity = job->entity;
+	pending.surface = surface;
+	pending.shader = surfaceShader;
+	pending.cubeSideBits = cubeSideBits;
+	pending.type = iaType;
+
+	job->interactions.push_back( pending );
+
+	if ( light->isStatic )
+	{
+		job->pc.c_slightInteractions++;
+	}
+	else
+	{
+		job->pc.c_dlightInteractions++;
+	}
+
+	return true;
+}
+
+/*
+=================
+R_MergeLightInteraction
+
+Allocates an interaction queued by R_AddLightInteraction and links it to
+its light
+=================
+*/
+void R_MergeLightInteraction( const frontEndInteraction_t *pending )
+{
+	trRefLight_t      *light = pending->light;
+	interactionType_t iaType = pending->type;
+	int               iaIndex;
+	interaction_t     *ia;
+
 	// instead of checking for overflow, we just mask the index
 	// so it wraps around
 	iaIndex = tr.refdef.numInteractions & INTERACTION_MASK;
@@ -916,27 +940,16 @@ bool R_AddLightInteraction( trRefLight_t *light, surfaceType_t *surface, shader_
 	ia->type = iaType;
 
 	ia->light = light;
-	ia->entity = tr.currentEntity;
-	ia->surface = surface;
-	ia->shaderNum = surfaceShader->sortedIndex;
+	ia->entity = pending->entity;
+	ia->surface = pending->surface;
+	ia->shaderNum = pending->shader->sortedIndex;
 
-	ia->cubeSideBits = cubeSideBits;
+	ia->cubeSideBits = pending->cubeSideBits;
 
 	ia->scissorX = light->scissor.coords[ 0 ];
 	ia->scissorY = light->scissor.coords[ 1 ];
 	ia->scissorWidth = light->scissor.coords[ 2 ] - light->scissor.coords[ 0 ];
 	ia->scissorHeight = light->scissor.coords[ 3 ] - light->scissor.coords[ 1 ];
-
-	if ( light->isStatic )
-	{
-		tr.pc.c_slightInteractions++;
-	}
-	else
-	{
-		tr.pc.c_dlightInteractions++;
-	}
-
-	return true;
 }
 
 /*
@@ -1293,32 +1306,33 @@ void R_SetupLightScissor( trRefLight_t *light )
 
 /*
 =============
-R_CalcLightCubeSideBits
+R_LightUsesCubeSides
+
+Only omni lights with shadow maps are split into the six sides of a cube
+=============
+*/
+static bool R_LightUsesCubeSides( const trRefLight_t *light )
+{
+	return light->l.rlType == refLightType_t::RL_OMNI && r_shadows->integer >= Util::ordinal(shadowingMode_t::SHADOWING_ESM16) && !r_noShadowPyramids->integer;
+}
+
+/*
+=============
+R_SetupLightCubeSideFrustums
+
+The frustums only depend on the light so they can be shared by all the
+bounds tested against it
 =============
 */
 // *INDENT-OFF*
-byte R_CalcLightCubeSideBits( trRefLight_t *light, vec3_t worldBounds[ 2 ] )
+static void R_SetupLightCubeSideFrustums( const trRefLight_t *light, frustum_t frustums[ 6 ] )
 {
-	int        i;
 	int        cubeSide;
-	byte       cubeSideBits;
 	float      xMin, xMax, yMin, yMax;
 	float      zNear, zFar;
 	float      fovX, fovY;
 	vec3_t     angles;
 	matrix_t   tmpMatrix, rotationMatrix, transformMatrix, viewMatrix, projectionMatrix, viewProjectionMatrix;
-	frustum_t  frustum;
-	cplane_t   *clipPlane;
-	int        r;
-	bool   anyClip;
-	bool   culled;
-
-	if ( light->l.rlType != refLightType_t::RL_OMNI || r_shadows->integer < Util::ordinal(shadowingMode_t::SHADOWING_ESM16) || r_noShadowPyramids->integer )
-	{
-		return CUBESIDE_CLIPALL;
-	}
-
-	cubeSideBits = 0;
 
 	for ( cubeSide = 0; cubeSide < 6; cubeSide++ )
 	{
@@ -1388,17 +1402,39 @@ byte R_CalcLightCubeSideBits( trRefLight_t *light, vec3_t worldBounds[ 2 ] )
 
 		// calculate frustum planes using the modelview projection matrix
 		MatrixMultiply( projectionMatrix, viewMatrix, viewProjectionMatrix );
-		R_SetupFrustum2( frustum, viewProjectionMatrix );
+		R_SetupFrustum2( frustums[ cubeSide ], viewProjectionMatrix );
+	}
+}
+
+/*
+=============
+R_CullLightCubeSides
+
+Returns the bits of the cube sides touched by the bounds, insideBits gets
+the sides which contain them completely. Doesn't touch any global state.
+=============
+*/
+static byte R_CullLightCubeSides( frustum_t frustums[ 6 ], vec3_t worldBounds[ 2 ], byte *insideBits )
+{
+	int        i;
+	int        cubeSide;
+	byte       cubeSideBits;
+	int        r;
+	bool   anyClip;
+	bool   culled;
+
+	cubeSideBits = 0;
+	*insideBits = 0;
 
+	for ( cubeSide = 0; cubeSide < 6; cubeSide++ )
+	{
 		// use the frustum planes to cut off shadowmaps beyond the light volume
 		anyClip = false;
 		culled = false;
 
 		for ( i = 0; i < 5; i++ )
 		{
-			clipPlane = &frustum[ i ];
-
-			r = BoxOnPlaneSide( worldBounds[ 0 ], worldBounds[ 1 ], clipPlane );
+			r = BoxOnPlaneSide( worldBounds[ 0 ], worldBounds[ 1 ], &frustums[ cubeSide ][ i ] );
 
 			if ( r == 2 )
 			{
@@ -1417,30 +1453,186 @@ byte R_CalcLightCubeSideBits( trRefLight_t *light, vec3_t worldBounds[ 2 ] )
 			if ( !anyClip )
 			{
 				// completely inside frustum
-				tr.pc.c_pyramid_cull_ent_in++;
-			}
-			else
-			{
-				// partially clipped
-				tr.pc.c_pyramid_cull_ent_clip++;
+				*insideBits |= ( 1 << cubeSide );
 			}
 
 			cubeSideBits |= ( 1 << cubeSide );
 		}
+	}
+
+	return cubeSideBits;
+}
+
+/*
+=============
+R_CountLightCubeSides
+=============
+*/
+static void R_CountLightCubeSides( byte cubeSideBits, byte insideBits, frontEndCounters_t *pc )
+{
+	for ( int cubeSide = 0; cubeSide < 6; cubeSide++ )
+	{
+		if ( insideBits & ( 1 << cubeSide ) )
+		{
+			// completely inside frustum
+			pc->c_pyramid_cull_ent_in++;
+		}
+		else if ( cubeSideBits & ( 1 << cubeSide ) )
+		{
+			// partially clipped
+			pc->c_pyramid_cull_ent_clip++;
+		}
 		else
 		{
 			// completely outside frustum
-			tr.pc.c_pyramid_cull_ent_out++;
+			pc->c_pyramid_cull_ent_out++;
 		}
 	}
 
-	tr.pc.c_pyramidTests++;
+	pc->c_pyramidTests++;
+}
+
+/*
+=============
+R_CalcLightCubeSideBits
+=============
+*/
+byte R_CalcLightCubeSideBits( trRefLight_t *light, vec3_t worldBounds[ 2 ], frontEndCounters_t *pc )
+{
+	frustum_t  frustums[ 6 ];
+	byte       cubeSideBits;
+	byte       insideBits;
+
+	if ( !R_LightUsesCubeSides( light ) )
+	{
+		return CUBESIDE_CLIPALL;
+	}
+
+	R_SetupLightCubeSideFrustums( light, frustums );
+	cubeSideBits = R_CullLightCubeSides( frustums, worldBounds, &insideBits );
+	R_CountLightCubeSides( cubeSideBits, insideBits, pc );
 
 	return cubeSideBits;
 }
 
 // *INDENT-ON*
 
+/*
+=============
+R_CullLightEntityBounds
+=============
+*/
+static void R_CullLightEntityBounds( trRefLight_t *light, frustum_t *cubeSideFrustums, trRefEntity_t *ent, lightEntityCull_t *cull )
+{
+	cull->culled = true;
+	cull->pyramidTested = false;
+	cull->cubeSideBits = CUBESIDE_CLIPALL;
+	cull->insideBits = 0;
+
+	// do a quick AABB cull
+	if ( !BoundsIntersect( light->worldBounds[ 0 ], light->worldBounds[ 1 ], ent->worldBounds[ 0 ], ent->worldBounds[ 1 ] ) )
+	{
+		return;
+	}
+
+	// do a more expensive and precise light frustum cull
+	if ( !r_noLightFrustums->integer )
+	{
+		if ( R_CullLightWorldBounds( light, ent->worldBounds ) == cullResult_t::CULL_OUT )
+		{
+			return;
+		}
+	}
+
+	cull->culled = false;
+
+	if ( cubeSideFrustums )
+	{
+		cull->cubeSideBits = R_CullLightCubeSides( cubeSideFrustums, ent->worldBounds, &cull->insideBits );
+		cull->pyramidTested = true;
+	}
+}
+
+/*
+=============
+R_CullLightEntities
+
+Culls every model entity of the scene against the light ahead of
+R_AddEntityInteractions. Only the light and the entities are read and
+nothing else is written than the cull array.
+=============
+*/
+void R_CullLightEntities( trRefLight_t *light, lightEntityCull_t *culls )
+{
+	frustum_t  cubeSideFrustums[ 6 ];
+	bool       useCubeSides;
+
+	useCubeSides = R_LightUsesCubeSides( light );
+
+	if ( useCubeSides )
+	{
+		R_SetupLightCubeSideFrustums( light, cubeSideFrustums );
+	}
+
+	for ( int i = 0; i < tr.refdef.numEntities; i++ )
+	{
+		trRefEntity_t *ent = &tr.refdef.entities[ i ];
+
+		// same as the entities skipped by R_AddEntityInteractions
+		if ( ent->e.reType != refEntityType_t::RT_MODEL ||
+		     ( ( ent->e.renderfx & RF_FIRST_PERSON ) && ( tr.viewParms.portalLevel > 0 || tr.viewParms.isMirror ) ) )
+		{
+			continue;
+		}
+
+		R_CullLightEntityBounds( light, useCubeSides ? cubeSideFrustums : nullptr, ent, &culls[ i ] );
+	}
+}
+
+/*
+=============
+R_CullLightEntity
+
+Returns true if the entity is outside of the light volume, otherwise sets
+the cube sides it touches. Uses the results of R_CullLightEntities when
+they are available.
+=============
+*/
+bool R_CullLightEntity( trRefLight_t *light, trRefEntity_t *ent, byte *cubeSideBits, frontEndCounters_t *pc )
+{
+	lightEntityCull_t cull;
+
+	if ( light->entityCulls )
+	{
+		cull = light->entityCulls[ ent - tr.refdef.entities ];
+	}
+	else
+	{
+		frustum_t cubeSideFrustums[ 6 ];
+		bool      useCubeSides = R_LightUsesCubeSides( light );
+
+		if ( useCubeSides )
+		{
+			R_SetupLightCubeSideFrustums( light, cubeSideFrustums );
+		}
+
+		R_CullLightEntityBounds( light, useCubeSides ? cubeSideFrustums : nullptr, ent, &cull );
+	}
+
+	if ( cull.culled )
+	{
+		return true;
+	}
+
+	if ( cull.pyramidTested )
+	{
+		R_CountLightCubeSides( cull.cubeSideBits, cull.insideBits, pc );
+	}
+
+	*cubeSideBits = cull.cubeSideBits;
+	return false;
+}
+
 /*
 =================
 R_SetupLightLOD
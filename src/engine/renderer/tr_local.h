@@ -160,6 +160,12 @@ static inline void halfToFloat( const f16vec4_t in, vec4_t out )
 
 #define MAX_SHADOWMAPS        5
 
+#define MAX_FRONTEND_THREADS  16
+#define MAX_FRONTEND_JOBS     32
+#define MAX_SKINNING_THREADS  16
+#define MAX_IMAGE_LOAD_THREADS 16
+#define MAX_MAP_LOAD_THREADS  16
+
 #define GLSL_COMPILE_STARTUP_ONLY  1
 
 #define MAX_TEXTURE_MIPS      16
@@ -203,7 +209,8 @@ static inline void halfToFloat( const f16vec4_t in, vec4_t out )
 	  RSPEEDS_SHADING_TIMES,
 	  RSPEEDS_CHC,
 	  RSPEEDS_NEAR_FAR,
-	  RSPEEDS_DECALS
+	  RSPEEDS_DECALS,
+	  RSPEEDS_SKELETONS
 	};
 
 	enum class glDebugModes_t
@@ -388,6 +395,15 @@ static inline void halfToFloat( const f16vec4_t in, vec4_t out )
 		return l->prev;
 	}
 
+	// result of culling an entity against a light, see R_CullLightEntities
+	struct lightEntityCull_t
+	{
+		bool culled;
+		bool pyramidTested; // cube side bits come from the shadow pyramid test
+		byte cubeSideBits;
+		byte insideBits; // cube sides containing the entity completely
+	};
+
 // a trRefLight_t has all the information passed in by
 // the client game, as well as some locally derived info
 	struct trRefLight_t
@@ -454,6 +470,8 @@ static inline void halfToFloat( const f16vec4_t in, vec4_t out )
 		uint16_t                  numLightOnlyInteractions;
 		bool                  noSort; // don't sort interactions by material
 
+		lightEntityCull_t         *entityCulls; // precomputed for the current view, indexed by entity number
+
 		link_t                    leafs;
 
 		int                       visCounts[ MAX_VISCOUNTS ]; // node needs to be traversed if current
@@ -592,6 +610,12 @@ static inline void halfToFloat( const f16vec4_t in, vec4_t out )
 		filterType_t   filterType;
 		wrapType_t     wrapType;
 
+		bool           loading; // still being decoded, see R_FinishImageLoad
+
+		// texture streaming feedback from the front end, see R_AddTextureUsage
+		float          streamScreenSize; // largest projected size in pixels of a model using it
+		float          streamPixelsPerUnit; // largest projected size in pixels of a world unit using it
+
 		image_t *next;
 	};
 
@@ -2411,6 +2435,9 @@ static inline void halfToFloat( const f16vec4_t in, vec4_t out )
 		int c_pyramidTests;
 		int c_pyramid_cull_ent_in, c_pyramid_cull_ent_clip, c_pyramid_cull_ent_out;
 
+		int c_occluders;
+		int c_occlusionTests, c_occlusion_cull_out;
+
 		int c_nodes;
 		int c_leafs;
 
@@ -2424,6 +2451,69 @@ static inline void halfToFloat( const f16vec4_t in, vec4_t out )
 		int c_dlightInteractions;
 
 		int c_decalProjectors, c_decalTestSurfaces, c_decalClipSurfaces, c_decalSurfaces, c_decalSurfacesCreated;
+
+		int c_skeletonCacheHits, c_skeletonCacheMisses, c_skeletonCacheEvictions;
+	};
+
+	// a surface gathered by a front end job, see R_AddDrawSurf
+	struct frontEndDrawSurf_t
+	{
+		trRefEntity_t *entity;
+		surfaceType_t *surface;
+		shader_t      *shader;
+		int           lightmapNum;
+		int           fogNum;
+
+		// world and brush model surfaces are only added once per view,
+		// this is sorted out when the job is merged
+		bspSurface_t  *bspSurface;
+		bspSurface_t  *markSurface; // leaf surface getting the decals
+		int           decalBits;
+		bool          culled;
+	};
+
+	// an interaction gathered by a front end job, see R_AddLightInteraction
+	struct frontEndInteraction_t
+	{
+		trRefLight_t      *light;
+		trRefEntity_t     *entity;
+		surfaceType_t     *surface;
+		shader_t          *shader;
+		byte              cubeSideBits;
+		interactionType_t type;
+	};
+
+	/*
+	A front end job gathers the surfaces and interactions of a part of the
+	view on a worker thread. Everything is kept local to the job and only
+	merged into tr.refdef in job order before R_SortDrawSurfs, so the result
+	is the same as when the view is gathered on the main thread.
+	*/
+	struct frontEndJob_t
+	{
+		trRefEntity_t      *entity; // entity the surfaces are added for
+		orientationr_t     orientation; // of that entity
+
+		int                firstItem, numItems; // entities or lights worked on
+
+		std::vector<frontEndDrawSurf_t>    drawSurfs;
+		std::vector<frontEndInteraction_t> interactions;
+
+		frontEndCounters_t pc;
+
+		// world BSP subtree
+		bspNode_t               *node;
+		int                     planeBits, decalBits;
+		std::vector<bspNode_t *> traversal;
+		vec3_t                  visBounds[ 2 ];
+
+		// stamps for the surfaces already seen by the job, indexed by
+		// R_WorldSurfaceNum, they replace bspSurface_t::viewCount,
+		// lightCount and interactionBits while the job is running
+		std::vector<int>        surfaceViewCounts;
+		std::vector<int>        surfaceLightCounts;
+		std::vector<int>        surfaceInteractionBits;
+		int                     lightCount;
 	};
 
 #define FOG_TABLE_SIZE  256
@@ -2696,7 +2786,6 @@ static inline void halfToFloat( const f16vec4_t in, vec4_t out )
 		// render entities
 		trRefEntity_t *currentEntity;
 		trRefEntity_t worldEntity; // point currentEntity at this when rendering world
-		model_t       *currentModel;
 
 		// render lights
 		trRefLight_t *currentLight;
@@ -2843,10 +2932,14 @@ static inline void halfToFloat( const f16vec4_t in, vec4_t out )
 	extern cvar_t *r_compressSpecularMaps;
 	extern cvar_t *r_compressNormalMaps;
 	extern cvar_t *r_exportTextures;
+	extern cvar_t *r_imageLoadThreads; // threads decoding the images of shader stages, 0 loads them on the main thread
+	extern cvar_t *r_imageUploadBudget; // kilobytes of decoded images uploaded per frame
+	extern cvar_t *r_textureStreamBudget; // megabytes of streamed textures, 0 disables texture streaming
 	extern cvar_t *r_heatHaze;
 	extern cvar_t *r_noMarksOnTrisurfs;
 	extern cvar_t *r_recompileShaders;
 	extern cvar_t *r_lazyShaders; // 0: build all shaders on program start 1: delay shader build until first map load 2: delay shader build until needed
+	extern cvar_t *r_shaderIndex; // find the shaders through a cached index of the shader scripts instead of loading them all
 
 	extern cvar_t *r_norefresh; // bypasses the ref rendering
 	extern cvar_t *r_drawentities; // disable/enable entity rendering
@@ -2855,6 +2948,7 @@ static inline void halfToFloat( const f16vec4_t in, vec4_t out )
 	extern cvar_t *r_speeds; // various levels of information display
 	extern cvar_t *r_novis; // disable/enable usage of PVS
 	extern cvar_t *r_nocull;
+	extern cvar_t *r_occlusionCulling; // cull what the large world faces hide from the main view on the CPU
 	extern cvar_t *r_facePlaneCull; // enables culling of planar surfaces with back side test
 	extern cvar_t *r_nocurves;
 	extern cvar_t *r_lightScissors;
@@ -2956,6 +3050,10 @@ static inline void halfToFloat( const f16vec4_t in, vec4_t out )
 	extern cvar_t *r_stitchCurves;
 
 	extern cvar_t *r_smp;
+	extern cvar_t *r_frontEndThreads; // worker threads gathering the surfaces and interactions of a view, 0 gathers on the main thread
+	extern cvar_t *r_skinningThreads; // worker threads helping the back end skin large meshes on the CPU
+	extern cvar_t *r_mapLoadThreads; // threads filling the world geometry and light grid, 0 loads them on the main thread
+	extern cvar_t *r_skeletonCacheSize; // kilobytes of built skeletons kept for reuse, 0 disables the cache
 	extern cvar_t *r_showSmp;
 	extern cvar_t *r_skipBackEnd;
 	extern cvar_t *r_skipLightBuffer;
@@ -3000,6 +3098,7 @@ static inline void halfToFloat( const f16vec4_t in, vec4_t out )
 	extern cvar_t *r_vboCurves;
 	extern cvar_t *r_vboTriangles;
 	extern cvar_t *r_vboShadows;
+	extern cvar_t *r_interactionCache; // save the light interactions of maps to the home path and load them back
 	extern cvar_t *r_vboLighting;
 	extern cvar_t *r_vboModels;
 	extern cvar_t *r_vboVertexSkinning;
@@ -3037,20 +3136,26 @@ static inline void halfToFloat( const f16vec4_t in, vec4_t out )
 	void           R_RenderView( viewParms_t *parms );
 	void           R_RenderPostProcess();
 
-	void           R_AddMDVSurfaces( trRefEntity_t *e );
-	void           R_AddMDVInteractions( trRefEntity_t *e, trRefLight_t *light, interactionType_t iaType );
+	void           R_AddMDVSurfaces( frontEndJob_t *job, trRefEntity_t *e, model_t *model );
+	void           R_AddMDVInteractions( frontEndJob_t *job, trRefEntity_t *e, model_t *model, trRefLight_t *light, interactionType_t iaType );
 
 	void           R_AddPolygonSurfaces();
 	void           R_AddPolygonBufferSurfaces();
 
-	void           R_AddDrawSurf( surfaceType_t *surface, shader_t *shader, int lightmapNum, int fogNum );
+	int            R_SetupFrontEndJobs( int numItems );
+	frontEndJob_t  *R_GetFrontEndJob( int jobNum );
+	void           R_ClearFrontEndJob( frontEndJob_t *job );
+	void           R_RunFrontEndJobs( int numJobs, void ( *func )( frontEndJob_t *job ) );
+	void           R_MergeFrontEndJob( frontEndJob_t *job );
+
+	void           R_AddDrawSurf( frontEndJob_t *job, surfaceType_t *surface, shader_t *shader, int lightmapNum, int fogNum );
 
 	void           R_LocalNormalToWorld( const vec3_t local, vec3_t world );
 	void           R_LocalPointToWorld( const vec3_t local, vec3_t world );
 
-	cullResult_t   R_CullBox( vec3_t worldBounds[ 2 ] );
-	cullResult_t   R_CullLocalBox( vec3_t bounds[ 2 ] );
-	cullResult_t   R_CullLocalPointAndRadius( vec3_t origin, float radius );
+	cullResult_t   R_CullBox( vec3_t worldBounds[ 2 ], frontEndCounters_t *pc );
+	cullResult_t   R_CullLocalBox( const orientationr_t *orientation, vec3_t bounds[ 2 ], frontEndCounters_t *pc );
+	cullResult_t   R_CullLocalPointAndRadius( const orientationr_t *orientation, vec3_t origin, float radius );
 	cullResult_t   R_CullPointAndRadius( vec3_t origin, float radius );
 
 	int            R_FogLocalPointAndRadius( const vec3_t pt, float radius );
@@ -3058,7 +3163,7 @@ static inline void halfToFloat( const f16vec4_t in, vec4_t out )
 
 	int            R_FogWorldBox( vec3_t bounds[ 2 ] );
 
-	void           R_SetupEntityWorldBounds( trRefEntity_t *ent );
+	void           R_SetupEntityWorldBounds( trRefEntity_t *ent, const orientationr_t *orientation );
 
 	void           R_RotateEntityForViewParms( const trRefEntity_t *ent, const viewParms_t *viewParms, orientationr_t *orien );
 	void           R_RotateEntityForLight( const trRefEntity_t *ent, const trRefLight_t *light, orientationr_t *orien );
@@ -3193,6 +3298,7 @@ static inline void halfToFloat( const f16vec4_t in, vec4_t out )
 	bool   R_GetModeInfo( int *width, int *height, float *windowAspect, int mode );
 
 	void       R_ImageList_f();
+	void       R_ImageLoadTimes_f();
 	void       R_SkinList_f();
 
 	void       R_SubImageCpy( byte *dest, size_t destx, size_t desty, size_t destw, size_t desth, byte *src, size_t srcw, size_t srch, size_t bytes );
@@ -3217,6 +3323,10 @@ static inline void halfToFloat( const f16vec4_t in, vec4_t out )
 	int     R_SumOfUsedImages();
 
 	image_t *R_FindImageFile( const char *name, int bits, filterType_t filterType, wrapType_t wrapType );
+	image_t *R_FindImageFileAsync( const char *name, int bits, filterType_t filterType, wrapType_t wrapType );
+	void    R_FinishImageLoad( image_t *image );
+	void    R_UploadDecodedImages();
+	void    R_UpdateTextureStreaming();
 	image_t *R_FindCubeImage( const char *name, int bits, filterType_t filterType, wrapType_t wrapType );
 
 	image_t *R_CreateImage( const char *name, const byte **pic,
@@ -3445,18 +3555,41 @@ static inline void halfToFloat( const f16vec4_t in, vec4_t out )
 	============================================================
 	*/
 
-	void     R_AddBSPModelSurfaces( trRefEntity_t *e );
+	void     R_AddBSPModelSurfaces( frontEndJob_t *job, trRefEntity_t *e, model_t *model );
 	void     R_AddWorldSurfaces();
+	bool     R_MergeWorldSurface( const frontEndDrawSurf_t *drawSurf );
 	bool R_inPVS( const vec3_t p1, const vec3_t p2 );
 	bool R_inPVVS( const vec3_t p1, const vec3_t p2 );
 
-	void     R_AddWorldInteractions( trRefLight_t *light );
-	void     R_AddPrecachedWorldInteractions( trRefLight_t *light );
+	void     R_AddWorldInteractions( frontEndJob_t *job, trRefLight_t *light );
+	void     R_AddPrecachedWorldInteractions( frontEndJob_t *job, trRefLight_t *light );
 	void     R_ShutdownVBOs();
 
 	/*
 	============================================================
 
+	DRAW SURFACE SORTING, tr_sort.cpp
+
+	============================================================
+	*/
+
+	void R_SortDrawSurfList( drawSurf_t *drawSurfs, int numDrawSurfs, int *firstDrawSurf, bool coherent );
+
+	/*
+	============================================================
+
+	OCCLUSION CULLING, tr_occlusion.cpp
+
+	============================================================
+	*/
+
+	void R_BuildOccluders( world_t *world );
+	void R_BuildOcclusionBuffer();
+	bool R_BoxOccluded( const vec3_t mins, const vec3_t maxs, frontEndCounters_t *pc );
+
+	/*
+	============================================================
+
 	FLARES, tr_flares.c
 
 	============================================================
@@ -3474,7 +3607,7 @@ static inline void halfToFloat( const f16vec4_t in, vec4_t out )
 	============================================================
 	*/
 
-	void     R_AddBrushModelInteractions( trRefEntity_t *ent, trRefLight_t *light, interactionType_t iaType );
+	void     R_AddBrushModelInteractions( frontEndJob_t *job, trRefEntity_t *ent, model_t *model, trRefLight_t *light, interactionType_t iaType );
 	void     R_SetupEntityLighting( const trRefdef_t *refdef, trRefEntity_t *ent, vec3_t forcedOrigin );
 	float R_InterpolateLightGrid( world_t *w, int from[3], int to[3],
 				      float *factors[3], vec3_t ambientLight,
@@ -3490,8 +3623,9 @@ static inline void halfToFloat( const f16vec4_t in, vec4_t out )
 	void     R_SetupLightFrustum( trRefLight_t *light );
 	void     R_SetupLightProjection( trRefLight_t *light );
 
-	bool R_AddLightInteraction( trRefLight_t *light, surfaceType_t *surface, shader_t *surfaceShader, byte cubeSideBits,
+	bool R_AddLightInteraction( frontEndJob_t *job, trRefLight_t *light, surfaceType_t *surface, shader_t *surfaceShader, byte cubeSideBits,
 	                                interactionType_t iaType );
+	void R_MergeLightInteraction( const frontEndInteraction_t *pending );
 
 	void     R_SortInteractions( trRefLight_t *light );
 
@@ -3500,7 +3634,9 @@ static inline void halfToFloat( const f16vec4_t in, vec4_t out )
 
 	void     R_SetupLightShader( trRefLight_t *light );
 
-	byte     R_CalcLightCubeSideBits( trRefLight_t *light, vec3_t worldBounds[ 2 ] );
+	byte     R_CalcLightCubeSideBits( trRefLight_t *light, vec3_t worldBounds[ 2 ], frontEndCounters_t *pc );
+	void     R_CullLightEntities( trRefLight_t *light, lightEntityCull_t *culls );
+	bool     R_CullLightEntity( trRefLight_t *light, trRefEntity_t *ent, byte *cubeSideBits, frontEndCounters_t *pc );
 
 	cullResult_t R_CullLightPoint( trRefLight_t *light, const vec3_t p );
 
@@ -3611,8 +3747,8 @@ static inline void halfToFloat( const f16vec4_t in, vec4_t out )
 
 	void     R_ProjectDecalOntoSurface( decalProjector_t *dp, bspSurface_t *surf, bspModel_t *bmodel );
 
-	void     R_AddDecalSurface( decal_t *decal );
-	void     R_AddDecalSurfaces( bspModel_t *bmodel );
+	void     R_AddDecalSurface( frontEndJob_t *job, decal_t *decal );
+	void     R_AddDecalSurfaces( frontEndJob_t *job, bspModel_t *bmodel );
 	void     R_CullDecalProjectors();
 
 	/*
@@ -3664,16 +3800,17 @@ static inline void halfToFloat( const f16vec4_t in, vec4_t out )
 	skelAnimation_t *R_GetAnimationByHandle( qhandle_t hAnim );
 	void            R_AnimationList_f();
 
-	void            R_AddMD5Surfaces( trRefEntity_t *ent );
-	void            R_AddMD5Interactions( trRefEntity_t *ent, trRefLight_t *light, interactionType_t iaType );
+	void            R_AddMD5Surfaces( frontEndJob_t *job, trRefEntity_t *ent, model_t *model );
+	void            R_AddMD5Interactions( frontEndJob_t *job, trRefEntity_t *ent, model_t *model, trRefLight_t *light, interactionType_t iaType );
 
-	void		R_AddIQMSurfaces( trRefEntity_t *ent );
-	void            R_AddIQMInteractions( trRefEntity_t *ent, trRefLight_t *light, interactionType_t iaType );
+	void		R_AddIQMSurfaces( frontEndJob_t *job, trRefEntity_t *ent, model_t *model );
+	void            R_AddIQMInteractions( frontEndJob_t *job, trRefEntity_t *ent, model_t *model, trRefLight_t *light, interactionType_t iaType );
 
 	int             RE_CheckSkeleton( refSkeleton_t *skel, qhandle_t hModel, qhandle_t hAnim );
 	int             RE_BuildSkeleton( refSkeleton_t *skel, qhandle_t anim, int startFrame, int endFrame, float frac,
 	                                  bool clearOrigin );
 	int             RE_BlendSkeleton( refSkeleton_t *skel, const refSkeleton_t *blend, float frac );
+	void            R_SkeletonCacheInfo( size_t *numPoses, size_t *poseBytes );
 	int             RE_AnimNumFrames( qhandle_t hAnim );
 	int             RE_AnimFrameRate( qhandle_t hAnim );
 
@@ -3985,15 +4122,19 @@ static inline void halfToFloat( const f16vec4_t in, vec4_t out )
 	void                                RE_EndFrame( int *frontEndMsec, int *backEndMsec );
 
 	void                                LoadTGA( const char *name, byte **pic, int *width, int *height, int *numLayers, int *numMips, int *bits, byte alphaByte );
+	void                                DecodeTGA( const char *name, const byte *data, int len, byte **pic, int *width, int *height, byte alphaByte );
 
 	void                                LoadJPG( const char *filename, unsigned char **pic, int *width, int *height, int *numLayers, int *numMips, int *bits, byte alphaByte );
+	void                                DecodeJPG( const char *filename, const byte *data, int len, unsigned char **pic, int *width, int *height, byte alphaByte );
 	void                                SaveJPG( char *filename, int quality, int image_width, int image_height, unsigned char *image_buffer );
 	int                                 SaveJPGToBuffer( byte *buffer, size_t bufferSize, int quality, int image_width, int image_height, byte *image_buffer );
 
 	void                                LoadPNG( const char *name, byte **pic, int *width, int *height, int *numLayers, int *numMips, int *bits, byte alphaByte );
+	void                                DecodePNG( const char *name, const byte *data, int len, byte **pic, int *width, int *height, byte alphaByte );
 	void                                SavePNG( const char *name, const byte *pic, int width, int height, int numBytes, bool flip );
 
 	void                                LoadWEBP( const char *name, byte **pic, int *width, int *height, int *numLayers, int *numMips, int *bits, byte alphaByte );
+	void                                DecodeWEBP( const char *name, const byte *data, int len, byte **pic, int *width, int *height, byte alphaByte );
 	void                                LoadDDS( const char *name, byte **pic, int *width, int *height, int *numLayers, int *numMips, int *bits, byte alphaByte);
 	void                                LoadCRN( const char *name, byte **pic, int *width, int *height, int *numLayers, int *numMips, int *bits, byte alphaByte);
 	void                                LoadKTX( const char *name, byte **pic, int *width, int *height, int *numLayers, int *numMips, int *bits, byte alphaByte);
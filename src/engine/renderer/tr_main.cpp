@@ -22,9 +22,14 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 */
 // tr_main.c -- main control flow for each frame
 #include "tr_local.h"
+#include "common/ThreadPool.h"
 
 trGlobals_t tr;
 
+// runs the front end jobs gathering the world, entity and light surfaces
+static Sys::ThreadPool frontEndPool;
+static frontEndJob_t   frontEndJobs[ MAX_FRONTEND_JOBS ];
+
 // convert from our coordinate system (looking down X)
 // to OpenGL's coordinate system (looking down -Z)
 const matrix_t quakeToOpenGLMatrix =
@@ -335,7 +340,7 @@ R_CullBox
 Returns CULL_IN, CULL_CLIP, or CULL_OUT
 =================
 */
-cullResult_t R_CullBox( vec3_t worldBounds[ 2 ] )
+cullResult_t R_CullBox( vec3_t worldBounds[ 2 ], frontEndCounters_t *pc )
 {
 	bool anyClip;
 	cplane_t *frust;
@@ -367,6 +372,12 @@ cullResult_t R_CullBox( vec3_t worldBounds[ 2 ] )
 		}
 	}
 
+	// hidden behind the occluders of the view
+	if ( R_BoxOccluded( worldBounds[ 0 ], worldBounds[ 1 ], pc ) )
+	{
+		return cullResult_t::CULL_OUT;
+	}
+
 	if ( !anyClip )
 	{
 		// completely inside frustum
@@ -384,14 +395,14 @@ R_CullLocalBox
 Returns CULL_IN, CULL_CLIP, or CULL_OUT
 =================
 */
-cullResult_t R_CullLocalBox( vec3_t localBounds[ 2 ] )
+cullResult_t R_CullLocalBox( const orientationr_t *orientation, vec3_t localBounds[ 2 ], frontEndCounters_t *pc )
 {
 	vec3_t   worldBounds[ 2 ];
 
 	// transform into world space
-	MatrixTransformBounds(tr.orientation.transformMatrix, localBounds[0], localBounds[1], worldBounds[0], worldBounds[1]);
+	MatrixTransformBounds(orientation->transformMatrix, localBounds[0], localBounds[1], worldBounds[0], worldBounds[1]);
 
-	return R_CullBox( worldBounds );
+	return R_CullBox( worldBounds, pc );
 }
 
 /*
@@ -399,11 +410,11 @@ cullResult_t R_CullLocalBox( vec3_t localBounds[ 2 ] )
 R_CullLocalPointAndRadius
 =================
 */
-cullResult_t R_CullLocalPointAndRadius( vec3_t pt, float radius )
+cullResult_t R_CullLocalPointAndRadius( const orientationr_t *orientation, vec3_t pt, float radius )
 {
 	vec3_t transformed;
 
-	R_LocalPointToWorld( pt, transformed );
+	MatrixTransformPoint( orientation->transformMatrix, pt, transformed );
 
 	return R_CullPointAndRadius( transformed, radius );
 }
@@ -616,9 +627,9 @@ R_SetupEntityWorldBounds
 Tr3B - needs R_RotateEntityForViewParms
 =================
 */
-void R_SetupEntityWorldBounds( trRefEntity_t *ent )
+void R_SetupEntityWorldBounds( trRefEntity_t *ent, const orientationr_t *orientation )
 {
-	MatrixTransformBounds(tr.orientation.transformMatrix, ent->localBounds[0], ent->localBounds[1], ent->worldBounds[0], ent->worldBounds[1]);
+	MatrixTransformBounds(orientation->transformMatrix, ent->localBounds[0], ent->localBounds[1], ent->worldBounds[0], ent->worldBounds[1]);
 }
 
 /*
@@ -1944,10 +1955,13 @@ int R_SpriteFogNum( trRefEntity_t *ent )
 
 /*
 =================
-R_AddDrawSurf
+R_InsertDrawSurf
+
+Appends a surface to the drawSurf list of the scene, the sort key depends
+on the position in that list
 =================
 */
-void R_AddDrawSurf( surfaceType_t *surface, shader_t *shader, int lightmapNum, int fogNum )
+static void R_InsertDrawSurf( trRefEntity_t *entity, surfaceType_t *surface, shader_t *shader, int lightmapNum, int fogNum )
 {
 	int        index;
 	drawSurf_t *drawSurf;
@@ -1958,18 +1972,18 @@ void R_AddDrawSurf( surfaceType_t *surface, shader_t *shader, int lightmapNum, i
 
 	drawSurf = &tr.refdef.drawSurfs[ index ];
 
-	drawSurf->entity = tr.currentEntity;
+	drawSurf->entity = entity;
 	drawSurf->surface = surface;
 
 	int entityNum;
 
-	if ( tr.currentEntity == &tr.worldEntity )
+	if ( entity == &tr.worldEntity )
 	{
 		entityNum = -1;
 	}
 	else
 	{
-		entityNum = tr.currentEntity - tr.refdef.entities;
+		entityNum = entity - tr.refdef.entities;
 	}
 
 	if (shader->sort > Util::ordinal(shaderSort_t::SS_OPAQUE))
@@ -1982,7 +1996,320 @@ void R_AddDrawSurf( surfaceType_t *surface, shader_t *shader, int lightmapNum, i
 	tr.refdef.numDrawSurfs++;
 
 	if ( shader->depthShader != nullptr ) {
-		R_AddDrawSurf( surface, shader->depthShader, 0, 0 );
+		R_InsertDrawSurf( entity, surface, shader->depthShader, 0, 0 );
+	}
+}
+
+/*
+=================
+R_AddDrawSurf
+
+Queues a surface of job->entity in the job, it gets its place in the
+drawSurf list of the scene when the job is merged
+=================
+*/
+void R_AddDrawSurf( frontEndJob_t *job, surfaceType_t *surface, shader_t *shader, int lightmapNum, int fogNum )
+{
+	frontEndDrawSurf_t drawSurf{};
+
+	drawSurf.entity = job->entity;
+	drawSurf.surface = surface;
+	drawSurf.shader = shader;
+	drawSurf.lightmapNum = lightmapNum;
+	drawSurf.fogNum = fogNum;
+
+	job->drawSurfs.push_back( drawSurf );
+}
+
+/*
+=================
+R_AddFrontEndCounters
+=================
+*/
+static void R_AddFrontEndCounters( const frontEndCounters_t *pc )
+{
+	tr.pc.c_box_cull_in += pc->c_box_cull_in;
+	tr.pc.c_box_cull_clip += pc->c_box_cull_clip;
+	tr.pc.c_box_cull_out += pc->c_box_cull_out;
+	tr.pc.c_plane_cull_in += pc->c_plane_cull_in;
+	tr.pc.c_plane_cull_out += pc->c_plane_cull_out;
+
+	tr.pc.c_sphere_cull_mdv_in += pc->c_sphere_cull_mdv_in;
+	tr.pc.c_sphere_cull_mdv_clip += pc->c_sphere_cull_mdv_clip;
+	tr.pc.c_sphere_cull_mdv_out += pc->c_sphere_cull_mdv_out;
+	tr.pc.c_box_cull_mdv_in += pc->c_box_cull_mdv_in;
+	tr.pc.c_box_cull_mdv_clip += pc->c_box_cull_mdv_clip;
+	tr.pc.c_box_cull_mdv_out += pc->c_box_cull_mdv_out;
+	tr.pc.c_box_cull_md5_in += pc->c_box_cull_md5_in;
+	tr.pc.c_box_cull_md5_clip += pc->c_box_cull_md5_clip;
+	tr.pc.c_box_cull_md5_out += pc->c_box_cull_md5_out;
+	tr.pc.c_box_cull_light_in += pc->c_box_cull_light_in;
+	tr.pc.c_box_cull_light_clip += pc->c_box_cull_light_clip;
+	tr.pc.c_box_cull_light_out += pc->c_box_cull_light_out;
+	tr.pc.c_pvs_cull_light_out += pc->c_pvs_cull_light_out;
+
+	tr.pc.c_pyramidTests += pc->c_pyramidTests;
+	tr.pc.c_pyramid_cull_ent_in += pc->c_pyramid_cull_ent_in;
+	tr.pc.c_pyramid_cull_ent_clip += pc->c_pyramid_cull_ent_clip;
+	tr.pc.c_pyramid_cull_ent_out += pc->c_pyramid_cull_ent_out;
+
+	tr.pc.c_occlusionTests += pc->c_occlusionTests;
+	tr.pc.c_occlusion_cull_out += pc->c_occlusion_cull_out;
+
+	tr.pc.c_nodes += pc->c_nodes;
+	tr.pc.c_leafs += pc->c_leafs;
+
+	tr.pc.c_slights += pc->c_slights;
+	tr.pc.c_slightSurfaces += pc->c_slightSurfaces;
+	tr.pc.c_slightInteractions += pc->c_slightInteractions;
+
+	tr.pc.c_dlights += pc->c_dlights;
+	tr.pc.c_dlightSurfaces += pc->c_dlightSurfaces;
+	tr.pc.c_dlightSurfacesCulled += pc->c_dlightSurfacesCulled;
+	tr.pc.c_dlightInteractions += pc->c_dlightInteractions;
+
+	tr.pc.c_decalProjectors += pc->c_decalProjectors;
+	tr.pc.c_decalTestSurfaces += pc->c_decalTestSurfaces;
+	tr.pc.c_decalClipSurfaces += pc->c_decalClipSurfaces;
+	tr.pc.c_decalSurfaces += pc->c_decalSurfaces;
+	tr.pc.c_decalSurfacesCreated += pc->c_decalSurfacesCreated;
+}
+
+/*
+=================
+R_ClearFrontEndJob
+
+Empties the job and points it at the world entity of the view
+=================
+*/
+void R_ClearFrontEndJob( frontEndJob_t *job )
+{
+	job->entity = &tr.worldEntity;
+	job->orientation = tr.viewParms.world;
+
+	job->firstItem = 0;
+	job->numItems = 0;
+
+	job->drawSurfs.clear();
+	job->interactions.clear();
+
+	Com_Memset( &job->pc, 0, sizeof( job->pc ) );
+
+	job->node = nullptr;
+	job->planeBits = 0;
+	job->decalBits = 0;
+	job->traversal.clear();
+	ClearBounds( job->visBounds[ 0 ], job->visBounds[ 1 ] );
+}
+
+/*
+=================
+R_SetupFrontEndJobs
+
+Splits numItems work items in as many jobs as worth it with the current
+r_frontEndThreads and clears these jobs. Returns the number of jobs.
+=================
+*/
+int R_SetupFrontEndJobs( int numItems )
+{
+	int numThreads = Math::Clamp( r_frontEndThreads->integer, 0, MAX_FRONTEND_THREADS );
+	int numJobs;
+
+	frontEndPool.SetNumThreads( numThreads );
+
+	// a few jobs per thread so that the costly ones don't make the others wait
+	numJobs = numThreads ? std::min( 2 * ( numThreads + 1 ), MAX_FRONTEND_JOBS ) : 1;
+	numJobs = Math::Clamp( numItems, 1, numJobs );
+
+	for ( int i = 0; i < numJobs; i++ )
+	{
+		frontEndJob_t *job = &frontEndJobs[ i ];
+
+		R_ClearFrontEndJob( job );
+
+		job->firstItem = i * numItems / numJobs;
+		job->numItems = ( i + 1 ) * numItems / numJobs - job->firstItem;
+	}
+
+	return numJobs;
+}
+
+/*
+=================
+R_GetFrontEndJob
+=================
+*/
+frontEndJob_t *R_GetFrontEndJob( int jobNum )
+{
+	ASSERT( jobNum >= 0 && jobNum < MAX_FRONTEND_JOBS );
+
+	return &frontEndJobs[ jobNum ];
+}
+
+/*
+=================
+R_RunFrontEndJobs
+
+Runs the first numJobs jobs on the front end threads, the main thread
+helps and returns when they are all done
+=================
+*/
+void R_RunFrontEndJobs( int numJobs, void ( *func )( frontEndJob_t *job ) )
+{
+	frontEndPool.ParallelFor( numJobs, [ func ]( int jobNum ) {
+		func( &frontEndJobs[ jobNum ] );
+	} );
+}
+
+/*
+=================
+R_MergeFrontEndJob
+
+Appends the surfaces gathered by the job to the drawSurf list of the scene
+and adds its counters. The interactions are merged light by light by
+R_AddLightInteractions.
+=================
+*/
+void R_MergeFrontEndJob( frontEndJob_t *job )
+{
+	for ( const frontEndDrawSurf_t &drawSurf : job->drawSurfs )
+	{
+		if ( drawSurf.bspSurface && !R_MergeWorldSurface( &drawSurf ) )
+		{
+			continue;
+		}
+
+		R_InsertDrawSurf( drawSurf.entity, drawSurf.surface, drawSurf.shader, drawSurf.lightmapNum, drawSurf.fogNum );
+	}
+
+	R_AddFrontEndCounters( &job->pc );
+
+	job->drawSurfs.clear();
+	Com_Memset( &job->pc, 0, sizeof( job->pc ) );
+}
+
+/*
+=================
+R_AddShaderTextureUsage
+=================
+*/
+static void R_AddShaderTextureUsage( const shader_t *shader, float screenSize, float pixelsPerUnit )
+{
+	for ( int i = 0; i < MAX_SHADER_STAGES && shader->stages[ i ]; i++ )
+	{
+		const shaderStage_t *stage = shader->stages[ i ];
+
+		for ( int j = 0; j < MAX_TEXTURE_BUNDLES; j++ )
+		{
+			const textureBundle_t &bundle = stage->bundle[ j ];
+
+			// only animMap sets numImages, other stages use image[ 0 ]
+			// like in BindAnimatedImage
+			for ( int k = 0; k < std::max<int>( bundle.numImages, 1 ); k++ )
+			{
+				image_t *image = bundle.image[ k ];
+
+				if ( image )
+				{
+					image->streamScreenSize = std::max( image->streamScreenSize, screenSize );
+					image->streamPixelsPerUnit = std::max( image->streamPixelsPerUnit, pixelsPerUnit );
+				}
+			}
+		}
+	}
+}
+
+/*
+=================
+R_AddTextureUsage
+
+Tells the texture streaming how large the images of the sorted surfaces of
+the view are on screen. Textures of world surfaces are assumed to be mapped
+at about a texel per unit, so their size is given in pixels per unit at the
+nearest point of the surface. Models are assumed to use their whole texture
+once, so their size is the projected size of their bounds.
+=================
+*/
+static void R_AddTextureUsage()
+{
+	// the size in pixels of a unit at a distance of one unit
+	float          pixelsPerUnitScale = tr.viewParms.viewportWidth * 0.5f / tanf( DEG2RAD( tr.viewParms.fovX * 0.5f ) );
+	const shader_t *shader = nullptr;
+	float          screenSize = 0.0f;
+	float          pixelsPerUnit = 0.0f;
+
+	for ( int i = 0; i < tr.viewParms.numDrawSurfs; i++ )
+	{
+		const drawSurf_t *drawSurf = &tr.viewParms.drawSurfs[ i ];
+		const shader_t   *surfShader = tr.sortedShaders[ drawSurf->shaderNum() ];
+
+		// the surfaces are sorted by shader
+		if ( surfShader != shader )
+		{
+			if ( shader )
+			{
+				R_AddShaderTextureUsage( shader, screenSize, pixelsPerUnit );
+			}
+
+			shader = surfShader;
+			screenSize = 0.0f;
+			pixelsPerUnit = 0.0f;
+		}
+
+		const surfaceType_t *surface = drawSurf->surface;
+
+		if ( drawSurf->entity == &tr.worldEntity )
+		{
+			if ( *surface == surfaceType_t::SF_FACE || *surface == surfaceType_t::SF_GRID ||
+			     *surface == surfaceType_t::SF_TRIANGLES || *surface == surfaceType_t::SF_VBO_MESH )
+			{
+				const srfGeneric_t *gen = ( const srfGeneric_t * ) surface;
+				float              distance = 0.0f;
+
+				// distance to the nearest point of the bounds
+				for ( int j = 0; j < 3; j++ )
+				{
+					float d = std::max( gen->bounds[ 0 ][ j ] - tr.viewParms.orientation.origin[ j ],
+					                    tr.viewParms.orientation.origin[ j ] - gen->bounds[ 1 ][ j ] );
+
+					if ( d > 0.0f )
+					{
+						distance += d * d;
+					}
+				}
+
+				distance = std::max( sqrtf( distance ), 1.0f );
+				pixelsPerUnit = std::max( pixelsPerUnit, pixelsPerUnitScale / distance );
+			}
+			else
+			{
+				// unknown extent, keep the full resolution
+				screenSize = FLT_MAX;
+			}
+		}
+		else if ( drawSurf->entity->e.reType != refEntityType_t::RT_MODEL )
+		{
+			// sprites, beams, polygons... keep the full resolution
+			screenSize = FLT_MAX;
+		}
+		else
+		{
+			const trRefEntity_t *ent = drawSurf->entity;
+			vec3_t              center;
+			float               radius = 0.5f * Distance( ent->worldBounds[ 0 ], ent->worldBounds[ 1 ] );
+
+			VectorAdd( ent->worldBounds[ 0 ], ent->worldBounds[ 1 ], center );
+			VectorScale( center, 0.5f, center );
+
+			float distance = std::max( Distance( tr.viewParms.orientation.origin, center ) - radius, 1.0f );
+
+			screenSize = std::max( screenSize, 2.0f * radius * pixelsPerUnitScale / distance );
+		}
+	}
+
+	if ( shader )
+	{
+		R_AddShaderTextureUsage( shader, screenSize, pixelsPerUnit );
 	}
 }
 
@@ -1994,8 +2321,7 @@ R_SortDrawSurfs
 static void R_SortDrawSurfs()
 {
 	drawSurf_t   *drawSurf;
-	shader_t     *shader;
-	int          i, sort;
+	int          i;
 
 	// it is possible for some views to not have any surfaces
 	if ( tr.viewParms.numDrawSurfs < 1 )
@@ -2027,30 +2353,13 @@ static void R_SortDrawSurfs()
 		ia->next = nullptr;
 	}
 
-	std::sort( tr.viewParms.drawSurfs, tr.viewParms.drawSurfs + tr.viewParms.numDrawSurfs,
-	           []( const drawSurf_t &a, const drawSurf_t &b ) {
-	               return a.sort < b.sort;
-	           } );
+	// the main view is mostly the same from frame to frame, unlike portal views
+	R_SortDrawSurfList( tr.viewParms.drawSurfs, tr.viewParms.numDrawSurfs, tr.viewParms.firstDrawSurf,
+	                    tr.viewParms.portalLevel == 0 && !tr.viewParms.isMirror );
 
-	// compute the offsets of the first surface of each SS_* type
-	sort = Util::ordinal( shaderSort_t::SS_BAD ) - 1;
-	for ( i = 0; i < tr.viewParms.numDrawSurfs; i++ )
+	if ( r_textureStreamBudget->integer )
 	{
-		drawSurf = &tr.viewParms.drawSurfs[ i ];
-		shader = tr.sortedShaders[ drawSurf->shaderNum() ];
-
-		// no shader should ever have this sort type
-		if ( shader->sort == Util::ordinal(shaderSort_t::SS_BAD) )
-		{
-			ri.Error(errorParm_t::ERR_DROP, "Shader '%s'with sort == SS_BAD", shader->name );
-		}
-
-		while ( sort < Util::ordinal( shaderSort_t::SS_NUM_SORTS ) - 1 && shader->sort > sort ) {
-			tr.viewParms.firstDrawSurf[ ++sort ] = i;
-		}
-	}
-	while ( sort < Util::ordinal( shaderSort_t::SS_NUM_SORTS ) ) {
-		tr.viewParms.firstDrawSurf[ ++sort ] = tr.viewParms.numDrawSurfs;
+		R_AddTextureUsage();
 	}
 
 	// tell renderer backend to render the depth for this view
@@ -2062,7 +2371,6 @@ static void R_SortDrawSurfs()
 	      i < tr.viewParms.firstDrawSurf[ Util::ordinal(shaderSort_t::SS_PORTAL) + 1 ]; i++ )
 	{
 		drawSurf = &tr.viewParms.drawSurfs[ i ];
-		shader = tr.sortedShaders[ drawSurf->shaderNum() ];
 
 		// if the mirror was completely clipped away, we may need to check another surface
 		if ( R_MirrorViewBySurface( drawSurf ) )
@@ -2083,111 +2391,142 @@ static void R_SortDrawSurfs()
 
 /*
 =============
-R_AddEntitySurfaces
+R_AddEntitySurface
 =============
 */
-void R_AddEntitySurfaces()
+static void R_AddEntitySurface( frontEndJob_t *job, trRefEntity_t *ent )
 {
-	int           i;
-	trRefEntity_t *ent;
 	shader_t      *shader;
+	model_t       *model;
 
-	if ( !r_drawentities->integer )
+	job->entity = ent;
+
+	//
+	// the weapon model must be handled special --
+	// we don't want the hacked weapon position showing in
+	// mirrors, because the true body position will already be drawn
+	//
+	if ( ( ent->e.renderfx & RF_FIRST_PERSON ) &&
+	     ( tr.viewParms.portalLevel > 0 || tr.viewParms.isMirror ) )
 	{
 		return;
 	}
 
-	for ( i = 0; i < tr.refdef.numEntities; i++ )
+	// simple generated models, like sprites and beams, are not culled
+	switch ( ent->e.reType )
 	{
-		ent = tr.currentEntity = &tr.refdef.entities[ i ];
+		case refEntityType_t::RT_PORTALSURFACE:
+			break; // don't draw anything
 
-		//
-		// the weapon model must be handled special --
-		// we don't want the hacked weapon position showing in
-		// mirrors, because the true body position will already be drawn
-		//
-		if ( ( ent->e.renderfx & RF_FIRST_PERSON ) &&
-		     ( tr.viewParms.portalLevel > 0 || tr.viewParms.isMirror ) )
-		{
-			continue;
-		}
+		case refEntityType_t::RT_SPRITE:
 
-		// simple generated models, like sprites and beams, are not culled
-		switch ( ent->e.reType )
-		{
-			case refEntityType_t::RT_PORTALSURFACE:
-				break; // don't draw anything
+			// self blood sprites, talk balloons, etc should not be drawn in the primary
+			// view.  We can't just do this check for all entities, because md3
+			// entities may still want to cast shadows from them
+			if ( ( ent->e.renderfx & RF_THIRD_PERSON ) &&
+			     tr.viewParms.portalLevel == 0 )
+			{
+				return;
+			}
 
-			case refEntityType_t::RT_SPRITE:
+			shader = R_GetShaderByHandle( ent->e.customShader );
+			R_AddDrawSurf( job, &entitySurface, shader, -1, R_SpriteFogNum( ent ) );
+			break;
+
+		case refEntityType_t::RT_MODEL:
+			// we must set up parts of the orientation for model culling
+			R_RotateEntityForViewParms( ent, &tr.viewParms, &job->orientation );
+
+			model = R_GetModelByHandle( ent->e.hModel );
 
-				// self blood sprites, talk balloons, etc should not be drawn in the primary
-				// view.  We can't just do this check for all entities, because md3
-				// entities may still want to cast shadows from them
-				if ( ( ent->e.renderfx & RF_THIRD_PERSON ) &&
-				     tr.viewParms.portalLevel == 0 )
+			if ( !model )
+			{
+				R_AddDrawSurf( job, &entitySurface, tr.defaultShader, -1, 0 );
+			}
+			else
+			{
+				switch ( model->type )
 				{
-					continue;
-				}
+					case modtype_t::MOD_MESH:
+						R_AddMDVSurfaces( job, ent, model );
+						break;
 
-				shader = R_GetShaderByHandle( ent->e.customShader );
-				R_AddDrawSurf( &entitySurface, shader, -1, R_SpriteFogNum( ent ) );
-				break;
+					case modtype_t::MOD_MD5:
+						R_AddMD5Surfaces( job, ent, model );
+						break;
 
-			case refEntityType_t::RT_MODEL:
-				// we must set up parts of tr.or for model culling
-				R_RotateEntityForViewParms( ent, &tr.viewParms, &tr.orientation );
+					case modtype_t::MOD_IQM:
+						R_AddIQMSurfaces( job, ent, model );
+						break;
 
-				tr.currentModel = R_GetModelByHandle( ent->e.hModel );
+					case modtype_t::MOD_BSP:
+						R_AddBSPModelSurfaces( job, ent, model );
+						break;
 
-				if ( !tr.currentModel )
-				{
-					R_AddDrawSurf( &entitySurface, tr.defaultShader, -1, 0 );
-				}
-				else
-				{
-					switch ( tr.currentModel->type )
-					{
-						case modtype_t::MOD_MESH:
-							R_AddMDVSurfaces( ent );
+					case modtype_t::MOD_BAD: // null model axis
+						if ( ( ent->e.renderfx & RF_THIRD_PERSON ) &&
+						     tr.viewParms.portalLevel == 0 )
+						{
 							break;
+						}
+
+						VectorClear( ent->localBounds[ 0 ] );
+						VectorClear( ent->localBounds[ 1 ] );
+						VectorClear( ent->worldBounds[ 0 ] );
+						VectorClear( ent->worldBounds[ 1 ] );
+						shader = R_GetShaderByHandle( ent->e.customShader );
+						R_AddDrawSurf( job, &entitySurface, tr.defaultShader, -1, 0 );
+						break;
 
-						case modtype_t::MOD_MD5:
-							R_AddMD5Surfaces( ent );
-							break;
+					default:
+						ri.Error(errorParm_t::ERR_DROP, "R_AddEntitySurfaces: Bad modeltype" );
+				}
+			}
 
-						case modtype_t::MOD_IQM:
-							R_AddIQMSurfaces( ent );
-							break;
+			break;
 
-						case modtype_t::MOD_BSP:
-							R_AddBSPModelSurfaces( ent );
-							break;
+		default:
+			ri.Error(errorParm_t::ERR_DROP, "R_AddEntitySurfaces: Bad reType" );
+	}
+}
 
-						case modtype_t::MOD_BAD: // null model axis
-							if ( ( ent->e.renderfx & RF_THIRD_PERSON ) &&
-							     tr.viewParms.portalLevel == 0 )
-							{
-								break;
-							}
-
-							VectorClear( ent->localBounds[ 0 ] );
-							VectorClear( ent->localBounds[ 1 ] );
-							VectorClear( ent->worldBounds[ 0 ] );
-							VectorClear( ent->worldBounds[ 1 ] );
-							shader = R_GetShaderByHandle( ent->e.customShader );
-							R_AddDrawSurf( &entitySurface, tr.defaultShader, -1, 0 );
-							break;
+/*
+=============
+R_AddEntitySurfacesJob
+=============
+*/
+static void R_AddEntitySurfacesJob( frontEndJob_t *job )
+{
+	for ( int i = job->firstItem; i < job->firstItem + job->numItems; i++ )
+	{
+		R_AddEntitySurface( job, &tr.refdef.entities[ i ] );
+	}
+}
 
-						default:
-							ri.Error(errorParm_t::ERR_DROP, "R_AddEntitySurfaces: Bad modeltype" );
-					}
-				}
+/*
+=============
+R_AddEntitySurfaces
 
-				break;
+The entities are culled and their surfaces gathered in batches by the
+front end jobs
+=============
+*/
+void R_AddEntitySurfaces()
+{
+	int numJobs;
 
-			default:
-				ri.Error(errorParm_t::ERR_DROP, "R_AddEntitySurfaces: Bad reType" );
-		}
+	if ( !r_drawentities->integer || !tr.refdef.numEntities )
+	{
+		return;
+	}
+
+	numJobs = R_SetupFrontEndJobs( tr.refdef.numEntities );
+
+	R_RunFrontEndJobs( numJobs, R_AddEntitySurfacesJob );
+
+	for ( int i = 0; i < numJobs; i++ )
+	{
+		R_MergeFrontEndJob( R_GetFrontEndJob( i ) );
 	}
 }
 
@@ -2196,10 +2535,11 @@ void R_AddEntitySurfaces()
 R_AddEntityInteractions
 =============
 */
-void R_AddEntityInteractions( trRefLight_t *light )
+void R_AddEntityInteractions( frontEndJob_t *job, trRefLight_t *light )
 {
 	int               i;
 	trRefEntity_t     *ent;
+	model_t           *model;
 	interactionType_t iaType;
 
 	if ( !r_drawentities->integer )
@@ -2228,7 +2568,7 @@ void R_AddEntityInteractions( trRefLight_t *light )
 			iaType = (interactionType_t) (iaType & ~IA_LIGHT);
 		}
 
-		ent = tr.currentEntity = &tr.refdef.entities[ i ];
+		ent = job->entity = &tr.refdef.entities[ i ];
 
 		//
 		// the weapon model must be handled special --
@@ -2251,26 +2591,26 @@ void R_AddEntityInteractions( trRefLight_t *light )
 				break;
 
 			case refEntityType_t::RT_MODEL:
-				tr.currentModel = R_GetModelByHandle( ent->e.hModel );
+				model = R_GetModelByHandle( ent->e.hModel );
 
-				if ( tr.currentModel )
+				if ( model )
 				{
-					switch ( tr.currentModel->type )
+					switch ( model->type )
 					{
 						case modtype_t::MOD_MESH:
-							R_AddMDVInteractions( ent, light, iaType );
+							R_AddMDVInteractions( job, ent, model, light, iaType );
 							break;
 
 						case modtype_t::MOD_MD5:
-							R_AddMD5Interactions( ent, light, iaType );
+							R_AddMD5Interactions( job, ent, model, light, iaType );
 							break;
 
 						case modtype_t::MOD_IQM:
-							R_AddIQMInteractions( ent, light, iaType );
+							R_AddIQMInteractions( job, ent, model, light, iaType );
 							break;
 
 						case modtype_t::MOD_BSP:
-							R_AddBrushModelInteractions( ent, light, iaType );
+							R_AddBrushModelInteractions( job, ent, model, light, iaType );
 							break;
 
 						case modtype_t::MOD_BAD: // null model axis
@@ -2332,22 +2672,69 @@ void R_TransformShadowLight( trRefLight_t *light ) {
 	VectorScale( forward, light->l.radius, light->l.projTarget );
 }
 
+// lights of the view gathered by the front end jobs, reused from frame
+// to frame to avoid allocations
+static std::vector<trRefLight_t *>    visibleLights;
+static std::vector<lightEntityCull_t> lightEntityCulls;
+
+/*
+=============
+R_AddLightInteractionsJob
+=============
+*/
+static void R_AddLightInteractionsJob( frontEndJob_t *job )
+{
+	int numEntities = tr.refdef.numEntities;
+
+	for ( int lightNum = job->firstItem; lightNum < job->firstItem + job->numItems; lightNum++ )
+	{
+		trRefLight_t *light = visibleLights[ lightNum ];
+
+		// cull the entities against the light once for all their surfaces
+		if ( r_drawentities->integer && numEntities > 0 )
+		{
+			light->entityCulls = &lightEntityCulls[ lightNum * numEntities ];
+			R_CullLightEntities( light, light->entityCulls );
+		}
+
+		if ( light->isStatic )
+		{
+			R_AddPrecachedWorldInteractions( job, light );
+		}
+		else
+		{
+			R_AddWorldInteractions( job, light );
+		}
+
+		R_AddEntityInteractions( job, light );
+	}
+}
+
 /*
 =============
 R_AddLightInteractions
+
+The visible lights are set up on the main thread, then their interactions
+are gathered in batches of lights by the front end jobs. Interactions are
+allocated one after the other, so they are merged light by light in order.
 =============
 */
 void R_AddLightInteractions()
 {
-	int          i;
-	trRefLight_t *light;
-	bspNode_t    *leaf;
-	link_t       *l;
+	int            i;
+	int            numJobs;
+	trRefLight_t   *light;
+	bspNode_t      *leaf;
+	link_t         *l;
+	orientationr_t orientation;
+
+	visibleLights.clear();
 
 	tr.refdef.numShaderLights = 0;
 	for ( i = 0; i < tr.refdef.numLights; i++ )
 	{
 		light = tr.currentLight = &tr.refdef.lights[ i ];
+		light->entityCulls = nullptr;
 
 		if ( light->isStatic ) {
 			if ( r_staticLight->integer != 1 || ( ( r_precomputedLighting->integer || r_vertexLighting->integer ) && !light->noRadiosity ) )
@@ -2380,8 +2767,8 @@ void R_AddLightInteractions()
 
 		R_TransformShadowLight( light );
 
-		// we must set up parts of tr.or for light culling
-		R_RotateLightForViewParms( light, &tr.viewParms, &tr.orientation );
+		// we must set up parts of the orientation for light culling
+		R_RotateLightForViewParms( light, &tr.viewParms, &orientation );
 
 		// calc local bounds for culling
 		if ( light->isStatic )
@@ -2414,7 +2801,7 @@ void R_AddLightInteractions()
 			}
 
 			// look if we have to draw the light including its interactions
-			switch ( R_CullLocalBox( light->localBounds ) )
+			switch ( R_CullLocalBox( &orientation, light->localBounds, &tr.pc ) )
 			{
 				case cullResult_t::CULL_IN:
 				default:
@@ -2452,7 +2839,7 @@ void R_AddLightInteractions()
 			R_SetupLightLocalBounds( light );
 
 			// look if we have to draw the light including its interactions
-			switch ( R_CullLocalBox( light->localBounds ) )
+			switch ( R_CullLocalBox( &orientation, light->localBounds, &tr.pc ) )
 			{
 				case cullResult_t::CULL_IN:
 				default:
@@ -2496,55 +2883,82 @@ void R_AddLightInteractions()
 		// look for proper attenuation shader
 		R_SetupLightShader( light );
 
-		// setup interactions
-		light->firstInteraction = nullptr;
-		light->lastInteraction = nullptr;
+		visibleLights.push_back( light );
+	}
 
-		light->numInteractions = 0;
-		light->numShadowOnlyInteractions = 0;
-		light->numLightOnlyInteractions = 0;
-		light->noSort = false;
+	if ( visibleLights.empty() )
+	{
+		return;
+	}
 
-		if ( light->isStatic )
-		{
-			R_AddPrecachedWorldInteractions( light );
-		}
-		else
-		{
-			R_AddWorldInteractions( light );
-		}
+	if ( r_drawentities->integer && tr.refdef.numEntities > 0 )
+	{
+		lightEntityCulls.resize( visibleLights.size() * tr.refdef.numEntities );
+	}
 
-		R_AddEntityInteractions( light );
+	numJobs = R_SetupFrontEndJobs( visibleLights.size() );
 
-		if ( light->numInteractions && light->numInteractions != light->numShadowOnlyInteractions )
+	R_RunFrontEndJobs( numJobs, R_AddLightInteractionsJob );
+
+	for ( int jobNum = 0; jobNum < numJobs; jobNum++ )
+	{
+		frontEndJob_t *job = R_GetFrontEndJob( jobNum );
+		size_t        iaNum = 0;
+
+		for ( int lightNum = job->firstItem; lightNum < job->firstItem + job->numItems; lightNum++ )
 		{
-			R_SortInteractions( light );
+			light = tr.currentLight = visibleLights[ lightNum ];
+
+			// setup interactions
+			light->firstInteraction = nullptr;
+			light->lastInteraction = nullptr;
 
-			if ( light->isStatic )
+			light->numInteractions = 0;
+			light->numShadowOnlyInteractions = 0;
+			light->numLightOnlyInteractions = 0;
+			light->noSort = false;
+
+			// the job gathered the interactions light after light
+			for ( ; iaNum < job->interactions.size() && job->interactions[ iaNum ].light == light; iaNum++ )
 			{
-				tr.pc.c_slights++;
+				R_MergeLightInteraction( &job->interactions[ iaNum ] );
+			}
+
+			if ( light->numInteractions && light->numInteractions != light->numShadowOnlyInteractions )
+			{
+				R_SortInteractions( light );
+
+				if ( light->isStatic )
+				{
+					tr.pc.c_slights++;
+				}
+				else
+				{
+					tr.pc.c_dlights++;
+				}
 			}
 			else
 			{
-				tr.pc.c_dlights++;
+				// skip all interactions of this light because it caused only shadow volumes
+				// but no lighting
+				tr.refdef.numInteractions -= light->numInteractions;
+				light->cull = cullResult_t::CULL_OUT;
 			}
+
+			light->entityCulls = nullptr;
 		}
-		else
-		{
-			// skip all interactions of this light because it caused only shadow volumes
-			// but no lighting
-			tr.refdef.numInteractions -= light->numInteractions;
-			light->cull = cullResult_t::CULL_OUT;
-		}
+
+		R_MergeFrontEndJob( job );
 	}
 }
 
 void R_AddLightBoundsToVisBounds()
 {
-	int          i;
-	trRefLight_t *light;
-	bspNode_t    *leaf;
-	link_t       *l;
+	int            i;
+	trRefLight_t   *light;
+	bspNode_t      *leaf;
+	link_t         *l;
+	orientationr_t orientation;
 
 	for ( i = 0; i < tr.refdef.numLights; i++ )
 	{
@@ -2565,8 +2979,8 @@ void R_AddLightBoundsToVisBounds()
 			}
 		}
 
-		// we must set up parts of tr.or for light culling
-		R_RotateLightForViewParms( light, &tr.viewParms, &tr.orientation );
+		// we must set up parts of the orientation for light culling
+		R_RotateLightForViewParms( light, &tr.viewParms, &orientation );
 
 		// calc local bounds for culling
 		if ( light->isStatic )
@@ -2597,7 +3011,7 @@ void R_AddLightBoundsToVisBounds()
 			}
 
 			// look if we have to draw the light including its interactions
-			switch ( R_CullLocalBox( light->localBounds ) )
+			switch ( R_CullLocalBox( &orientation, light->localBounds, &tr.pc ) )
 			{
 				case cullResult_t::CULL_IN:
 				default:
@@ -2628,7 +3042,7 @@ void R_AddLightBoundsToVisBounds()
 			R_SetupLightLocalBounds( light );
 
 			// look if we have to draw the light including its interactions
-			switch ( R_CullLocalBox( light->localBounds ) )
+			switch ( R_CullLocalBox( &orientation, light->localBounds, &tr.pc ) )
 			{
 				case cullResult_t::CULL_IN:
 				default:
@@ -28,7 +28,7 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 R_CullMDV
 =============
 */
-static void R_CullMDV( mdvModel_t *model, trRefEntity_t *ent )
+static void R_CullMDV( frontEndJob_t *job, mdvModel_t *model, trRefEntity_t *ent )
 {
 	mdvFrame_t *oldFrame, *newFrame;
 	int        i;
@@ -47,34 +47,34 @@ static void R_CullMDV( mdvModel_t *model, trRefEntity_t *ent )
 	}
 
 	// setup world bounds for intersection tests
-	R_SetupEntityWorldBounds(ent);
+	R_SetupEntityWorldBounds( ent, &job->orientation );
 
 	// cull bounding sphere ONLY if this is not an upscaled entity
 	if ( !ent->e.nonNormalizedAxes )
 	{
 		if ( ent->e.frame == ent->e.oldframe )
 		{
-			switch ( R_CullLocalPointAndRadius( newFrame->localOrigin, newFrame->radius ) )
+			switch ( R_CullLocalPointAndRadius( &job->orientation, newFrame->localOrigin, newFrame->radius ) )
 			{
 				case cullResult_t::CULL_OUT:
-					tr.pc.c_sphere_cull_mdv_out++;
+					job->pc.c_sphere_cull_mdv_out++;
 					ent->cull = cullResult_t::CULL_OUT;
 					return;
 
 				case cullResult_t::CULL_IN:
-					tr.pc.c_sphere_cull_mdv_in++;
+					job->pc.c_sphere_cull_mdv_in++;
 					ent->cull = cullResult_t::CULL_IN;
 					return;
 
 				case cullResult_t::CULL_CLIP:
-					tr.pc.c_sphere_cull_mdv_clip++;
+					job->pc.c_sphere_cull_mdv_clip++;
 					break;
 			}
 		}
 		else
 		{
 			cullResult_t sphereCullB;
-			cullResult_t sphereCull = R_CullLocalPointAndRadius( newFrame->localOrigin, newFrame->radius );
+			cullResult_t sphereCull = R_CullLocalPointAndRadius( &job->orientation, newFrame->localOrigin, newFrame->radius );
 
 			if ( newFrame == oldFrame )
 			{
@@ -82,46 +82,46 @@ static void R_CullMDV( mdvModel_t *model, trRefEntity_t *ent )
 			}
 			else
 			{
-				sphereCullB = R_CullLocalPointAndRadius( oldFrame->localOrigin, oldFrame->radius );
+				sphereCullB = R_CullLocalPointAndRadius( &job->orientation, oldFrame->localOrigin, oldFrame->radius );
 			}
 
 			if ( sphereCull == sphereCullB )
 			{
 				if ( sphereCull == cullResult_t::CULL_OUT )
 				{
-					tr.pc.c_sphere_cull_mdv_out++;
+					job->pc.c_sphere_cull_mdv_out++;
 					ent->cull = cullResult_t::CULL_OUT;
 					return;
 				}
 				else if ( sphereCull == cullResult_t::CULL_IN )
 				{
-					tr.pc.c_sphere_cull_mdv_in++;
+					job->pc.c_sphere_cull_mdv_in++;
 					ent->cull = cullResult_t::CULL_IN;
 					return;
 				}
 				else
 				{
-					tr.pc.c_sphere_cull_mdv_clip++;
+					job->pc.c_sphere_cull_mdv_clip++;
 				}
 			}
 		}
 	}
 
-	switch ( R_CullBox( ent->worldBounds ) )
+	switch ( R_CullBox( ent->worldBounds, &job->pc ) )
 	{
 		case cullResult_t::CULL_IN:
-			tr.pc.c_box_cull_mdv_in++;
+			job->pc.c_box_cull_mdv_in++;
 			ent->cull = cullResult_t::CULL_IN;
 			return;
 
 		case cullResult_t::CULL_CLIP:
-			tr.pc.c_box_cull_mdv_clip++;
+			job->pc.c_box_cull_mdv_clip++;
 			ent->cull = cullResult_t::CULL_CLIP;
 			return;
 
 		case cullResult_t::CULL_OUT:
 		default:
-			tr.pc.c_box_cull_mdv_out++;
+			job->pc.c_box_cull_mdv_out++;
 			ent->cull = cullResult_t::CULL_OUT;
 			return;
 	}
@@ -132,7 +132,7 @@ static void R_CullMDV( mdvModel_t *model, trRefEntity_t *ent )
 R_ComputeLOD
 =================
 */
-int R_ComputeLOD( trRefEntity_t *ent )
+int R_ComputeLOD( trRefEntity_t *ent, model_t *pModel )
 {
 	float      radius;
 	float      flod, lodscale;
@@ -140,7 +140,7 @@ int R_ComputeLOD( trRefEntity_t *ent )
 	mdvFrame_t *frame;
 	int        lod;
 
-	if ( tr.currentModel->numLods < 2 )
+	if ( pModel->numLods < 2 )
 	{
 		// model has only 1 LOD level, skip computations and bias
 		lod = 0;
@@ -150,7 +150,7 @@ int R_ComputeLOD( trRefEntity_t *ent )
 		// multiple LODs exist, so compute projected bounding sphere
 		// and use that as a criteria for selecting LOD
 
-		frame = tr.currentModel->mdv[ 0 ]->frames;
+		frame = pModel->mdv[ 0 ]->frames;
 		frame += ent->e.frame;
 
 		radius = RadiusFromBounds( frame->bounds[ 0 ], frame->bounds[ 1 ] );
@@ -172,24 +172,24 @@ int R_ComputeLOD( trRefEntity_t *ent )
 			flod = 0;
 		}
 
-		flod *= tr.currentModel->numLods;
+		flod *= pModel->numLods;
 		lod = Q_ftol( flod );
 
 		if ( lod < 0 )
 		{
 			lod = 0;
 		}
-		else if ( lod >= tr.currentModel->numLods )
+		else if ( lod >= pModel->numLods )
 		{
-			lod = tr.currentModel->numLods - 1;
+			lod = pModel->numLods - 1;
 		}
 	}
 
 	lod += r_lodBias->integer;
 
-	if ( lod >= tr.currentModel->numLods )
+	if ( lod >= pModel->numLods )
 	{
-		lod = tr.currentModel->numLods - 1;
+		lod = pModel->numLods - 1;
 	}
 
 	if ( lod < 0 )
@@ -250,7 +250,7 @@ static shader_t *GetMDVSurfaceShader( const trRefEntity_t *ent, mdvSurface_t *md
 R_AddMDVSurfaces
 =================
 */
-void R_AddMDVSurfaces( trRefEntity_t *ent )
+void R_AddMDVSurfaces( frontEndJob_t *job, trRefEntity_t *ent, model_t *pModel )
 {
 	int          i;
 	mdvModel_t   *model = 0;
@@ -266,8 +266,8 @@ void R_AddMDVSurfaces( trRefEntity_t *ent )
 
 	if ( ent->e.renderfx & RF_WRAP_FRAMES )
 	{
-		ent->e.frame %= tr.currentModel->mdv[ 0 ]->numFrames;
-		ent->e.oldframe %= tr.currentModel->mdv[ 0 ]->numFrames;
+		ent->e.frame %= pModel->mdv[ 0 ]->numFrames;
+		ent->e.oldframe %= pModel->mdv[ 0 ]->numFrames;
 	}
 
 	// compute LOD
@@ -277,27 +277,27 @@ void R_AddMDVSurfaces( trRefEntity_t *ent )
 	}
 	else
 	{
-		lod = R_ComputeLOD( ent );
+		lod = R_ComputeLOD( ent, pModel );
 	}
 
 	// Validate the frames so there is no chance of a crash.
 	// This will write directly into the entity structure, so
 	// when the surfaces are rendered, they don't need to be
 	// range checked again.
-	if ( ( ent->e.frame >= tr.currentModel->mdv[ lod ]->numFrames )
-	     || ( ent->e.frame < 0 ) || ( ent->e.oldframe >= tr.currentModel->mdv[ lod ]->numFrames ) || ( ent->e.oldframe < 0 ) )
+	if ( ( ent->e.frame >= pModel->mdv[ lod ]->numFrames )
+	     || ( ent->e.frame < 0 ) || ( ent->e.oldframe >= pModel->mdv[ lod ]->numFrames ) || ( ent->e.oldframe < 0 ) )
 	{
 		Log::Debug("R_AddMDVSurfaces: no such frame %d to %d for '%s' (%d)",
-		           ent->e.oldframe, ent->e.frame, tr.currentModel->name, tr.currentModel->mdv[ lod ]->numFrames );
+		           ent->e.oldframe, ent->e.frame, pModel->name, pModel->mdv[ lod ]->numFrames );
 		ent->e.frame = 0;
 		ent->e.oldframe = 0;
 	}
 
-	model = tr.currentModel->mdv[ lod ];
+	model = pModel->mdv[ lod ];
 
 	// cull the entire model if merged bounding box of both frames
 	// is outside the view frustum.
-	R_CullMDV( model, ent );
+	R_CullMDV( job, model, ent );
 
 	if ( ent->cull == CULL_OUT )
 	{
@@ -330,7 +330,7 @@ void R_AddMDVSurfaces( trRefEntity_t *ent )
 			// don't add third_person objects if not viewing through a portal
 			if ( !personalModel )
 			{
-				R_AddDrawSurf( ( surfaceType_t * ) vboSurface, shader, -1, fogNum );
+				R_AddDrawSurf( job, ( surfaceType_t * ) vboSurface, shader, -1, fogNum );
 			}
 		}
 	}
@@ -345,7 +345,7 @@ void R_AddMDVSurfaces( trRefEntity_t *ent )
 			// don't add third_person objects if not viewing through a portal
 			if ( !personalModel )
 			{
-				R_AddDrawSurf( ( surfaceType_t * ) mdvSurface, shader, -1, fogNum );
+				R_AddDrawSurf( job, ( surfaceType_t * ) mdvSurface, shader, -1, fogNum );
 			}
 		}
 	}
@@ -356,7 +356,7 @@ void R_AddMDVSurfaces( trRefEntity_t *ent )
 R_AddMDVInteractions
 =================
 */
-void R_AddMDVInteractions( trRefEntity_t *ent, trRefLight_t *light, interactionType_t iaType )
+void R_AddMDVInteractions( frontEndJob_t *job, trRefEntity_t *ent, model_t *pModel, trRefLight_t *light, interactionType_t iaType )
 {
 	int               i;
 	mdvModel_t        *model = 0;
@@ -403,29 +403,17 @@ void R_AddMDVInteractions( trRefEntity_t *ent, trRefLight_t *light, interactionT
 	  tr.viewParms.portalLevel == 0;
 
 	// compute LOD
-	lod = R_ComputeLOD( ent );
+	lod = R_ComputeLOD( ent, pModel );
 
-	model = tr.currentModel->mdv[ lod ];
+	model = pModel->mdv[ lod ];
 
-	// do a quick AABB cull
-	if ( !BoundsIntersect( light->worldBounds[ 0 ], light->worldBounds[ 1 ], ent->worldBounds[ 0 ], ent->worldBounds[ 1 ] ) )
+	// cull against the light volume and its shadow cube sides
+	if ( R_CullLightEntity( light, ent, &cubeSideBits, &job->pc ) )
 	{
-		tr.pc.c_dlightSurfacesCulled += model->numSurfaces;
+		job->pc.c_dlightSurfacesCulled += model->numSurfaces;
 		return;
 	}
 
-	// do a more expensive and precise light frustum cull
-	if ( !r_noLightFrustums->integer )
-	{
-		if ( R_CullLightWorldBounds( light, ent->worldBounds ) == CULL_OUT )
-		{
-			tr.pc.c_dlightSurfacesCulled += model->numSurfaces;
-			return;
-		}
-	}
-
-	cubeSideBits = R_CalcLightCubeSideBits( light, ent->worldBounds );
-
 	// generate interactions with all surfaces
 	if ( r_vboModels->integer && model->numVBOSurfaces )
 	{
@@ -453,8 +441,8 @@ void R_AddMDVInteractions( trRefEntity_t *ent, trRefLight_t *light, interactionT
 			// don't add third_person objects if not viewing through a portal
 			if ( !personalModel )
 			{
-				R_AddLightInteraction( light, ( surfaceType_t * ) vboSurface, shader, cubeSideBits, iaType );
-				tr.pc.c_dlightSurfaces++;
+				R_AddLightInteraction( job, light, ( surfaceType_t * ) vboSurface, shader, cubeSideBits, iaType );
+				job->pc.c_dlightSurfaces++;
 			}
 		}
 	}
@@ -475,8 +463,8 @@ void R_AddMDVInteractions( trRefEntity_t *ent, trRefLight_t *light, interactionT
 			// don't add third_person objects if not viewing through a portal
 			if ( !personalModel )
 			{
-				R_AddLightInteraction( light, ( surfaceType_t * ) mdvSurface, shader, cubeSideBits, iaType );
-				tr.pc.c_dlightSurfaces++;
+				R_AddLightInteraction( job, light, ( surfaceType_t * ) mdvSurface, shader, cubeSideBits, iaType );
+				job->pc.c_dlightSurfaces++;
 			}
 		}
 	}
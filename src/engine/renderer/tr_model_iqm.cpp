@@ -894,10 +894,10 @@ bool R_LoadIQModel( model_t *mod, void *buffer, int filesize,
 R_CullIQM
 =============
 */
-static void R_CullIQM( trRefEntity_t *ent ) {
+static void R_CullIQM( frontEndJob_t *job, trRefEntity_t *ent, model_t *pModel ) {
 	vec3_t     localBounds[ 2 ];
 	float      scale = ent->e.skeleton.scale;
-	IQModel_t *model = tr.currentModel->iqm;
+	IQModel_t *model = pModel->iqm;
 	IQAnim_t  *anim = model->anims;
 	float     *bounds;
 
@@ -920,21 +920,21 @@ static void R_CullIQM( trRefEntity_t *ent ) {
 	VectorScale( localBounds[1], scale, ent->localBounds[ 1 ] );
 
 	
-	R_SetupEntityWorldBounds(ent);
+	R_SetupEntityWorldBounds( ent, &job->orientation );
 
-	switch ( R_CullBox( ent->worldBounds ) )
+	switch ( R_CullBox( ent->worldBounds, &job->pc ) )
 	{
 	case cullResult_t::CULL_IN:
-		tr.pc.c_box_cull_md5_in++;
+		job->pc.c_box_cull_md5_in++;
 		ent->cull = cullResult_t::CULL_IN;
 		return;
 	case cullResult_t::CULL_CLIP:
-		tr.pc.c_box_cull_md5_clip++;
+		job->pc.c_box_cull_md5_clip++;
 		ent->cull = cullResult_t::CULL_CLIP;
 		return;
 	case cullResult_t::CULL_OUT:
 	default:
-		tr.pc.c_box_cull_md5_out++;
+		job->pc.c_box_cull_md5_out++;
 		ent->cull = cullResult_t::CULL_OUT;
 		return;
 	}
@@ -947,7 +947,7 @@ R_AddIQMSurfaces
 Add all surfaces of this model
 =================
 */
-void R_AddIQMSurfaces( trRefEntity_t *ent ) {
+void R_AddIQMSurfaces( frontEndJob_t *job, trRefEntity_t *ent, model_t *pModel ) {
 	IQModel_t		*IQModel;
 	srfIQModel_t		*surface;
 	int                     i, j;
@@ -956,7 +956,7 @@ void R_AddIQMSurfaces( trRefEntity_t *ent ) {
 	shader_t                *shader;
 	skin_t                  *skin;
 
-	IQModel = tr.currentModel->iqm;
+	IQModel = pModel->iqm;
 	surface = IQModel->surfaces;
 
 	// don't add third_person objects if not in a portal
@@ -967,7 +967,7 @@ void R_AddIQMSurfaces( trRefEntity_t *ent ) {
 	// cull the entire model if merged bounding box of both frames
 	// is outside the view frustum.
 	//
-	R_CullIQM( ent );
+	R_CullIQM( job, ent, pModel );
 
 	if ( ent->cull == cullResult_t::CULL_OUT )
 	{
@@ -1023,7 +1023,7 @@ void R_AddIQMSurfaces( trRefEntity_t *ent ) {
 		// we will add shadows even if the main object isn't visible in the view
 
 		if( !personalModel ) {
-			R_AddDrawSurf( ( surfaceType_t *)surface, shader, -1, fogNum );
+			R_AddDrawSurf( job, ( surfaceType_t *)surface, shader, -1, fogNum );
 		}
 
 		surface++;
@@ -0,0 +1,604 @@
+/*
+===========================================================================
+Copyright (C) 2026 Daemon Developers
+
+This file is part of Daemon source code.
+
+Daemon source code is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the License,
+or (at your option) any later version.
+
+Daemon source code is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Daemon source code; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+===========================================================================
+*/
+// tr_occlusion.cpp -- software occlusion culling of the main view
+#include "tr_local.h"
+
+/*
+The large opaque faces of the world are picked as occluders when the map is
+loaded. Every frame, the ones that hide the most of the main view are drawn
+into a small depth buffer on the CPU, which is then reduced into a hierarchy
+of tiles. The bounds of the nodes and entities are tested against the tiles
+before they are added, so nothing has to be read back from the GPU.
+
+The buffer stores the inverse view depth of the farthest point of the
+occluders seen through each pixel, and only the pixels an occluder covers
+entirely are written. A box is tested with its nearest point, so it is only
+reported hidden when it is behind the occluders everywhere.
+*/
+
+static const int OCCLUSION_WIDTH = 256;
+static const int OCCLUSION_HEIGHT = 128;
+
+// the last level has 4x2 tiles
+static const int OCCLUSION_LEVELS = 7;
+
+// faces smaller than this, in square units, hide too little to be drawn
+static const float MIN_OCCLUDER_AREA = 64.0f * 64.0f;
+
+static const int MAX_FRAME_OCCLUDERS = 256;
+
+// a box is tested against at most this many tiles in each direction
+static const int MAX_TEST_TILES = 4;
+
+static_assert( OCCLUSION_WIDTH % 4 == 0, "rows are rasterized 4 pixels at a time" );
+static_assert( ( OCCLUSION_WIDTH >> ( OCCLUSION_LEVELS - 1 ) ) > 0 && ( OCCLUSION_HEIGHT >> ( OCCLUSION_LEVELS - 1 ) ) > 0,
+               "too many levels for the buffer size" );
+
+struct occluderVert_t
+{
+	vec3_t xyz;
+};
+
+struct occluder_t
+{
+	vec3_t     bounds[ 2 ];
+	vec3_t     center;
+	float      area;
+
+	// the face is only drawn from the sides its shader isn't culled from
+	cplane_t   plane;
+	cullType_t cullType;
+
+	int        firstVert; // three per triangle
+	int        numVerts;
+};
+
+// screen position and inverse view depth
+struct occlusionVert_t
+{
+	float x, y, w;
+};
+
+struct occlusionLevel_t
+{
+	int                width, height;
+	std::vector<float> depths;
+};
+
+static std::vector<occluder_t>            occluders;
+static std::vector<occluderVert_t>        occluderVerts;
+static std::vector<std::pair<float, int>> frameOccluders;
+
+static occlusionLevel_t occlusionLevels[ OCCLUSION_LEVELS ];
+
+// the view the buffer was drawn for
+static int    occlusionFrameCount = -1;
+static int    occlusionSceneNum = -1;
+static int    occlusionViewCount = -1;
+
+static vec3_t occlusionOrigin;
+static vec3_t occlusionAxis[ 3 ];
+static float  occlusionScaleX, occlusionScaleY;
+static float  occlusionZNear;
+
+/*
+=================
+R_IsOccluderShader
+
+Only the shaders which are always drawn opaque at the place of their surface
+can hide what is behind them
+=================
+*/
+static bool R_IsOccluderShader( const shader_t *shader )
+{
+	return shader->sort <= Util::ordinal( shaderSort_t::SS_OPAQUE ) &&
+	       shader->numStages &&
+	       !shader->alphaTest &&
+	       !shader->translucent &&
+	       !shader->isSky &&
+	       !shader->isPortal &&
+	       !shader->polygonOffset &&
+	       !shader->numDeforms &&
+	       !shader->autoSpriteMode &&
+	       !( shader->surfaceFlags & SURF_NODRAW );
+}
+
+/*
+=================
+R_BuildOccluders
+
+Copies the triangles of the large opaque faces of the world model
+=================
+*/
+void R_BuildOccluders( world_t *world )
+{
+	int numTriangles = 0;
+
+	occluders.clear();
+	occluderVerts.clear();
+	occlusionFrameCount = -1;
+
+	for ( int level = 0; level < OCCLUSION_LEVELS; level++ )
+	{
+		occlusionLevel_t &l = occlusionLevels[ level ];
+
+		l.width = OCCLUSION_WIDTH >> level;
+		l.height = OCCLUSION_HEIGHT >> level;
+		l.depths.assign( l.width * l.height, 0.0f );
+	}
+
+	if ( !world->numModels )
+	{
+		return;
+	}
+
+	const bspModel_t *model = &world->models[ 0 ];
+
+	for ( uint32_t i = 0; i < model->numSurfaces; i++ )
+	{
+		const bspSurface_t *surface = &model->firstSurface[ i ];
+
+		if ( *surface->data != surfaceType_t::SF_FACE || !R_IsOccluderShader( surface->shader ) )
+		{
+			continue;
+		}
+
+		const srfSurfaceFace_t *face = ( const srfSurfaceFace_t * ) surface->data;
+		float                  area = 0.0f;
+
+		for ( int j = 0; j < face->numTriangles; j++ )
+		{
+			const srfTriangle_t *tri = &face->triangles[ j ];
+			vec3_t              edge1, edge2, normal;
+
+			VectorSubtract( face->verts[ tri->indexes[ 1 ] ].xyz, face->verts[ tri->indexes[ 0 ] ].xyz, edge1 );
+			VectorSubtract( face->verts[ tri->indexes[ 2 ] ].xyz, face->verts[ tri->indexes[ 0 ] ].xyz, edge2 );
+			CrossProduct( edge1, edge2, normal );
+
+			area += 0.5f * VectorLength( normal );
+		}
+
+		if ( area < MIN_OCCLUDER_AREA )
+		{
+			continue;
+		}
+
+		occluder_t occluder;
+
+		VectorCopy( face->bounds[ 0 ], occluder.bounds[ 0 ] );
+		VectorCopy( face->bounds[ 1 ], occluder.bounds[ 1 ] );
+		VectorAdd( face->bounds[ 0 ], face->bounds[ 1 ], occluder.center );
+		VectorScale( occluder.center, 0.5f, occluder.center );
+		occluder.area = area;
+		occluder.plane = face->plane;
+		occluder.cullType = surface->shader->cullType;
+		occluder.firstVert = occluderVerts.size();
+		occluder.numVerts = face->numTriangles * 3;
+
+		for ( int j = 0; j < face->numTriangles; j++ )
+		{
+			for ( int k = 0; k < 3; k++ )
+			{
+				occluderVert_t vert;
+
+				VectorCopy( face->verts[ face->triangles[ j ].indexes[ k ] ].xyz, vert.xyz );
+				occluderVerts.push_back( vert );
+			}
+		}
+
+		numTriangles += face->numTriangles;
+		occluders.push_back( occluder );
+	}
+
+	Log::Debug( "%i occluders with %i triangles", occluders.size(), numTriangles );
+}
+
+/*
+=================
+R_RasterizeOccluderTriangle
+
+Writes the pixels the triangle covers entirely with the inverse depth of
+the farthest point of the triangle inside them
+=================
+*/
+static void R_RasterizeOccluderTriangle( const occlusionVert_t &v0, occlusionVert_t v1, occlusionVert_t v2 )
+{
+	float area = ( v1.x - v0.x ) * ( v2.y - v0.y ) - ( v1.y - v0.y ) * ( v2.x - v0.x );
+
+	// smaller than a pixel, it can't cover one entirely
+	if ( fabsf( area ) < 1.0f )
+	{
+		return;
+	}
+
+	// only triangles facing the view are drawn, but whether they project
+	// clockwise depends on the side of the face that is drawn
+	if ( area < 0.0f )
+	{
+		std::swap( v1, v2 );
+		area = -area;
+	}
+
+	float minX = std::max( std::min( { v0.x, v1.x, v2.x } ), 0.0f );
+	float maxX = std::min( std::max( { v0.x, v1.x, v2.x } ), float( OCCLUSION_WIDTH ) );
+	float minY = std::max( std::min( { v0.y, v1.y, v2.y } ), 0.0f );
+	float maxY = std::min( std::max( { v0.y, v1.y, v2.y } ), float( OCCLUSION_HEIGHT ) );
+
+	int x0 = int( ceilf( minX ) );
+	int x1 = int( floorf( maxX ) ) - 1;
+	int y0 = int( ceilf( minY ) );
+	int y1 = int( floorf( maxY ) ) - 1;
+
+	if ( x0 > x1 || y0 > y1 )
+	{
+		return;
+	}
+
+	// edge functions, positive inside, moved inwards by half a pixel so
+	// that they are only positive at the centers of the covered pixels
+	const occlusionVert_t *verts[ 3 ] = { &v0, &v1, &v2 };
+	float                 edgeA[ 3 ], edgeB[ 3 ], edgeC[ 3 ];
+
+	for ( int i = 0; i < 3; i++ )
+	{
+		const occlusionVert_t &a = *verts[ ( i + 1 ) % 3 ];
+		const occlusionVert_t &b = *verts[ ( i + 2 ) % 3 ];
+
+		edgeA[ i ] = a.y - b.y;
+		edgeB[ i ] = b.x - a.x;
+		edgeC[ i ] = -( edgeA[ i ] * a.x + edgeB[ i ] * a.y ) - 0.5f * ( fabsf( edgeA[ i ] ) + fabsf( edgeB[ i ] ) );
+	}
+
+	// the inverse depth is affine in screen space, the edge function of the
+	// opposite edge is the barycentric coordinate of a vertex times the area
+	float depthA = ( edgeA[ 0 ] * v0.w + edgeA[ 1 ] * v1.w + edgeA[ 2 ] * v2.w ) / area;
+	float depthB = ( edgeB[ 0 ] * v0.w + edgeB[ 1 ] * v1.w + edgeB[ 2 ] * v2.w ) / area;
+	float depthC = v0.w - depthA * v0.x - depthB * v0.y - 0.5f * ( fabsf( depthA ) + fabsf( depthB ) );
+	float depthMin = std::min( { v0.w, v1.w, v2.w } );
+
+	for ( int y = y0; y <= y1; y++ )
+	{
+		float cy = y + 0.5f;
+		float *row = occlusionLevels[ 0 ].depths.data() + y * OCCLUSION_WIDTH;
+
+#if idx86_sse
+		__m128 e0Row = _mm_set1_ps( edgeB[ 0 ] * cy + edgeC[ 0 ] );
+		__m128 e1Row = _mm_set1_ps( edgeB[ 1 ] * cy + edgeC[ 1 ] );
+		__m128 e2Row = _mm_set1_ps( edgeB[ 2 ] * cy + edgeC[ 2 ] );
+		__m128 depthRow = _mm_set1_ps( depthB * cy + depthC );
+		__m128 zero = _mm_setzero_ps();
+
+		// the pixels before x0 in the first group aren't covered, the edge
+		// functions reject them
+		for ( int x = x0 & ~3; x <= x1; x += 4 )
+		{
+			__m128 cx = _mm_add_ps( _mm_set1_ps( x + 0.5f ), _mm_set_ps( 3.0f, 2.0f, 1.0f, 0.0f ) );
+			__m128 e0 = _mm_add_ps( _mm_mul_ps( _mm_set1_ps( edgeA[ 0 ] ), cx ), e0Row );
+			__m128 e1 = _mm_add_ps( _mm_mul_ps( _mm_set1_ps( edgeA[ 1 ] ), cx ), e1Row );
+			__m128 e2 = _mm_add_ps( _mm_mul_ps( _mm_set1_ps( edgeA[ 2 ] ), cx ), e2Row );
+			__m128 inside = _mm_and_ps( _mm_and_ps( _mm_cmpge_ps( e0, zero ), _mm_cmpge_ps( e1, zero ) ),
+			                            _mm_cmpge_ps( e2, zero ) );
+
+			if ( !_mm_movemask_ps( inside ) )
+			{
+				continue;
+			}
+
+			__m128 depth = _mm_max_ps( _mm_add_ps( _mm_mul_ps( _mm_set1_ps( depthA ), cx ), depthRow ),
+			                           _mm_set1_ps( depthMin ) );
+			__m128 old = _mm_loadu_ps( row + x );
+			__m128 nearest = _mm_max_ps( old, depth );
+
+			_mm_storeu_ps( row + x, _mm_or_ps( _mm_and_ps( inside, nearest ), _mm_andnot_ps( inside, old ) ) );
+		}
+#else
+		for ( int x = x0; x <= x1; x++ )
+		{
+			float cx = x + 0.5f;
+
+			if ( edgeA[ 0 ] * cx + edgeB[ 0 ] * cy + edgeC[ 0 ] < 0.0f ||
+			     edgeA[ 1 ] * cx + edgeB[ 1 ] * cy + edgeC[ 1 ] < 0.0f ||
+			     edgeA[ 2 ] * cx + edgeB[ 2 ] * cy + edgeC[ 2 ] < 0.0f )
+			{
+				continue;
+			}
+
+			float depth = std::max( depthA * cx + depthB * cy + depthC, depthMin );
+
+			row[ x ] = std::max( row[ x ], depth );
+		}
+#endif
+	}
+}
+
+/*
+=================
+R_ProjectOcclusionVert
+=================
+*/
+static occlusionVert_t R_ProjectOcclusionVert( const vec3_t view )
+{
+	occlusionVert_t vert;
+
+	vert.w = 1.0f / view[ 0 ];
+	vert.x = 0.5f * OCCLUSION_WIDTH - view[ 1 ] * occlusionScaleX * vert.w;
+	vert.y = 0.5f * OCCLUSION_HEIGHT - view[ 2 ] * occlusionScaleY * vert.w;
+
+	return vert;
+}
+
+/*
+=================
+R_DrawOccluderTriangle
+
+Clips the triangle to the near plane in view space before rasterizing it
+=================
+*/
+static void R_DrawOccluderTriangle( const occluderVert_t *triangle )
+{
+	vec3_t view[ 3 ];
+	vec3_t clipped[ 4 ];
+	int    numClipped = 0;
+
+	for ( int i = 0; i < 3; i++ )
+	{
+		vec3_t delta;
+
+		VectorSubtract( triangle[ i ].xyz, occlusionOrigin, delta );
+
+		view[ i ][ 0 ] = DotProduct( delta, occlusionAxis[ 0 ] );
+		view[ i ][ 1 ] = DotProduct( delta, occlusionAxis[ 1 ] );
+		view[ i ][ 2 ] = DotProduct( delta, occlusionAxis[ 2 ] );
+	}
+
+	for ( int i = 0; i < 3; i++ )
+	{
+		const float *a = view[ i ];
+		const float *b = view[ ( i + 1 ) % 3 ];
+		bool        aInside = a[ 0 ] >= occlusionZNear;
+		bool        bInside = b[ 0 ] >= occlusionZNear;
+
+		if ( aInside )
+		{
+			VectorCopy( a, clipped[ numClipped++ ] );
+		}
+
+		if ( aInside != bInside )
+		{
+			float frac = ( occlusionZNear - a[ 0 ] ) / ( b[ 0 ] - a[ 0 ] );
+
+			VectorLerp( a, b, frac, clipped[ numClipped ] );
+			clipped[ numClipped++ ][ 0 ] = occlusionZNear;
+		}
+	}
+
+	if ( numClipped < 3 )
+	{
+		return;
+	}
+
+	occlusionVert_t first = R_ProjectOcclusionVert( clipped[ 0 ] );
+	occlusionVert_t previous = R_ProjectOcclusionVert( clipped[ 1 ] );
+
+	for ( int i = 2; i < numClipped; i++ )
+	{
+		occlusionVert_t current = R_ProjectOcclusionVert( clipped[ i ] );
+
+		R_RasterizeOccluderTriangle( first, previous, current );
+		previous = current;
+	}
+}
+
+/*
+=================
+R_BuildOcclusionBuffer
+
+Draws the occluders of the current view, must be called once its frustum
+is set up and before anything is culled
+=================
+*/
+void R_BuildOcclusionBuffer()
+{
+	occlusionFrameCount = -1;
+
+	if ( !r_occlusionCulling->integer || r_nocull->integer || occluders.empty() )
+	{
+		return;
+	}
+
+	VectorCopy( tr.viewParms.orientation.origin, occlusionOrigin );
+	VectorCopy( tr.viewParms.orientation.axis[ 0 ], occlusionAxis[ 0 ] );
+	VectorCopy( tr.viewParms.orientation.axis[ 1 ], occlusionAxis[ 1 ] );
+	VectorCopy( tr.viewParms.orientation.axis[ 2 ], occlusionAxis[ 2 ] );
+
+	occlusionScaleX = 0.5f * OCCLUSION_WIDTH / tanf( DEG2RAD( tr.viewParms.fovX * 0.5f ) );
+	occlusionScaleY = 0.5f * OCCLUSION_HEIGHT / tanf( DEG2RAD( tr.viewParms.fovY * 0.5f ) );
+	occlusionZNear = std::max( r_znear->value, 1.0f );
+
+	// keep the occluders that hide the most, by their area seen from the view
+	frameOccluders.clear();
+
+	for ( size_t i = 0; i < occluders.size(); i++ )
+	{
+		const occluder_t &occluder = occluders[ i ];
+		bool             culled = false;
+
+		// a face seen from its culled side isn't drawn, so it hides nothing
+		if ( occluder.cullType != CT_TWO_SIDED )
+		{
+			float d = DotProduct( occlusionOrigin, occluder.plane.normal ) - occluder.plane.dist;
+
+			if ( occluder.cullType == CT_FRONT_SIDED ? d <= 0.0f : d >= 0.0f )
+			{
+				continue;
+			}
+		}
+
+		for ( int j = 0; j < FRUSTUM_PLANES && !culled; j++ )
+		{
+			culled = BoxOnPlaneSide( occluder.bounds[ 0 ], occluder.bounds[ 1 ], &tr.viewParms.frustums[ 0 ][ j ] ) == 2;
+		}
+
+		if ( culled )
+		{
+			continue;
+		}
+
+		vec3_t delta;
+
+		VectorSubtract( occluder.center, occlusionOrigin, delta );
+		frameOccluders.emplace_back( occluder.area / ( DotProduct( delta, delta ) + 1.0f ), i );
+	}
+
+	if ( frameOccluders.size() > size_t( MAX_FRAME_OCCLUDERS ) )
+	{
+		std::nth_element( frameOccluders.begin(), frameOccluders.begin() + MAX_FRAME_OCCLUDERS, frameOccluders.end(),
+		                  std::greater<std::pair<float, int>>() );
+		frameOccluders.resize( MAX_FRAME_OCCLUDERS );
+	}
+
+	std::fill( occlusionLevels[ 0 ].depths.begin(), occlusionLevels[ 0 ].depths.end(), 0.0f );
+
+	for ( const std::pair<float, int> &frameOccluder : frameOccluders )
+	{
+		const occluder_t &occluder = occluders[ frameOccluder.second ];
+
+		for ( int i = 0; i < occluder.numVerts; i += 3 )
+		{
+			R_DrawOccluderTriangle( &occluderVerts[ occluder.firstVert + i ] );
+		}
+	}
+
+	// every tile keeps the farthest depth of the four below it
+	for ( int level = 1; level < OCCLUSION_LEVELS; level++ )
+	{
+		const occlusionLevel_t &below = occlusionLevels[ level - 1 ];
+		occlusionLevel_t       &l = occlusionLevels[ level ];
+
+		for ( int y = 0; y < l.height; y++ )
+		{
+			const float *row0 = below.depths.data() + 2 * y * below.width;
+			const float *row1 = row0 + below.width;
+			float       *out = l.depths.data() + y * l.width;
+
+			for ( int x = 0; x < l.width; x++ )
+			{
+				out[ x ] = std::min( std::min( row0[ 2 * x ], row0[ 2 * x + 1 ] ), std::min( row1[ 2 * x ], row1[ 2 * x + 1 ] ) );
+			}
+		}
+	}
+
+	tr.pc.c_occluders = frameOccluders.size();
+
+	occlusionFrameCount = tr.viewParms.frameCount;
+	occlusionSceneNum = tr.viewParms.frameSceneNum;
+	occlusionViewCount = tr.viewParms.viewCount;
+}
+
+/*
+=================
+R_BoxOccluded
+
+Returns true if the world space box is entirely hidden by the occluders of
+the current view. Boxes crossing the near plane are never hidden.
+=================
+*/
+bool R_BoxOccluded( const vec3_t mins, const vec3_t maxs, frontEndCounters_t *pc )
+{
+	if ( occlusionFrameCount != tr.viewParms.frameCount ||
+	     occlusionSceneNum != tr.viewParms.frameSceneNum ||
+	     occlusionViewCount != tr.viewParms.viewCount )
+	{
+		return false;
+	}
+
+	pc->c_occlusionTests++;
+
+	float minX = FLT_MAX, maxX = -FLT_MAX;
+	float minY = FLT_MAX, maxY = -FLT_MAX;
+	float nearest = 0.0f;
+
+	for ( int i = 0; i < 8; i++ )
+	{
+		vec3_t corner, delta;
+
+		corner[ 0 ] = ( i & 1 ) ? maxs[ 0 ] : mins[ 0 ];
+		corner[ 1 ] = ( i & 2 ) ? maxs[ 1 ] : mins[ 1 ];
+		corner[ 2 ] = ( i & 4 ) ? maxs[ 2 ] : mins[ 2 ];
+
+		VectorSubtract( corner, occlusionOrigin, delta );
+
+		float depth = DotProduct( delta, occlusionAxis[ 0 ] );
+
+		if ( depth < occlusionZNear )
+		{
+			return false;
+		}
+
+		float w = 1.0f / depth;
+		float x = 0.5f * OCCLUSION_WIDTH - DotProduct( delta, occlusionAxis[ 1 ] ) * occlusionScaleX * w;
+		float y = 0.5f * OCCLUSION_HEIGHT - DotProduct( delta, occlusionAxis[ 2 ] ) * occlusionScaleY * w;
+
+		minX = std::min( minX, x );
+		maxX = std::max( maxX, x );
+		minY = std::min( minY, y );
+		maxY = std::max( maxY, y );
+		nearest = std::max( nearest, w );
+	}
+
+	// the frustum decides for the boxes outside of the screen
+	if ( maxX < 0.0f || minX >= OCCLUSION_WIDTH || maxY < 0.0f || minY >= OCCLUSION_HEIGHT )
+	{
+		return false;
+	}
+
+	int x0 = std::max( minX, 0.0f );
+	int x1 = std::min( maxX, OCCLUSION_WIDTH - 1.0f );
+	int y0 = std::max( minY, 0.0f );
+	int y1 = std::min( maxY, OCCLUSION_HEIGHT - 1.0f );
+
+	int level = 0;
+
+	while ( level < OCCLUSION_LEVELS - 1 &&
+	        ( ( x1 >> level ) - ( x0 >> level ) >= MAX_TEST_TILES || ( y1 >> level ) - ( y0 >> level ) >= MAX_TEST_TILES ) )
+	{
+		level++;
+	}
+
+	const occlusionLevel_t &l = occlusionLevels[ level ];
+
+	for ( int y = y0 >> level; y <= y1 >> level; y++ )
+	{
+		const float *row = l.depths.data() + y * l.width;
+
+		for ( int x = x0 >> level; x <= x1 >> level; x++ )
+		{
+			if ( nearest >= row[ x ] )
+			{
+				return false;
+			}
+		}
+	}
+
+	pc->c_occlusion_cull_out++;
+	return true;
+}
@@ -128,22 +128,26 @@ Adds all the scene's polys into this view's drawsurf list
 */
 void R_AddPolygonSurfaces()
 {
-	int       i;
-	shader_t  *sh;
-	srfPoly_t *poly;
+	int           i;
+	shader_t      *sh;
+	srfPoly_t     *poly;
+	frontEndJob_t *job;
 
 	if ( !r_drawpolies->integer )
 	{
 		return;
 	}
 
-	tr.currentEntity = &tr.worldEntity;
+	job = R_GetFrontEndJob( 0 );
+	R_ClearFrontEndJob( job );
 
 	for ( i = 0, poly = tr.refdef.polys; i < tr.refdef.numPolys; i++, poly++ )
 	{
 		sh = R_GetShaderByHandle( poly->hShader );
-		R_AddDrawSurf( ( surfaceType_t * ) poly, sh, -1, poly->fogIndex );
+		R_AddDrawSurf( job, ( surfaceType_t * ) poly, sh, -1, poly->fogIndex );
 	}
+
+	R_MergeFrontEndJob( job );
 }
 
 /*
@@ -158,15 +162,19 @@ void R_AddPolygonBufferSurfaces()
 	int             i;
 	shader_t        *sh;
 	srfPolyBuffer_t *polybuffer;
+	frontEndJob_t   *job;
 
-	tr.currentEntity = &tr.worldEntity;
+	job = R_GetFrontEndJob( 0 );
+	R_ClearFrontEndJob( job );
 
 	for ( i = 0, polybuffer = tr.refdef.polybuffers; i < tr.refdef.numPolybuffers; i++, polybuffer++ )
 	{
 		sh = R_GetShaderByHandle( polybuffer->pPolyBuffer->shader );
 
-		R_AddDrawSurf( ( surfaceType_t * ) polybuffer, sh, -1, polybuffer->fogIndex );
+		R_AddDrawSurf( job, ( surfaceType_t * ) polybuffer, sh, -1, polybuffer->fogIndex );
 	}
+
+	R_MergeFrontEndJob( job );
 }
 
 /*
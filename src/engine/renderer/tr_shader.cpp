@@ -22,6 +22,7 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 */
 // tr_shader.c -- this file deals with the parsing and definition of shaders
 #include "tr_local.h"
+#include "common/FileSystem.h"
 #include "gl_shader.h"
 
 static const int MAX_SHADERTABLE_HASH = 1024;
@@ -1449,7 +1450,7 @@ static bool LoadMap( shaderStage_t *stage, const char *buffer )
 	}
 
 	// try to load the image
-	stage->bundle[ 0 ].image[ 0 ] = R_FindImageFile( buffer, imageBits, filterType, wrapType );
+	stage->bundle[ 0 ].image[ 0 ] = R_FindImageFileAsync( buffer, imageBits, filterType, wrapType );
 
 	if ( !stage->bundle[ 0 ].image[ 0 ] )
 	{
@@ -1581,7 +1582,7 @@ static bool ParseStage( shaderStage_t *stage, const char **text )
 				filterType = shader.filterType;
 			}
 
-			stage->bundle[ 0 ].image[ 0 ] = R_FindImageFile( token, imageBits, filterType, wrapTypeEnum_t::WT_CLAMP );
+			stage->bundle[ 0 ].image[ 0 ] = R_FindImageFileAsync( token, imageBits, filterType, wrapTypeEnum_t::WT_CLAMP );
 
 			if ( !stage->bundle[ 0 ].image[ 0 ] )
 			{
@@ -1618,7 +1619,7 @@ static bool ParseStage( shaderStage_t *stage, const char **text )
 
 				if ( num < MAX_IMAGE_ANIMATIONS )
 				{
-					stage->bundle[ 0 ].image[ num ] = R_FindImageFile( token, IF_NONE, filterType_t::FT_DEFAULT, wrapTypeEnum_t::WT_REPEAT );
+					stage->bundle[ 0 ].image[ num ] = R_FindImageFileAsync( token, IF_NONE, filterType_t::FT_DEFAULT, wrapTypeEnum_t::WT_REPEAT );
 
 					if ( !stage->bundle[ 0 ].image[ num ] )
 					{
@@ -4678,6 +4679,106 @@ bool RE_LoadDynamicShader( const char *shadername, const char *shadertext )
 
 //========================================================================================
 
+/*
+When the shader scripts haven't changed since the last start, the text of
+the shaders isn't loaded at all: a cached index gives the file, offset and
+length of every shader and only the shaders that get requested are read.
+*/
+
+static const uint32_t SHADER_INDEX_VERSION = 1;
+
+// there is only one index, the key in its header tells whether it is stale
+static const char SHADER_INDEX_PATH[] = "shaderindex.cache";
+
+struct shaderIndexEntry_t
+{
+	int        file;   // in shaderIndexFiles
+	int        offset; // of the text before the name, in the file as read
+	int        length; // up to the end of the braced section
+	const char *text;  // the compressed text once it was read
+};
+
+static bool                                                s_shaderIndexLoaded;
+static std::vector<std::string>                            shaderIndexFiles;
+static std::vector<std::string>                            shaderIndexFileTexts;
+static std::unordered_map<std::string, shaderIndexEntry_t> shaderIndex;
+
+/*
+====================
+R_ShaderIndexText
+
+Reads the text of a shader or table found in the index and prepares it
+like ScanAndLoadShaderFiles prepares the whole text
+====================
+*/
+static const char *R_ShaderIndexText( shaderIndexEntry_t &entry )
+{
+	if ( entry.text )
+	{
+		return entry.text;
+	}
+
+	std::string &fileText = shaderIndexFileTexts[ entry.file ];
+
+	if ( fileText.empty() )
+	{
+		std::string filename = "scripts/" + shaderIndexFiles[ entry.file ];
+		char        *buffer;
+		int         length = ri.FS_ReadFile( filename.c_str(), ( void ** ) &buffer );
+
+		if ( !buffer )
+		{
+			Log::Warn( "Couldn't load %s", filename );
+			return nullptr;
+		}
+
+		fileText.assign( buffer, length );
+		ri.FS_FreeFile( buffer );
+	}
+
+	if ( entry.offset < 0 || entry.length < 0 || size_t( entry.offset ) + entry.length > fileText.size() )
+	{
+		Log::Warn( "shader index doesn't match scripts/%s", shaderIndexFiles[ entry.file ] );
+		return nullptr;
+	}
+
+	char *text = ( char * ) ri.Hunk_Alloc( entry.length + 1, ha_pref::h_low );
+	memcpy( text, fileText.data() + entry.offset, entry.length );
+	text[ entry.length ] = '\0';
+
+	COM_FixPath( text );
+	COM_Compress( text );
+
+	entry.text = text;
+	return text;
+}
+
+/*
+====================
+FindShaderInShaderIndex
+====================
+*/
+static const char *FindShaderInShaderIndex( const char *shaderName )
+{
+	auto it = shaderIndex.find( Str::ToLower( shaderName ) );
+
+	if ( it == shaderIndex.end() )
+	{
+		return nullptr;
+	}
+
+	const char *p = R_ShaderIndexText( it->second );
+
+	if ( !p )
+	{
+		return nullptr;
+	}
+
+	// step over the name
+	COM_ParseExt2( &p, true );
+	return p;
+}
+
 /*
 ====================
 FindShaderInShaderText
@@ -4696,6 +4797,11 @@ static const char    *FindShaderInShaderText( const char *shaderName )
 
 	int  i, hash;
 
+	if ( s_shaderIndexLoaded )
+	{
+		return FindShaderInShaderIndex( shaderName );
+	}
+
 	hash = generateHashValue( shaderName, MAX_SHADERTEXT_HASH );
 
 	for ( i = 0; shaderTextHashTable[ hash ][ i ]; i++ )
@@ -5329,6 +5435,309 @@ void R_ShaderExp_f()
 	Log::Notice("------------------" );
 }
 
+/*
+====================
+ParseShaderTable
+
+Parses a table definition, p points after the "table" keyword
+====================
+*/
+static void ParseShaderTable( const char **p )
+{
+	const char    *token;
+	int           depth;
+	float         values[ FUNCTABLE_SIZE ];
+	int           numValues;
+	shaderTable_t *tb;
+	bool      alreadyCreated;
+	int           hash;
+
+	Com_Memset( &table, 0, sizeof( table ) );
+
+	token = COM_ParseExt2( p, true );
+
+	Q_strncpyz( table.name, token, sizeof( table.name ) );
+
+	// check if already created
+	alreadyCreated = false;
+	hash = generateHashValue( table.name, MAX_SHADERTABLE_HASH );
+
+	for ( tb = shaderTableHashTable[ hash ]; tb; tb = tb->next )
+	{
+		if ( Q_stricmp( tb->name, table.name ) == 0 )
+		{
+			// match found
+			alreadyCreated = true;
+			break;
+		}
+	}
+
+	depth = 0;
+	numValues = 0;
+
+	do
+	{
+		token = COM_ParseExt2( p, true );
+
+		if ( !Q_stricmp( token, "snap" ) )
+		{
+			table.snap = true;
+		}
+		else if ( !Q_stricmp( token, "clamp" ) )
+		{
+			table.clamp = true;
+		}
+		else if ( token[ 0 ] == '{' )
+		{
+			depth++;
+		}
+		else if ( token[ 0 ] == '}' )
+		{
+			depth--;
+		}
+		else if ( token[ 0 ] == ',' )
+		{
+			continue;
+		}
+		else
+		{
+			if ( numValues == FUNCTABLE_SIZE )
+			{
+				Log::Warn("FUNCTABLE_SIZE hit" );
+				break;
+			}
+
+			values[ numValues++ ] = atof( token );
+		}
+	}
+	while ( depth && *p );
+
+	if ( !alreadyCreated )
+	{
+		Log::Debug("...generating '%s'", table.name );
+		GeneratePermanentShaderTable( values, numValues );
+	}
+}
+
+struct shaderIndexHeader_t
+{
+	uint32_t version;
+	uint32_t key;
+	int32_t  numFiles;
+	int32_t  numTables;
+	int32_t  numShaders;
+};
+
+struct shaderIndexRecord_t
+{
+	int32_t file;
+	int32_t offset;
+	int32_t length;
+};
+
+/*
+====================
+R_ShaderIndexKey
+
+Checksums the list of shader files and where each of them comes from, any
+change to a pak or to a file in the home path gives another key
+====================
+*/
+static uint32_t R_ShaderIndexKey( char **shaderFiles, int numShaderFiles )
+{
+	std::string key;
+
+	for ( int i = 0; i < numShaderFiles; i++ )
+	{
+		std::string     path = Str::Format( "scripts/%s", shaderFiles[ i ] );
+		std::error_code err;
+
+		key += path;
+		key += '\0';
+
+		if ( const FS::LoadedPakInfo *pak = FS::PakPath::LocateFile( path ) )
+		{
+			key += Str::Format( "%s_%s_%u_", pak->name, pak->version,
+			                    pak->realChecksum ? *pak->realChecksum : pak->checksum ? *pak->checksum : 0 );
+
+			auto timestamp = FS::PakPath::FileTimestamp( path, err );
+
+			if ( !err )
+			{
+				key += std::to_string( timestamp.time_since_epoch().count() );
+			}
+		}
+
+		auto timestamp = FS::HomePath::FileTimestamp( path, err );
+
+		if ( !err )
+		{
+			key += "_" + std::to_string( timestamp.time_since_epoch().count() );
+		}
+
+		key += '\0';
+	}
+
+	return Com_BlockChecksum( key.data(), key.size() );
+}
+
+/*
+====================
+R_LoadShaderIndex
+
+Loads the index of the shader scripts and parses the tables it lists
+====================
+*/
+static bool R_LoadShaderIndex( uint32_t key )
+{
+	shaderIndexHeader_t header;
+	std::error_code     err;
+
+	FS::File file = FS::HomePath::OpenRead( SHADER_INDEX_PATH, err );
+
+	if ( err )
+	{
+		return false;
+	}
+
+	std::string data = file.ReadAll( err );
+
+	if ( err || data.size() < sizeof( header ) )
+	{
+		return false;
+	}
+
+	memcpy( &header, data.data(), sizeof( header ) );
+
+	if ( header.version != SHADER_INDEX_VERSION || header.key != key
+	     || header.numFiles < 0 || header.numTables < 0 || header.numShaders < 0 )
+	{
+		return false;
+	}
+
+	size_t numRecords = size_t( header.numTables ) + header.numShaders;
+	size_t offset = sizeof( header ) + numRecords * sizeof( shaderIndexRecord_t );
+
+	if ( offset > data.size() )
+	{
+		return false;
+	}
+
+	// the names follow the records, the file names then the table and shader names
+	std::vector<std::string> names;
+
+	while ( offset < data.size() )
+	{
+		size_t end = data.find( '\0', offset );
+
+		if ( end == std::string::npos )
+		{
+			return false;
+		}
+
+		names.emplace_back( data, offset, end - offset );
+		offset = end + 1;
+	}
+
+	if ( names.size() != header.numFiles + numRecords )
+	{
+		return false;
+	}
+
+	std::vector<shaderIndexRecord_t> records( numRecords );
+
+	if ( numRecords )
+	{
+		memcpy( records.data(), data.data() + sizeof( header ), numRecords * sizeof( shaderIndexRecord_t ) );
+	}
+
+	for ( const shaderIndexRecord_t &record : records )
+	{
+		if ( record.file < 0 || record.file >= header.numFiles )
+		{
+			return false;
+		}
+	}
+
+	shaderIndexFiles.assign( names.begin(), names.begin() + header.numFiles );
+	shaderIndexFileTexts.assign( header.numFiles, std::string() );
+	shaderIndex.clear();
+	shaderIndex.reserve( header.numShaders );
+
+	for ( size_t i = header.numTables; i < numRecords; i++ )
+	{
+		const shaderIndexRecord_t &record = records[ i ];
+
+		shaderIndex.emplace( names[ header.numFiles + i ], shaderIndexEntry_t{ record.file, record.offset, record.length, nullptr } );
+	}
+
+	s_shaderIndexLoaded = true;
+
+	// the tables are needed whatever the shaders used
+	for ( int i = 0; i < header.numTables; i++ )
+	{
+		shaderIndexEntry_t entry{ records[ i ].file, records[ i ].offset, records[ i ].length, nullptr };
+		const char         *p = R_ShaderIndexText( entry );
+
+		if ( p )
+		{
+			// step over the "table" keyword
+			COM_ParseExt2( &p, true );
+			ParseShaderTable( &p );
+		}
+	}
+
+	return true;
+}
+
+/*
+====================
+R_SaveShaderIndex
+====================
+*/
+static void R_SaveShaderIndex( uint32_t key, char **shaderFiles, int numShaderFiles,
+                               const std::vector<std::pair<std::string, shaderIndexRecord_t>> &tables,
+                               const std::vector<std::pair<std::string, shaderIndexRecord_t>> &shaders )
+{
+	shaderIndexHeader_t header;
+	std::string         data;
+
+	header.version = SHADER_INDEX_VERSION;
+	header.key = key;
+	header.numFiles = numShaderFiles;
+	header.numTables = tables.size();
+	header.numShaders = shaders.size();
+
+	data.append( reinterpret_cast<const char *>( &header ), sizeof( header ) );
+
+	for ( const auto &record : tables )
+	{
+		data.append( reinterpret_cast<const char *>( &record.second ), sizeof( record.second ) );
+	}
+
+	for ( const auto &record : shaders )
+	{
+		data.append( reinterpret_cast<const char *>( &record.second ), sizeof( record.second ) );
+	}
+
+	for ( int i = 0; i < numShaderFiles; i++ )
+	{
+		data.append( shaderFiles[ i ], strlen( shaderFiles[ i ] ) + 1 );
+	}
+
+	for ( const auto &record : tables )
+	{
+		data.append( record.first.c_str(), record.first.size() + 1 );
+	}
+
+	for ( const auto &record : shaders )
+	{
+		data.append( record.first.c_str(), record.first.size() + 1 );
+	}
+
+	ri.FS_WriteFile( SHADER_INDEX_PATH, data.data(), data.size() );
+}
+
 /*
 ====================
 ScanAndLoadShaderFiles
@@ -5351,9 +5760,22 @@ static void ScanAndLoadShaderFiles()
 	int  shaderTextHashTableSizes[ MAX_SHADERTEXT_HASH ], hash, size;
 	char filename[ MAX_QPATH ];
 	long sum = 0, summand;
+	int  startTime;
+	uint32_t indexKey = 0;
+
+	// the text and index of the shaders of each file, in file order
+	std::vector<std::vector<std::pair<std::string, shaderIndexRecord_t>>> fileTables, fileShaders;
 
 	Log::Debug("----- ScanAndLoadShaderFiles -----" );
 
+	startTime = ri.Milliseconds();
+
+	s_shaderText = nullptr;
+	s_shaderIndexLoaded = false;
+	shaderIndex.clear();
+	shaderIndexFiles.clear();
+	shaderIndexFileTexts.clear();
+
 	// scan for shader files
 	shaderFiles = ri.FS_ListFiles( "scripts", ".shader", &numShaderFiles );
 
@@ -5367,6 +5789,23 @@ static void ScanAndLoadShaderFiles()
 		numShaderFiles = MAX_SHADER_FILES;
 	}
 
+	if ( r_shaderIndex->integer )
+	{
+		indexKey = R_ShaderIndexKey( shaderFiles, numShaderFiles );
+
+		if ( R_LoadShaderIndex( indexKey ) )
+		{
+			ri.FS_FreeFileList( shaderFiles );
+
+			Log::Debug( "%i shaders indexed, shader scripts loaded from the index in %i msec",
+			            shaderIndex.size(), ri.Milliseconds() - startTime );
+			return;
+		}
+	}
+
+	fileTables.resize( numShaderFiles );
+	fileShaders.resize( numShaderFiles );
+
 	// load and parse shader files
 	for ( i = 0; i < numShaderFiles; i++ )
 	{
@@ -5384,6 +5823,9 @@ static void ScanAndLoadShaderFiles()
 
 		while ( 1 )
 		{
+			bool isTable = false;
+
+			oldp = p;
 			token = COM_ParseExt2( &p, true );
 
 			if ( !*token )
@@ -5391,6 +5833,8 @@ static void ScanAndLoadShaderFiles()
 				break;
 			}
 
+			std::string name = token;
+
 			// Step over the "table" and the name
 			if ( !Q_stricmp( token, "table" ) )
 			{
@@ -5400,6 +5844,9 @@ static void ScanAndLoadShaderFiles()
 				{
 					break;
 				}
+
+				isTable = true;
+				name = token;
 			}
 
 			token = COM_ParseExt2( &p, true );
@@ -5411,6 +5858,13 @@ static void ScanAndLoadShaderFiles()
 				buffers[ i ] = nullptr;
 				break;
 			}
+
+			shaderIndexRecord_t record{ i, int32_t( oldp - buffers[ i ] ), int32_t( p - oldp ) };
+
+			// the names are looked up in the unixified text
+			std::replace( name.begin(), name.end(), '\\', '/' );
+
+			( isTable ? fileTables : fileShaders )[ i ].emplace_back( Str::ToLower( name ), record );
 		}
 
 		if ( buffers[ i ] )
@@ -5419,6 +5873,33 @@ static void ScanAndLoadShaderFiles()
 		}
 	}
 
+	if ( r_shaderIndex->integer )
+	{
+		// the files are searched from the last one, and each file from its start
+		std::vector<std::pair<std::string, shaderIndexRecord_t>> tables, shaders;
+		std::unordered_set<std::string>                          indexed;
+
+		for ( i = numShaderFiles - 1; i >= 0; i-- )
+		{
+			if ( !buffers[ i ] )
+			{
+				continue;
+			}
+
+			tables.insert( tables.end(), fileTables[ i ].begin(), fileTables[ i ].end() );
+
+			for ( const auto &record : fileShaders[ i ] )
+			{
+				if ( indexed.insert( record.first ).second )
+				{
+					shaders.push_back( record );
+				}
+			}
+		}
+
+		R_SaveShaderIndex( indexKey, shaderFiles, numShaderFiles, tables, shaders );
+	}
+
 	// build single large buffer
 	s_shaderText = (char*) ri.Hunk_Alloc( sum + numShaderFiles * 2, ha_pref::h_low );
 	s_shaderText[ 0 ] = '\0';
@@ -5506,77 +5987,7 @@ static void ScanAndLoadShaderFiles()
 		// parse shader tables
 		if ( !Q_stricmp( token, "table" ) )
 		{
-			int           depth;
-			float         values[ FUNCTABLE_SIZE ];
-			int           numValues;
-			shaderTable_t *tb;
-			bool      alreadyCreated;
-
-			Com_Memset( &table, 0, sizeof( table ) );
-
-			token = COM_ParseExt2( &p, true );
-
-			Q_strncpyz( table.name, token, sizeof( table.name ) );
-
-			// check if already created
-			alreadyCreated = false;
-			hash = generateHashValue( table.name, MAX_SHADERTABLE_HASH );
-
-			for ( tb = shaderTableHashTable[ hash ]; tb; tb = tb->next )
-			{
-				if ( Q_stricmp( tb->name, table.name ) == 0 )
-				{
-					// match found
-					alreadyCreated = true;
-					break;
-				}
-			}
-
-			depth = 0;
-			numValues = 0;
-
-			do
-			{
-				token = COM_ParseExt2( &p, true );
-
-				if ( !Q_stricmp( token, "snap" ) )
-				{
-					table.snap = true;
-				}
-				else if ( !Q_stricmp( token, "clamp" ) )
-				{
-					table.clamp = true;
-				}
-				else if ( token[ 0 ] == '{' )
-				{
-					depth++;
-				}
-				else if ( token[ 0 ] == '}' )
-				{
-					depth--;
-				}
-				else if ( token[ 0 ] == ',' )
-				{
-					continue;
-				}
-				else
-				{
-					if ( numValues == FUNCTABLE_SIZE )
-					{
-						Log::Warn("FUNCTABLE_SIZE hit" );
-						break;
-					}
-
-					values[ numValues++ ] = atof( token );
-				}
-			}
-			while ( depth && p );
-
-			if ( !alreadyCreated )
-			{
-				Log::Debug("...generating '%s'", table.name );
-				GeneratePermanentShaderTable( values, numValues );
-			}
+			ParseShaderTable( &p );
 		}
 		else
 		{
@@ -5586,6 +5997,8 @@ static void ScanAndLoadShaderFiles()
 			SkipBracedSection( &p );
 		}
 	}
+
+	Log::Debug( "shader scripts scanned in %i msec", ri.Milliseconds() - startTime );
 }
 
 /*
@@ -0,0 +1,315 @@
+/*
+===========================================================================
+Copyright (C) 2026 Daemon Developers
+
+This file is part of Daemon source code.
+
+Daemon source code is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the License,
+or (at your option) any later version.
+
+Daemon source code is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Daemon source code; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+===========================================================================
+*/
+// tr_sort.cpp -- sorting of the draw surfaces of a view
+#include "tr_local.h"
+
+/*
+The draw surfaces are sorted through compact (key, index) pairs and moved
+to their place once at the end. The pairs are sorted with an LSD radix sort
+whose digits follow the fields of the sort key, so the histogram of the
+shader digit also gives the range of every shaderSort_t.
+
+The main view mostly draws the same surfaces in the same order from one
+frame to the next, so the order found in the previous frame is tried first.
+If it is still sorted or nearly so, the few runs it leaves are merged
+instead of sorting everything again.
+*/
+
+struct sortKeyDigit_t
+{
+	int shift;
+	int bits;
+};
+
+static const sortKeyDigit_t sortKeyDigits[] =
+{
+	{ 0, 8 },  // index, low byte
+	{ 8, 8 },  // index, high byte
+	{ SORT_FOGNUM_SHIFT, SORT_FOGNUM_BITS },
+	{ SORT_ENTITYNUM_SHIFT, SORT_ENTITYNUM_BITS },
+	{ SORT_LIGHTMAP_SHIFT, SORT_LIGHTMAP_BITS },
+	{ SORT_SHADER_SHIFT, SORT_SHADER_BITS },
+};
+
+static const int NUM_SORT_KEY_DIGITS = ARRAY_LEN( sortKeyDigits );
+static const int SHADER_DIGIT = NUM_SORT_KEY_DIGITS - 1;
+
+static_assert( SORT_INDEX_BITS == 16, "index digits don't cover the index bits" );
+static_assert( SORT_SHADER_SHIFT + SORT_SHADER_BITS == 64, "shader digit must be the most significant one" );
+
+// below this many surfaces a comparison sort is cheaper than clearing the histograms
+static const int MIN_RADIX_SORT_SURFS = 256;
+
+// the previous order is only worth merging if it leaves few runs
+static const int MAX_COHERENT_RUNS_FRACTION = 32;
+
+struct sortKey_t
+{
+	uint64_t key;
+	int      index;
+};
+
+static std::vector<sortKey_t>  sortKeys;
+static std::vector<sortKey_t>  sortKeysTemp;
+static std::vector<int>        sortRunStarts;
+static std::vector<uint32_t>   sortHistograms[ NUM_SORT_KEY_DIGITS ];
+static std::vector<uint32_t>   sortOffsets;
+static std::vector<drawSurf_t> sortedDrawSurfs;
+
+// the order of the last main view
+static std::vector<int>        previousOrder;
+
+static inline uint32_t R_SortKeyDigit( uint64_t key, int digit )
+{
+	return ( key >> sortKeyDigits[ digit ].shift ) & ( ( 1u << sortKeyDigits[ digit ].bits ) - 1 );
+}
+
+/*
+=================
+R_CountSortKeys
+
+Fills the histograms of the digits and collects the positions where the
+keys stop being in order. Only the shader digit is needed when the keys
+won't be radix sorted.
+=================
+*/
+static void R_CountSortKeys( int numKeys, bool allDigits )
+{
+	int firstDigit = allDigits ? 0 : SHADER_DIGIT;
+
+	for ( int digit = firstDigit; digit < NUM_SORT_KEY_DIGITS; digit++ )
+	{
+		// shader numbers are sorted indexes, they can't go above numShaders
+		size_t size = digit == SHADER_DIGIT ? tr.numShaders : 1u << sortKeyDigits[ digit ].bits;
+
+		sortHistograms[ digit ].assign( size, 0 );
+	}
+
+	sortRunStarts.clear();
+	sortRunStarts.push_back( 0 );
+
+	for ( int i = 0; i < numKeys; i++ )
+	{
+		uint64_t key = sortKeys[ i ].key;
+
+		for ( int digit = firstDigit; digit < NUM_SORT_KEY_DIGITS; digit++ )
+		{
+			sortHistograms[ digit ][ R_SortKeyDigit( key, digit ) ]++;
+		}
+
+		if ( i > 0 && key < sortKeys[ i - 1 ].key )
+		{
+			sortRunStarts.push_back( i );
+		}
+	}
+
+	sortRunStarts.push_back( numKeys );
+}
+
+/*
+=================
+R_RadixSortKeys
+=================
+*/
+static void R_RadixSortKeys( int numKeys )
+{
+	sortKeysTemp.resize( numKeys );
+
+	for ( int digit = 0; digit < NUM_SORT_KEY_DIGITS; digit++ )
+	{
+		std::vector<uint32_t> &histogram = sortHistograms[ digit ];
+
+		// all the keys share this digit, the pass wouldn't move anything
+		if ( histogram[ R_SortKeyDigit( sortKeys[ 0 ].key, digit ) ] == uint32_t( numKeys ) )
+		{
+			continue;
+		}
+
+		// the counts of the shader digit are still needed afterwards
+		uint32_t offset = 0;
+
+		sortOffsets.resize( histogram.size() );
+
+		for ( size_t i = 0; i < histogram.size(); i++ )
+		{
+			sortOffsets[ i ] = offset;
+			offset += histogram[ i ];
+		}
+
+		for ( int i = 0; i < numKeys; i++ )
+		{
+			const sortKey_t &sortKey = sortKeys[ i ];
+
+			sortKeysTemp[ sortOffsets[ R_SortKeyDigit( sortKey.key, digit ) ]++ ] = sortKey;
+		}
+
+		std::swap( sortKeys, sortKeysTemp );
+	}
+}
+
+/*
+=================
+R_MergeSortKeyRuns
+
+Merges the ascending runs found by R_CountSortKeys two by two
+=================
+*/
+static void R_MergeSortKeyRuns( int numKeys )
+{
+	auto compare = []( const sortKey_t &a, const sortKey_t &b ) {
+		return a.key < b.key;
+	};
+
+	sortKeysTemp.resize( numKeys );
+
+	while ( sortRunStarts.size() > 2 )
+	{
+		size_t numRuns = sortRunStarts.size() - 1;
+		size_t numMerged = 0;
+
+		for ( size_t run = 0; run < numRuns; run += 2 )
+		{
+			sortKey_t *first = sortKeys.data() + sortRunStarts[ run ];
+			sortKey_t *middle = sortKeys.data() + sortRunStarts[ std::min( run + 1, numRuns ) ];
+			sortKey_t *last = sortKeys.data() + sortRunStarts[ std::min( run + 2, numRuns ) ];
+
+			std::merge( first, middle, middle, last, sortKeysTemp.data() + sortRunStarts[ run ], compare );
+
+			sortRunStarts[ numMerged++ ] = sortRunStarts[ run ];
+		}
+
+		sortRunStarts[ numMerged++ ] = numKeys;
+		sortRunStarts.resize( numMerged );
+
+		std::swap( sortKeys, sortKeysTemp );
+	}
+}
+
+/*
+=================
+R_SortDrawSurfList
+
+Sorts the draw surfaces of a view by their sort key and fills firstDrawSurf
+with the offset of the first surface of each shaderSort_t. When coherent is
+set the order of the previous call with coherent set is tried first.
+=================
+*/
+void R_SortDrawSurfList( drawSurf_t *drawSurfs, int numDrawSurfs, int *firstDrawSurf, bool coherent )
+{
+	int       i;
+	int       sort;
+	shader_t  *shader;
+
+	bool      radixSort = numDrawSurfs >= MIN_RADIX_SORT_SURFS;
+	bool      usePreviousOrder = coherent && radixSort && previousOrder.size() == size_t( numDrawSurfs );
+
+	sortKeys.resize( numDrawSurfs );
+
+	for ( i = 0; i < numDrawSurfs; i++ )
+	{
+		int index = usePreviousOrder ? previousOrder[ i ] : i;
+
+		sortKeys[ i ].key = drawSurfs[ index ].sort;
+		sortKeys[ i ].index = index;
+	}
+
+	R_CountSortKeys( numDrawSurfs, radixSort );
+
+	size_t numRuns = sortRunStarts.size() - 1;
+
+	if ( numRuns > 1 )
+	{
+		if ( usePreviousOrder && numRuns <= size_t( numDrawSurfs / MAX_COHERENT_RUNS_FRACTION ) )
+		{
+			R_MergeSortKeyRuns( numDrawSurfs );
+		}
+		else if ( radixSort )
+		{
+			R_RadixSortKeys( numDrawSurfs );
+		}
+		else
+		{
+			std::sort( sortKeys.begin(), sortKeys.end(),
+			           []( const sortKey_t &a, const sortKey_t &b ) {
+			               return a.key < b.key;
+			           } );
+		}
+	}
+
+	// the keys were gathered in the previous order, so the surfaces need to be
+	// moved even when that order turned out to be sorted already
+	if ( numRuns > 1 || usePreviousOrder )
+	{
+		sortedDrawSurfs.resize( numDrawSurfs );
+
+		for ( i = 0; i < numDrawSurfs; i++ )
+		{
+			sortedDrawSurfs[ i ] = drawSurfs[ sortKeys[ i ].index ];
+		}
+
+		std::copy( sortedDrawSurfs.begin(), sortedDrawSurfs.end(), drawSurfs );
+	}
+
+	// remember the order unless it is the one that was just reused as is
+	if ( coherent && radixSort && !( usePreviousOrder && numRuns == 1 ) )
+	{
+		previousOrder.resize( numDrawSurfs );
+
+		for ( i = 0; i < numDrawSurfs; i++ )
+		{
+			previousOrder[ i ] = sortKeys[ i ].index;
+		}
+	}
+
+	// compute the offsets of the first surface of each SS_* type from the
+	// number of surfaces using each shader, sorted shaders are ordered by sort
+	const std::vector<uint32_t> &shaderCounts = sortHistograms[ SHADER_DIGIT ];
+	int                         numSorts = Util::ordinal( shaderSort_t::SS_NUM_SORTS );
+	int                         sortCounts[ Util::ordinal( shaderSort_t::SS_NUM_SORTS ) ] = {};
+
+	for ( size_t shaderNum = 0; shaderNum < shaderCounts.size(); shaderNum++ )
+	{
+		if ( !shaderCounts[ shaderNum ] )
+		{
+			continue;
+		}
+
+		shader = tr.sortedShaders[ shaderNum ];
+
+		// no shader should ever have this sort type
+		if ( shader->sort == Util::ordinal(shaderSort_t::SS_BAD) )
+		{
+			ri.Error(errorParm_t::ERR_DROP, "Shader '%s'with sort == SS_BAD", shader->name );
+		}
+
+		// a surface is counted before the sort types its shader sort is strictly above
+		sort = Math::Clamp( int( ceilf( shader->sort ) ), 0, numSorts - 1 );
+		sortCounts[ sort ] += shaderCounts[ shaderNum ];
+	}
+
+	firstDrawSurf[ 0 ] = 0;
+
+	for ( sort = 0; sort < numSorts; sort++ )
+	{
+		firstDrawSurf[ sort + 1 ] = firstDrawSurf[ sort ] + sortCounts[ sort ];
+	}
+}
@@ -22,6 +22,7 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 */
 // tr_surface.c
 #include "tr_local.h"
+#include "common/ThreadPool.h"
 
 /*
 ==============================================================================
@@ -1089,6 +1090,227 @@ static void Tess_SurfaceMDV( mdvSurface_t *srf )
 	tess.numVertexes += numVertexes;
 }
 
+/*
+==============================================================================
+CPU SKINNING
+
+The bone transforms are converted to matrices once per surface, then each
+vertex blends the matrices of the bones influencing it and transforms its
+attributes with the result. The matrix columns are SSE vectors, so both
+the blending and the transforms use the full vector width. Large meshes
+are split over the skinning threads, each one writing its own range of
+tess.verts.
+==============================================================================
+*/
+
+struct skinMatrix_t
+{
+	vec4_t point[ 4 ]; // scaled rotation columns, then translation
+	vec4_t normal[ 3 ]; // rotation columns only, like TransformNormalVector
+};
+
+static ALIGNED( 16, skinMatrix_t skinMatrices[ MAX_BONES ] );
+
+struct skinVertex_t
+{
+	const float *position;
+	const float *normal;
+	const float *tangent;
+	const float *binormal;
+
+	int   numWeights;
+	int   boneIndexes[ MAX_WEIGHTS ];
+	float boneWeights[ MAX_WEIGHTS ];
+};
+
+// below this many vertexes per thread it is cheaper to skin on one thread
+static const int MIN_SKINNING_JOB_VERTEXES = 1024;
+
+static Sys::ThreadPool skinningPool;
+
+/*
+==============
+R_BuildSkinMatrices
+==============
+*/
+static void R_BuildSkinMatrices( const transform_t *transforms, int numBones )
+{
+	static const vec3_t axis[ 3 ] = { { 1, 0, 0 }, { 0, 1, 0 }, { 0, 0, 1 } };
+
+	for ( int i = 0; i < numBones; i++ )
+	{
+		const transform_t *t = &transforms[ i ];
+		skinMatrix_t      *m = &skinMatrices[ i ];
+
+		for ( int j = 0; j < 3; j++ )
+		{
+			TransformNormalVector( t, axis[ j ], m->normal[ j ] );
+			m->normal[ j ][ 3 ] = 0.0f;
+
+			VectorScale( m->normal[ j ], t->scale, m->point[ j ] );
+			m->point[ j ][ 3 ] = 0.0f;
+		}
+
+		VectorCopy( t->trans, m->point[ 3 ] );
+		m->point[ 3 ][ 3 ] = 0.0f;
+	}
+}
+
+/*
+==============
+R_SkinVertex
+
+Writes the position and, unless skipped, the qtangents of the vertex
+==============
+*/
+static void R_SkinVertex( const skinVertex_t *in, bool tangentSpaces, shaderVertex_t *out )
+{
+	vec3_t normal, tangent, binormal;
+
+#if idx86_sse
+	__m128 p0 = _mm_setzero_ps(), p1 = p0, p2 = p0, p3 = p0;
+	__m128 n0 = p0, n1 = p0, n2 = p0;
+
+	for ( int k = 0; k < in->numWeights; k++ )
+	{
+		const skinMatrix_t *m = &skinMatrices[ in->boneIndexes[ k ] ];
+		__m128             w = _mm_set1_ps( in->boneWeights[ k ] );
+
+		p0 = _mm_add_ps( p0, _mm_mul_ps( w, _mm_load_ps( m->point[ 0 ] ) ) );
+		p1 = _mm_add_ps( p1, _mm_mul_ps( w, _mm_load_ps( m->point[ 1 ] ) ) );
+		p2 = _mm_add_ps( p2, _mm_mul_ps( w, _mm_load_ps( m->point[ 2 ] ) ) );
+		p3 = _mm_add_ps( p3, _mm_mul_ps( w, _mm_load_ps( m->point[ 3 ] ) ) );
+
+		if ( tangentSpaces )
+		{
+			n0 = _mm_add_ps( n0, _mm_mul_ps( w, _mm_load_ps( m->normal[ 0 ] ) ) );
+			n1 = _mm_add_ps( n1, _mm_mul_ps( w, _mm_load_ps( m->normal[ 1 ] ) ) );
+			n2 = _mm_add_ps( n2, _mm_mul_ps( w, _mm_load_ps( m->normal[ 2 ] ) ) );
+		}
+	}
+
+	auto transform = [ & ]( const float *v, __m128 c0, __m128 c1, __m128 c2 ) {
+		return _mm_add_ps( _mm_add_ps( _mm_mul_ps( c0, _mm_set1_ps( v[ 0 ] ) ),
+		                               _mm_mul_ps( c1, _mm_set1_ps( v[ 1 ] ) ) ),
+		                   _mm_mul_ps( c2, _mm_set1_ps( v[ 2 ] ) ) );
+	};
+
+	sseStoreVec3( _mm_add_ps( transform( in->position, p0, p1, p2 ), p3 ), out->xyz );
+
+	if ( !tangentSpaces )
+	{
+		return;
+	}
+
+	sseStoreVec3( transform( in->normal, n0, n1, n2 ), normal );
+	sseStoreVec3( transform( in->tangent, n0, n1, n2 ), tangent );
+	sseStoreVec3( transform( in->binormal, n0, n1, n2 ), binormal );
+#else
+	vec4_t p[ 4 ] = {}, n[ 3 ] = {};
+
+	for ( int k = 0; k < in->numWeights; k++ )
+	{
+		const skinMatrix_t *m = &skinMatrices[ in->boneIndexes[ k ] ];
+		float              w = in->boneWeights[ k ];
+
+		for ( int j = 0; j < 4; j++ )
+		{
+			VectorMA( p[ j ], w, m->point[ j ], p[ j ] );
+		}
+
+		if ( tangentSpaces )
+		{
+			for ( int j = 0; j < 3; j++ )
+			{
+				VectorMA( n[ j ], w, m->normal[ j ], n[ j ] );
+			}
+		}
+	}
+
+	auto transform = [ & ]( const float *v, const vec4_t *c, vec3_t result ) {
+		VectorScale( c[ 0 ], v[ 0 ], result );
+		VectorMA( result, v[ 1 ], c[ 1 ], result );
+		VectorMA( result, v[ 2 ], c[ 2 ], result );
+	};
+
+	transform( in->position, p, out->xyz );
+	VectorAdd( out->xyz, p[ 3 ], out->xyz );
+
+	if ( !tangentSpaces )
+	{
+		return;
+	}
+
+	transform( in->normal, n, normal );
+	transform( in->tangent, n, tangent );
+	transform( in->binormal, n, binormal );
+#endif
+
+	VectorNormalize( normal );
+	VectorNormalize( tangent );
+	VectorNormalize( binormal );
+
+	R_TBNtoQtangents( tangent, binormal, normal, out->qtangents );
+}
+
+/*
+==============
+R_SkinVertexes
+
+Calls skin( first, last ) over ranges covering [0, numVertexes), spread
+over the skinning threads when the mesh is large enough
+==============
+*/
+static void R_SkinVertexes( int numVertexes, const std::function<void( int, int )> &skin )
+{
+	int numThreads = Math::Clamp( r_skinningThreads->integer, 0, MAX_SKINNING_THREADS );
+	int numJobs = std::min( numVertexes / MIN_SKINNING_JOB_VERTEXES, numThreads + 1 );
+
+	if ( numJobs <= 1 )
+	{
+		skin( 0, numVertexes );
+		return;
+	}
+
+	skinningPool.SetNumThreads( numThreads );
+	skinningPool.ParallelFor( numJobs, [ & ]( int job ) {
+		skin( numVertexes * job / numJobs, numVertexes * ( job + 1 ) / numJobs );
+	} );
+}
+
+/*
+==============
+R_SkinMD5Vertexes
+==============
+*/
+static void R_SkinMD5Vertexes( const md5Surface_t *srf, int first, int last, bool tangentSpaces )
+{
+	skinVertex_t in;
+
+	for ( int j = first; j < last; j++ )
+	{
+		const md5Vertex_t *v = &srf->verts[ j ];
+		shaderVertex_t    *out = &tess.verts[ tess.numVertexes + j ];
+
+		in.position = v->position;
+		in.normal = v->normal;
+		in.tangent = v->tangent;
+		in.binormal = v->binormal;
+		in.numWeights = v->numWeights;
+
+		for ( uint32_t k = 0; k < v->numWeights; k++ )
+		{
+			in.boneIndexes[ k ] = v->boneIndexes[ k ];
+			in.boneWeights[ k ] = v->boneWeights[ k ];
+		}
+
+		R_SkinVertex( &in, tangentSpaces, out );
+
+		out->texCoords[ 0 ] = floatToHalf( v->texCoords[ 0 ] );
+		out->texCoords[ 1 ] = floatToHalf( v->texCoords[ 1 ] );
+	}
+}
+
 /*
 ==============
 Tess_SurfaceMD5
@@ -1096,11 +1318,9 @@ Tess_SurfaceMD5
 */
 static void Tess_SurfaceMD5( md5Surface_t *srf )
 {
-	int             j;
 	int             numIndexes = 0;
 	int             numVertexes;
 	md5Model_t      *model;
-	md5Vertex_t     *v;
 	srfTriangle_t   *tri;
 
 	GLimp_LogComment( "--- Tess_SurfaceMD5 ---\n" );
@@ -1145,26 +1365,13 @@ static void Tess_SurfaceMD5( md5Surface_t *srf )
 		}
 
 		// deform the vertices by the lerped bones
-		numVertexes = srf->numVerts;
-
-		for ( j = 0, v = srf->verts; j < numVertexes; j++, v++ )
-		{
-			vec3_t tmp; vec3_t pos;
+		R_BuildSkinMatrices( bones, model->numBones );
 
-			VectorClear( pos );
-			for (unsigned k = 0; k < v->numWeights; k++ ) {
-				TransformPoint( &bones[ v->boneIndexes[ k ] ],
-						v->position, tmp );
-				VectorMA( pos,
-					  v->boneWeights[ k ], tmp,
-					  pos );
-
-			}
+		numVertexes = srf->numVerts;
 
-			VectorCopy(pos, tess.verts[tess.numVertexes + j].xyz);
-			tess.verts[ tess.numVertexes + j ].texCoords[ 0 ] = floatToHalf( v->texCoords[ 0 ] );
-			tess.verts[ tess.numVertexes + j ].texCoords[ 1 ] = floatToHalf( v->texCoords[ 1 ] );
-		}
+		R_SkinVertexes( numVertexes, [ srf ]( int first, int last ) {
+			R_SkinMD5Vertexes( srf, first, last, false );
+		} );
 	}
 	else
 	{
@@ -1191,52 +1398,62 @@ static void Tess_SurfaceMD5( md5Surface_t *srf )
 		}
 
 		// deform the vertices by the lerped bones
-		numVertexes = srf->numVerts;
+		R_BuildSkinMatrices( bones, model->numBones );
 
-		for ( j = 0, v = srf->verts; j < numVertexes; j++, v++ )
-		{
-			vec3_t tangent, binormal, normal, tmp, pos;
-
-			VectorClear( pos );
-			VectorClear( normal );
-			VectorClear( binormal );
-			VectorClear( tangent );
-
-			for(unsigned k = 0; k < v->numWeights; k++ ) {
-				TransformPoint( &bones[ v->boneIndexes[ k ] ],
-						v->position, tmp );
-				VectorMA( pos,
-					  v->boneWeights[ k ], tmp,
-					  pos );
-
-				TransformNormalVector( &bones[ v->boneIndexes[ k ] ],
-						       v->normal, tmp );
-				VectorMA( normal, v->boneWeights[ k ], tmp, normal );
-
-				TransformNormalVector( &bones[ v->boneIndexes[ k ] ],
-						       v->tangent, tmp );
-				VectorMA( tangent, v->boneWeights[ k ], tmp, tangent );
-
-				TransformNormalVector( &bones[ v->boneIndexes[ k ] ],
-						       v->binormal, tmp );
-				VectorMA( binormal, v->boneWeights[ k ], tmp, binormal );
-			}
-			VectorNormalize( normal );
-			VectorNormalize( tangent );
-			VectorNormalize( binormal );
-
-			VectorCopy(pos, tess.verts[tess.numVertexes + j].xyz);
-			R_TBNtoQtangents( tangent, binormal, normal, tess.verts[ tess.numVertexes + j ].qtangents );
+		numVertexes = srf->numVerts;
 
-			tess.verts[ tess.numVertexes + j ].texCoords[ 0 ] = floatToHalf( v->texCoords[ 0 ] );
-			tess.verts[ tess.numVertexes + j ].texCoords[ 1 ] = floatToHalf( v->texCoords[ 1 ] );
-		}
+		R_SkinVertexes( numVertexes, [ srf ]( int first, int last ) {
+			R_SkinMD5Vertexes( srf, first, last, true );
+		} );
 	}
 
 	tess.numIndexes += numIndexes;
 	tess.numVertexes += numVertexes;
 }
 
+/*
+=================
+R_SkinIQMVertexes
+=================
+*/
+static void R_SkinIQMVertexes( const srfIQModel_t *surf, int first, int last )
+{
+	const IQModel_t *model = surf->data;
+	const float     weightFactor = 1.0f / 255.0f;
+	skinVertex_t    in;
+
+	in.numWeights = 4;
+
+	for ( int i = first; i < last; i++ )
+	{
+		int            idxIn = surf->first_vertex + i;
+		shaderVertex_t *out = &tess.verts[ tess.numVertexes + i ];
+		const byte     *weights = &model->blendWeights[ 4 * idxIn ];
+
+		in.position = &model->positions[ 3 * idxIn ];
+		in.normal = &model->normals[ 3 * idxIn ];
+		in.tangent = &model->tangents[ 3 * idxIn ];
+		in.binormal = &model->bitangents[ 3 * idxIn ];
+
+		for ( int j = 0; j < 4; j++ )
+		{
+			in.boneIndexes[ j ] = model->blendIndexes[ 4 * idxIn + j ];
+			in.boneWeights[ j ] = weightFactor * weights[ j ];
+		}
+
+		// unweighted vertexes follow their first bone
+		if ( !weights[ 0 ] && !weights[ 1 ] && !weights[ 2 ] && !weights[ 3 ] )
+		{
+			in.boneWeights[ 0 ] = 1.0f;
+		}
+
+		R_SkinVertex( &in, true, out );
+
+		out->texCoords[ 0 ] = model->texcoords[ 2 * idxIn + 0 ];
+		out->texCoords[ 1 ] = model->texcoords[ 2 * idxIn + 1 ];
+	}
+}
+
 /*
 =================
 Tess_SurfaceIQM
@@ -1246,7 +1463,7 @@ Compute vertices for this model surface
 */
 void Tess_SurfaceIQM( srfIQModel_t *surf ) {
 	IQModel_t       *model = surf->data;
-	int             i, j;
+	int             i;
 	int             offset = tess.numVertexes - surf->first_vertex;
 
 	GLimp_LogComment( "--- RB_SurfaceIQM ---\n" );
@@ -1303,54 +1520,11 @@ void Tess_SurfaceIQM( srfIQModel_t *surf ) {
 
 	if( model->num_joints > 0 && model->blendWeights && model->blendIndexes ) {
 		// deform the vertices by the lerped bones
-		for ( i = 0; i < surf->num_vertexes; i++ )
-		{
-			int    idxIn = surf->first_vertex + i;
-			int    idxOut = tess.numVertexes + i;
-			const float weightFactor = 1.0f / 255.0f;
-			vec3_t tangent, binormal, normal, tmp;
-			vec3_t pos;
-
-			if( model->blendWeights[ 4 * idxIn + 0 ] == 0 &&
-			    model->blendWeights[ 4 * idxIn + 1 ] == 0 &&
-			    model->blendWeights[ 4 * idxIn + 2 ] == 0 &&
-			    model->blendWeights[ 4 * idxIn + 3 ] == 0 )
-				model->blendWeights[ 4 * idxIn + 0 ] = 255;
-
-			VectorClear( pos );
-			VectorClear( normal );
-			VectorClear( tangent );
-			VectorClear( binormal );
-			for ( j = 0; j < 4; j++ ) {
-				int bone = model->blendIndexes[ 4 * idxIn + j ];
-				float weight = weightFactor * model->blendWeights[ 4 * idxIn + j ];
-
-				TransformPoint( &bones[ bone ],
-						&model->positions[ 3 * idxIn ], tmp );
-				VectorMA( pos, weight, tmp,
-					  pos );
-
-				TransformNormalVector( &bones[ bone ],
-						       &model->normals[ 3 * idxIn ], tmp );
-				VectorMA( normal, weight, tmp, normal );
-				TransformNormalVector( &bones[ bone ],
-						       &model->tangents[ 3 * idxIn ], tmp );
-				VectorMA( tangent, weight, tmp, tangent );
-				TransformNormalVector( &bones[ bone ],
-						       &model->bitangents[ 3 * idxIn ], tmp );
-				VectorMA( binormal, weight, tmp, binormal );
-			}
-			VectorNormalize( normal );
-			VectorNormalize( tangent );
-			VectorNormalize( binormal );
-
-			VectorCopy(pos, tess.verts[idxOut].xyz);
+		R_BuildSkinMatrices( bones, model->num_joints );
 
-			R_TBNtoQtangents( tangent, binormal, normal, tess.verts[ idxOut ].qtangents );
-
-			tess.verts[ idxOut ].texCoords[ 0 ] = model->texcoords[ 2 * idxIn + 0 ];
-			tess.verts[ idxOut ].texCoords[ 1 ] = model->texcoords[ 2 * idxIn + 1 ];
-		}
+		R_SkinVertexes( surf->num_vertexes, [ surf ]( int first, int last ) {
+			R_SkinIQMVertexes( surf, first, last );
+		} );
 	} else {
 		for ( i = 0; i < surf->num_vertexes; i++ )
 		{
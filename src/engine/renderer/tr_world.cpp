@@ -35,7 +35,7 @@ added to the sorting list.
 This will also allow mirrors on both sides of a model without recursion.
 ================
 */
-static bool R_CullSurface( surfaceType_t *surface, shader_t *shader, int planeBits )
+static bool R_CullSurface( frontEndJob_t *job, surfaceType_t *surface, shader_t *shader, int planeBits )
 {
 	srfGeneric_t *gen;
 	float        d;
@@ -64,7 +64,7 @@ static bool R_CullSurface( surfaceType_t *surface, shader_t *shader, int planeBi
 	if ( *surface == surfaceType_t::SF_FACE && r_facePlaneCull->integer )
 	{
 		srfSurfaceFace_t *srf = ( srfSurfaceFace_t * )gen;
-		d = DotProduct( tr.orientation.viewOrigin, srf->plane.normal ) - srf->plane.dist;
+		d = DotProduct( job->orientation.viewOrigin, srf->plane.normal ) - srf->plane.dist;
 
 		// don't cull exactly on the plane, because there are levels of rounding
 		// through the BSP, ICD, and hardware that may cause pixel gaps if an
@@ -73,7 +73,7 @@ static bool R_CullSurface( surfaceType_t *surface, shader_t *shader, int planeBi
 		{
 			if ( d < -8.0f )
 			{
-				tr.pc.c_plane_cull_out++;
+				job->pc.c_plane_cull_out++;
 				return true;
 			}
 		}
@@ -81,39 +81,39 @@ static bool R_CullSurface( surfaceType_t *surface, shader_t *shader, int planeBi
 		{
 			if ( d > 8.0f )
 			{
-				tr.pc.c_plane_cull_out++;
+				job->pc.c_plane_cull_out++;
 				return true;
 			}
 		}
 
-		tr.pc.c_plane_cull_in++;
+		job->pc.c_plane_cull_in++;
 	}
 
 	if ( planeBits )
 	{
 		cullResult_t cull;
 
-		if ( tr.currentEntity != &tr.worldEntity )
+		if ( job->entity != &tr.worldEntity )
 		{
-			cull = R_CullLocalBox( gen->bounds );
+			cull = R_CullLocalBox( &job->orientation, gen->bounds, &job->pc );
 		}
 		else
 		{
-			cull = R_CullBox( gen->bounds );
+			cull = R_CullBox( gen->bounds, &job->pc );
 		}
 
 		if ( cull == CULL_OUT )
 		{
-			tr.pc.c_box_cull_out++;
+			job->pc.c_box_cull_out++;
 			return true;
 		}
 		else if ( cull == CULL_CLIP )
 		{
-			tr.pc.c_box_cull_clip++;
+			job->pc.c_box_cull_clip++;
 		}
 		else
 		{
-			tr.pc.c_box_cull_in++;
+			job->pc.c_box_cull_in++;
 		}
 	}
 
@@ -121,7 +121,7 @@ static bool R_CullSurface( surfaceType_t *surface, shader_t *shader, int planeBi
 	return false;
 }
 
-static bool R_CullLightSurface( surfaceType_t *surface, shader_t *shader, trRefLight_t *light, byte *cubeSideBits )
+static bool R_CullLightSurface( surfaceType_t *surface, shader_t *shader, trRefLight_t *light, byte *cubeSideBits, frontEndCounters_t *pc )
 {
 	srfGeneric_t *gen;
 	float        d;
@@ -193,32 +193,78 @@ static bool R_CullLightSurface( surfaceType_t *surface, shader_t *shader, trRefL
 
 	if ( r_cullShadowPyramidFaces->integer )
 	{
-		*cubeSideBits = R_CalcLightCubeSideBits( light, gen->bounds );
+		*cubeSideBits = R_CalcLightCubeSideBits( light, gen->bounds, pc );
 	}
 
 	return false;
 }
 
+/*
+======================
+R_WorldSurfaceNum
+
+Index of a world or merged world surface in the stamps of the front end
+jobs, -1 for the other surfaces
+======================
+*/
+static int R_WorldSurfaceNum( const bspSurface_t *surf )
+{
+	if ( surf >= tr.world->surfaces && surf < tr.world->surfaces + tr.world->numSurfaces )
+	{
+		return surf - tr.world->surfaces;
+	}
+
+	if ( surf >= tr.world->mergedSurfaces && surf < tr.world->mergedSurfaces + tr.world->numMergedSurfaces )
+	{
+		return tr.world->numSurfaces + ( surf - tr.world->mergedSurfaces );
+	}
+
+	return -1;
+}
+
+/*
+======================
+R_SetupSurfaceStamps
+
+Makes room for the stamps of all the world surfaces in the job. The stamps
+only ever grow, so the ones left by a previous map never match.
+======================
+*/
+static void R_SetupSurfaceStamps( frontEndJob_t *job )
+{
+	size_t numSurfaces = tr.world->numSurfaces + tr.world->numMergedSurfaces;
+
+	if ( job->surfaceViewCounts.size() != numSurfaces )
+	{
+		job->surfaceViewCounts.assign( numSurfaces, 0 );
+		job->surfaceLightCounts.assign( numSurfaces, 0 );
+		job->surfaceInteractionBits.assign( numSurfaces, 0 );
+	}
+}
+
 /*
 ======================
 R_AddInteractionSurface
 ======================
 */
-static void R_AddInteractionSurface( bspSurface_t *surf, trRefLight_t *light, int interactionBits )
+static void R_AddInteractionSurface( frontEndJob_t *job, bspSurface_t *surf, trRefLight_t *light, int interactionBits )
 {
 	byte              cubeSideBits = CUBESIDE_CLIPALL;
 	bool          firstAddition = false;
 	int               bits;
+	int               surfaceNum = R_WorldSurfaceNum( surf );
+	int               &lightCount = job->surfaceLightCounts[ surfaceNum ];
+	int               &surfaceBits = job->surfaceInteractionBits[ surfaceNum ];
 
-	if ( surf->lightCount != tr.lightCount )
+	if ( lightCount != job->lightCount )
 	{
-		surf->interactionBits = 0;
-		surf->lightCount = tr.lightCount;
+		surfaceBits = 0;
+		lightCount = job->lightCount;
 		firstAddition = true;
 	}
 
 	// only add interactions we haven't already added
-	bits = interactionBits & ~surf->interactionBits;
+	bits = interactionBits & ~surfaceBits;
 
 	if ( !bits )
 	{
@@ -226,7 +272,7 @@ static void R_AddInteractionSurface( bspSurface_t *surf, trRefLight_t *light, in
 		return;
 	}
 
-	surf->interactionBits |= bits;
+	surfaceBits |= bits;
 
 	//  skip all surfaces that don't matter for lighting only pass
 	if ( surf->shader->isSky || ( !surf->shader->interactLight && surf->shader->noShadows ) )
@@ -234,26 +280,26 @@ static void R_AddInteractionSurface( bspSurface_t *surf, trRefLight_t *light, in
 		return;
 	}
 
-	if ( R_CullLightSurface( surf->data, surf->shader, light, &cubeSideBits ) )
+	if ( R_CullLightSurface( surf->data, surf->shader, light, &cubeSideBits, &job->pc ) )
 	{
 		if ( !light->isStatic && firstAddition )
 		{
-			tr.pc.c_dlightSurfacesCulled++;
+			job->pc.c_dlightSurfacesCulled++;
 		}
 		return;
 	}
 
-	R_AddLightInteraction( light, surf->data, surf->shader, cubeSideBits, ( interactionType_t ) bits );
+	R_AddLightInteraction( job, light, surf->data, surf->shader, cubeSideBits, ( interactionType_t ) bits );
 
 	if ( firstAddition )
 	{
 		if ( light->isStatic )
 		{
-			tr.pc.c_slightSurfaces++;
+			job->pc.c_slightSurfaces++;
 		}
 		else
 		{
-			tr.pc.c_dlightSurfaces++;
+			job->pc.c_dlightSurfaces++;
 		}
 	}
 }
@@ -279,25 +325,77 @@ static void R_AddDecalSurface( bspSurface_t *surf, int decalBits )
 /*
 ======================
 R_AddWorldSurface
+
+Queues a world or brush model surface in the job. Whether it is the first
+time the surface is seen in this view is only known when the jobs are
+merged in order, see R_MergeWorldSurface.
 ======================
 */
-static bool R_AddWorldSurface( bspSurface_t *surf, int fogIndex, int planeBits )
+static void R_AddWorldSurface( frontEndJob_t *job, bspSurface_t *surf, bspSurface_t *mark, int fogIndex, int planeBits, int decalBits )
 {
-	if ( surf->viewCount == tr.viewCountNoReset )
+	frontEndDrawSurf_t drawSurf{};
+	int                surfaceNum = R_WorldSurfaceNum( surf );
+
+	drawSurf.entity = job->entity;
+	drawSurf.surface = surf->data;
+	drawSurf.shader = surf->shader;
+	drawSurf.lightmapNum = surf->lightmapNum;
+	drawSurf.fogNum = fogIndex;
+	drawSurf.bspSurface = surf;
+	drawSurf.markSurface = mark;
+	drawSurf.decalBits = decalBits;
+
+	if ( surfaceNum >= 0 && surfaceNum < ( int ) job->surfaceViewCounts.size() &&
+	     job->surfaceViewCounts[ surfaceNum ] == tr.viewCountNoReset )
+	{
+		// already seen by the job, an earlier entry does the adding
+		drawSurf.culled = true;
+	}
+	else
 	{
-		return false; // already in this view
+		if ( surfaceNum >= 0 && surfaceNum < ( int ) job->surfaceViewCounts.size() )
+		{
+			job->surfaceViewCounts[ surfaceNum ] = tr.viewCountNoReset;
+		}
+
+		// try to cull before lighting or adding
+		drawSurf.culled = R_CullSurface( job, surf->data, surf->shader, planeBits );
 	}
 
-	surf->viewCount = tr.viewCountNoReset;
+	job->drawSurfs.push_back( drawSurf );
+}
+
+/*
+======================
+R_MergeWorldSurface
+
+Returns true if the surface queued by R_AddWorldSurface has to be added
+to the drawSurf list. Only the first entry of a surface in a view counts,
+like when the BSP was walked on the main thread.
+======================
+*/
+bool R_MergeWorldSurface( const frontEndDrawSurf_t *drawSurf )
+{
+	bspSurface_t *surf = drawSurf->bspSurface;
+	bool         added = false;
 
-	// try to cull before lighting or adding
-	if ( R_CullSurface( surf->data, surf->shader, planeBits ) )
+	if ( surf->viewCount != tr.viewCountNoReset )
 	{
-		return true;
+		surf->viewCount = tr.viewCountNoReset;
+		added = !drawSurf->culled;
+
+		if ( drawSurf->markSurface )
+		{
+			R_AddDecalSurface( drawSurf->markSurface, drawSurf->decalBits );
+		}
 	}
 
-	R_AddDrawSurf( surf->data, surf->shader, surf->lightmapNum, fogIndex );
-	return true;
+	if ( drawSurf->markSurface )
+	{
+		drawSurf->markSurface->viewCount = tr.viewCountNoReset;
+	}
+
+	return added;
 }
 
 /*
@@ -313,18 +411,16 @@ static bool R_AddWorldSurface( bspSurface_t *surf, int fogIndex, int planeBits )
 R_AddBSPModelSurfaces
 =================
 */
-void R_AddBSPModelSurfaces( trRefEntity_t *ent )
+void R_AddBSPModelSurfaces( frontEndJob_t *job, trRefEntity_t *ent, model_t *model )
 {
 	bspModel_t *bspModel;
-	model_t    *pModel;
 	unsigned int i;
 	vec3_t     v;
 	vec3_t     transformed;
 	vec3_t     boundsCenter;
 	int        fogNum;
 
-	pModel = R_GetModelByHandle( ent->e.hModel );
-	bspModel = pModel->bsp;
+	bspModel = model->bsp;
 
 	// copy local bounds
 	for ( i = 0; i < 3; i++ )
@@ -333,12 +429,12 @@ void R_AddBSPModelSurfaces( trRefEntity_t *ent )
 		ent->localBounds[ 1 ][ i ] = bspModel->bounds[ 1 ][ i ];
 	}
 
-	R_SetupEntityWorldBounds(ent);
+	R_SetupEntityWorldBounds( ent, &job->orientation );
 
 	VectorAdd( ent->worldBounds[ 0 ], ent->worldBounds[ 1 ], boundsCenter );
 	VectorScale( boundsCenter, 0.5f, boundsCenter );
 
-	ent->cull = R_CullBox( ent->worldBounds );
+	ent->cull = R_CullBox( ent->worldBounds, &job->pc );
 
 	if ( ent->cull == CULL_OUT )
 	{
@@ -352,7 +448,7 @@ void R_AddBSPModelSurfaces( trRefEntity_t *ent )
 
 	for ( i = 0; i < bspModel->numSurfaces; i++ )
 	{
-		R_AddWorldSurface( bspModel->firstSurface + i, fogNum, FRUSTUM_CLIPALL );
+		R_AddWorldSurface( job, bspModel->firstSurface + i, nullptr, fogNum, FRUSTUM_CLIPALL, 0 );
 	}
 }
 
@@ -364,43 +460,43 @@ void R_AddBSPModelSurfaces( trRefEntity_t *ent )
 =============================================================
 */
 
-static void R_AddLeafSurfaces( bspNode_t *node, int decalBits, int planeBits )
+static void R_AddLeafSurfaces( frontEndJob_t *job, bspNode_t *node, int decalBits, int planeBits )
 {
 	int          c;
 	bspSurface_t **mark;
 	bspSurface_t **view;
 
-	tr.pc.c_leafs++;
+	job->pc.c_leafs++;
 
 	// add to z buffer bounds
-	if ( node->mins[ 0 ] < tr.viewParms.visBounds[ 0 ][ 0 ] )
+	if ( node->mins[ 0 ] < job->visBounds[ 0 ][ 0 ] )
 	{
-		tr.viewParms.visBounds[ 0 ][ 0 ] = node->mins[ 0 ];
+		job->visBounds[ 0 ][ 0 ] = node->mins[ 0 ];
 	}
 
-	if ( node->mins[ 1 ] < tr.viewParms.visBounds[ 0 ][ 1 ] )
+	if ( node->mins[ 1 ] < job->visBounds[ 0 ][ 1 ] )
 	{
-		tr.viewParms.visBounds[ 0 ][ 1 ] = node->mins[ 1 ];
+		job->visBounds[ 0 ][ 1 ] = node->mins[ 1 ];
 	}
 
-	if ( node->mins[ 2 ] < tr.viewParms.visBounds[ 0 ][ 2 ] )
+	if ( node->mins[ 2 ] < job->visBounds[ 0 ][ 2 ] )
 	{
-		tr.viewParms.visBounds[ 0 ][ 2 ] = node->mins[ 2 ];
+		job->visBounds[ 0 ][ 2 ] = node->mins[ 2 ];
 	}
 
-	if ( node->maxs[ 0 ] > tr.viewParms.visBounds[ 1 ][ 0 ] )
+	if ( node->maxs[ 0 ] > job->visBounds[ 1 ][ 0 ] )
 	{
-		tr.viewParms.visBounds[ 1 ][ 0 ] = node->maxs[ 0 ];
+		job->visBounds[ 1 ][ 0 ] = node->maxs[ 0 ];
 	}
 
-	if ( node->maxs[ 1 ] > tr.viewParms.visBounds[ 1 ][ 1 ] )
+	if ( node->maxs[ 1 ] > job->visBounds[ 1 ][ 1 ] )
 	{
-		tr.viewParms.visBounds[ 1 ][ 1 ] = node->maxs[ 1 ];
+		job->visBounds[ 1 ][ 1 ] = node->maxs[ 1 ];
 	}
 
-	if ( node->maxs[ 2 ] > tr.viewParms.visBounds[ 1 ][ 2 ] )
+	if ( node->maxs[ 2 ] > job->visBounds[ 1 ][ 2 ] )
 	{
-		tr.viewParms.visBounds[ 1 ][ 2 ] = node->maxs[ 2 ];
+		job->visBounds[ 1 ][ 2 ] = node->maxs[ 2 ];
 	}
 
 	// add the individual surfaces
@@ -412,12 +508,7 @@ static void R_AddLeafSurfaces( bspNode_t *node, int decalBits, int planeBits )
 	{
 		// the surface may have already been added if it
 		// spans multiple leafs
-		if ( R_AddWorldSurface( *view, ( *view )->fogIndex, planeBits ) )
-		{
-			R_AddDecalSurface( *mark, decalBits );
-		}
-
-		( *mark )->viewCount = tr.viewCountNoReset;
+		R_AddWorldSurface( job, *view, *mark, ( *view )->fogIndex, planeBits, decalBits );
 
 		mark++;
 		view++;
@@ -426,71 +517,107 @@ static void R_AddLeafSurfaces( bspNode_t *node, int decalBits, int planeBits )
 
 /*
 ================
-R_RecursiveWorldNode
+R_CullWorldNode
+
+Returns true if nothing of the node can be visible, otherwise removes the
+frustum planes the node is completely in front of from planeBits
 ================
 */
-static void R_RecursiveWorldNode( bspNode_t *node, int planeBits, int decalBits )
+static bool R_CullWorldNode( bspNode_t *node, int *planeBits, frontEndCounters_t *pc )
 {
-	do
+	// if the node wasn't marked as potentially visible, exit
+	if ( node->visCounts[ tr.visIndex ] != tr.visCounts[ tr.visIndex ] )
 	{
-		// if the node wasn't marked as potentially visible, exit
-		if ( node->visCounts[ tr.visIndex ] != tr.visCounts[ tr.visIndex ] )
-		{
-			return;
-		}
+		return true;
+	}
 
-		if ( node->contents != -1 && !node->numMarkSurfaces )
-		{
-			// don't waste time dealing with this empty leaf
-			return;
-		}
+	if ( node->contents != -1 && !node->numMarkSurfaces )
+	{
+		// don't waste time dealing with this empty leaf
+		return true;
+	}
 
-		// if the bounding volume is outside the frustum, nothing
-		// inside can be visible
-		if ( !r_nocull->integer )
-		{
-			int i;
-			int r;
+	// if the bounding volume is outside the frustum, nothing
+	// inside can be visible
+	if ( !r_nocull->integer )
+	{
+		int i;
+		int r;
 
-			for ( i = 0; i < FRUSTUM_PLANES; i++ )
+		for ( i = 0; i < FRUSTUM_PLANES; i++ )
+		{
+			if ( *planeBits & ( 1 << i ) )
 			{
-				if ( planeBits & ( 1 << i ) )
-				{
-					r = BoxOnPlaneSide( node->mins, node->maxs, &tr.viewParms.frustums[ 0 ][ i ] );
+				r = BoxOnPlaneSide( node->mins, node->maxs, &tr.viewParms.frustums[ 0 ][ i ] );
 
-					if ( r == 2 )
-					{
-						return; // culled
-					}
+				if ( r == 2 )
+				{
+					return true; // culled
+				}
 
-					if ( r == 1 )
-					{
-						planeBits &= ~( 1 << i );  // all descendants will also be in front
-					}
+				if ( r == 1 )
+				{
+					*planeBits &= ~( 1 << i );  // all descendants will also be in front
 				}
 			}
 		}
 
-		backEndData[ tr.smpFrame ]->traversalList[ backEndData[ tr.smpFrame ]->traversalLength++ ] = node;
-
-		// ydnar: cull decals
-		if ( decalBits )
+		// or if it is hidden behind the occluders of the view
+		if ( R_BoxOccluded( node->mins, node->maxs, pc ) )
 		{
-			int i;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/*
+================
+R_CullNodeDecals
+================
+*/
+static int R_CullNodeDecals( bspNode_t *node, int decalBits )
+{
+	// ydnar: cull decals
+	if ( decalBits )
+	{
+		int i;
 
-			for ( i = 0; i < tr.refdef.numDecalProjectors; i++ )
+		for ( i = 0; i < tr.refdef.numDecalProjectors; i++ )
+		{
+			if ( decalBits & ( 1 << i ) )
 			{
-				if ( decalBits & ( 1 << i ) )
+				// test decal bounds against node bounds
+				if ( tr.refdef.decalProjectors[ i ].shader == nullptr ||
+				     !R_TestDecalBoundingBox( &tr.refdef.decalProjectors[ i ], node->mins, node->maxs ) )
 				{
-					// test decal bounds against node bounds
-					if ( tr.refdef.decalProjectors[ i ].shader == nullptr ||
-					     !R_TestDecalBoundingBox( &tr.refdef.decalProjectors[ i ], node->mins, node->maxs ) )
-					{
-						decalBits &= ~( 1 << i );
-					}
+					decalBits &= ~( 1 << i );
 				}
 			}
 		}
+	}
+
+	return decalBits;
+}
+
+/*
+================
+R_RecursiveWorldNode
+================
+*/
+static void R_RecursiveWorldNode( frontEndJob_t *job, bspNode_t *node, int planeBits, int decalBits )
+{
+	do
+	{
+		if ( R_CullWorldNode( node, &planeBits, &job->pc ) )
+		{
+			return;
+		}
+
+		job->traversal.push_back( node );
+
+		decalBits = R_CullNodeDecals( node, decalBits );
 
 		if ( node->contents != -1 )
 		{
@@ -502,7 +629,7 @@ static void R_RecursiveWorldNode( bspNode_t *node, int planeBits, int decalBits
 		uint32_t side = d <= 0;
 
 		// recurse down the children, front side first
-		R_RecursiveWorldNode( node->children[ side ], planeBits, decalBits );
+		R_RecursiveWorldNode( job, node->children[ side ], planeBits, decalBits );
 
 		// tail recurse
 		node = node->children[ side ^ 1 ];
@@ -512,8 +639,76 @@ static void R_RecursiveWorldNode( bspNode_t *node, int planeBits, int decalBits
 	if ( node->numMarkSurfaces )
 	{
 		// ydnar: moved off to separate function
-		R_AddLeafSurfaces( node, decalBits, planeBits );
+		R_AddLeafSurfaces( job, node, decalBits, planeBits );
+	}
+}
+
+/*
+================
+R_SplitWorldNode
+
+Walks the top of the BSP like R_RecursiveWorldNode and hands the subtrees
+found depth levels below over to the front end jobs, front side first.
+The nodes walked since the previous subtree go to the traversal of the job,
+so that the traversal list comes out in the same order when the jobs are
+merged.
+================
+*/
+static void R_SplitWorldNode( bspNode_t *node, int planeBits, int decalBits, int depth, std::vector<bspNode_t *> &traversal, int *numJobs )
+{
+	if ( depth == 0 || node->contents != -1 )
+	{
+		frontEndJob_t *job = R_GetFrontEndJob( ( *numJobs )++ );
+
+		job->node = node;
+		job->planeBits = planeBits;
+		job->decalBits = decalBits;
+		job->traversal.swap( traversal );
+		return;
+	}
+
+	if ( R_CullWorldNode( node, &planeBits, &tr.pc ) )
+	{
+		return;
 	}
+
+	traversal.push_back( node );
+
+	decalBits = R_CullNodeDecals( node, decalBits );
+
+	float d = DotProduct( tr.viewParms.orientation.viewOrigin, node->plane->normal ) - node->plane->dist;
+
+	uint32_t side = d <= 0;
+
+	R_SplitWorldNode( node->children[ side ], planeBits, decalBits, depth - 1, traversal, numJobs );
+	R_SplitWorldNode( node->children[ side ^ 1 ], planeBits, decalBits, depth - 1, traversal, numJobs );
+}
+
+/*
+================
+R_AddWorldSurfacesJob
+================
+*/
+static void R_AddWorldSurfacesJob( frontEndJob_t *job )
+{
+	R_RecursiveWorldNode( job, job->node, job->planeBits, job->decalBits );
+}
+
+/*
+================
+R_MergeWorldJob
+================
+*/
+static void R_MergeWorldJob( frontEndJob_t *job )
+{
+	for ( bspNode_t *node : job->traversal )
+	{
+		backEndData[ tr.smpFrame ]->traversalList[ backEndData[ tr.smpFrame ]->traversalLength++ ] = node;
+	}
+
+	BoundsAdd( tr.viewParms.visBounds[ 0 ], tr.viewParms.visBounds[ 1 ], job->visBounds[ 0 ], job->visBounds[ 1 ] );
+
+	R_MergeFrontEndJob( job );
 }
 
 /*
@@ -521,7 +716,7 @@ static void R_RecursiveWorldNode( bspNode_t *node, int planeBits, int decalBits
 R_RecursiveInteractionNode
 ================
 */
-static void R_RecursiveInteractionNode( bspNode_t *node, trRefLight_t *light, int planeBits, int interactionBits )
+static void R_RecursiveInteractionNode( frontEndJob_t *job, bspNode_t *node, trRefLight_t *light, int planeBits, int interactionBits )
 {
 	int i;
 	int r;
@@ -591,7 +786,7 @@ static void R_RecursiveInteractionNode( bspNode_t *node, trRefLight_t *light, in
 			case 3:
 			default:
 				// recurse down the children, front side first
-				R_RecursiveInteractionNode( node->children[ 0 ], light, planeBits, interactionBits );
+				R_RecursiveInteractionNode( job, node->children[ 0 ], light, planeBits, interactionBits );
 
 				// tail recurse
 				node = node->children[ 1 ];
@@ -614,7 +809,7 @@ static void R_RecursiveInteractionNode( bspNode_t *node, trRefLight_t *light, in
 			// the surface may have already been added if it
 			// spans multiple leafs
 			surf = *mark;
-			R_AddInteractionSurface( surf, light, interactionBits );
+			R_AddInteractionSurface( job, surf, light, interactionBits );
 			mark++;
 		}
 	}
@@ -745,10 +940,11 @@ cluster
 */
 static void R_MarkLeaves()
 {
-	const byte *vis;
-	bspNode_t  *leaf, *parent;
-	int        i;
-	int        cluster;
+	const byte    *vis;
+	bspNode_t     *leaf, *parent;
+	int           i;
+	int           cluster;
+	frontEndJob_t *job = nullptr;
 
 	// lockpvs lets designers walk around to determine the
 	// extent of the current pvs
@@ -849,7 +1045,14 @@ static void R_MarkLeaves()
 				tr.world->skyNodes[ tr.world->numSkyNodes++ ] = leaf;
 			}
 
-			R_AddLeafSurfaces( leaf, 0, FRUSTUM_CLIPALL );
+			if ( !job )
+			{
+				job = R_GetFrontEndJob( 0 );
+				R_ClearFrontEndJob( job );
+				R_SetupSurfaceStamps( job );
+			}
+
+			R_AddLeafSurfaces( job, leaf, 0, FRUSTUM_CLIPALL );
 			continue;
 		}
 
@@ -867,15 +1070,25 @@ static void R_MarkLeaves()
 		}
 		while ( parent );
 	}
+
+	if ( job )
+	{
+		R_MergeWorldJob( job );
+	}
 }
 
 /*
 =============
 R_AddWorldSurfaces
+
+The subtrees of the BSP are walked by the front end jobs and merged front
+to back
 =============
 */
 void R_AddWorldSurfaces()
 {
+	frontEndJob_t *job;
+
 	if ( !r_drawworld->integer )
 	{
 		return;
@@ -886,8 +1099,6 @@ void R_AddWorldSurfaces()
 		return;
 	}
 
-	tr.currentEntity = &tr.worldEntity;
-
 	// clear out the visible min/max
 	ClearBounds( tr.viewParms.visBounds[ 0 ], tr.viewParms.visBounds[ 1 ] );
 
@@ -897,24 +1108,70 @@ void R_AddWorldSurfaces()
 		int       i;
 		bspNode_t **node;
 
+		job = R_GetFrontEndJob( 0 );
+		R_ClearFrontEndJob( job );
+		R_SetupSurfaceStamps( job );
+
 		for ( i = 0, node = tr.world->skyNodes; i < tr.world->numSkyNodes; i++, node++ )
 		{
-			R_AddLeafSurfaces( *node, 0, FRUSTUM_CLIPALL );  // no decals on skybox nodes
+			R_AddLeafSurfaces( job, *node, 0, FRUSTUM_CLIPALL );  // no decals on skybox nodes
 		}
+
+		R_MergeWorldJob( job );
 	}
 	else
 	{
+		// nodes walked after the last subtree
+		static std::vector<bspNode_t *> traversal;
+		int                             numJobs, numSubtrees, depth;
+
 		// determine which leaves are in the PVS / areamask
 		R_MarkLeaves();
 
 		// clear traversal list
 		backEndData[ tr.smpFrame ]->traversalLength = 0;
 
+		// draw the occluders of the main view for the culling of the nodes and entities
+		if ( !tr.viewParms.portalLevel )
+		{
+			R_BuildOcclusionBuffer();
+		}
+
+		// there are at most 2^depth subtrees depth levels below the root
+		numJobs = R_SetupFrontEndJobs( MAX_FRONTEND_JOBS );
+
+		for ( depth = 0; ( 2 << depth ) <= numJobs; depth++ )
+		{
+		}
+
+		numSubtrees = 0;
+		traversal.clear();
+
+		R_SplitWorldNode( tr.world->nodes, FRUSTUM_CLIPALL, tr.refdef.decalBits, depth, traversal, &numSubtrees );
+
+		for ( int i = 0; i < numSubtrees; i++ )
+		{
+			R_SetupSurfaceStamps( R_GetFrontEndJob( i ) );
+		}
+
 		// update visbounds and add surfaces that weren't cached with VBOs
-		R_RecursiveWorldNode( tr.world->nodes, FRUSTUM_CLIPALL, tr.refdef.decalBits );
+		R_RunFrontEndJobs( numSubtrees, R_AddWorldSurfacesJob );
+
+		for ( int i = 0; i < numSubtrees; i++ )
+		{
+			R_MergeWorldJob( R_GetFrontEndJob( i ) );
+		}
+
+		for ( bspNode_t *node : traversal )
+		{
+			backEndData[ tr.smpFrame ]->traversalList[ backEndData[ tr.smpFrame ]->traversalLength++ ] = node;
+		}
 
 		// ydnar: add decal surfaces
-		R_AddDecalSurfaces( tr.world->models );
+		job = R_GetFrontEndJob( 0 );
+		R_ClearFrontEndJob( job );
+		R_AddDecalSurfaces( job, tr.world->models );
+		R_MergeFrontEndJob( job );
 	}
 }
 
@@ -923,7 +1180,7 @@ void R_AddWorldSurfaces()
 R_AddWorldInteractions
 =============
 */
-void R_AddWorldInteractions( trRefLight_t *light )
+void R_AddWorldInteractions( frontEndJob_t *job, trRefLight_t *light )
 {
 	int interactionBits;
 
@@ -937,10 +1194,11 @@ void R_AddWorldInteractions( trRefLight_t *light )
 		return;
 	}
 
-	tr.currentEntity = &tr.worldEntity;
+	job->entity = &tr.worldEntity;
 
 	// perform frustum culling and add all the potentially visible surfaces
-	tr.lightCount++;
+	R_SetupSurfaceStamps( job );
+	job->lightCount++;
 
 	interactionBits = IA_DEFAULT;
 
@@ -954,7 +1212,7 @@ void R_AddWorldInteractions( trRefLight_t *light )
 		interactionBits = interactionBits & IA_LIGHT;
 	}
 
-	R_RecursiveInteractionNode( tr.world->nodes, light, FRUSTUM_CLIPALL, interactionBits );
+	R_RecursiveInteractionNode( job, tr.world->nodes, light, FRUSTUM_CLIPALL, interactionBits );
 }
 
 /*
@@ -962,7 +1220,7 @@ void R_AddWorldInteractions( trRefLight_t *light )
 R_AddPrecachedWorldInteractions
 =============
 */
-void R_AddPrecachedWorldInteractions( trRefLight_t *light )
+void R_AddPrecachedWorldInteractions( frontEndJob_t *job, trRefLight_t *light )
 {
 	interactionType_t iaType = IA_DEFAULT;
 
@@ -982,7 +1240,7 @@ void R_AddPrecachedWorldInteractions( trRefLight_t *light )
 		return;
 	}
 
-	tr.currentEntity = &tr.worldEntity;
+	job->entity = &tr.worldEntity;
 
 	if ( ( r_vboShadows->integer || r_vboLighting->integer ) )
 	{
@@ -1006,16 +1264,16 @@ void R_AddPrecachedWorldInteractions( trRefLight_t *light )
 			switch ( light->l.rlType )
 			{
 				case refLightType_t::RL_OMNI:
-					R_AddLightInteraction( light, ( surfaceType_t * ) srf, shader, CUBESIDE_CLIPALL, IA_LIGHT );
+					R_AddLightInteraction( job, light, ( surfaceType_t * ) srf, shader, CUBESIDE_CLIPALL, IA_LIGHT );
 					break;
 
 				case refLightType_t::RL_DIRECTIONAL:
 				case refLightType_t::RL_PROJ:
-					R_AddLightInteraction( light, ( surfaceType_t * ) srf, shader, CUBESIDE_CLIPALL, IA_LIGHT );
+					R_AddLightInteraction( job, light, ( surfaceType_t * ) srf, shader, CUBESIDE_CLIPALL, IA_LIGHT );
 					break;
 
 				default:
-					R_AddLightInteraction( light, ( surfaceType_t * ) srf, shader, CUBESIDE_CLIPALL, IA_DEFAULT );
+					R_AddLightInteraction( job, light, ( surfaceType_t * ) srf, shader, CUBESIDE_CLIPALL, IA_DEFAULT );
 					break;
 			}
 		}
@@ -1031,7 +1289,7 @@ void R_AddPrecachedWorldInteractions( trRefLight_t *light )
 			srf = iaVBO->vboShadowMesh;
 			shader = iaVBO->shader;
 
-			R_AddLightInteraction( light, ( surfaceType_t * ) srf, shader, iaVBO->cubeSideBits, IA_SHADOW );
+			R_AddLightInteraction( job, light, ( surfaceType_t * ) srf, shader, iaVBO->cubeSideBits, IA_SHADOW );
 		}
 
 		// add interactions that couldn't be merged into VBOs
@@ -1067,7 +1325,7 @@ void R_AddPrecachedWorldInteractions( trRefLight_t *light )
 				iaType = iaCache->type;
 			}
 
-			R_AddLightInteraction( light, surface->data, surface->shader, iaCache->cubeSideBits, iaType );
+			R_AddLightInteraction( job, light, surface->data, surface->shader, iaCache->cubeSideBits, iaType );
 		}
 	}
 	else
@@ -1102,7 +1360,7 @@ void R_AddPrecachedWorldInteractions( trRefLight_t *light )
 				iaType = iaCache->type;
 			}
 
-			R_AddLightInteraction( light, surface->data, surface->shader, iaCache->cubeSideBits, iaType );
+			R_AddLightInteraction( job, light, surface->data, surface->shader, iaCache->cubeSideBits, iaType );
 		}
 	}
 }
@@ -52,7 +52,6 @@ Maryland 20850 USA.
 struct svEntity_t
 {
 	entityState_t        baseline; // for delta compression of initial sighting
-	int                  snapshotCounter; // used to prevent double adding from portal views
 };
 
 enum class serverState_t
@@ -69,7 +68,6 @@ struct server_t
 	int           serverId; // changes each server start
 	int           restartedServerId; // serverId before a map_restart
 	int           checksumFeed; // the feed key that we use to compute the pure checksum strings
-	int             snapshotCounter; // incremented for each snapshot built
 	int             timeResidual; // <= 1000 / sv_frame->value
 	int             nextFrameTime; // when time > nextFrameTime, process world
 	struct cmodel_t *models[ MAX_MODELS ];
@@ -121,8 +119,8 @@ struct clientSnapshot_t
 	int           first_entity; // into the circular sv_packet_entities[]
 	// the entities MUST be in increasing state number
 	// order, otherwise the delta compression will fail
-	int messageSent; // time the message was transmitted
-	int messageAcked; // time the message was acked
+	int messageSent; // Sys_Milliseconds() when the message was transmitted
+	int messageAcked; // Sys_Milliseconds() when the ack arrived
 	int messageSize; // used to rate drop packets
 };
 
@@ -195,6 +193,7 @@ struct client_t
 	bool         rateDelayed; // true if nextSnapshotTime was set based on rate instead of snapshotMsec
 	int              timeoutCount; // must timeout a few frames in a row so debugging doesn't break
 	clientSnapshot_t frames[ PACKET_BACKUP ]; // updates can be delta'd from here
+	int              entityHeldBackTime[ MAX_GENTITIES ]; // svs.time an entity change was first held back for the rate, 0 if it was sent
 	int              ping;
 	int              rate; // bytes / second
 	int              snapshotMsec; // requests a snapshot every snapshotMsec unless rate choked
@@ -228,15 +227,28 @@ struct svstats_t
 	int    latched_packets;
 };
 
-struct receipt_t
+// getstatus+getinfo responses are limited by token buckets that hold
+// MAX_INFO_RECEIPTS responses overall and MAX_SUBNET_RECEIPTS per subnet,
+// and refill completely in INFO_RECEIPT_PERIOD milliseconds.
+struct infoBucket_t
 {
-	netadr_t adr;
-	int      time;
+	netadr_t adr; // subnet of the bucket, unused for the global one
+	int      time; // svs.time of the last response
+	float    used; // responses sent, drains back to 0 over time
 };
 
-// MAX_INFO_RECEIPTS is the maximum number of getstatus+getinfo responses that we send
-// in a two second time period.
-#define MAX_INFO_RECEIPTS 48
+#define MAX_INFO_RECEIPTS   48
+#define MAX_SUBNET_RECEIPTS 3
+#define INFO_RECEIPT_PERIOD 2000
+
+// the subnet buckets are hashed, a subnet is looked for in that many
+// slots from its hash before the stalest of them gets replaced
+#define INFO_BUCKETS       256
+#define INFO_BUCKET_PROBES 8
+
+// clients are found from the address and qport of their packets through
+// an open addressing table, kept at most half full
+#define CLIENT_INDEX_SIZE ( MAX_CLIENTS * 2 )
 
 #define SERVER_PERFORMANCECOUNTER_FRAMES  600
 #define SERVER_PERFORMANCECOUNTER_SAMPLES 6
@@ -248,6 +260,8 @@ struct serverStatic_t
 
 	int           time; // will be strictly increasing across level changes
 
+	int           packetTime; // Sys_Milliseconds() when the packet being processed arrived
+
 	int           snapFlagServerBit; // ^= SNAPFLAG_SERVERCOUNT every SV_SpawnServer()
 
 	client_t      *clients; // [sv_maxclients->integer];
@@ -255,7 +269,10 @@ struct serverStatic_t
 	int           nextSnapshotEntities; // next snapshotEntities to use
 	entityState_t *snapshotEntities; // [numSnapshotEntities]
 	int           nextHeartbeatTime;
-	receipt_t     infoReceipts[ MAX_INFO_RECEIPTS ];
+	infoBucket_t  infoBucket; // all the responses
+	infoBucket_t  infoBuckets[ INFO_BUCKETS ]; // the responses to each subnet
+
+	int           clientIndex[ CLIENT_INDEX_SIZE ]; // client number + 1, 0 for an empty slot
 
 	int       sampleTimes[ SERVER_PERFORMANCECOUNTER_SAMPLES ];
 	int       currentSampleIndex;
@@ -358,6 +375,10 @@ void       SV_RemoveOperatorCommands();
 
 void       SV_NET_Config();
 
+void       SV_AddClientIndex( client_t *cl );
+void       SV_RemoveClientIndex( client_t *cl );
+void       SV_RebuildClientIndex();
+
 void       SV_MasterHeartbeat( const char *hbname );
 void       SV_MasterShutdown();
 void       SV_MasterGameStat( const char *data );
@@ -182,6 +182,7 @@ void SV_DirectConnect( netadr_t from, const Cmd::Args& args )
 	// build a new connection
 	// accept the new client
 	// this is the only place a client_t is ever initialized
+	SV_RemoveClientIndex( new_client );
 	memset( new_client, 0, sizeof( client_t ) );
 	int clientNum = new_client - svs.clients;
 
@@ -232,6 +233,7 @@ void SV_DirectConnect( netadr_t from, const Cmd::Args& args )
 	Log::Debug( "Going from CS_FREE to CS_CONNECTED for %s", new_client->name );
 
 	new_client->state = clientState_t::CS_CONNECTED;
+	SV_AddClientIndex( new_client );
 	new_client->nextSnapshotTime = svs.time;
 	new_client->lastPacketTime = svs.time;
 	new_client->lastConnectTime = svs.time;
@@ -432,6 +434,9 @@ void SV_ClientEnterWorld( client_t *client, usercmd_t *cmd )
 
 	client->deltaMessage = -1;
 	client->nextSnapshotTime = svs.time; // generate a snapshot immediately
+
+	// also called on map restarts, nothing is held back from a full snapshot
+	std::fill( std::begin( client->entityHeldBackTime ), std::end( client->entityHeldBackTime ), 0 );
 	client->lastUsercmd = *cmd;
 
 	// call the game begin function
@@ -1329,8 +1334,9 @@ static void SV_UserMove( client_t *cl, msg_t *msg, bool delta )
 		oldcmd = cmd;
 	}
 
-	// save time for ping calculation
-	cl->frames[ cl->messageAcknowledge & PACKET_MASK ].messageAcked = svs.time;
+	// save time for ping calculation, the arrival time of the packet is
+	// more accurate than the time of the frame it is processed in
+	cl->frames[ cl->messageAcknowledge & PACKET_MASK ].messageAcked = svs.packetTime;
 
 	// if this is the first usercmd we have received
 	// this gamestate, put the client into the world
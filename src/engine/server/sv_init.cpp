@@ -415,6 +415,8 @@ void SV_ChangeMaxClients()
 	// free the old clients on the hunk
 	Hunk_FreeTempMemory( oldClients );
 
+	SV_RebuildClientIndex();
+
 	svs.numSnapshotEntities = sv_maxclients->integer * PACKET_BACKUP * 64;
 }
 
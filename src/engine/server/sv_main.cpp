@@ -661,6 +661,97 @@ void SVC_Ping( netadr_t from, const Cmd::Args& )
 	Net::OutOfBandPrint( netsrc_t::NS_SERVER, from, "ack\n" );
 }
 
+/*
+=================
+SV_HashAdr
+
+Hashes an address without its port
+=================
+*/
+static uint32_t SV_HashAdr( const netadr_t &adr )
+{
+	netadrtype_t type = NET_TYPE( adr.type );
+	uint32_t     hash = 2166136261u ^ Util::ordinal( type );
+	const byte   *bytes = nullptr;
+	int          numBytes = 0;
+
+	if ( type == netadrtype_t::NA_IP )
+	{
+		bytes = adr.ip;
+		numBytes = sizeof( adr.ip );
+	}
+	else if ( type == netadrtype_t::NA_IP6 )
+	{
+		bytes = adr.ip6;
+		numBytes = sizeof( adr.ip6 );
+	}
+
+	for ( int i = 0; i < numBytes; i++ )
+	{
+		hash = ( hash ^ bytes[ i ] ) * 16777619u;
+	}
+
+	return hash ^ ( hash >> 15 );
+}
+
+/*
+=================
+SV_RefillInfoBucket
+
+Gives back the responses of a bucket that are older than the refill period
+=================
+*/
+static void SV_RefillInfoBucket( infoBucket_t *bucket, int size )
+{
+	int elapsed = svs.time - bucket->time;
+
+	if ( elapsed >= INFO_RECEIPT_PERIOD || elapsed < 0 )
+	{
+		bucket->used = 0.0f;
+	}
+	else
+	{
+		bucket->used = std::max( 0.0f, bucket->used - elapsed * size / float( INFO_RECEIPT_PERIOD ) );
+	}
+
+	bucket->time = svs.time;
+}
+
+/*
+=================
+SV_SubnetInfoBucket
+
+Finds the bucket of a subnet, or the one to replace by it
+=================
+*/
+static infoBucket_t *SV_SubnetInfoBucket( netadr_t subnet )
+{
+	uint32_t     hash = SV_HashAdr( subnet );
+	infoBucket_t *stalest = nullptr;
+
+	for ( int i = 0; i < INFO_BUCKET_PROBES; i++ )
+	{
+		infoBucket_t *bucket = &svs.infoBuckets[ ( hash + i ) & ( INFO_BUCKETS - 1 ) ];
+
+		if ( bucket->adr.type == subnet.type && NET_CompareBaseAdr( subnet, bucket->adr ) )
+		{
+			return bucket;
+		}
+
+		if ( !stalest || bucket->time - stalest->time < 0 )
+		{
+			stalest = bucket;
+		}
+	}
+
+	// the stalest bucket has usually been refilled already, when it hasn't
+	// its subnet only gets to start over if it comes back
+	stalest->adr = subnet;
+	stalest->time = svs.time;
+	stalest->used = 0.0f;
+	return stalest;
+}
+
 /*
 =================
 SV_CheckDRDoS
@@ -674,15 +765,10 @@ If the address isn't NA_IP, it's automatically denied.
 */
 bool SV_CheckDRDoS( netadr_t from )
 {
-	int        i;
-	int        globalCount;
-	int        specificCount;
-	receipt_t  *receipt;
-	netadr_t   exactFrom;
-	int        oldest;
-	int        oldestTime;
-	static int lastGlobalLogTime = 0;
-	static int lastSpecificLogTime = 0;
+	infoBucket_t *bucket;
+	netadr_t     exactFrom;
+	static int   lastGlobalLogTime = 0;
+	static int   lastSpecificLogTime = 0;
 
 	// Usually the network is smart enough to not allow incoming UDP packets
 	// with a source address being a spoofed LAN address.  Even if that's not
@@ -708,42 +794,13 @@ bool SV_CheckDRDoS( netadr_t from )
 		return true;
 	}
 
-	// Count receipts in last 2 seconds.
-	globalCount = 0;
-	specificCount = 0;
-	receipt = &svs.infoReceipts[ 0 ];
-	oldest = 0;
-	oldestTime = 0x7fffffff;
+	from.port = 0;
 
-	for ( i = 0; i < MAX_INFO_RECEIPTS; i++, receipt++ )
-	{
-		if ( receipt->time + 2000 > svs.time )
-		{
-			if ( receipt->time )
-			{
-				// When the server starts, all receipt times are at zero.  Furthermore,
-				// svs.time is close to zero.  We check that the receipt time is already
-				// set so that during the first two seconds after server starts, queries
-				// from the master servers don't get ignored.  As a consequence a potentially
-				// unlimited number of getinfo+getstatus responses may be sent during the
-				// first frame of a server's life.
-				globalCount++;
-			}
-
-			if ( NET_CompareBaseAdr( from, receipt->adr ) )
-			{
-				specificCount++;
-			}
-		}
+	// The buckets start empty, so queries from the master servers don't get
+	// ignored when the server starts.
+	SV_RefillInfoBucket( &svs.infoBucket, MAX_INFO_RECEIPTS );
 
-		if ( receipt->time < oldestTime )
-		{
-			oldestTime = receipt->time;
-			oldest = i;
-		}
-	}
-
-	if ( globalCount == MAX_INFO_RECEIPTS ) // All receipts happened in last 2 seconds.
+	if ( svs.infoBucket.used > MAX_INFO_RECEIPTS - 1 ) // Sent them all in the last 2 seconds.
 	{
 		if ( lastGlobalLogTime + 1000 <= svs.time ) // Limit one log every second.
 		{
@@ -754,21 +811,23 @@ bool SV_CheckDRDoS( netadr_t from )
 		return true;
 	}
 
-	if ( specificCount >= 3 ) // Already sent 3 to this IP address in last 2 seconds.
+	bucket = SV_SubnetInfoBucket( from );
+	SV_RefillInfoBucket( bucket, MAX_SUBNET_RECEIPTS );
+
+	if ( bucket->used > MAX_SUBNET_RECEIPTS - 1 ) // Already sent 3 to this subnet in the last 2 seconds.
 	{
 		if ( lastSpecificLogTime + 1000 <= svs.time ) // Limit one log every second.
 		{
-			Log::Notice( "Possible DRDoS attack to address %i.%i.%i.%i, ignoring getinfo/getstatus connectionless packet",
-			            exactFrom.ip[ 0 ], exactFrom.ip[ 1 ], exactFrom.ip[ 2 ], exactFrom.ip[ 3 ] );
+			Log::Notice( "Possible DRDoS attack to address %s, ignoring getinfo/getstatus connectionless packet",
+			            NET_AdrToString( exactFrom ) );
 			lastSpecificLogTime = svs.time;
 		}
 
 		return true;
 	}
 
-	receipt = &svs.infoReceipts[ oldest ];
-	receipt->adr = from;
-	receipt->time = svs.time;
+	svs.infoBucket.used += 1.0f;
+	bucket->used += 1.0f;
 	return false;
 }
 
@@ -1098,32 +1157,114 @@ void SV_ConnectionlessPacket( netadr_t from, msg_t *msg )
 //============================================================================
 
 /*
-=================
-SV_ReadPackets
-=================
+==================
+SV_ClientIndexSlot
+
+The home slot of a client address in svs.clientIndex. The port isn't part of
+it, so the slot doesn't change when a router translates the port.
+==================
 */
-void SV_PacketEvent( netadr_t from, msg_t *msg )
+static int SV_ClientIndexSlot( netadr_t adr, int qport )
 {
-	int      i;
-	client_t *cl;
-	int      qport;
+	return ( SV_HashAdr( adr ) ^ ( qport * 0x9e3779b1u ) ) & ( CLIENT_INDEX_SIZE - 1 );
+}
 
-	// check for connectionless packet (0xffffffff) first
-	if ( msg->cursize >= 4 && * ( int * ) msg->data == -1 )
+/*
+==================
+SV_AddClientIndex
+
+Called when a client connects
+==================
+*/
+void SV_AddClientIndex( client_t *cl )
+{
+	int slot = SV_ClientIndexSlot( cl->netchan.remoteAddress, cl->netchan.qport );
+
+	while ( svs.clientIndex[ slot ] )
 	{
-		SV_ConnectionlessPacket( from, msg );
-		return;
+		slot = ( slot + 1 ) & ( CLIENT_INDEX_SIZE - 1 );
 	}
 
-	// read the qport out of the message so we can fix up
-	// stupid address translating routers
-	MSG_BeginReadingOOB( msg );
-	MSG_ReadLong( msg );  // sequence number
-	qport = MSG_ReadShort( msg ) & 0xffff;
+	svs.clientIndex[ slot ] = cl - svs.clients + 1;
+}
 
-	// find which client the message is from
-	for ( i = 0, cl = svs.clients; i < sv_maxclients->integer; i++, cl++ )
+/*
+==================
+SV_RemoveClientIndex
+
+Called before a client slot gets freed or reused, while its netchan still
+has the address it was added with
+==================
+*/
+void SV_RemoveClientIndex( client_t *cl )
+{
+	int clientNum = cl - svs.clients + 1;
+	int slot = SV_ClientIndexSlot( cl->netchan.remoteAddress, cl->netchan.qport );
+
+	while ( svs.clientIndex[ slot ] != clientNum )
+	{
+		if ( !svs.clientIndex[ slot ] )
+		{
+			return; // never added, e.g. a bot or a client rejected by the game
+		}
+
+		slot = ( slot + 1 ) & ( CLIENT_INDEX_SIZE - 1 );
+	}
+
+	// move back the following clients that can't be found anymore
+	// now that there is a hole in their probe sequence
+	for ( int next = ( slot + 1 ) & ( CLIENT_INDEX_SIZE - 1 ); svs.clientIndex[ next ];
+	      next = ( next + 1 ) & ( CLIENT_INDEX_SIZE - 1 ) )
+	{
+		client_t *other = &svs.clients[ svs.clientIndex[ next ] - 1 ];
+		int      home = SV_ClientIndexSlot( other->netchan.remoteAddress, other->netchan.qport );
+
+		if ( ( ( next - home ) & ( CLIENT_INDEX_SIZE - 1 ) ) >= ( ( next - slot ) & ( CLIENT_INDEX_SIZE - 1 ) ) )
+		{
+			svs.clientIndex[ slot ] = svs.clientIndex[ next ];
+			slot = next;
+		}
+	}
+
+	svs.clientIndex[ slot ] = 0;
+}
+
+/*
+==================
+SV_RebuildClientIndex
+
+Called when the client slots get reallocated
+==================
+*/
+void SV_RebuildClientIndex()
+{
+	memset( svs.clientIndex, 0, sizeof( svs.clientIndex ) );
+
+	for ( int i = 0; i < sv_maxclients->integer; i++ )
+	{
+		client_t *cl = &svs.clients[ i ];
+
+		if ( cl->state != clientState_t::CS_FREE && !SV_IsBot( cl ) )
+		{
+			SV_AddClientIndex( cl );
+		}
+	}
+}
+
+/*
+==================
+SV_ClientForPacket
+
+Finds the client a sequenced packet comes from
+==================
+*/
+static client_t *SV_ClientForPacket( netadr_t from, int qport )
+{
+	for ( int slot = SV_ClientIndexSlot( from, qport ); svs.clientIndex[ slot ];
+	      slot = ( slot + 1 ) & ( CLIENT_INDEX_SIZE - 1 ) )
 	{
+		client_t *cl = &svs.clients[ svs.clientIndex[ slot ] - 1 ];
+
 		if ( cl->state == clientState_t::CS_FREE )
 		{
 			continue;
@@ -1141,7 +1282,43 @@ void SV_PacketEvent( netadr_t from, msg_t *msg )
 			continue;
 		}
 
-		// the IP port can't be used to differentiate them, because
+		return cl;
+	}
+
+	return nullptr;
+}
+
+/*
+=================
+SV_ReadPackets
+=================
+*/
+void SV_PacketEvent( netadr_t from, msg_t *msg, int time )
+{
+	client_t *cl;
+	int      qport;
+
+	svs.packetTime = time;
+
+	// check for connectionless packet (0xffffffff) first
+	if ( msg->cursize >= 4 && * ( int * ) msg->data == -1 )
+	{
+		SV_ConnectionlessPacket( from, msg );
+		return;
+	}
+
+	// read the qport out of the message so we can fix up
+	// stupid address translating routers
+	MSG_BeginReadingOOB( msg );
+	MSG_ReadLong( msg );  // sequence number
+	qport = MSG_ReadShort( msg ) & 0xffff;
+
+	// find which client the message is from
+	cl = SV_ClientForPacket( from, qport );
+
+	if ( cl )
+	{
+		// the IP port can't be used to differentiate clients, because
 		// some address translating routers periodically change UDP
 		// port assignments
 		if ( cl->netchan.remoteAddress.port != from.port )
@@ -1278,6 +1455,7 @@ void SV_CheckTimeouts()
 		{
 			// using the client id cause the cl->name is empty at this point
 			Log::Debug( "Going from CS_ZOMBIE to CS_FREE for client %d", i );
+			SV_RemoveClientIndex( cl );
 			cl->state = clientState_t::CS_FREE; // can now be reused
 
 			continue;
@@ -1290,6 +1468,7 @@ void SV_CheckTimeouts()
 			if ( ++cl->timeoutCount > 5 )
 			{
 				SV_DropClient( cl, "timed out" );
+				SV_RemoveClientIndex( cl );
 				cl->state = clientState_t::CS_FREE; // don't bother with zombie state
 			}
 		}
@@ -393,6 +393,7 @@ void GameVM::Start()
 		Com_Error( errorParm_t::ERR_DROP, "SGame ABI mismatch, expected %d, got %d", GAME_API_VERSION, version );
 	}
 
+	this->CreateBulkBuffers();
 	this->GameStaticInit();
 }
 
@@ -33,6 +33,46 @@ Maryland 20850 USA.
 */
 
 #include "server.h"
+#include "common/ThreadPool.h"
+
+static Cvar::Range<Cvar::Cvar<int>> cvar_server_snapshot_threads(
+	"server.snapshot.threads",
+	"Number of worker threads used to build and encode client snapshots, 0 to do it on the main thread",
+	Cvar::NONE,
+	0,
+	0,
+	64
+);
+
+static Cvar::Cvar<bool> cvar_server_snapshot_entityIndex(
+	"server.snapshot.entityIndex",
+	"Find the entities visible to clients with a per frame index of the PVS clusters",
+	Cvar::NONE,
+	true
+);
+
+static Cvar::Cvar<bool> cvar_server_snapshot_deltaCache(
+	"server.snapshot.deltaCache",
+	"Encode the entity deltas that several clients are sent only once per frame",
+	Cvar::NONE,
+	true
+);
+
+static Cvar::Cvar<bool> cvar_server_snapshot_prioritize(
+	"server.snapshot.prioritize",
+	"Hold back the least important entity changes of the snapshots that are too big for the rate of the client",
+	Cvar::NONE,
+	true
+);
+
+static Cvar::Cvar<bool> cvar_server_snapshot_showStats(
+	"server.snapshot.showStats",
+	"Print how many entities were checked to build the snapshots, how many entity deltas were found in the cache or held back and how long sending them took",
+	Cvar::NONE,
+	false
+);
+
+static Sys::ThreadPool snapshotPool;
 
 /*
 =============================================================================
@@ -56,6 +96,172 @@ A server packet will look something like:
 =============================================================================
 */
 
+/*
+=============================================================================
+
+Entity delta cache
+
+Clients that are in sync are sent the same deltas of the same entities, so
+the encoded bits of each delta are kept for the frame and written again for
+the following clients instead of being encoded once per client. Entries are
+found by entity number and checked against the whole from and to states, so
+the messages are exactly the same as without the cache. The snapshots may be
+written on several threads, the entities are split between locked shards.
+
+=============================================================================
+*/
+
+#define DELTA_CACHE_SHARDS 64 // must be a power of two
+
+// distinct deltas kept for one entity in a frame, clients that are out of
+// sync with all of them encode their own
+#define MAX_DELTA_CACHE_ENTITY_ENTRIES 4
+
+struct deltaCacheEntry_t
+{
+	entityState_t from;
+	entityState_t to;
+	bool          force;
+	int           next; // next entry of the same entity, -1 for none
+	int           firstByte; // in the bits of the shard
+	int           numBits;
+	int           uncompsize;
+};
+
+struct deltaCacheShard_t
+{
+	std::mutex                     mutex;
+	std::vector<deltaCacheEntry_t> entries;
+	std::vector<byte>              bits;
+	int                            lookups;
+	int                            hits;
+};
+
+static deltaCacheShard_t deltaCacheShards[ DELTA_CACHE_SHARDS ];
+
+// first entry of each entity in its shard, -1 for none
+static int deltaCacheHeads[ MAX_GENTITIES ];
+
+// the cvar is read once per frame on the main thread
+static bool deltaCacheEnabled;
+
+/*
+=============
+SV_ClearDeltaCache
+=============
+*/
+static void SV_ClearDeltaCache()
+{
+	for ( deltaCacheShard_t &shard : deltaCacheShards )
+	{
+		shard.entries.clear();
+		shard.bits.clear();
+		shard.lookups = 0;
+		shard.hits = 0;
+	}
+
+	std::fill( std::begin( deltaCacheHeads ), std::end( deltaCacheHeads ), -1 );
+
+	deltaCacheEnabled = cvar_server_snapshot_deltaCache.Get();
+}
+
+/*
+=============
+SV_WriteCachedDeltaEntity
+
+MSG_WriteDeltaEntity through the delta cache, countStats is false when the
+delta is only written again or measured
+=============
+*/
+static void SV_WriteCachedDeltaEntity( msg_t *msg, entityState_t *from, entityState_t *to, bool force, bool countStats )
+{
+	// removals are too short to be worth it, and unchanged entities
+	// are found without encoding anything
+	if ( !deltaCacheEnabled || !to || ( !force && !memcmp( from, to, sizeof( *to ) ) ) )
+	{
+		MSG_WriteDeltaEntity( msg, from, to, force );
+		return;
+	}
+
+	int               number = to->number & ( MAX_GENTITIES - 1 );
+	deltaCacheShard_t &shard = deltaCacheShards[ number & ( DELTA_CACHE_SHARDS - 1 ) ];
+	int               numEntries = 0;
+
+	{
+		std::lock_guard<std::mutex> lock( shard.mutex );
+
+		if ( countStats )
+		{
+			shard.lookups++;
+		}
+
+		for ( int i = deltaCacheHeads[ number ]; i >= 0; i = shard.entries[ i ].next, numEntries++ )
+		{
+			const deltaCacheEntry_t &entry = shard.entries[ i ];
+
+			if ( entry.force == force && !memcmp( &entry.to, to, sizeof( *to ) ) &&
+			     !memcmp( &entry.from, from, sizeof( *from ) ) )
+			{
+				if ( countStats )
+				{
+					shard.hits++;
+				}
+
+				if ( !MSG_WriteEncodedBits( msg, shard.bits.data() + entry.firstByte, entry.numBits, entry.uncompsize ) )
+				{
+					MSG_WriteDeltaEntity( msg, from, to, force );
+				}
+
+				return;
+			}
+		}
+	}
+
+	// an entity delta is well below this size, if it doesn't fit anyway
+	// it is simply not cached
+	byte  buffer[ 4 * sizeof( entityState_t ) ];
+	msg_t encoded;
+
+	MSG_Init( &encoded, buffer, sizeof( buffer ) );
+	encoded.allowoverflow = true;
+
+	MSG_WriteDeltaEntity( &encoded, from, to, force );
+
+	if ( encoded.overflowed )
+	{
+		MSG_WriteDeltaEntity( msg, from, to, force );
+		return;
+	}
+
+	if ( !MSG_WriteEncodedBits( msg, encoded.data, encoded.bit, encoded.uncompsize ) )
+	{
+		MSG_WriteDeltaEntity( msg, from, to, force );
+	}
+
+	if ( numEntries >= MAX_DELTA_CACHE_ENTITY_ENTRIES )
+	{
+		return;
+	}
+
+	// another thread may have added the same delta in the meantime,
+	// which only wastes a little space
+	std::lock_guard<std::mutex> lock( shard.mutex );
+
+	deltaCacheEntry_t entry;
+
+	entry.from = *from;
+	entry.to = *to;
+	entry.force = force;
+	entry.next = deltaCacheHeads[ number ];
+	entry.firstByte = shard.bits.size();
+	entry.numBits = encoded.bit;
+	entry.uncompsize = encoded.uncompsize;
+
+	shard.bits.insert( shard.bits.end(), buffer, buffer + ( ( encoded.bit + 7 ) >> 3 ) );
+	deltaCacheHeads[ number ] = shard.entries.size();
+	shard.entries.push_back( entry );
+}
+
 /*
 =============
 SV_EmitPacketEntities
@@ -63,7 +269,7 @@ SV_EmitPacketEntities
 Writes a delta update of an entityState_t list to the message.
 =============
 */
-static void SV_EmitPacketEntities( const clientSnapshot_t *from, clientSnapshot_t *to, msg_t *msg )
+static void SV_EmitPacketEntities( const clientSnapshot_t *from, clientSnapshot_t *to, msg_t *msg, bool countStats )
 {
 	entityState_t *oldent, *newent;
 	int           oldindex, newindex;
@@ -117,7 +323,7 @@ static void SV_EmitPacketEntities( const clientSnapshot_t *from, clientSnapshot_
 			// delta update from old position
 			// because the force parm is false, this will not result
 			// in any bytes being emited if the entity has not changed at all
-			MSG_WriteDeltaEntity( msg, oldent, newent, false );
+			SV_WriteCachedDeltaEntity( msg, oldent, newent, false, countStats );
 			oldindex++;
 			newindex++;
 			continue;
@@ -126,7 +332,7 @@ static void SV_EmitPacketEntities( const clientSnapshot_t *from, clientSnapshot_
 		if ( newnum < oldnum )
 		{
 			// this is a new entity, send it from the baseline
-			MSG_WriteDeltaEntity( msg, &sv.svEntities[ newnum ].baseline, newent, true );
+			SV_WriteCachedDeltaEntity( msg, &sv.svEntities[ newnum ].baseline, newent, true, countStats );
 			newindex++;
 			continue;
 		}
@@ -143,12 +349,283 @@ static void SV_EmitPacketEntities( const clientSnapshot_t *from, clientSnapshot_
 	MSG_WriteBits( msg, ( MAX_GENTITIES - 1 ), GENTITYNUM_BITS );  // end of packetentities
 }
 
+/*
+=============================================================================
+
+Entity prioritization
+
+When the entities of a snapshot don't fit in what the rate of the client
+allows to send every snapshotMsec, the least important changes are held
+back instead of fragmenting the message: a changed entity keeps the state
+the client already has and a new one is left out, so the next snapshot,
+which is delta compressed against this one, sends them again. Entities
+score higher when they are close, in front of the client and have been
+held back for long. Events and removals are always sent.
+
+Only the changes of the entities that are still the same in the last sent
+snapshot as in the acknowledged one are held back: the client may already
+show the newer state of the others, holding them back would make them jump
+back or disappear for a moment.
+
+=============================================================================
+*/
+
+// distance at which the score of an entity is halved
+static const float PRIORITY_HALF_DISTANCE = 1024.0f;
+
+// the score of a held back entity grows by its base value every PRIORITY_AGE_MSEC
+static const float PRIORITY_AGE_MSEC = 100.0f;
+
+// room always left to the entities, even when the reliable commands and the
+// playerstate already take the whole budget
+static const int MIN_ENTITY_BUDGET_BYTES = 128;
+
+struct entityPriority_t
+{
+	int   index; // in the new snapshot
+	int   oldIndex; // in the delta frame, -1 for a new entity
+	int   bits;
+	float score;
+};
+
+// the snapshot writers may run on several threads
+static std::atomic<int> heldBackEntities;
+
+static int SV_SnapshotBudget( const client_t *client );
+
+/*
+=============
+SV_EntityDeltaBits
+
+Size of an entity delta once encoded
+=============
+*/
+static int SV_EntityDeltaBits( entityState_t *from, entityState_t *to, bool force )
+{
+	byte  buffer[ 4 * sizeof( entityState_t ) ];
+	msg_t msg;
+
+	MSG_Init( &msg, buffer, sizeof( buffer ) );
+	msg.allowoverflow = true;
+
+	// the deltas were just written once, so they come from the cache,
+	// but measuring them isn't a use of the cache
+	SV_WriteCachedDeltaEntity( &msg, from, to, force, false );
+
+	return msg.overflowed ? MAX_MSGLEN * 8 : msg.bit;
+}
+
+/*
+=============
+SV_EntityMustBeSent
+
+Events would be lost if they were held back
+=============
+*/
+static bool SV_EntityMustBeSent( const entityState_t *from, const entityState_t *to )
+{
+	if ( Util::ordinal( to->eType ) >= Util::ordinal( entityType_t::ET_EVENTS ) )
+	{
+		return true;
+	}
+
+	return from && ( from->event != to->event || from->eventSequence != to->eventSequence );
+}
+
+/*
+=============
+SV_SentEntityState
+
+The state of an entity in a snapshot, looked up in increasing entity number
+order from cursor, nullptr if it isn't in the snapshot
+=============
+*/
+static const entityState_t *SV_SentEntityState( const clientSnapshot_t *frame, int number, int *cursor )
+{
+	for ( ; *cursor < frame->num_entities; ( *cursor )++ )
+	{
+		const entityState_t *state = &svs.snapshotEntities[( frame->first_entity + *cursor ) % svs.numSnapshotEntities ];
+
+		if ( state->number >= number )
+		{
+			return state->number == number ? state : nullptr;
+		}
+	}
+
+	return nullptr;
+}
+
+/*
+=============
+SV_PrioritizeSnapshotEntities
+
+Holds back the entity changes of a snapshot that don't fit in budgetBits.
+sent is the last snapshot sent to the client if it isn't from.
+=============
+*/
+static void SV_PrioritizeSnapshotEntities( client_t *client, const clientSnapshot_t *from, const clientSnapshot_t *sent,
+                                           clientSnapshot_t *to, int budgetBits )
+{
+	entityPriority_t           candidates[ MAX_GENTITIES ];
+	int                        numCandidates = 0;
+	std::bitset<MAX_GENTITIES> leftOut;
+	vec3_t                     viewOrigin, viewForward;
+	int                        oldindex = 0, newindex = 0, sentindex = 0;
+
+	VectorCopy( to->ps.origin, viewOrigin );
+	viewOrigin[ 2 ] += to->ps.viewheight;
+	AngleVectors( to->ps.viewangles, viewForward, nullptr, nullptr );
+
+	// the end of the entities
+	budgetBits -= GENTITYNUM_BITS;
+
+	while ( newindex < to->num_entities || oldindex < from->num_entities )
+	{
+		entityState_t *newent = nullptr, *oldent = nullptr;
+		int           newnum = MAX_GENTITIES, oldnum = MAX_GENTITIES;
+
+		if ( newindex < to->num_entities )
+		{
+			newent = &svs.snapshotEntities[( to->first_entity + newindex ) % svs.numSnapshotEntities ];
+			newnum = newent->number;
+		}
+
+		if ( oldindex < from->num_entities )
+		{
+			oldent = &svs.snapshotEntities[( from->first_entity + oldindex ) % svs.numSnapshotEntities ];
+			oldnum = oldent->number;
+		}
+
+		if ( newnum > oldnum )
+		{
+			// removals are always sent
+			budgetBits -= GENTITYNUM_BITS + 1;
+			client->entityHeldBackTime[ oldnum ] = 0;
+			oldindex++;
+			continue;
+		}
+
+		entityState_t *base = newnum == oldnum ? oldent : &sv.svEntities[ newnum ].baseline;
+		bool          force = newnum != oldnum;
+
+		if ( !force && !memcmp( oldent, newent, sizeof( *newent ) ) )
+		{
+			oldindex++;
+			newindex++;
+			continue;
+		}
+
+		int  bits = SV_EntityDeltaBits( base, newent, force );
+		bool clientHasNewer = false;
+
+		if ( sent )
+		{
+			const entityState_t *sentState = SV_SentEntityState( sent, newnum, &sentindex );
+
+			clientHasNewer = force ? sentState != nullptr : !sentState || memcmp( sentState, oldent, sizeof( *oldent ) );
+		}
+
+		if ( clientHasNewer || SV_EntityMustBeSent( force ? nullptr : oldent, newent ) )
+		{
+			budgetBits -= bits;
+			client->entityHeldBackTime[ newnum ] = 0;
+		}
+		else
+		{
+			entityPriority_t &candidate = candidates[ numCandidates++ ];
+			vec3_t           dir;
+			int              heldBackTime = client->entityHeldBackTime[ newnum ];
+
+			VectorSubtract( newent->pos.trBase, viewOrigin, dir );
+			float distance = VectorNormalize( dir );
+
+			candidate.index = newindex;
+			candidate.oldIndex = force ? -1 : oldindex;
+			candidate.bits = bits;
+
+			// entities behind the client count half as much as those in front
+			candidate.score = PRIORITY_HALF_DISTANCE / ( PRIORITY_HALF_DISTANCE + distance );
+			candidate.score *= 0.75f + 0.25f * DotProduct( dir, viewForward );
+
+			if ( heldBackTime )
+			{
+				candidate.score *= 1.0f + ( svs.time - heldBackTime ) / PRIORITY_AGE_MSEC;
+			}
+		}
+
+		if ( !force )
+		{
+			oldindex++;
+		}
+
+		newindex++;
+	}
+
+	std::sort( candidates, candidates + numCandidates,
+	           []( const entityPriority_t &a, const entityPriority_t &b ) {
+	               return a.score > b.score;
+	           } );
+
+	// the smaller ones that still fit are sent after a bigger one that doesn't
+	for ( int i = 0; i < numCandidates; i++ )
+	{
+		const entityPriority_t &candidate = candidates[ i ];
+		entityState_t          *state = &svs.snapshotEntities[( to->first_entity + candidate.index ) % svs.numSnapshotEntities ];
+		int                    number = state->number;
+
+		if ( candidate.bits <= budgetBits )
+		{
+			budgetBits -= candidate.bits;
+			client->entityHeldBackTime[ number ] = 0;
+			continue;
+		}
+
+		if ( !client->entityHeldBackTime[ number ] )
+		{
+			client->entityHeldBackTime[ number ] = svs.time;
+		}
+
+		heldBackEntities++;
+
+		if ( candidate.oldIndex >= 0 )
+		{
+			*state = svs.snapshotEntities[( from->first_entity + candidate.oldIndex ) % svs.numSnapshotEntities ];
+		}
+		else
+		{
+			leftOut[ number ] = true;
+		}
+	}
+
+	if ( leftOut.none() )
+	{
+		return;
+	}
+
+	int numKept = 0;
+
+	for ( int i = 0; i < to->num_entities; i++ )
+	{
+		entityState_t *state = &svs.snapshotEntities[( to->first_entity + i ) % svs.numSnapshotEntities ];
+
+		if ( !leftOut[ state->number ] )
+		{
+			svs.snapshotEntities[( to->first_entity + numKept++ ) % svs.numSnapshotEntities ] = *state;
+		}
+	}
+
+	to->num_entities = numKept;
+}
+
 /*
 ==================
 SV_WriteSnapshotToClient
+
+nextSnapshotEntities is the value svs.nextSnapshotEntities had when the
+snapshot was built, which tells which older frames are still usable.
 ==================
 */
-static void SV_WriteSnapshotToClient( client_t *client, msg_t *msg )
+static void SV_WriteSnapshotToClient( client_t *client, msg_t *msg, int nextSnapshotEntities )
 {
 	clientSnapshot_t *frame, *oldframe;
 	int              lastframe;
@@ -179,7 +656,7 @@ static void SV_WriteSnapshotToClient( client_t *client, msg_t *msg )
 		lastframe = client->netchan.outgoingSequence - client->deltaMessage;
 
 		// the snapshot's entities may still have rolled off the buffer, though
-		if ( oldframe->first_entity <= svs.nextSnapshotEntities - svs.numSnapshotEntities )
+		if ( oldframe->first_entity <= nextSnapshotEntities - svs.numSnapshotEntities )
 		{
 			Log::Debug( "%s^7: Delta request from out of date entities.", client->name );
 			oldframe = nullptr;
@@ -231,7 +708,34 @@ static void SV_WriteSnapshotToClient( client_t *client, msg_t *msg )
 	}
 
 	// delta encode the entities
-	SV_EmitPacketEntities( oldframe, frame, msg );
+	msg_t            entitiesStart = *msg;
+	int              budget = oldframe && cvar_server_snapshot_prioritize.Get() ? SV_SnapshotBudget( client ) : 0;
+	clientSnapshot_t *sentframe = nullptr;
+
+	// the client may have been sent newer states than the delta frame has
+	if ( budget && client->netchan.outgoingSequence - 1 != client->deltaMessage )
+	{
+		sentframe = &client->frames[ ( client->netchan.outgoingSequence - 1 ) & PACKET_MASK ];
+
+		// without them nothing can be held back safely
+		if ( sentframe->first_entity <= nextSnapshotEntities - svs.numSnapshotEntities )
+		{
+			budget = 0;
+		}
+	}
+
+	SV_EmitPacketEntities( oldframe, frame, msg, true );
+
+	// too big for the rate, start over with only the most important changes
+	if ( budget && msg->cursize > budget )
+	{
+		*msg = entitiesStart;
+		msg->data[ msg->bit >> 3 ] &= ( 1 << ( msg->bit & 7 ) ) - 1;
+
+		SV_PrioritizeSnapshotEntities( client, oldframe, sentframe, frame,
+		                               std::max( budget - msg->cursize, MIN_ENTITY_BUDGET_BYTES ) * 8 );
+		SV_EmitPacketEntities( oldframe, frame, msg, false );
+	}
 
 	// padding for rate debugging
 	if ( sv_padPackets->integer )
@@ -280,8 +784,51 @@ struct snapshotEntityNumbers_t
 {
 	int numSnapshotEntities;
 	int snapshotEntities[ MAX_SNAPSHOT_ENTITIES ];
+
+	// entities already considered for this snapshot, used to prevent double adding from portal views
+	std::bitset<MAX_GENTITIES> considered;
+
+	// entities that may never be sent to this client
+	std::bitset<MAX_GENTITIES> hidden;
+
+	// number of entities whose visibility had to be checked, for statistics
+	int numCandidates;
+};
+
+/*
+The entities that may be sent to clients, indexed once per frame so that
+snapshots don't need to check every entity against the PVS of the client.
+*/
+struct snapshotEntityIndex_t
+{
+	// the entities touching each cluster are stored contiguously in clusterEntities
+	std::vector<int> clusterNumEntities;
+	std::vector<int> clusterFirstEntity;
+	std::vector<int> clusterEntities;
+
+	// clusters touched by at least one entity
+	std::vector<int> occupiedClusters;
+
+	// entities checked from every viewpoint: broadcast, range and origin based ones,
+	// and those whose clusters couldn't be indexed
+	std::vector<int> alwaysCheckedEntities;
+
+	// entities that are only sent to some clients
+	std::vector<int> restrictedEntities;
 };
 
+static snapshotEntityIndex_t entityIndex;
+
+static struct
+{
+	int snapshots;
+	int candidates;
+	int entities;
+} snapshotStats;
+
+// every entity can be considered at most once, so the list never needs to be truncated
+static_assert( MAX_GENTITIES <= MAX_SNAPSHOT_ENTITIES, "snapshot entity list too small" );
+
 /*
 =======================
 SV_QsortEntityNumbers
@@ -310,35 +857,238 @@ static int QDECL SV_QsortEntityNumbers( const void *a, const void *b )
 /*
 ===============
 SV_AddEntToSnapshot
+
+Entities with a snapshot callback are added anyway, the callback is
+checked later by SV_FilterSnapshotEntities since it can't run in parallel.
 ===============
 */
-static void SV_AddEntToSnapshot( sharedEntity_t *clientEnt, svEntity_t *svEnt, sharedEntity_t *gEnt,
-                                 snapshotEntityNumbers_t *eNums )
+static void SV_AddEntToSnapshot( sharedEntity_t *gEnt, snapshotEntityNumbers_t *eNums )
 {
 	// if we have already added this entity to this snapshot, don't add again
-	if ( svEnt->snapshotCounter == sv.snapshotCounter )
+	if ( eNums->considered[ gEnt->s.number ] )
 	{
 		return;
 	}
 
-	svEnt->snapshotCounter = sv.snapshotCounter;
+	eNums->considered[ gEnt->s.number ] = true;
 
-	// if we are full, silently discard entities
-	if ( eNums->numSnapshotEntities == MAX_SNAPSHOT_ENTITIES )
-	{
-		return;
-	}
+	eNums->snapshotEntities[ eNums->numSnapshotEntities ] = gEnt->s.number;
+	eNums->numSnapshotEntities++;
+}
 
-	if ( gEnt->r.snapshotCallback )
-	{
-		if ( !gvm.GameSnapshotCallback( gEnt->s.number, clientEnt->s.number ) )
+/*
+===============
+SV_FilterSnapshotEntities
+
+Asks the game whether the entities that requested it should be in the snapshot.
+This calls into the game VM so it has to run on the main thread.
+===============
+*/
+static void SV_FilterSnapshotEntities( sharedEntity_t *clientEnt, snapshotEntityNumbers_t *eNums )
+{
+	int numKept = 0;
+
+	for ( int i = 0; i < eNums->numSnapshotEntities; i++ )
+	{
+		int number = eNums->snapshotEntities[ i ];
+		sharedEntity_t *gEnt = SV_GentityNum( number );
+
+		if ( gEnt->r.snapshotCallback && !gvm.GameSnapshotCallback( number, clientEnt->s.number ) )
 		{
-			return;
+			continue;
 		}
+
+		eNums->snapshotEntities[ numKept++ ] = number;
 	}
 
-	eNums->snapshotEntities[ eNums->numSnapshotEntities ] = gEnt->s.number;
-	eNums->numSnapshotEntities++;
+	eNums->numSnapshotEntities = numKept;
+}
+
+/*
+===============
+SV_EntityHiddenFromClient
+
+Whether the game restricted the entity to other clients.
+===============
+*/
+static bool SV_EntityHiddenFromClient( const sharedEntity_t *ent, int clientNum )
+{
+	// entities can be flagged to be sent to only one client
+	if ( ent->r.svFlags & SVF_SINGLECLIENT )
+	{
+		if ( ent->r.singleClient != clientNum )
+		{
+			return true;
+		}
+	}
+
+	// entities can be flagged to be sent to everyone but one client
+	if ( ent->r.svFlags & SVF_NOTSINGLECLIENT )
+	{
+		if ( ent->r.singleClient == clientNum )
+		{
+			return true;
+		}
+	}
+
+	// entities can be flagged to be sent to only a given mask of clients
+	if ( ent->r.svFlags & SVF_CLIENTMASK )
+	{
+		if ( clientNum >= 32 )
+		{
+			if ( ~ent->r.hiMask & ( 1 << ( clientNum - 32 ) ) )
+			{
+				return true;
+			}
+		}
+		else
+		{
+			if ( ~ent->r.loMask & ( 1 << clientNum ) )
+			{
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+/*
+===============
+SV_EntityClustersIndexable
+
+Whether the visibility of the entity only depends on its cluster list.
+===============
+*/
+static bool SV_EntityClustersIndexable( const sharedEntity_t *ent, int numMapClusters )
+{
+	if ( ent->r.svFlags & ( SVF_BROADCAST | SVF_CLIENTS_IN_RANGE | SVF_IGNOREBMODELEXTENTS ) )
+	{
+		return false;
+	}
+
+	// overflowing cluster lists are checked the slow way
+	if ( ent->r.numClusters < 0 || ent->r.numClusters > MAX_ENT_CLUSTERS || ent->r.lastCluster )
+	{
+		return false;
+	}
+
+	for ( int i = 0; i < ent->r.numClusters; i++ )
+	{
+		if ( ent->r.clusternums[ i ] < 0 || ent->r.clusternums[ i ] >= numMapClusters )
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/*
+===============
+SV_BuildEntityIndex
+
+Makes sure the entity numbers are right and sorts the entities by cluster
+before snapshots, which may be built on several threads, look at them.
+===============
+*/
+static void SV_BuildEntityIndex()
+{
+	snapshotEntityIndex_t &index = entityIndex;
+	int numMapClusters = CM_NumClusters();
+	bool useClusters = cvar_server_snapshot_entityIndex.Get();
+
+	if ( (int) index.clusterNumEntities.size() != numMapClusters )
+	{
+		index.clusterNumEntities.assign( numMapClusters, 0 );
+		index.clusterFirstEntity.assign( numMapClusters, 0 );
+	}
+	else
+	{
+		for ( int cluster : index.occupiedClusters )
+		{
+			index.clusterNumEntities[ cluster ] = 0;
+		}
+	}
+
+	index.clusterEntities.clear();
+	index.occupiedClusters.clear();
+	index.alwaysCheckedEntities.clear();
+	index.restrictedEntities.clear();
+
+	// count the entities in each cluster
+	for ( int e = 0; e < sv.num_entities; e++ )
+	{
+		sharedEntity_t *ent = SV_GentityNum( e );
+
+		// never send entities that aren't linked in
+		if ( !ent->r.linked )
+		{
+			continue;
+		}
+
+		if ( ent->s.number != e )
+		{
+			Log::Debug( "FIXING ENT->S.NUMBER!!!" );
+			ent->s.number = e;
+		}
+
+		// entities can be flagged to explicitly not be sent to the client
+		if ( ent->r.svFlags & SVF_NOCLIENT )
+		{
+			continue;
+		}
+
+		if ( ent->r.svFlags & ( SVF_SINGLECLIENT | SVF_NOTSINGLECLIENT | SVF_CLIENTMASK ) )
+		{
+			index.restrictedEntities.push_back( e );
+		}
+
+		if ( !useClusters || !SV_EntityClustersIndexable( ent, numMapClusters ) )
+		{
+			index.alwaysCheckedEntities.push_back( e );
+			continue;
+		}
+
+		for ( int i = 0; i < ent->r.numClusters; i++ )
+		{
+			int cluster = ent->r.clusternums[ i ];
+
+			if ( index.clusterNumEntities[ cluster ]++ == 0 )
+			{
+				index.occupiedClusters.push_back( cluster );
+			}
+		}
+	}
+
+	int numClusterEntities = 0;
+
+	for ( int cluster : index.occupiedClusters )
+	{
+		index.clusterFirstEntity[ cluster ] = numClusterEntities;
+		numClusterEntities += index.clusterNumEntities[ cluster ];
+		index.clusterNumEntities[ cluster ] = 0;
+	}
+
+	// then store them
+	index.clusterEntities.resize( numClusterEntities );
+
+	for ( int e = 0; e < sv.num_entities && useClusters; e++ )
+	{
+		sharedEntity_t *ent = SV_GentityNum( e );
+
+		if ( !ent->r.linked || ( ent->r.svFlags & SVF_NOCLIENT ) || !SV_EntityClustersIndexable( ent, numMapClusters ) )
+		{
+			continue;
+		}
+
+		for ( int i = 0; i < ent->r.numClusters; i++ )
+		{
+			int cluster = ent->r.clusternums[ i ];
+
+			index.clusterEntities[ index.clusterFirstEntity[ cluster ] + index.clusterNumEntities[ cluster ]++ ] = e;
+		}
+	}
 }
 
 /*
@@ -353,7 +1103,6 @@ static void SV_AddEntitiesVisibleFromPoint( vec3_t origin, clientSnapshot_t *fra
 {
 	int            e, i;
 	sharedEntity_t *ent, *playerEnt;
-	svEntity_t     *svEnt;
 	int            l;
 	int            clientarea, clientcluster;
 	int            leafnum;
@@ -387,77 +1136,58 @@ static void SV_AddEntitiesVisibleFromPoint( vec3_t origin, clientSnapshot_t *fra
 		SV_AddEntitiesVisibleFromPoint( playerEnt->s.origin2, frame, eNums );
 	}
 
-	for ( e = 0; e < sv.num_entities; e++ )
-	{
-		ent = SV_GentityNum( e );
+	// only the entities touching a potentially visible cluster need to be checked
+	std::bitset<MAX_GENTITIES> candidates;
 
-		// never send entities that aren't linked in
-		if ( !ent->r.linked )
-		{
-			continue;
-		}
-
-		if ( ent->s.number != e )
-		{
-			Log::Debug( "FIXING ENT->S.NUMBER!!!" );
-			ent->s.number = e;
-		}
-
-		// entities can be flagged to explicitly not be sent to the client
-		if ( ent->r.svFlags & SVF_NOCLIENT )
+	for ( int cluster : entityIndex.occupiedClusters )
+	{
+		if ( clientpvs[ cluster >> 3 ] & ( 1 << ( cluster & 7 ) ) )
 		{
-			continue;
-		}
+			const int *clusterEntities = &entityIndex.clusterEntities[ entityIndex.clusterFirstEntity[ cluster ] ];
 
-		// entities can be flagged to be sent to only one client
-		if ( ent->r.svFlags & SVF_SINGLECLIENT )
-		{
-			if ( ent->r.singleClient != frame->ps.clientNum )
+			for ( i = 0; i < entityIndex.clusterNumEntities[ cluster ]; i++ )
 			{
-				continue;
+				candidates[ clusterEntities[ i ] ] = true;
 			}
 		}
+	}
 
-		// entities can be flagged to be sent to everyone but one client
-		if ( ent->r.svFlags & SVF_NOTSINGLECLIENT )
+	for ( int number : entityIndex.alwaysCheckedEntities )
+	{
+		candidates[ number ] = true;
+	}
+
+	// don't double add an entity through portals
+	candidates &= ~( eNums->considered | eNums->hidden );
+
+	for ( e = 0; e < sv.num_entities; e++ )
+	{
+		if ( !candidates[ e ] )
 		{
-			if ( ent->r.singleClient == frame->ps.clientNum )
-			{
-				continue;
-			}
+			continue;
 		}
 
-		// entities can be flagged to be sent to only a given mask of clients
-		if ( ent->r.svFlags & SVF_CLIENTMASK )
+		// an entity seen through a portal may have been added since
+		if ( eNums->considered[ e ] )
 		{
-			if ( frame->ps.clientNum >= 32 )
-			{
-				if ( ~ent->r.hiMask & ( 1 << ( frame->ps.clientNum - 32 ) ) )
-				{
-					continue;
-				}
-			}
-			else
-			{
-				if ( ~ent->r.loMask & ( 1 << frame->ps.clientNum ) )
-				{
-					continue;
-				}
-			}
+			continue;
 		}
 
-		svEnt = SV_SvEntityForGentity( ent );
+		ent = SV_GentityNum( e );
 
-		// don't double add an entity through portals
-		if ( svEnt->snapshotCounter == sv.snapshotCounter )
+		// the index is built once per frame, but dropping a client in the
+		// middle of it can unlink entities or stop them from being sent
+		if ( !ent->r.linked || ( ent->r.svFlags & SVF_NOCLIENT ) )
 		{
 			continue;
 		}
 
+		eNums->numCandidates++;
+
 		// broadcast entities are always sent
 		if ( ent->r.svFlags & SVF_BROADCAST )
 		{
-			SV_AddEntToSnapshot( playerEnt, svEnt, ent, eNums );
+			SV_AddEntToSnapshot( ent, eNums );
 			continue;
 		}
 
@@ -465,7 +1195,7 @@ static void SV_AddEntitiesVisibleFromPoint( vec3_t origin, clientSnapshot_t *fra
 		if ( (ent->r.svFlags & SVF_CLIENTS_IN_RANGE) &&
 		     Distance( ent->s.origin, playerEnt->s.origin ) <= ent->r.clientRadius )
 		{
-			SV_AddEntToSnapshot( playerEnt, svEnt, ent, eNums );
+			SV_AddEntToSnapshot( ent, eNums );
 			continue;
 		}
 
@@ -476,7 +1206,7 @@ static void SV_AddEntitiesVisibleFromPoint( vec3_t origin, clientSnapshot_t *fra
 		{
 			if ( bitvector[ ent->r.originCluster >> 3 ] & ( 1 << ( ent->r.originCluster & 7 ) ) )
 			{
-				SV_AddEntToSnapshot( playerEnt, svEnt, ent, eNums );
+				SV_AddEntToSnapshot( ent, eNums );
 			}
 
 			continue;
@@ -547,16 +1277,12 @@ static void SV_AddEntitiesVisibleFromPoint( vec3_t origin, clientSnapshot_t *fra
 
 			if ( ment )
 			{
-				svEntity_t *master = 0;
-
-				master = SV_SvEntityForGentity( ment );
-
-				if ( master->snapshotCounter == sv.snapshotCounter || !ment->r.linked )
+				if ( !ment->r.linked || eNums->considered[ ment->s.number ] )
 				{
 					continue;
 				}
 
-				SV_AddEntToSnapshot( playerEnt, master, ment, eNums );
+				SV_AddEntToSnapshot( ment, eNums );
 			}
 
 			continue; // master needs to be added, but not this dummy ent
@@ -567,7 +1293,6 @@ static void SV_AddEntitiesVisibleFromPoint( vec3_t origin, clientSnapshot_t *fra
 			{
 				int            h;
 				sharedEntity_t *ment = 0;
-				svEntity_t     *master = 0;
 
 				for ( h = 0; h < sv.num_entities; h++ )
 				{
@@ -578,39 +1303,24 @@ static void SV_AddEntitiesVisibleFromPoint( vec3_t origin, clientSnapshot_t *fra
 						continue;
 					}
 
-					if ( ment )
-					{
-						master = SV_SvEntityForGentity( ment );
-					}
-					else
-					{
-						continue;
-					}
-
 					if ( !( ment->r.linked ) )
 					{
 						continue;
 					}
 
-					if ( ment->s.number != h )
-					{
-						Log::Debug( "FIXING vis dummy multiple ment->S.NUMBER!!!" );
-						ment->s.number = h;
-					}
-
 					if ( ment->r.svFlags & SVF_NOCLIENT )
 					{
 						continue;
 					}
 
-					if ( master->snapshotCounter == sv.snapshotCounter )
+					if ( eNums->considered[ h ] )
 					{
 						continue;
 					}
 
 					if ( ment->s.otherEntityNum == ent->s.number )
 					{
-						SV_AddEntToSnapshot( playerEnt, master, ment, eNums );
+						SV_AddEntToSnapshot( ment, eNums );
 					}
 				}
 
@@ -619,7 +1329,7 @@ static void SV_AddEntitiesVisibleFromPoint( vec3_t origin, clientSnapshot_t *fra
 		}
 
 		// add it
-		SV_AddEntToSnapshot( playerEnt, svEnt, ent, eNums );
+		SV_AddEntToSnapshot( ent, eNums );
 
 		// if it's a portal entity, add everything visible from its camera position
 		if ( ent->r.svFlags & SVF_PORTAL )
@@ -654,29 +1364,28 @@ This properly handles multiple recursive portals, but the render
 currently doesn't.
 
 For viewing through other player's eyes, clent can be something other than client->gentity
+
+This only reads the world so snapshots of several clients can be built at
+the same time, SV_FinishClientSnapshot then has to be called in client order.
 =============
 */
-static void SV_BuildClientSnapshot( client_t *client )
+static void SV_BuildClientSnapshot( client_t *client, snapshotEntityNumbers_t *entityNumbers )
 {
 	vec3_t                  org;
 	clientSnapshot_t        *frame;
-	snapshotEntityNumbers_t entityNumbers;
 	int                     i;
-	sharedEntity_t          *ent;
-	entityState_t           *state;
-	svEntity_t              *svEnt;
 	sharedEntity_t          *clent;
 	int                     clientNum;
 	playerState_t           *ps;
 
-	// bump the counter used to prevent double adding
-	sv.snapshotCounter++;
-
 	// this is the frame we are creating
 	frame = &client->frames[ client->netchan.outgoingSequence & PACKET_MASK ];
 
 	// clear everything in this snapshot
-	entityNumbers.numSnapshotEntities = 0;
+	entityNumbers->numSnapshotEntities = 0;
+	entityNumbers->numCandidates = 0;
+	entityNumbers->considered.reset();
+	entityNumbers->hidden.reset();
 	Com_Memset( frame->areabits, 0, sizeof( frame->areabits ) );
 
 	// show_bug.cgi?id=62
@@ -702,9 +1411,15 @@ static void SV_BuildClientSnapshot( client_t *client )
 		Com_Error( errorParm_t::ERR_DROP, "SV_SvEntityForGentity: bad gEnt" );
 	}
 
-	svEnt = &sv.svEntities[ clientNum ];
+	entityNumbers->considered[ clientNum ] = true;
 
-	svEnt->snapshotCounter = sv.snapshotCounter;
+	for ( int number : entityIndex.restrictedEntities )
+	{
+		if ( SV_EntityHiddenFromClient( SV_GentityNum( number ), clientNum ) )
+		{
+			entityNumbers->hidden[ number ] = true;
+		}
+	}
 
 	if ( clent->r.svFlags & SVF_SELF_PORTAL_EXCLUSIVE )
 	{
@@ -720,14 +1435,7 @@ static void SV_BuildClientSnapshot( client_t *client )
 
 	// add all the entities directly visible to the eye, which
 	// may include portal entities that merge other viewpoints
-	SV_AddEntitiesVisibleFromPoint( org, frame, &entityNumbers /*, false, client->netchan.remoteAddress.type == NA_LOOPBACK */ );
-
-	// if there were portals visible, there may be out of order entities
-	// in the list which will need to be resorted for the delta compression
-	// to work correctly.  This also catches the error condition
-	// of an entity being included twice.
-	qsort( entityNumbers.snapshotEntities, entityNumbers.numSnapshotEntities,
-	       sizeof( entityNumbers.snapshotEntities[ 0 ] ), SV_QsortEntityNumbers );
+	SV_AddEntitiesVisibleFromPoint( org, frame, entityNumbers /*, false, client->netchan.remoteAddress.type == NA_LOOPBACK */ );
 
 	// now that all viewpoint's areabits have been OR'd together, invert
 	// all of them to make it a mask vector, which is what the renderer wants
@@ -735,14 +1443,52 @@ static void SV_BuildClientSnapshot( client_t *client )
 	{
 		( ( int * ) frame->areabits ) [ i ] = ( ( int * ) frame->areabits ) [ i ] ^ -1;
 	}
+}
+
+/*
+=============
+SV_FinishClientSnapshot
+
+Runs the snapshot callbacks of the game and copies the entity states out
+to the circular snapshot entity buffer.
+=============
+*/
+static void SV_FinishClientSnapshot( client_t *client, snapshotEntityNumbers_t *entityNumbers )
+{
+	clientSnapshot_t        *frame;
+	int                     i;
+	sharedEntity_t          *ent;
+	entityState_t           *state;
+
+	if ( !client->gentity || client->state == clientState_t::CS_ZOMBIE )
+	{
+		return;
+	}
+
+	frame = &client->frames[ client->netchan.outgoingSequence & PACKET_MASK ];
+
+	// the game sees the entities in the order they were found, and from
+	// the point of view of the player being followed
+	SV_FilterSnapshotEntities( SV_GentityNum( frame->ps.clientNum ), entityNumbers );
+
+	// if there were portals visible, there may be out of order entities
+	// in the list which will need to be resorted for the delta compression
+	// to work correctly.  This also catches the error condition
+	// of an entity being included twice.
+	qsort( entityNumbers->snapshotEntities, entityNumbers->numSnapshotEntities,
+	       sizeof( entityNumbers->snapshotEntities[ 0 ] ), SV_QsortEntityNumbers );
+
+	snapshotStats.snapshots++;
+	snapshotStats.candidates += entityNumbers->numCandidates;
+	snapshotStats.entities += entityNumbers->numSnapshotEntities;
 
 	// copy the entity states out
 	frame->num_entities = 0;
 	frame->first_entity = svs.nextSnapshotEntities;
 
-	for ( i = 0; i < entityNumbers.numSnapshotEntities; i++ )
+	for ( i = 0; i < entityNumbers->numSnapshotEntities; i++ )
 	{
-		ent = SV_GentityNum( entityNumbers.snapshotEntities[ i ] );
+		ent = SV_GentityNum( entityNumbers->snapshotEntities[ i ] );
 		state = &svs.snapshotEntities[ svs.nextSnapshotEntities % svs.numSnapshotEntities ];
 		*state = ent->s;
 		svs.nextSnapshotEntities++;
@@ -757,34 +1503,21 @@ static void SV_BuildClientSnapshot( client_t *client )
 	}
 }
 
+static const int HEADER_RATE_BYTES = 48; // include our header, IP header, and some overhead
+
 /*
 ====================
-SV_RateMsec
+SV_ClientRate
 
-Return the number of msec a given size message is supposed
-to take to clear, based on the current rate
+Return the rate of the client in bytes per second
 TTimo - use sv_maxRate or sv_dl_maxRate depending on regular or downloading client
 ====================
 */
-static const int HEADER_RATE_BYTES = 48; // include our header, IP header, and some overhead
-static int SV_RateMsec( client_t *client, int messageSize )
+static int SV_ClientRate( const client_t *client )
 {
 	int rate;
-	int rateMsec;
 	int maxRate;
 
-	// individual messages will never be larger than fragment size
-	if ( messageSize > 1500 )
-	{
-		messageSize = 1500;
-	}
-
-	// low watermark for sv_maxRate, never 0 < sv_maxRate < 1000 (0 is no limitation)
-	if ( sv_maxRate->integer && sv_maxRate->integer < 1000 )
-	{
-		Cvar_Set( "sv_MaxRate", "1000" );
-	}
-
 	rate = client->rate;
 
 	// work on the appropriate max rate (client or download)
@@ -805,11 +1538,63 @@ static int SV_RateMsec( client_t *client, int messageSize )
 		}
 	}
 
-	rateMsec = ( messageSize + HEADER_RATE_BYTES ) * 1000 / rate;
+	return rate;
+}
+
+/*
+====================
+SV_RateMsec
+
+Return the number of msec a given size message is supposed
+to take to clear, based on the current rate
+====================
+*/
+static int SV_RateMsec( client_t *client, int messageSize )
+{
+	int rateMsec;
+
+	// individual messages will never be larger than fragment size
+	if ( messageSize > 1500 )
+	{
+		messageSize = 1500;
+	}
+
+	// low watermark for sv_maxRate, never 0 < sv_maxRate < 1000 (0 is no limitation)
+	if ( sv_maxRate->integer && sv_maxRate->integer < 1000 )
+	{
+		Cvar_Set( "sv_MaxRate", "1000" );
+	}
+
+	rateMsec = ( messageSize + HEADER_RATE_BYTES ) * 1000 / SV_ClientRate( client );
 
 	return rateMsec;
 }
 
+/*
+====================
+SV_SnapshotBudget
+
+Return the size a snapshot can have without delaying the next one,
+0 if the client isn't limited by its rate
+====================
+*/
+static int SV_SnapshotBudget( const client_t *client )
+{
+	if ( client->netchan.remoteAddress.type == netadrtype_t::NA_LOOPBACK ||
+	     ( sv_lanForceRate->integer && Sys_IsLANAddress( client->netchan.remoteAddress ) ) )
+	{
+		return 0;
+	}
+
+	// downloads take what the snapshots leave anyway
+	if ( *client->downloadName )
+	{
+		return 0;
+	}
+
+	return std::max( 1, SV_ClientRate( client ) * client->snapshotMsec / 1000 - HEADER_RATE_BYTES );
+}
+
 /*
 =======================
 SV_SendMessageToClient
@@ -823,7 +1608,7 @@ void SV_SendMessageToClient( msg_t *msg, client_t *client )
 
 	// record information about the message
 	client->frames[ client->netchan.outgoingSequence & PACKET_MASK ].messageSize = msg->cursize;
-	client->frames[ client->netchan.outgoingSequence & PACKET_MASK ].messageSent = svs.time;
+	client->frames[ client->netchan.outgoingSequence & PACKET_MASK ].messageSent = Sys_Milliseconds();
 	client->frames[ client->netchan.outgoingSequence & PACKET_MASK ].messageAcked = -1;
 
 	// send the datagram
@@ -923,16 +1708,64 @@ void SV_SendClientIdle( client_t *client )
 
 /*
 =======================
-SV_SendClientSnapshot
+SV_WriteClientMessage
 
-Also called by SV_FinalCommand
+Writes the snapshot message of a client whose snapshot has been built,
+this doesn't touch anything shared so it can be done in parallel.
+=======================
+*/
+static void SV_WriteClientMessage( client_t *client, msg_t *msg, int nextSnapshotEntities )
+{
+	// NOTE, MRE: all server->client messages now acknowledge
+	// let the client know which reliable clientCommands we have received
+	MSG_WriteLong( msg, client->lastClientCommand );
+
+	// (re)send any reliable server commands
+	SV_UpdateServerCommandsToClient( client, msg );
 
+	// send over all the relevant entityState_t
+	// and the playerState_t
+	SV_WriteSnapshotToClient( client, msg, nextSnapshotEntities );
+}
+
+/*
+=======================
+SV_TransmitClientMessage
 =======================
 */
-void SV_SendClientSnapshot( client_t *client )
+static void SV_TransmitClientMessage( client_t *client, msg_t *msg )
+{
+	// Add any download data if the client is downloading
+	SV_WriteDownloadToClient( client, msg );
+
+	// check for overflow
+	if ( msg->overflowed )
+	{
+		Log::Warn("msg overflowed for %s", client->name );
+		MSG_Clear( msg );
+
+		SV_DropClient( client, "Msg overflowed" );
+		return;
+	}
+
+	SV_SendMessageToClient( msg, client );
+
+	sv.bpsTotalBytes += msg->cursize; // NERVE - SMF - net debugging
+	sv.ubpsTotalBytes += msg->uncompsize / 8; // NERVE - SMF - net debugging
+}
+
+/*
+=======================
+SV_SendIndexedClientSnapshot
+
+SV_SendClientSnapshot once the entity index of this frame has been built.
+=======================
+*/
+static void SV_SendIndexedClientSnapshot( client_t *client )
 {
 	byte  msg_buf[ MAX_MSGLEN ];
 	msg_t msg;
+	snapshotEntityNumbers_t entityNumbers;
 
 	//bani
 	if ( client->state < clientState_t::CS_ACTIVE )
@@ -947,7 +1780,8 @@ void SV_SendClientSnapshot( client_t *client )
 	}
 
 	// build the snapshot
-	SV_BuildClientSnapshot( client );
+	SV_BuildClientSnapshot( client, &entityNumbers );
+	SV_FinishClientSnapshot( client, &entityNumbers );
 
 	// bots need to have their snapshots built, but
 	// those are queried directly without needing to be sent
@@ -959,34 +1793,258 @@ void SV_SendClientSnapshot( client_t *client )
 	MSG_Init( &msg, msg_buf, sizeof( msg_buf ) );
 	msg.allowoverflow = true;
 
-	// NOTE, MRE: all server->client messages now acknowledge
-	// let the client know which reliable clientCommands we have received
-	MSG_WriteLong( &msg, client->lastClientCommand );
+	SV_WriteClientMessage( client, &msg, svs.nextSnapshotEntities );
+	SV_TransmitClientMessage( client, &msg );
+}
 
-	// (re)send any reliable server commands
-	SV_UpdateServerCommandsToClient( client, &msg );
+/*
+=======================
+SV_SendClientSnapshot
 
-	// send over all the relevant entityState_t
-	// and the playerState_t
-	SV_WriteSnapshotToClient( client, &msg );
+Also called by SV_FinalCommand
 
-	// Add any download data if the client is downloading
-	SV_WriteDownloadToClient( client, &msg );
+=======================
+*/
+void SV_SendClientSnapshot( client_t *client )
+{
+	SV_BuildEntityIndex();
+	SV_SendIndexedClientSnapshot( client );
+}
 
-	// check for overflow
-	if ( msg.overflowed )
+/*
+=======================
+SV_ClientNeedsMessage
+
+Whether a message should be sent to the client this frame.
+=======================
+*/
+static bool SV_ClientNeedsMessage( client_t *c )
+{
+	// rain - changed <= CS_ZOMBIE to < CS_ZOMBIE so that the
+	// disconnect reason is properly sent in the network stream
+	if ( c->state < clientState_t::CS_ZOMBIE )
 	{
-		Log::Warn("msg overflowed for %s", client->name );
-		MSG_Clear( &msg );
+		return false; // not connected
+	}
 
-		SV_DropClient( client, "Msg overflowed" );
+	// RF, needed to insert this otherwise bots would cause error drops in sv_net_chan.c:
+	// --> "netchan queue is not properly initialized in SV_Netchan_TransmitNextFragment\n"
+	if ( SV_IsBot(c) )
+	{
+		return false;
+	}
+
+	if ( svs.time < c->nextSnapshotTime )
+	{
+		return false; // not time yet
+	}
+
+	return true;
+}
+
+/*
+=======================
+SV_SendClientMessage
+=======================
+*/
+static void SV_SendClientMessage( client_t *c )
+{
+	// send additional message fragments if the last message
+	// was too large to send at once
+	if ( c->netchan.unsentFragments )
+	{
+		c->nextSnapshotTime = svs.time + SV_RateMsec( c, c->netchan.unsentLength - c->netchan.unsentFragmentStart );
+		SV_Netchan_TransmitNextFragment( c );
 		return;
 	}
 
-	SV_SendMessageToClient( &msg, client );
+	// generate and send a new message
+	SV_SendIndexedClientSnapshot( c );
+}
 
-	sv.bpsTotalBytes += msg.cursize; // NERVE - SMF - net debugging
-	sv.ubpsTotalBytes += msg.uncompsize / 8; // NERVE - SMF - net debugging
+/*
+=======================
+SV_SendClientMessagesFrom
+
+Sends the messages of the clients from the given one on, one after the other.
+Dropping a client runs game code, which can link, move or hide entities, so
+the entity index is rebuilt before the snapshots of the following clients.
+Returns the number of clients a message was sent to.
+=======================
+*/
+static int SV_SendClientMessagesFrom( client_t *first )
+{
+	int numclients = 0;
+
+	for ( client_t *c = first; c < svs.clients + sv_maxclients->integer; c++ )
+	{
+		if ( !SV_ClientNeedsMessage( c ) )
+		{
+			continue;
+		}
+
+		clientState_t state = c->state;
+
+		numclients++;
+		SV_SendClientMessage( c );
+
+		if ( c->state != state )
+		{
+			SV_BuildEntityIndex();
+		}
+	}
+
+	return numclients;
+}
+
+/*
+=============================================================================
+
+Parallel snapshots
+
+The snapshots of all the clients are built and encoded on the worker threads,
+only the parts that call into the game or touch shared state run on the main
+thread, in client order, so the result is the same as SV_SendClientMessage
+being called for each client in turn.
+
+=============================================================================
+*/
+
+struct snapshotTask_t
+{
+	client_t                *client;
+	snapshotEntityNumbers_t entityNumbers;
+	int                     firstSnapshotEntity; // svs.nextSnapshotEntities before this snapshot was added
+	int                     nextSnapshotEntities; // svs.nextSnapshotEntities after this snapshot was added
+	bool                    written;
+	msg_t                   msg;
+	byte                    msgBuffer[ MAX_MSGLEN ];
+};
+
+/*
+=======================
+SV_SendClientMessagesParallel
+
+Sends the messages of the given clients, which must be in increasing client
+number order and all need a message this frame.
+=======================
+*/
+static void SV_SendClientMessagesParallel( const std::vector<client_t *> &clients )
+{
+	// each task holds a whole message buffer, so keep them around between frames
+	static std::vector<snapshotTask_t> tasks;
+	static std::vector<int> clientTasks;
+
+	int numTasks = 0;
+
+	clientTasks.assign( clients.size(), -1 );
+
+	for ( size_t i = 0; i < clients.size(); i++ )
+	{
+		client_t *c = clients[ i ];
+
+		// fragments and idle messages are sent directly
+		if ( !c->netchan.unsentFragments &&
+		     ( c->state == clientState_t::CS_ACTIVE || c->state == clientState_t::CS_ZOMBIE ) )
+		{
+			clientTasks[ i ] = numTasks++;
+		}
+	}
+
+	if ( tasks.size() < static_cast<size_t>( numTasks ) )
+	{
+		tasks.resize( numTasks );
+	}
+
+	for ( size_t i = 0; i < clients.size(); i++ )
+	{
+		if ( clientTasks[ i ] >= 0 )
+		{
+			tasks[ clientTasks[ i ] ].client = clients[ i ];
+		}
+	}
+
+	snapshotPool.ParallelFor( numTasks, []( int i ) {
+		SV_BuildClientSnapshot( tasks[ i ].client, &tasks[ i ].entityNumbers );
+	} );
+
+	// upper bound of the number of entity states the remaining snapshots will add
+	int pendingEntities = 0;
+
+	for ( int i = 0; i < numTasks; i++ )
+	{
+		pendingEntities += tasks[ i ].entityNumbers.numSnapshotEntities;
+	}
+
+	for ( int i = 0; i < numTasks; i++ )
+	{
+		snapshotTask_t &task = tasks[ i ];
+		client_t       *c = task.client;
+
+		pendingEntities -= task.entityNumbers.numSnapshotEntities;
+
+		task.firstSnapshotEntity = svs.nextSnapshotEntities;
+		SV_FinishClientSnapshot( c, &task.entityNumbers );
+		task.nextSnapshotEntities = svs.nextSnapshotEntities;
+
+		MSG_Init( &task.msg, task.msgBuffer, sizeof( task.msgBuffer ) );
+		task.msg.allowoverflow = true;
+
+		// if the following snapshots might overwrite the entities this one
+		// is delta compressed against, it has to be written right away
+		task.written = false;
+
+		if ( c->deltaMessage > 0 &&
+		     c->frames[ c->deltaMessage & PACKET_MASK ].first_entity <=
+		     svs.nextSnapshotEntities + pendingEntities - svs.numSnapshotEntities )
+		{
+			SV_WriteClientMessage( c, &task.msg, task.nextSnapshotEntities );
+			task.written = true;
+		}
+	}
+
+	snapshotPool.ParallelFor( numTasks, []( int i ) {
+		if ( !tasks[ i ].written )
+		{
+			SV_WriteClientMessage( tasks[ i ].client, &tasks[ i ].msg, tasks[ i ].nextSnapshotEntities );
+		}
+	} );
+
+	for ( size_t i = 0; i < clients.size(); i++ )
+	{
+		client_t      *c = clients[ i ];
+		clientState_t state = c->state;
+
+		if ( clientTasks[ i ] >= 0 )
+		{
+			SV_TransmitClientMessage( c, &tasks[ clientTasks[ i ] ].msg );
+		}
+		else
+		{
+			SV_SendClientMessage( c );
+		}
+
+		if ( c->state == state )
+		{
+			continue;
+		}
+
+		// the client was dropped, which runs game code that can change what
+		// the following clients see: forget about their prepared messages
+		// and send them the serial way
+		for ( size_t j = i + 1; j < clients.size(); j++ )
+		{
+			if ( clientTasks[ j ] >= 0 )
+			{
+				svs.nextSnapshotEntities = tasks[ clientTasks[ j ] ].firstSnapshotEntity;
+				break;
+			}
+		}
+
+		SV_BuildEntityIndex();
+		SV_SendClientMessagesFrom( c + 1 );
+		return;
+	}
 }
 
 /*
@@ -997,9 +2055,8 @@ SV_SendClientMessages
 
 void SV_SendClientMessages()
 {
-	int      i;
-	client_t *c;
-	int      numclients = 0; // NERVE - SMF - net debugging
+	int i;
+	int numclients = 0; // NERVE - SMF - net debugging
 
 	sv.bpsTotalBytes = 0; // NERVE - SMF - net debugging
 	sv.ubpsTotalBytes = 0; // NERVE - SMF - net debugging
@@ -1007,43 +2064,65 @@ void SV_SendClientMessages()
 	// Gordon: update any changed configstrings from this frame
 	SV_UpdateConfigStrings();
 
-	// send a message to each connected client
-	for ( i = 0; i < sv_maxclients->integer; i++ )
+	Sys::SteadyClock::time_point startTime = Sys::SteadyClock::now();
+	snapshotStats.snapshots = 0;
+	snapshotStats.candidates = 0;
+	snapshotStats.entities = 0;
+
+	SV_BuildEntityIndex();
+	SV_ClearDeltaCache();
+	heldBackEntities = 0;
+
+	// hand the messages of the frame to the network layer together, also
+	// when a client drop throws out of here
+	struct packetBatchGuard_t
 	{
-		c = &svs.clients[ i ];
+		packetBatchGuard_t() { NET_BeginPacketBatch(); }
+		~packetBatchGuard_t() { NET_EndPacketBatch(); }
+	} packetBatchGuard;
 
-		// rain - changed <= CS_ZOMBIE to < CS_ZOMBIE so that the
-		// disconnect reason is properly sent in the network stream
-		if ( c->state < clientState_t::CS_ZOMBIE )
-		{
-			continue; // not connected
-		}
+	snapshotPool.SetNumThreads( cvar_server_snapshot_threads.Get() );
 
-		// RF, needed to insert this otherwise bots would cause error drops in sv_net_chan.c:
-		// --> "netchan queue is not properly initialized in SV_Netchan_TransmitNextFragment\n"
-		if ( SV_IsBot(c) )
-		{
-			continue;
-		}
+	if ( snapshotPool.GetNumThreads() > 0 )
+	{
+		static std::vector<client_t *> clients;
 
-		if ( svs.time < c->nextSnapshotTime )
+		clients.clear();
+
+		for ( i = 0; i < sv_maxclients->integer; i++ )
 		{
-			continue; // not time yet
+			if ( SV_ClientNeedsMessage( &svs.clients[ i ] ) )
+			{
+				clients.push_back( &svs.clients[ i ] );
+			}
 		}
 
-		numclients++; // NERVE - SMF - net debugging
+		numclients = clients.size(); // NERVE - SMF - net debugging
 
-		// send additional message fragments if the last message
-		// was too large to send at once
-		if ( c->netchan.unsentFragments )
+		SV_SendClientMessagesParallel( clients );
+	}
+	else
+	{
+		// send a message to each connected client
+		numclients = SV_SendClientMessagesFrom( svs.clients ); // NERVE - SMF - net debugging
+	}
+
+	if ( cvar_server_snapshot_showStats.Get() && snapshotStats.snapshots > 0 )
+	{
+		auto duration = std::chrono::duration_cast<std::chrono::microseconds>( Sys::SteadyClock::now() - startTime );
+		int  deltaLookups = 0;
+		int  deltaHits = 0;
+
+		for ( const deltaCacheShard_t &shard : deltaCacheShards )
 		{
-			c->nextSnapshotTime = svs.time + SV_RateMsec( c, c->netchan.unsentLength - c->netchan.unsentFragmentStart );
-			SV_Netchan_TransmitNextFragment( c );
-			continue;
+			deltaLookups += shard.lookups;
+			deltaHits += shard.hits;
 		}
 
-		// generate and send a new message
-		SV_SendClientSnapshot( c );
+		Log::Notice( "%d snapshots: %d/%d entities checked, %d sent, %d/%d deltas cached, %d held back, %dus",
+		             snapshotStats.snapshots, snapshotStats.candidates, snapshotStats.snapshots * sv.num_entities,
+		             snapshotStats.entities, deltaHits, deltaLookups, heldBackEntities.load(),
+		             static_cast<int>( duration.count() ) );
 	}
 
 	// NERVE - SMF - net debugging